@@ -0,0 +1,853 @@
+/*
+  Copyright (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+/* Throughput benchmark for the parser, the printers and the utils.
+ *
+ *   sbjson_bench [--json FILE] [--min-time SECONDS] [--quick] [FILE...]
+ *
+ * Every operation runs on every document of the built-in corpus, plus the
+ * JSON files given on the command line (e.g. the real twitter.json,
+ * citm_catalog.json and canada.json), until it took --min-time seconds. The
+ * median run is reported as MB/s of the document (of the printed text for the
+ * printers), or ns per lookup for the pointers, together with the allocations
+ * one run makes. --json writes the same results as a JSON document for
+ * tracking regressions, --quick shrinks the corpus to a smoke test. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../sbjson.h"
+#include "../sbjson_utils.h"
+
+/* Growable text the corpus is generated into */
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} text;
+
+static void append(text *const output, char const *const format, ...) {
+    va_list arguments;
+    int length = 0;
+
+    for (;;) {
+        va_start(arguments, format);
+        length = vsnprintf(output->data + output->length,
+                           output->capacity - output->length, format,
+                           arguments);
+        va_end(arguments);
+        if ((length >= 0) &&
+            ((size_t)length < output->capacity - output->length)) {
+            break;
+        }
+
+        output->capacity =
+            (output->capacity == 0) ? 4096 : output->capacity * 2;
+        output->data = (char *)realloc(output->data, output->capacity);
+        if (output->data == NULL) {
+            fputs("out of memory\n", stderr);
+            exit(EXIT_FAILURE);
+        }
+    }
+    output->length += (size_t)length;
+}
+
+/* Deterministic pseudo random numbers, so every run sees the same corpus */
+static unsigned long long random_state = 0x853c49e6748fea9bULL;
+
+static unsigned long next_random(void) {
+    random_state =
+        random_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned long)(random_state >> 33);
+}
+
+static char const *const words[] = {
+    "the",     "quick",  "brown",      "fox",    "jumps",  "over",
+    "lazy",    "dog",    "\xC3\xA9t\xC3\xA9", "\xE6\x9D\xB1\xE4\xBA\xAC",
+    "json",    "parser", "\\\"quoted\\\"", "tab\\there", "line\\nbreak",
+    "\\u00fcber", "emoji \\ud83d\\ude00", "#hashtag", "@mention",
+    "https:\\/\\/example.com\\/path"};
+#define word_count (sizeof(words) / sizeof(words[0]))
+
+static void append_sentence(text *const output, size_t const length) {
+    size_t i = 0;
+
+    for (i = 0; i < length; i++) {
+        append(output, (i == 0) ? "%s" : " %s",
+               words[next_random() % word_count]);
+    }
+}
+
+/* Tweets as returned by the search API: nested objects of mixed values */
+static void generate_twitter(text *const output, size_t const scale) {
+    size_t i = 0;
+    size_t j = 0;
+
+    append(output, "{\"statuses\":[");
+    for (i = 0; i < scale * 2; i++) {
+        unsigned long long const id = 505874924095815681ULL + next_random();
+        size_t const hashtags = next_random() % 4;
+
+        append(output, "%s{\"metadata\":{\"result_type\":\"recent\","
+                       "\"iso_language_code\":\"%s\"},",
+               (i == 0) ? "" : ",", (i % 3 == 0) ? "ja" : "en");
+        append(output, "\"created_at\":\"Sun Aug 31 00:29:%02lu +0000 2014\","
+                       "\"id\":%llu,\"id_str\":\"%llu\",\"text\":\"",
+               next_random() % 60, id, id);
+        append_sentence(output, 8 + next_random() % 16);
+        append(output, "\",\"source\":\"<a href=\\\"https:\\/\\/mobile.twitter"
+                       ".com\\\" rel=\\\"nofollow\\\">Mobile Web<\\/a>\","
+                       "\"truncated\":false,\"in_reply_to_status_id\":null,"
+                       "\"user\":{\"id\":%lu,\"name\":\"",
+               next_random());
+        append_sentence(output, 2);
+        append(output, "\",\"screen_name\":\"user%lu\",\"location\":\"\","
+                       "\"description\":\"",
+               next_random() % 100000);
+        append_sentence(output, next_random() % 24);
+        append(output, "\",\"protected\":false,\"followers_count\":%lu,"
+                       "\"friends_count\":%lu,\"created_at\":\"Sat Feb 18 "
+                       "23:16:42 +0000 2012\",\"utc_offset\":%s,"
+                       "\"verified\":false,\"profile_background_color\":"
+                       "\"C0DEED\",\"default_profile\":true},",
+               next_random() % 10000, next_random() % 1000,
+               (i % 2 == 0) ? "null" : "32400");
+        append(output, "\"geo\":null,\"coordinates\":null,\"place\":null,"
+                       "\"retweet_count\":%lu,\"favorite_count\":%lu,"
+                       "\"entities\":{\"hashtags\":[",
+               next_random() % 100, next_random() % 100);
+        for (j = 0; j < hashtags; j++) {
+            append(output, "%s{\"text\":\"%s\",\"indices\":[%lu,%lu]}",
+                   (j == 0) ? "" : ",", words[next_random() % word_count],
+                   (unsigned long)j * 10, (unsigned long)j * 10 + 8);
+        }
+        append(output, "],\"symbols\":[],\"urls\":[],\"user_mentions\":[]},"
+                       "\"favorited\":false,\"retweeted\":false,"
+                       "\"lang\":\"%s\"}",
+               (i % 3 == 0) ? "ja" : "en");
+    }
+    append(output, "],\"search_metadata\":{\"completed_in\":0.087,"
+                   "\"max_id\":505874924095815681,\"query\":\"%%E4%%B8%%80\","
+                   "\"count\":%lu,\"since_id\":0}}",
+           (unsigned long)(scale * 2));
+}
+
+/* Event catalog: objects keyed by ids, small integer arrays and nulls */
+static void generate_citm(text *const output, size_t const scale) {
+    size_t i = 0;
+    size_t j = 0;
+
+    append(output, "{\"areaNames\":{");
+    for (i = 0; i < scale / 4 + 1; i++) {
+        append(output, "%s\"%lu\":\"", (i == 0) ? "" : ",",
+               (unsigned long)(205705993 + i));
+        append_sentence(output, 2);
+        append(output, "\"");
+    }
+    append(output, "},\"events\":{");
+    for (i = 0; i < scale; i++) {
+        unsigned long const id = 138586341 + (unsigned long)i;
+        append(output, "%s\"%lu\":{\"description\":null,\"id\":%lu,"
+                       "\"logo\":%s,\"name\":\"",
+               (i == 0) ? "" : ",", id, id,
+               (i % 4 == 0) ? "\"\\/images\\/UE0AAAAACEKo6QAAAAZDSVRN\""
+                            : "null");
+        append_sentence(output, 3);
+        append(output, "\",\"subTopicIds\":[337184269,337184283],"
+                       "\"subjectCode\":null,\"subtitle\":null,"
+                       "\"topicIds\":[324846099,107888604]}");
+    }
+    append(output, "},\"performances\":[");
+    for (i = 0; i < scale * 2; i++) {
+        append(output, "%s{\"eventId\":%lu,\"id\":%lu,\"logo\":null,"
+                       "\"name\":null,\"prices\":[",
+               (i == 0) ? "" : ",", 138586341 + next_random() % (scale + 1),
+               339887544 + (unsigned long)i);
+        for (j = 0; j < 3; j++) {
+            append(output, "%s{\"amount\":%lu,\"audienceSubCategoryId\":"
+                           "337100890,\"seatCategoryId\":%lu}",
+                   (j == 0) ? "" : ",", 10000 + next_random() % 90000,
+                   338937295 + j);
+        }
+        append(output, "],\"seatCategories\":[{\"areas\":[{\"areaId\":"
+                       "205705999,\"blockIds\":[]},{\"areaId\":205705998,"
+                       "\"blockIds\":[]}],\"seatCategoryId\":338937295}],"
+                       "\"seatMapImage\":null,\"start\":%llu,"
+                       "\"venueCode\":\"PLEYEL_PLEYEL\"}",
+               1372701600000ULL + next_random() * 1000ULL);
+    }
+    append(output, "],\"venueNames\":{\"PLEYEL_PLEYEL\":\"Salle Pleyel\"}}");
+}
+
+/* GeoJSON polygon: deeply packed arrays of long doubles */
+static void generate_canada(text *const output, size_t const scale) {
+    size_t ring = 0;
+    size_t i = 0;
+
+    append(output, "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":"
+                   "\"Feature\",\"properties\":{\"name\":\"Canada\"},"
+                   "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[");
+    for (ring = 0; ring < scale / 8 + 1; ring++) {
+        append(output, "%s[", (ring == 0) ? "" : ",");
+        for (i = 0; i < 100; i++) {
+            append(output, "%s[%.15f,%.15f]", (i == 0) ? "" : ",",
+                   -141.0 + (double)next_random() / 17000000.0,
+                   41.0 + (double)next_random() / 50000000.0);
+        }
+        append(output, "]");
+    }
+    append(output, "]}}]}");
+}
+
+/* Objects and arrays nested close to the nesting limit */
+static void generate_deep(text *const output, size_t const scale) {
+    size_t const depth = (SBJSON_NESTING_LIMIT - 2) / 2;
+    size_t i = 0;
+    size_t level = 0;
+
+    append(output, "[");
+    for (i = 0; i < scale / 4 + 1; i++) {
+        append(output, (i == 0) ? "" : ",");
+        for (level = 0; level < depth; level++) {
+            append(output, "{\"level%lu\":[%lu,", (unsigned long)level,
+                   (unsigned long)level);
+        }
+        append(output, "null");
+        for (level = 0; level < depth; level++) {
+            append(output, "]}");
+        }
+    }
+    append(output, "]");
+}
+
+/* Long strings with escapes and multibyte characters */
+static void generate_strings(text *const output, size_t const scale) {
+    size_t i = 0;
+
+    append(output, "[");
+    for (i = 0; i < scale * 4; i++) {
+        append(output, "%s\"", (i == 0) ? "" : ",");
+        append_sentence(output, 16 + next_random() % 64);
+        append(output, "\"");
+    }
+    append(output, "]");
+}
+
+/* Integers and doubles of every magnitude */
+static void generate_numbers(text *const output, size_t const scale) {
+    size_t i = 0;
+
+    append(output, "[");
+    for (i = 0; i < scale * 64; i++) {
+        unsigned long const value = next_random();
+        switch (value % 4) {
+        case 0:
+            append(output, "%s%lu", (i == 0) ? "" : ",", value % 1000);
+            break;
+        case 1:
+            append(output, "%s-%lu%lu", (i == 0) ? "" : ",", value,
+                   next_random());
+            break;
+        case 2:
+            append(output, "%s%.17g", (i == 0) ? "" : ",",
+                   (double)value / 3.0);
+            break;
+        default:
+            append(output, "%s%.6e", (i == 0) ? "" : ",",
+                   (double)value * 1e-30);
+            break;
+        }
+    }
+    append(output, "]");
+}
+
+/* One array of many small values of every type */
+static void generate_flat_array(text *const output, size_t const scale) {
+    static char const *const values[] = {"true", "false", "null", "0", "\"\"",
+                                         "{}", "[]", "\"short\"", "-1.5"};
+    size_t i = 0;
+
+    append(output, "[");
+    for (i = 0; i < scale * 128; i++) {
+        append(output, "%s%s", (i == 0) ? "" : ",",
+               values[next_random() % (sizeof(values) / sizeof(values[0]))]);
+    }
+    append(output, "]");
+}
+
+/* One object of many members */
+static void generate_flat_object(text *const output, size_t const scale) {
+    size_t i = 0;
+
+    append(output, "{");
+    for (i = 0; i < scale * 64; i++) {
+        append(output, "%s\"member_%lu\":%lu", (i == 0) ? "" : ",",
+               (unsigned long)i, next_random() % 100000);
+    }
+    append(output, "}");
+}
+
+typedef struct {
+    char const *name;
+    void (*generate)(text *const output, size_t const scale);
+} generator;
+
+static generator const corpus[] = {
+    {"twitter", generate_twitter},
+    {"citm_catalog", generate_citm},
+    {"canada", generate_canada},
+    {"deep_nesting", generate_deep},
+    {"strings", generate_strings},
+    {"numbers", generate_numbers},
+    {"flat_array", generate_flat_array},
+    {"flat_object", generate_flat_object},
+};
+
+static char *read_file(char const *const path, size_t *const length) {
+    FILE *file = fopen(path, "rb");
+    char *content = NULL;
+    long size = 0;
+
+    if (file == NULL) {
+        return NULL;
+    }
+    if ((fseek(file, 0, SEEK_END) == 0) && ((size = ftell(file)) >= 0) &&
+        (fseek(file, 0, SEEK_SET) == 0)) {
+        content = (char *)malloc((size_t)size + sizeof(""));
+    }
+    if ((content != NULL) &&
+        (fread(content, 1, (size_t)size, file) != (size_t)size)) {
+        free(content);
+        content = NULL;
+    }
+    fclose(file);
+
+    if (content != NULL) {
+        content[size] = '\0';
+        *length = (size_t)size;
+    }
+    return content;
+}
+
+/* A document and everything the operations work on, prepared untimed */
+typedef struct {
+    char const *name;
+    char *json;
+    size_t length;
+    size_t printed_length;
+    size_t unformatted_length;
+    sbJSON *tree;
+    sbJSON *copy;
+    /* tree with a few values changed, and the patches between them */
+    sbJSON *target;
+    sbJSON *patches;
+    sbJSON *merge_patch;
+    char **pointers;
+    size_t pointer_count;
+    size_t pointer_capacity;
+    /* per run */
+    char *scratch;
+    sbJSON *from;
+    sbJSON *to;
+    sbJSON *result;
+    char *printed;
+} document;
+
+static size_t count_leaves(sbJSON const *const item) {
+    sbJSON const *child = NULL;
+    size_t leaves = 0;
+
+    if (!sbj_is_array(item) && !sbj_is_object(item)) {
+        return 1;
+    }
+    sbJSON_ArrayForEach(child, item) { leaves += count_leaves(child); }
+
+    return leaves;
+}
+
+/* Collects pointers to every stride-th leaf, escaping names as RFC6901
+ * requires */
+static void collect_pointers(document *const doc, sbJSON const *const item,
+                             text *const path, size_t *const counter,
+                             size_t const stride) {
+    size_t const length = path->length;
+    sbJSON const *child = NULL;
+    size_t index = 0;
+
+    if (!sbj_is_array(item) && !sbj_is_object(item)) {
+        if ((*counter)++ % stride != 0) {
+            return;
+        }
+        if (doc->pointer_count == doc->pointer_capacity) {
+            doc->pointer_capacity =
+                (doc->pointer_capacity == 0) ? 64 : doc->pointer_capacity * 2;
+            doc->pointers = (char **)realloc(
+                doc->pointers, doc->pointer_capacity * sizeof(char *));
+        }
+        doc->pointers[doc->pointer_count] = (char *)malloc(path->length + 1);
+        memcpy(doc->pointers[doc->pointer_count], path->data, path->length);
+        doc->pointers[doc->pointer_count++][path->length] = '\0';
+        return;
+    }
+
+    sbJSON_ArrayForEach(child, item) {
+        if (sbj_is_object(item)) {
+            char const *name = child->string;
+            append(path, "/");
+            for (; *name != '\0'; name++) {
+                append(path, (*name == '~')   ? "~0"
+                             : (*name == '/') ? "~1"
+                                              : "%c",
+                       *name);
+            }
+        } else {
+            append(path, "/%lu", (unsigned long)index);
+        }
+        collect_pointers(doc, child, path, counter, stride);
+        path->length = length;
+        path->data[length] = '\0';
+        index++;
+    }
+}
+
+/* Changes every stride-th leaf, so there is something to diff and patch */
+static void change_leaves(sbJSON *const item, size_t *const counter,
+                          size_t const stride) {
+    sbJSON *child = NULL;
+
+    sbJSON_ArrayForEach(child, item) {
+        if (sbj_is_array(child) || sbj_is_object(child)) {
+            change_leaves(child, counter, stride);
+        } else if ((*counter)++ % stride == 0) {
+            sbJSON *const replacement = sbj_create_integer_number(
+                (int64_t)*counter);
+            if (sbj_is_object(item)) {
+                sbj_replace_item_in_object(item, child->string, replacement);
+            } else {
+                sbj_replace_item_via_pointer(item, child, replacement);
+            }
+            return; /* child is gone, continue with the next container */
+        }
+    }
+}
+
+static void setup_copies(document *const doc);
+static void teardown(document *const doc);
+
+static bool prepare_document(document *const doc) {
+    text path = {NULL, 0, 0};
+    size_t leaves = 0;
+    size_t counter = 0;
+    sbJSON *check = NULL;
+    char *printed = NULL;
+    bool matches = false;
+
+    doc->tree = sbj_parse_with_length(doc->json, doc->length);
+    if (doc->tree == NULL) {
+        fprintf(stderr, "%s: invalid JSON near byte %lu\n", doc->name,
+                (unsigned long)(sbJSON_GetErrorPtr() - doc->json));
+        return false;
+    }
+    doc->copy = sbj_duplicate(doc->tree, true);
+
+    printed = sbj_print(doc->tree);
+    doc->printed_length = strlen(printed);
+    sbJSON_free(printed);
+    printed = sbj_print_unformatted(doc->tree);
+    doc->unformatted_length = strlen(printed);
+    sbJSON_free(printed);
+
+    /* about a thousand lookups, spread over the document */
+    leaves = count_leaves(doc->tree);
+    append(&path, "");
+    collect_pointers(doc, doc->tree, &path, &counter, leaves / 1024 + 1);
+    free(path.data);
+
+    /* a handful of changes, spread over the document */
+    doc->target = sbj_duplicate(doc->tree, true);
+    counter = 0;
+    change_leaves(doc->target, &counter, leaves / 64 + 1);
+    doc->patches = sbJSONUtils_Diff(doc->tree, doc->target);
+    /* generating a merge patch sorts both sides */
+    setup_copies(doc);
+    doc->merge_patch = sbJSONUtils_GenerateMergePatch(doc->from, doc->to);
+    teardown(doc);
+
+    /* the patches have to reproduce the target */
+    check = sbj_duplicate(doc->tree, true);
+    matches = (sbJSONUtils_ApplyPatches(check, doc->patches) == 0) &&
+              sbj_compare(check, doc->target);
+    sbj_delete(check);
+    if (!matches) {
+        fprintf(stderr, "%s: patches don't reproduce the target\n", doc->name);
+        return false;
+    }
+
+    doc->scratch = (char *)malloc(doc->length + sizeof(""));
+    return (doc->copy != NULL) && (doc->patches != NULL) &&
+           (doc->scratch != NULL);
+}
+
+static void release_document(document *const doc) {
+    size_t i = 0;
+
+    for (i = 0; i < doc->pointer_count; i++) {
+        free(doc->pointers[i]);
+    }
+    free(doc->pointers);
+    free(doc->scratch);
+    free(doc->json);
+    sbj_delete(doc->merge_patch);
+    sbj_delete(doc->patches);
+    sbj_delete(doc->target);
+    sbj_delete(doc->copy);
+    sbj_delete(doc->tree);
+}
+
+/* An operation: setup and teardown around every run are not timed, run
+ * returns how many bytes (or lookups) it processed. */
+typedef struct {
+    char const *name;
+    void (*setup)(document *const doc);
+    size_t (*run)(document *const doc);
+    void (*teardown)(document *const doc);
+    bool lookups; /* run counts lookups instead of bytes */
+} operation;
+
+static volatile bool sink = false;
+
+static size_t run_parse(document *const doc) {
+    doc->result = sbj_parse(doc->json);
+    return doc->length;
+}
+
+static size_t run_print(document *const doc) {
+    doc->printed = sbj_print(doc->tree);
+    return doc->printed_length;
+}
+
+static size_t run_print_unformatted(document *const doc) {
+    doc->printed = sbj_print_unformatted(doc->tree);
+    return doc->unformatted_length;
+}
+
+static void setup_minify(document *const doc) {
+    memcpy(doc->scratch, doc->json, doc->length + sizeof(""));
+}
+
+static size_t run_minify(document *const doc) {
+    sbj_minify(doc->scratch);
+    return doc->length;
+}
+
+static size_t run_duplicate(document *const doc) {
+    doc->result = sbj_duplicate(doc->tree, true);
+    return doc->length;
+}
+
+static size_t run_compare(document *const doc) {
+    sink = sbj_compare(doc->tree, doc->copy);
+    return doc->length;
+}
+
+static size_t run_get_pointer(document *const doc) {
+    size_t i = 0;
+
+    for (i = 0; i < doc->pointer_count; i++) {
+        sink = sbJSONUtils_GetPointer(doc->tree, doc->pointers[i]) != NULL;
+    }
+    return doc->pointer_count;
+}
+
+static size_t run_diff(document *const doc) {
+    doc->result = sbJSONUtils_Diff(doc->tree, doc->target);
+    return doc->length;
+}
+
+/* generating sorts both sides, so it gets copies */
+static void setup_copies(document *const doc) {
+    doc->from = sbj_duplicate(doc->tree, true);
+    doc->to = sbj_duplicate(doc->target, true);
+}
+
+static size_t run_generate_patches(document *const doc) {
+    doc->result = sbJSONUtils_GeneratePatches(doc->from, doc->to);
+    return doc->length;
+}
+
+static size_t run_generate_merge_patch(document *const doc) {
+    doc->result = sbJSONUtils_GenerateMergePatch(doc->from, doc->to);
+    return doc->length;
+}
+
+static void setup_result(document *const doc) {
+    doc->result = sbj_duplicate(doc->tree, true);
+}
+
+static size_t run_apply_patches(document *const doc) {
+    sink = sbJSONUtils_ApplyPatches(doc->result, doc->patches) == 0;
+    return doc->length;
+}
+
+static size_t run_merge_patch(document *const doc) {
+    doc->result = sbJSONUtils_MergePatch(doc->result, doc->merge_patch);
+    return doc->length;
+}
+
+static void teardown(document *const doc) {
+    sbj_delete(doc->result);
+    sbj_delete(doc->from);
+    sbj_delete(doc->to);
+    sbJSON_free(doc->printed);
+    doc->result = NULL;
+    doc->from = NULL;
+    doc->to = NULL;
+    doc->printed = NULL;
+}
+
+static operation const operations[] = {
+    {"parse", NULL, run_parse, teardown, false},
+    {"print", NULL, run_print, teardown, false},
+    {"print_unformatted", NULL, run_print_unformatted, teardown, false},
+    {"minify", setup_minify, run_minify, teardown, false},
+    {"duplicate", NULL, run_duplicate, teardown, false},
+    {"compare", NULL, run_compare, teardown, false},
+    {"get_pointer", NULL, run_get_pointer, teardown, true},
+    {"diff", NULL, run_diff, teardown, false},
+    {"generate_patches", setup_copies, run_generate_patches, teardown, false},
+    {"apply_patches", setup_result, run_apply_patches, teardown, false},
+    {"generate_merge_patch", setup_copies, run_generate_merge_patch, teardown,
+     false},
+    {"merge_patch", setup_result, run_merge_patch, teardown, false},
+};
+
+/* Allocations are counted in one extra run with counting hooks, without
+ * realloc there, so growing buffers counts as allocations too. */
+static size_t allocations = 0;
+
+static void *counting_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+static int compare_seconds(void const *a, void const *b) {
+    double const left = *(double const *)a;
+    double const right = *(double const *)b;
+    return (left > right) - (left < right);
+}
+
+#define max_runs 10000
+
+typedef struct {
+    size_t runs;
+    double median;
+    double best;
+    size_t units;
+    size_t allocations;
+} measurement;
+
+static measurement measure(operation const *const op, document *const doc,
+                           double const min_time) {
+    static double seconds[max_runs];
+    sbJSON_Hooks hooks = {counting_malloc, free};
+    measurement result = {0, 0, 0, 0, 0};
+    double total = 0;
+
+    /* the warm up run counts the allocations */
+    sbJSON_InitHooks(&hooks);
+    if (op->setup != NULL) {
+        op->setup(doc);
+    }
+    allocations = 0;
+    result.units = op->run(doc);
+    result.allocations = allocations;
+    op->teardown(doc);
+    sbJSON_InitHooks(NULL);
+
+    while ((result.runs < 3) ||
+           ((total < min_time) && (result.runs < max_runs))) {
+        double start = 0;
+
+        if (op->setup != NULL) {
+            op->setup(doc);
+        }
+        start = now();
+        op->run(doc);
+        seconds[result.runs] = now() - start;
+        total += seconds[result.runs++];
+        op->teardown(doc);
+    }
+
+    qsort(seconds, result.runs, sizeof(seconds[0]), compare_seconds);
+    result.median = seconds[result.runs / 2];
+    result.best = seconds[0];
+
+    return result;
+}
+
+static void usage(char const *const program) {
+    fprintf(stderr,
+            "usage: %s [--json FILE] [--min-time SECONDS] [--quick] "
+            "[FILE...]\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    document documents[sizeof(corpus) / sizeof(corpus[0]) + 64];
+    size_t document_count = 0;
+    char const *json_path = NULL;
+    double min_time = 0.5;
+    size_t scale = 400;
+    sbJSON *report = sbj_create_object();
+    sbJSON *results = sbj_add_array_to_object(report, "results");
+    size_t d = 0;
+    size_t o = 0;
+    int i = 0;
+    int status = EXIT_SUCCESS;
+
+    memset(documents, 0, sizeof(documents));
+    for (i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--json") == 0) && (i + 1 < argc)) {
+            json_path = argv[++i];
+        } else if ((strcmp(argv[i], "--min-time") == 0) && (i + 1 < argc)) {
+            min_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            scale = 4;
+            min_time = 0;
+        } else if ((argv[i][0] == '-') ||
+                   (document_count ==
+                    sizeof(documents) / sizeof(documents[0]) -
+                        sizeof(corpus) / sizeof(corpus[0]))) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            document *const doc = &documents[document_count++];
+            char const *const slash = strrchr(argv[i], '/');
+            doc->name = (slash != NULL) ? slash + 1 : argv[i];
+            doc->json = read_file(argv[i], &doc->length);
+            if (doc->json == NULL) {
+                fprintf(stderr, "can't read %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    for (d = 0; d < sizeof(corpus) / sizeof(corpus[0]); d++) {
+        document *const doc = &documents[document_count++];
+        text output = {NULL, 0, 0};
+        corpus[d].generate(&output, scale);
+        doc->name = corpus[d].name;
+        doc->json = output.data;
+        doc->length = output.length;
+    }
+
+    sbj_add_double_number_to_object(report, "min_time", min_time);
+    sbj_add_integer_number_to_object(report, "scale", (int64_t)scale);
+
+    printf("%-20s %-20s %10s %12s %12s %14s\n", "document", "operation",
+           "bytes", "MB/s", "ns/lookup", "allocations");
+    for (d = 0; d < document_count; d++) {
+        document *const doc = &documents[d];
+
+        if (!prepare_document(doc)) {
+            status = EXIT_FAILURE;
+            release_document(doc);
+            continue;
+        }
+
+        for (o = 0; o < sizeof(operations) / sizeof(operations[0]); o++) {
+            operation const *const op = &operations[o];
+            measurement const result = measure(op, doc, min_time);
+            sbJSON *const entry = sbj_create_object();
+            double const mb_per_s =
+                (result.median > 0)
+                    ? (double)result.units / result.median / 1e6
+                    : 0;
+            double const ns_per_lookup =
+                (result.units > 0) ? result.median * 1e9 / (double)result.units
+                                   : 0;
+
+            if (op->lookups) {
+                printf("%-20s %-20s %10lu %12s %12.1f %14lu\n", doc->name,
+                       op->name, (unsigned long)doc->length, "-",
+                       ns_per_lookup, (unsigned long)result.allocations);
+            } else {
+                printf("%-20s %-20s %10lu %12.1f %12s %14lu\n", doc->name,
+                       op->name, (unsigned long)result.units, mb_per_s, "-",
+                       (unsigned long)result.allocations);
+            }
+            fflush(stdout);
+
+            sbj_add_string_to_object(entry, "document", doc->name);
+            sbj_add_string_to_object(entry, "operation", op->name);
+            sbj_add_integer_number_to_object(entry, "document_bytes",
+                                             (int64_t)doc->length);
+            sbj_add_integer_number_to_object(
+                entry, op->lookups ? "lookups" : "bytes",
+                (int64_t)result.units);
+            sbj_add_integer_number_to_object(entry, "runs",
+                                             (int64_t)result.runs);
+            sbj_add_double_number_to_object(entry, "median_ns",
+                                            result.median * 1e9);
+            sbj_add_double_number_to_object(entry, "best_ns",
+                                            result.best * 1e9);
+            if (op->lookups) {
+                sbj_add_double_number_to_object(entry, "ns_per_lookup",
+                                                ns_per_lookup);
+            } else {
+                sbj_add_double_number_to_object(entry, "mb_per_s", mb_per_s);
+            }
+            sbj_add_integer_number_to_object(entry, "allocations",
+                                             (int64_t)result.allocations);
+            sbj_add_item_to_array(results, entry);
+        }
+
+        release_document(doc);
+    }
+
+    if (json_path != NULL) {
+        char *const printed = sbj_print(report);
+        FILE *const file = fopen(json_path, "wb");
+        if ((printed == NULL) || (file == NULL) ||
+            (fputs(printed, file) < 0) || (fputc('\n', file) == EOF)) {
+            fprintf(stderr, "can't write %s\n", json_path);
+            status = EXIT_FAILURE;
+        }
+        if (file != NULL) {
+            fclose(file);
+        }
+        sbJSON_free(printed);
+    }
+    sbj_delete(report);
+
+    return status;
+}
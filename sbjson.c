@@ -34,6 +34,26 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if !defined(SBJSON_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define SBJSON_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef SBJSON_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(SBJSON_STATS) && !defined(SBJSON_STATS_CLOCK) &&                   \
+    (defined(__GNUC__) || defined(__clang__)) &&                               \
+    (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define SBJSON_STATS_CLOCK() ((uint64_t)__rdtsc())
+#endif
+
 #include "sbjson.h"
 
 typedef struct {
@@ -111,12 +131,70 @@ bool sbj_try_get_bool_value(sbJSON const *const item, bool default_bool) {
     return default_bool;
 }
 
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define sbjson_thread_local _Thread_local
+#elif defined(__GNUC__)
+#define sbjson_thread_local __thread
+#elif defined(_MSC_VER)
+#define sbjson_thread_local __declspec(thread)
+#endif
+
 typedef struct internal_hooks {
     void *(*allocate)(size_t size);
     void (*deallocate)(void *pointer);
     void *(*reallocate)(void *pointer, size_t size);
+#ifdef SBJSON_STATS
+    sbj_stats *stats; /* where to count, NULL counts into thread_stats */
+#endif
 } internal_hooks;
 
+/* initializer of internal_hooks that count into thread_stats */
+#ifdef SBJSON_STATS
+#define hooks_initializer(allocate, deallocate, reallocate)                    \
+    {allocate, deallocate, reallocate, NULL}
+#else
+#define hooks_initializer(allocate, deallocate, reallocate)                    \
+    {allocate, deallocate, reallocate}
+#endif
+
+#ifdef SBJSON_STATS
+/* Counters of the functions without a context */
+#ifdef sbjson_thread_local
+static sbjson_thread_local sbj_stats thread_stats;
+#else
+static sbj_stats thread_stats;
+#endif
+
+#ifndef SBJSON_STATS_CLOCK
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+static uint64_t stats_clock(void) {
+    uint64_t ticks = 0;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+}
+#define SBJSON_STATS_CLOCK() stats_clock()
+#else
+#define SBJSON_STATS_CLOCK() ((uint64_t)0)
+#endif
+#endif
+
+#define hooks_stats(hooks)                                                     \
+    (((hooks)->stats != NULL) ? (hooks)->stats : &thread_stats)
+#define stats_add(hooks, counter, amount)                                      \
+    (hooks_stats(hooks)->counter += (amount))
+#define stats_depth(hooks, depth)                                              \
+    do {                                                                       \
+        sbj_stats *const depth_stats = hooks_stats(hooks);                     \
+        if ((depth) > depth_stats->max_depth) {                                \
+            depth_stats->max_depth = (depth);                                  \
+        }                                                                      \
+    } while (0)
+#else
+/* nothing is counted, the arguments aren't even evaluated */
+#define stats_add(hooks, counter, amount) ((void)0)
+#define stats_depth(hooks, depth) ((void)0)
+#endif
+
 #if defined(_MSC_VER)
 /* work around MSVC error C2322: '...' address of dllimport '...' is not static
  */
@@ -134,8 +212,8 @@ static void *internal_realloc(void *pointer, size_t size) {
 /* strlen of character literals resolved at compile time */
 #define static_strlen(string_literal) (sizeof(string_literal) - sizeof(""))
 
-static internal_hooks global_hooks = {internal_malloc, internal_free,
-                                      internal_realloc};
+static internal_hooks global_hooks =
+    hooks_initializer(internal_malloc, internal_free, internal_realloc);
 
 static unsigned char *sbJSON_strdup(unsigned char const *string,
                                     internal_hooks const *const hooks) {
@@ -152,1033 +230,6982 @@ static unsigned char *sbJSON_strdup(unsigned char const *string,
         return NULL;
     }
     memcpy(copy, string, length);
+    stats_add(hooks, string_bytes, length);
 
     return copy;
 }
 
-void sbJSON_InitHooks(sbJSON_Hooks *hooks) {
+/* translate user supplied hooks, NULL means malloc and free */
+static internal_hooks make_hooks(sbJSON_Hooks const *const hooks) {
+    internal_hooks result =
+        hooks_initializer(internal_malloc, internal_free, internal_realloc);
+
     if (hooks == NULL) {
-        /* Reset hooks */
-        global_hooks.allocate = malloc;
-        global_hooks.deallocate = free;
-        global_hooks.reallocate = realloc;
-        return;
+        return result;
     }
 
-    global_hooks.allocate = malloc;
     if (hooks->malloc_fn != NULL) {
-        global_hooks.allocate = hooks->malloc_fn;
+        result.allocate = hooks->malloc_fn;
     }
 
-    global_hooks.deallocate = free;
     if (hooks->free_fn != NULL) {
-        global_hooks.deallocate = hooks->free_fn;
+        result.deallocate = hooks->free_fn;
     }
 
     /* use realloc only if both free and malloc are used */
-    global_hooks.reallocate = NULL;
-    if ((global_hooks.allocate == malloc) &&
-        (global_hooks.deallocate == free)) {
-        global_hooks.reallocate = realloc;
+    result.reallocate = NULL;
+    if ((result.allocate == malloc) && (result.deallocate == free)) {
+        result.reallocate = realloc;
     }
+
+    return result;
 }
 
+void sbJSON_InitHooks(sbJSON_Hooks *hooks) { global_hooks = make_hooks(hooks); }
+
+/* Nodes are the bulk of a tree, on 64 bit targets one has to stay at six
+ * words (this fails to compile if it doesn't). */
+typedef char sbjson_node_size_check[((sizeof(void *) != 8) ||
+                                     (sizeof(sbJSON) == 48))
+                                        ? 1
+                                        : -1];
+
 /* Internal constructor. */
 static sbJSON *sbJSON_New_Item(internal_hooks const *const hooks) {
     sbJSON *node = (sbJSON *)hooks->allocate(sizeof(sbJSON));
     if (node) {
         memset(node, '\0', sizeof(sbJSON));
+        stats_add(hooks, nodes_allocated, 1);
     }
 
     return node;
 }
 
-/* Delete a sbJSON structure. */
-void sbj_delete(sbJSON *item) {
-    sbJSON *next = NULL;
-    while (item != NULL) {
-        next = item->next;
-        if ((!item->is_reference) && (item->child != NULL)) {
-            sbj_delete(item->child);
-        }
-
-        if (!item->is_reference &&
-            (item->type == sbJSON_String || item->type == sbJSON_Raw)) {
-            global_hooks.deallocate(item->u.valuestring);
-        }
-
-        if ((!item->string_is_const) && (item->string != NULL)) {
-            global_hooks.deallocate(item->string);
-        }
-
-        global_hooks.deallocate(item);
-        item = next;
-    }
-}
+/* Pool allocator behind sbj_pool_malloc/sbj_pool_free: every block starts
+ * with a header naming its size class, so freeing needs no size. Small blocks
+ * come from slabs carved into blocks of one class and go back to a free list
+ * of the freeing thread, so churn reuses the same memory and threads don't
+ * meet in the allocator. A thread that frees more than it allocates hands the
+ * surplus on to the depot. Larger requests go to malloc. */
+typedef union {
+    size_t size_class;
+    /* keeps the payload aligned like malloc would for any basic type */
+    long double alignment_long_double;
+    double alignment_double;
+    void *alignment_pointer;
+} pool_header;
+
+typedef struct pool_block {
+    struct pool_block *next;
+} pool_block;
+
+/* Block sizes including the header, a node takes the 64 byte class */
+static size_t const pool_class_sizes[] = {32, 64, 96, 128, 192, 256};
+#define pool_class_count                                                       \
+    (sizeof(pool_class_sizes) / sizeof(pool_class_sizes[0]))
+#define pool_slab_size ((size_t)64 * 1024)
+/* Free blocks a thread keeps of a class, a slab's worth */
+#define pool_cache_limit(size_class)                                           \
+    (pool_slab_size / pool_class_sizes[size_class])
 
 typedef struct {
-    unsigned char const *content;
-    size_t length;
-    size_t offset;
-    size_t depth; /* How deeply nested (in arrays/objects) is the input at the
-                     current offset. */
-    internal_hooks hooks;
-} parse_buffer;
+    pool_block *free_blocks[pool_class_count];
+    size_t free_counts[pool_class_count];
+    bool registered; /* for handing the blocks on when the thread exits */
+} pool_cache;
 
-/* check if the given size is left to read in a given parse buffer (starting
- * with 1) */
-#define can_read(buffer, size)                                                 \
-    ((buffer != NULL) && (((buffer)->offset + size) <= (buffer)->length))
-/* check if the buffer can be accessed at the given index (starting with 0) */
-#define can_access_at_index(buffer, index)                                     \
-    ((buffer != NULL) && (((buffer)->offset + index) < (buffer)->length))
-#define cannot_access_at_index(buffer, index)                                  \
-    (!can_access_at_index(buffer, index))
-/* get a pointer to the buffer at the position */
-#define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
+#ifdef sbjson_thread_local
+static sbjson_thread_local pool_cache thread_pool_cache;
+#else
+/* without thread local storage the pool is shared by all threads and not
+ * safe to use from several of them */
+static pool_cache thread_pool_cache;
+#endif
 
-/* Parse the input text to generate a number, and populate the result into item.
- */
-static bool parse_number(sbJSON *const item, parse_buffer *const input_buffer) {
-    unsigned char number_c_string[64];
+#if defined(SBJSON_THREADS) && defined(sbjson_thread_local)
+/* Blocks of threads that have exited, taken by the first that runs out */
+static pool_cache pool_depot;
+static pthread_mutex_t pool_depot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t pool_exit_key;
+static pthread_once_t pool_exit_once = PTHREAD_ONCE_INIT;
+
+static void pool_move_blocks(pool_cache *const from, pool_cache *const to) {
     size_t i = 0;
 
-    if ((input_buffer == NULL) || (input_buffer->content == NULL)) {
-        return false;
+    for (i = 0; i < pool_class_count; i++) {
+        while (from->free_blocks[i] != NULL) {
+            pool_block *const block = from->free_blocks[i];
+            from->free_blocks[i] = block->next;
+            block->next = to->free_blocks[i];
+            to->free_blocks[i] = block;
+        }
+        to->free_counts[i] += from->free_counts[i];
+        from->free_counts[i] = 0;
     }
+}
 
-    bool decimal_number = false;
+static void pool_thread_exit(void *cache) {
+    pthread_mutex_lock(&pool_depot_mutex);
+    pool_move_blocks((pool_cache *)cache, &pool_depot);
+    pthread_mutex_unlock(&pool_depot_mutex);
+}
 
-    unsigned char const *buffer = buffer_at_offset(input_buffer);
-    const size_t buffer_length = input_buffer->length - input_buffer->offset;
+static void pool_create_exit_key(void) {
+    pthread_key_create(&pool_exit_key, pool_thread_exit);
+}
 
-    /* Copy the number into a temporary buffer. This takes care of '\0' not
-     * necessarily being available for marking the end of the input */
-    for (i = 0; (i < (sizeof(number_c_string) - 1)) && i < buffer_length; i++) {
-        unsigned char const c = buffer[i];
+/* Once a thread holds blocks they have to go to the depot when it exits */
+static void pool_register(pool_cache *const cache) {
+    pthread_once(&pool_exit_once, pool_create_exit_key);
+    pthread_setspecific(pool_exit_key, cache);
+    cache->registered = true;
+}
 
-        switch (c) {
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-        case '+':
-        case '-':
-            number_c_string[i] = c;
-            break;
-        case 'e':
-        case 'E':
-        case '.':
-            number_c_string[i] = c;
-            decimal_number = true;
-            break;
+/* Moves the blocks of size_class beyond half the limit to the depot */
+static void pool_spill(pool_cache *const cache, size_t const size_class) {
+    size_t const keep = pool_cache_limit(size_class) / 2;
+    pool_block *last_kept = cache->free_blocks[size_class];
+    pool_block *first = NULL;
+    pool_block *last = NULL;
+    size_t i = 0;
 
-        default:
-            goto loop_end;
-        }
+    for (i = 1; i < keep; i++) {
+        last_kept = last_kept->next;
+    }
+    first = last_kept->next;
+    last_kept->next = NULL;
+    for (last = first; last->next != NULL; last = last->next) {
     }
-loop_end:
-    number_c_string[i] = '\0';
-
-    unsigned char *after_end = NULL;
 
-    if (!decimal_number) {
-        int64_t number =
-            strtoll((char const *)number_c_string, (char **)&after_end, 10);
-        if (number_c_string == after_end) {
-            return false; /* parse_error */
-        }
+    pthread_mutex_lock(&pool_depot_mutex);
+    last->next = pool_depot.free_blocks[size_class];
+    pool_depot.free_blocks[size_class] = first;
+    pool_depot.free_counts[size_class] +=
+        cache->free_counts[size_class] - keep;
+    pthread_mutex_unlock(&pool_depot_mutex);
+    cache->free_counts[size_class] = keep;
+}
+#endif
 
-        // TODO: When a number is exactly LLONG_MAX or LLONG_MIN,
-        // it will be classified as a double which is a bug!
-        if (number == LLONG_MAX) {
-            // Number too large to be stored as an integer.
-            after_end = NULL;
-            decimal_number = true;
-        } else if (number == LLONG_MIN) {
-            after_end = NULL;
-            decimal_number = true;
-        } else {
-            item->type = sbJSON_Number;
-            sbj_set_integer_number_value(item, number);
+/* Refills the free list of size_class from the depot or a new slab */
+static bool pool_refill(pool_cache *const cache, size_t const size_class) {
+    size_t const block_size = pool_class_sizes[size_class];
+    unsigned char *slab = NULL;
+    size_t offset = 0;
+
+#if defined(SBJSON_THREADS) && defined(sbjson_thread_local)
+    if (!cache->registered) {
+        pool_register(cache);
+    }
+    /* half the limit, so the frees that follow don't spill right away */
+    pthread_mutex_lock(&pool_depot_mutex);
+    if (pool_depot.free_blocks[size_class] != NULL) {
+        pool_block *last = pool_depot.free_blocks[size_class];
+        size_t taken = 1;
+
+        while ((taken < pool_cache_limit(size_class) / 2) &&
+               (last->next != NULL)) {
+            last = last->next;
+            taken++;
         }
+        cache->free_blocks[size_class] = pool_depot.free_blocks[size_class];
+        cache->free_counts[size_class] = taken;
+        pool_depot.free_blocks[size_class] = last->next;
+        pool_depot.free_counts[size_class] -= taken;
+        last->next = NULL;
+    }
+    pthread_mutex_unlock(&pool_depot_mutex);
+    if (cache->free_blocks[size_class] != NULL) {
+        return true;
     }
+#endif
 
-    if (decimal_number) {
-        double number =
-            strtod((char const *)number_c_string, (char **)&after_end);
-        if (number_c_string == after_end) {
-            return false; /* parse_error */
-        }
-        item->type = sbJSON_Number;
-        sbj_set_double_number_value(item, number);
+    /* slabs stay with the pool for the life of the process */
+    slab = (unsigned char *)internal_malloc(pool_slab_size);
+    if (slab == NULL) {
+        return false;
+    }
+    for (offset = 0; offset + block_size <= pool_slab_size;
+         offset += block_size) {
+        pool_block *const block = (pool_block *)(slab + offset);
+        block->next = cache->free_blocks[size_class];
+        cache->free_blocks[size_class] = block;
+        cache->free_counts[size_class]++;
     }
 
-    input_buffer->offset += (size_t)(after_end - number_c_string);
     return true;
 }
 
-void sbj_set_double_number_value(sbJSON *object, double number) {
-    if (object == NULL) {
-        return;
-    }
-
-    assert(object->type == sbJSON_Number);
-    object->u.valuedouble = number;
-    object->is_number_double = true;
-}
+void *sbj_pool_malloc(size_t size) {
+    pool_cache *const cache = &thread_pool_cache;
+    pool_header *header = NULL;
+    size_t size_class = 0;
 
-void sbj_set_integer_number_value(sbJSON *object, int64_t number) {
-    if (object == NULL) {
-        return;
+    while ((size_class < pool_class_count) &&
+           (pool_class_sizes[size_class] - sizeof(pool_header) < size)) {
+        size_class++;
     }
 
-    assert(object->type == sbJSON_Number);
-    object->u.valueint = number;
-    object->is_number_double = false;
-}
-
-char *sbj_set_valuestring(sbJSON *object, char const *valuestring) {
-    if (object == NULL) {
+    if (size_class == pool_class_count) {
+        if (size > SIZE_MAX - sizeof(pool_header)) {
+            return NULL;
+        }
+        header = (pool_header *)internal_malloc(sizeof(pool_header) + size);
+    } else {
+        if ((cache->free_blocks[size_class] != NULL) ||
+            pool_refill(cache, size_class)) {
+            header = (pool_header *)cache->free_blocks[size_class];
+            cache->free_blocks[size_class] =
+                cache->free_blocks[size_class]->next;
+            cache->free_counts[size_class]--;
+        }
+    }
+    if (header == NULL) {
         return NULL;
     }
 
-    assert(object->type == sbJSON_String && !object->is_reference &&
-           valuestring != NULL);
+    header->size_class = size_class;
+    return header + 1;
+}
 
-    if (strlen(valuestring) <= strlen(object->u.valuestring)) {
-        strcpy(object->u.valuestring, valuestring);
-        return object->u.valuestring;
+void sbj_pool_free(void *pointer) {
+    pool_cache *const cache = &thread_pool_cache;
+    pool_header *header = NULL;
+    pool_block *block = NULL;
+    size_t size_class = 0;
+
+    if (pointer == NULL) {
+        return;
     }
 
-    char *copy = (char *)sbJSON_strdup((unsigned char const *)valuestring,
-                                       &global_hooks);
-    if (copy == NULL) {
-        return NULL;
+    header = (pool_header *)pointer - 1;
+    size_class = header->size_class;
+    if (size_class >= pool_class_count) {
+        internal_free(header);
+        return;
     }
 
-    sbJSON_free(object->u.valuestring);
-    object->u.valuestring = copy;
-    return copy;
-}
+    block = (pool_block *)header;
+    block->next = cache->free_blocks[size_class];
+    cache->free_blocks[size_class] = block;
+    cache->free_counts[size_class]++;
 
-bool sbj_set_bool_value(sbJSON *object, bool boolValue) {
-    if (object == NULL) {
-        return false;
+#if defined(SBJSON_THREADS) && defined(sbjson_thread_local)
+    /* blocks can come from other threads, this one may never allocate */
+    if (!cache->registered) {
+        pool_register(cache);
     }
-
-    if (object->type != sbJSON_Bool) {
-        return false;
+    if (cache->free_counts[size_class] > pool_cache_limit(size_class)) {
+        pool_spill(cache, size_class);
     }
-
-    assert(!object->is_reference && !object->string_is_const);
-    object->type = sbJSON_Bool;
-    object->u.valuebool = boolValue;
-    return true;
+#endif
 }
 
-typedef struct {
-    unsigned char *buffer;
-    size_t length;
-    size_t offset;
-    size_t depth; /* current nesting depth (for formatted printing) */
-    bool noalloc;
-    bool format; /* is this print a formatted print */
+/* Every arena allocation is aligned to this, which is enough for sbJSON nodes
+ * and anything a string could be reinterpreted as. */
+#define arena_alignment 16
+#define arena_default_block_size ((size_t)64 * 1024)
+
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size; /* usable bytes after the header */
+    size_t used;
+} arena_block;
+
+/* keep the payload of a block aligned */
+#define arena_header_size                                                      \
+    ((sizeof(arena_block) + arena_alignment - 1) &                             \
+     ~(size_t)(arena_alignment - 1))
+
+struct sbj_arena {
+    /* the block currently allocated from comes first, full ones follow */
+    arena_block *blocks;
+    size_t block_size;
     internal_hooks hooks;
-} printbuffer;
-
-/* realloc printbuffer if necessary to have at least "needed" bytes more */
-static unsigned char *ensure(printbuffer *const p, size_t needed) {
-    unsigned char *newbuffer = NULL;
-    size_t newsize = 0;
-
-    if ((p == NULL) || (p->buffer == NULL)) {
-        return NULL;
-    }
+};
 
-    if ((p->length > 0) && (p->offset >= p->length)) {
-        /* make sure that offset is valid */
+sbj_arena *sbj_arena_new(size_t block_size) {
+    sbj_arena *arena =
+        (sbj_arena *)global_hooks.allocate(sizeof(struct sbj_arena));
+    if (arena == NULL) {
         return NULL;
     }
 
-    if (needed > INT_MAX) {
-        /* sizes bigger than INT_MAX are currently not supported */
-        return NULL;
-    }
+    arena->blocks = NULL;
+    arena->block_size =
+        (block_size == 0) ? arena_default_block_size : block_size;
+    arena->hooks = global_hooks;
 
-    needed += p->offset + 1;
-    if (needed <= p->length) {
-        return p->buffer + p->offset;
-    }
+    return arena;
+}
 
-    if (p->noalloc) {
-        return NULL;
-    }
+static void *arena_allocate(sbj_arena *const arena, size_t size) {
+    arena_block *block = arena->blocks;
+    unsigned char *memory = NULL;
 
-    /* calculate new buffer size */
-    if (needed > (INT_MAX / 2)) {
-        /* overflow of int, use INT_MAX if possible */
-        if (needed <= INT_MAX) {
-            newsize = INT_MAX;
-        } else {
-            return NULL;
-        }
-    } else {
-        newsize = needed * 2;
+    size = (size + arena_alignment - 1) & ~(size_t)(arena_alignment - 1);
+    if (size == 0) {
+        size = arena_alignment;
     }
 
-    if (p->hooks.reallocate != NULL) {
-        /* reallocate with realloc if available */
-        newbuffer = (unsigned char *)p->hooks.reallocate(p->buffer, newsize);
-        if (newbuffer == NULL) {
-            p->hooks.deallocate(p->buffer);
-            p->length = 0;
-            p->buffer = NULL;
+    if ((block == NULL) || (block->size - block->used < size)) {
+        /* Oversized requests get a block of their own. It goes behind the
+         * current block, which keeps serving the small requests. */
+        bool const oversized = size > arena->block_size;
+        size_t const block_size = oversized ? size : arena->block_size;
 
+        if (block_size > SIZE_MAX - arena_header_size) {
             return NULL;
         }
-    } else {
-        /* otherwise reallocate manually */
-        newbuffer = (unsigned char *)p->hooks.allocate(newsize);
-        if (!newbuffer) {
-            p->hooks.deallocate(p->buffer);
-            p->length = 0;
-            p->buffer = NULL;
 
+        block = (arena_block *)arena->hooks.allocate(arena_header_size +
+                                                     block_size);
+        if (block == NULL) {
             return NULL;
         }
-
-        memcpy(newbuffer, p->buffer, p->offset + 1);
-        p->hooks.deallocate(p->buffer);
+        block->size = block_size;
+        block->used = 0;
+        if (oversized && (arena->blocks != NULL)) {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        } else {
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
     }
-    p->length = newsize;
-    p->buffer = newbuffer;
 
-    return newbuffer + p->offset;
+    memory = (unsigned char *)block + arena_header_size + block->used;
+    block->used += size;
+
+    return memory;
 }
 
-/* calculate the new length of the string in a printbuffer and update the offset
- */
-static void update_offset(printbuffer *const buffer) {
-    unsigned char const *buffer_pointer = NULL;
-    if (buffer->buffer == NULL) {
+void sbj_arena_reset(sbj_arena *arena) {
+    arena_block *block = NULL;
+    arena_block *largest = NULL;
+
+    if ((arena == NULL) || (arena->blocks == NULL)) {
         return;
     }
-    buffer_pointer = buffer->buffer + buffer->offset;
 
-    buffer->offset += strlen((char const *)buffer_pointer);
-}
+    /* keep the largest block, it can take whatever the others held */
+    for (block = arena->blocks; block != NULL; block = block->next) {
+        if ((largest == NULL) || (block->size > largest->size)) {
+            largest = block;
+        }
+    }
+    block = arena->blocks;
+    while (block != NULL) {
+        arena_block *next = block->next;
+        if (block != largest) {
+            arena->hooks.deallocate(block);
+        }
+        block = next;
+    }
 
-/* securely comparison of floating-point variables */
-static bool compare_double(double a, double b) {
-    double maxVal = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
-    return (fabs(a - b) <= maxVal * DBL_EPSILON);
+    largest->next = NULL;
+    largest->used = 0;
+    arena->blocks = largest;
 }
 
-/* Render the number nicely from the given item into a string. */
-static bool print_number(sbJSON const *const item,
-                         printbuffer *const output_buffer) {
-
-    unsigned char *output_pointer = NULL;
-    int length = 0;
-    size_t i = 0;
-    unsigned char number_buffer[26] = {
-        0}; /* temporary buffer to print the number into */
-    double test = 0.0;
-
-    if (output_buffer == NULL) {
-        return false;
+void sbj_arena_free(sbj_arena *arena) {
+    if (arena == NULL) {
+        return;
     }
 
-    if (item->is_number_double) {
-        double d = item->u.valuedouble;
-
-        /* This checks for NaN and Infinity */
-        if (isnan(d) || isinf(d)) {
-            // TODO: This behavior should be controllable. Crashing is at least
-            // as valid. Also think about rountrip ability.
-            length = sprintf((char *)number_buffer, "null");
-        } else if (d == (int64_t)d) {
-            length = sprintf((char *)number_buffer, "%" PRId64, (int64_t)d);
-        } else {
-            /* Try 15 decimal places of precision to avoid nonsignificant
-             * nonzero digits */
-            length = sprintf((char *)number_buffer, "%1.15g", d);
-
-            /* Check whether the original double can be recovered */
-            if ((sscanf((char *)number_buffer, "%lg", &test) != 1) ||
-                !compare_double((double)test, d)) {
-                /* If not, print with 17 decimal places of precision */
-                length = sprintf((char *)number_buffer, "%1.17g", d);
-            }
-        }
-    } else {
-        int64_t i = item->u.valueint;
-        length = sprintf((char *)number_buffer, "%" PRId64, i);
+    sbj_arena_reset(arena);
+    if (arena->blocks != NULL) {
+        arena->hooks.deallocate(arena->blocks);
     }
+    arena->hooks.deallocate(arena);
+}
 
-    /* sprintf failed or buffer overrun occurred */
-    if ((length < 0) || (length > (int)(sizeof(number_buffer) - 1))) {
-        return false;
+/* FNV-1a */
+static uint64_t hash_string(char const *string) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (; *string != '\0'; string++) {
+        hash ^= (unsigned char)*string;
+        hash *= 0x100000001b3;
     }
 
-    /* reserve appropriate space in the output */
-    output_pointer = ensure(output_buffer, (size_t)length + sizeof(""));
-    if (output_pointer == NULL) {
-        return false;
-    }
+    return hash;
+}
 
-    for (i = 0; i < ((size_t)length); i++) {
-        output_pointer[i] = number_buffer[i];
-    }
-    output_pointer[i] = '\0';
+static size_t hash_name(char const *name) { return (size_t)hash_string(name); }
 
-    output_buffer->offset += (size_t)length;
+/* hash_name of the length bytes at name, which needn't be terminated */
+static size_t hash_bytes(unsigned char const *name, size_t const length) {
+    uint64_t hash = 0xcbf29ce484222325;
+    unsigned char const *const end = name + length;
+    for (; name < end; name++) {
+        hash ^= *name;
+        hash *= 0x100000001b3;
+    }
 
-    return true;
+    return (size_t)hash;
 }
 
-/* parse 4 digit hexadecimal number */
-static unsigned parse_hex4(unsigned char const *const input) {
-    unsigned int h = 0;
-    size_t i = 0;
+/* Shared object keys, see sbj_keys_new: a set of names with open addressing,
+ * the names are allocated from an arena of the table. */
+typedef struct key_slot {
+    size_t hash;
+    size_t length;
+    char const *key; /* NULL if the slot is unused */
+} key_slot;
 
-    for (i = 0; i < 4; i++) {
-        /* parse digit */
-        if ((input[i] >= '0') && (input[i] <= '9')) {
-            h += (unsigned int)input[i] - '0';
-        } else if ((input[i] >= 'A') && (input[i] <= 'F')) {
-            h += (unsigned int)10 + input[i] - 'A';
-        } else if ((input[i] >= 'a') && (input[i] <= 'f')) {
-            h += (unsigned int)10 + input[i] - 'a';
-        } else /* invalid */
-        {
-            return 0;
-        }
+struct sbj_keys {
+    internal_hooks hooks;
+    sbj_arena *strings;
+    key_slot *slots;
+    size_t mask; /* number of slots - 1, the number of slots is a power of 2 */
+    size_t count;
+    size_t max_keys;
+#ifdef SBJSON_THREADS
+    /* lookups take it for reading, only insertions for writing */
+    pthread_rwlock_t lock;
+#endif
+};
 
-        if (i < 3) {
-            /* shift left to make place for the next nibble */
-            h = h << 4;
-        }
+#define keys_initial_slots 64
+#define keys_string_block_size 4096
+
+sbj_keys *sbj_keys_new(size_t max_keys) {
+    sbj_keys *keys = (sbj_keys *)global_hooks.allocate(sizeof(sbj_keys));
+    if (keys == NULL) {
+        return NULL;
     }
 
-    return h;
-}
+    memset(keys, '\0', sizeof(sbj_keys));
+    keys->hooks = global_hooks;
+    keys->max_keys = max_keys;
+    keys->mask = keys_initial_slots - 1;
+    keys->strings = sbj_arena_new(keys_string_block_size);
+    keys->slots = (key_slot *)keys->hooks.allocate(keys_initial_slots *
+                                                   sizeof(key_slot));
+    if ((keys->strings == NULL) || (keys->slots == NULL)) {
+        goto fail;
+    }
+    memset(keys->slots, '\0', keys_initial_slots * sizeof(key_slot));
+#ifdef SBJSON_THREADS
+    if (pthread_rwlock_init(&keys->lock, NULL) != 0) {
+        goto fail;
+    }
+#endif
 
-/* converts a UTF-16 literal to UTF-8
- * A literal can be one or two sequences of the form \uXXXX */
-static unsigned char
-utf16_literal_to_utf8(unsigned char const *const input_pointer,
-                      unsigned char const *const input_end,
-                      unsigned char **output_pointer) {
-    long unsigned int codepoint = 0;
-    unsigned int first_code = 0;
-    unsigned char const *first_sequence = input_pointer;
-    unsigned char utf8_length = 0;
-    unsigned char utf8_position = 0;
-    unsigned char sequence_length = 0;
-    unsigned char first_byte_mark = 0;
+    return keys;
 
-    if ((input_end - first_sequence) < 6) {
-        /* input ends unexpectedly */
-        goto fail;
+fail:
+    sbj_arena_free(keys->strings);
+    if (keys->slots != NULL) {
+        keys->hooks.deallocate(keys->slots);
     }
+    keys->hooks.deallocate(keys);
 
-    /* get the first utf16 sequence */
-    first_code = parse_hex4(first_sequence + 2);
+    return NULL;
+}
 
-    /* check that the code is valid */
-    if (((first_code >= 0xDC00) && (first_code <= 0xDFFF))) {
-        goto fail;
+void sbj_keys_free(sbj_keys *keys) {
+    if (keys == NULL) {
+        return;
     }
 
-    /* UTF16 surrogate pair */
-    if ((first_code >= 0xD800) && (first_code <= 0xDBFF)) {
-        unsigned char const *second_sequence = first_sequence + 6;
-        unsigned int second_code = 0;
-        sequence_length = 12; /* \uXXXX\uXXXX */
+#ifdef SBJSON_THREADS
+    pthread_rwlock_destroy(&keys->lock);
+#endif
+    sbj_arena_free(keys->strings);
+    keys->hooks.deallocate(keys->slots);
+    keys->hooks.deallocate(keys);
+}
 
-        if ((input_end - second_sequence) < 6) {
-            /* input ends unexpectedly */
-            goto fail;
-        }
+size_t sbj_keys_count(sbj_keys const *keys) {
+    return (keys != NULL) ? keys->count : 0;
+}
 
-        if ((second_sequence[0] != '\\') || (second_sequence[1] != 'u')) {
-            /* missing second half of the surrogate pair */
-            goto fail;
+/* The slot holding the name, or the unused one it would go in */
+static key_slot *find_key(sbj_keys const *const keys,
+                          unsigned char const *const name,
+                          size_t const length, size_t const hash) {
+    size_t position = hash & keys->mask;
+    while (keys->slots[position].key != NULL) {
+        key_slot *const slot = &keys->slots[position];
+        if ((slot->hash == hash) && (slot->length == length) &&
+            (memcmp(slot->key, name, length) == 0)) {
+            return slot;
         }
+        position = (position + 1) & keys->mask;
+    }
 
-        /* get the second utf16 sequence */
-        second_code = parse_hex4(second_sequence + 2);
-        /* check that the code is valid */
-        if ((second_code < 0xDC00) || (second_code > 0xDFFF)) {
-            /* invalid second half of the surrogate pair */
-            goto fail;
+    return &keys->slots[position];
+}
+
+/* Doubles the number of slots, keeping the table at most half full */
+static bool grow_keys(sbj_keys *const keys) {
+    size_t const slot_count = keys->mask + 1;
+    key_slot *const old_slots = keys->slots;
+    key_slot *slots = NULL;
+    size_t i = 0;
+
+    if (slot_count > (SIZE_MAX / sizeof(key_slot)) / 2) {
+        return false;
+    }
+    slots = (key_slot *)keys->hooks.allocate(2 * slot_count *
+                                             sizeof(key_slot));
+    if (slots == NULL) {
+        return false;
+    }
+    memset(slots, '\0', 2 * slot_count * sizeof(key_slot));
+
+    keys->slots = slots;
+    keys->mask = 2 * slot_count - 1;
+    for (i = 0; i < slot_count; i++) {
+        if (old_slots[i].key != NULL) {
+            *find_key(keys, (unsigned char const *)old_slots[i].key,
+                      old_slots[i].length, old_slots[i].hash) = old_slots[i];
         }
+    }
+    keys->hooks.deallocate(old_slots);
 
-        /* calculate the unicode codepoint from the surrogate pair */
-        codepoint =
-            0x10000 + (((first_code & 0x3FF) << 10) | (second_code & 0x3FF));
-    } else {
-        sequence_length = 6; /* \uXXXX */
-        codepoint = first_code;
+    return true;
+}
+
+/* The shared copy of the length bytes at name, NULL if the table is full or
+ * out of memory */
+static char const *intern_key(sbj_keys *const keys,
+                              unsigned char const *const name,
+                              size_t const length) {
+    size_t const hash = hash_bytes(name, length);
+    key_slot *slot = NULL;
+    char const *key = NULL;
+    char *copy = NULL;
+
+#ifdef SBJSON_THREADS
+    pthread_rwlock_rdlock(&keys->lock);
+#endif
+    key = find_key(keys, name, length, hash)->key;
+#ifdef SBJSON_THREADS
+    pthread_rwlock_unlock(&keys->lock);
+#endif
+    if (key != NULL) {
+        return key;
     }
 
-    /* encode as UTF-8
-     * takes at maximum 4 bytes to encode:
-     * 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx */
-    if (codepoint < 0x80) {
-        /* normal ascii, encoding 0xxxxxxx */
-        utf8_length = 1;
-    } else if (codepoint < 0x800) {
-        /* two bytes, encoding 110xxxxx 10xxxxxx */
-        utf8_length = 2;
-        first_byte_mark = 0xC0; /* 11000000 */
-    } else if (codepoint < 0x10000) {
-        /* three bytes, encoding 1110xxxx 10xxxxxx 10xxxxxx */
-        utf8_length = 3;
-        first_byte_mark = 0xE0; /* 11100000 */
-    } else if (codepoint <= 0x10FFFF) {
-        /* four bytes, encoding 1110xxxx 10xxxxxx 10xxxxxx 10xxxxxx */
-        utf8_length = 4;
-        first_byte_mark = 0xF0; /* 11110000 */
-    } else {
-        /* invalid unicode codepoint */
-        goto fail;
+#ifdef SBJSON_THREADS
+    /* another thread may have added the name in between */
+    pthread_rwlock_wrlock(&keys->lock);
+#endif
+    slot = find_key(keys, name, length, hash);
+    if ((slot->key != NULL) ||
+        ((keys->max_keys != 0) && (keys->count >= keys->max_keys))) {
+        goto done;
+    }
+    if (2 * (keys->count + 1) > keys->mask + 1) {
+        if (!grow_keys(keys)) {
+            goto done;
+        }
+        slot = find_key(keys, name, length, hash);
     }
 
-    /* encode as utf8 */
-    for (utf8_position = (unsigned char)(utf8_length - 1); utf8_position > 0;
-         utf8_position--) {
-        /* 10xxxxxx */
-        (*output_pointer)[utf8_position] =
-            (unsigned char)((codepoint | 0x80) & 0xBF);
-        codepoint >>= 6;
+    copy = (char *)arena_allocate(keys->strings, length + sizeof(""));
+    if (copy == NULL) {
+        goto done;
+    }
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+    slot->hash = hash;
+    slot->length = length;
+    slot->key = copy;
+    keys->count++;
+
+done:
+    key = slot->key;
+#ifdef SBJSON_THREADS
+    pthread_rwlock_unlock(&keys->lock);
+#endif
+
+    return key;
+}
+
+char const *sbj_keys_intern(sbj_keys *keys, char const *key) {
+    if ((keys == NULL) || (key == NULL)) {
+        return NULL;
     }
-    /* encode first byte */
-    if (utf8_length > 1) {
-        (*output_pointer)[0] =
-            (unsigned char)((codepoint | first_byte_mark) & 0xFF);
-    } else {
-        (*output_pointer)[0] = (unsigned char)(codepoint & 0x7F);
+
+    return intern_key(keys, (unsigned char const *)key, strlen(key));
+}
+
+/* Hash index of the members of an object, see sbj_object_build_index. Every
+ * name maps to its first member in list order, like the linear lookup. */
+typedef struct index_slot {
+    size_t hash;
+    sbJSON *item; /* NULL if the slot is unused */
+} index_slot;
+
+struct sbj_index {
+    internal_hooks hooks; /* the index was allocated with these */
+    size_t count;
+    size_t mask; /* number of slots - 1, the number of slots is a power of 2 */
+    bool has_duplicates; /* some name belongs to more than one member */
+    index_slot slots[];
+};
+
+static bool has_index(sbJSON const *const item) {
+    return (item->type == sbJSON_Object) && !item->is_lazy &&
+           (item->u.index != NULL);
+}
+
+static void free_index(struct sbj_index *const index) {
+    if (index != NULL) {
+        index->hooks.deallocate(index);
     }
+}
 
-    *output_pointer += utf8_length;
+/* Element pointers of an array in list order, see sbj_array_build_index. The
+ * first child_count of them are used. */
+struct sbj_vector {
+    internal_hooks hooks; /* the vector was allocated with these */
+    size_t capacity;
+    sbJSON *items[];
+};
+
+static bool has_vector(sbJSON const *const item) {
+    return (item->type == sbJSON_Array) && !item->is_lazy &&
+           !item->is_packed && (item->u.vector != NULL);
+}
 
-    return sequence_length;
+static void free_vector(struct sbj_vector *const vector) {
+    if (vector != NULL) {
+        vector->hooks.deallocate(vector);
+    }
+}
 
-fail:
-    return 0;
+/* Numbers of a packed array in element order, the array's child_count of
+ * them. */
+struct sbj_packed {
+    internal_hooks hooks; /* the block was allocated with these */
+    bool is_double;       /* all doubles, otherwise all integers */
+    union sbj_packed_number {
+        int64_t integer;
+        double number;
+    } numbers[];
+};
+
+/* NULL if out of memory */
+static struct sbj_packed *new_packed(size_t const count, bool const is_double,
+                                     internal_hooks const *const hooks) {
+    struct sbj_packed *const packed = (struct sbj_packed *)hooks->allocate(
+        sizeof(struct sbj_packed) + count * sizeof(union sbj_packed_number));
+
+    if (packed != NULL) {
+        packed->hooks = *hooks;
+        packed->is_double = is_double;
+    }
+
+    return packed;
 }
 
-/* Parse the input text into an unescaped cinput, and populate item. */
-static bool parse_string(sbJSON *const item, parse_buffer *const input_buffer) {
-    unsigned char const *input_pointer = buffer_at_offset(input_buffer) + 1;
-    unsigned char const *input_end = buffer_at_offset(input_buffer) + 1;
-    unsigned char *output_pointer = NULL;
-    unsigned char *output = NULL;
+static void free_packed(struct sbj_packed *const packed) {
+    if (packed != NULL) {
+        packed->hooks.deallocate(packed);
+    }
+}
 
-    /* not a string */
-    if (cannot_access_at_index(input_buffer, 0) || buffer_at_offset(input_buffer)[0] != '\"') {
-        goto fail;
+/* Element index of a packed array as a node on the stack */
+static void packed_element(sbJSON const *const array, size_t const index,
+                           sbJSON *const element) {
+    struct sbj_packed const *const packed = array->u.packed;
+
+    memset(element, 0, sizeof(sbJSON));
+    element->type = sbJSON_Number;
+    element->is_number_double = packed->is_double;
+    if (packed->is_double) {
+        element->u.valuedouble = packed->numbers[index].number;
+    } else {
+        element->u.valueint = packed->numbers[index].integer;
     }
+}
 
-    {
-        /* calculate approximate size of the output (overestimate) */
-        size_t allocation_length = 0;
-        size_t skipped_bytes = 0;
-        while (((size_t)(input_end - input_buffer->content) <
-                input_buffer->length) &&
-               (*input_end != '\"')) {
-            /* is escape sequence */
-            if (input_end[0] == '\\') {
-                if ((size_t)(input_end + 1 - input_buffer->content) >=
-                    input_buffer->length) {
-                    /* prevent buffer overflow when last input character is a
-                     * backslash */
-                    goto fail;
-                }
-                skipped_bytes++;
-                input_end++;
-            }
-            input_end++;
+/* Delete a sbJSON structure. */
+static void delete_item(sbJSON *item, internal_hooks const *const hooks) {
+    sbJSON *next = NULL;
+    while (item != NULL) {
+        next = item->next;
+        if ((!item->is_reference) && (item->child != NULL)) {
+            delete_item(item->child, hooks);
         }
-        if (((size_t)(input_end - input_buffer->content) >=
-             input_buffer->length) ||
-            (*input_end != '\"')) {
-            goto fail; /* string ended unexpectedly */
+
+        if (!item->is_reference &&
+            (item->type == sbJSON_String || item->type == sbJSON_Raw)) {
+            hooks->deallocate(item->u.valuestring);
         }
 
-        /* This is at most how much we need for the output */
-        allocation_length =
-            (size_t)(input_end - buffer_at_offset(input_buffer)) -
-            skipped_bytes;
-        output = (unsigned char *)input_buffer->hooks.allocate(
-            allocation_length + sizeof(""));
-        if (output == NULL) {
-            goto fail; /* allocation failure */
+        if (!item->is_reference && has_index(item)) {
+            free_index(item->u.index);
         }
-    }
 
-    output_pointer = output;
-    /* loop through the string literal */
-    while (input_pointer < input_end) {
-        if (*input_pointer != '\\') {
-            *output_pointer++ = *input_pointer++;
+        if (!item->is_reference && has_vector(item)) {
+            free_vector(item->u.vector);
         }
-        /* escape sequence */
-        else {
-            unsigned char sequence_length = 2;
-            if ((input_end - input_pointer) < 1) {
-                goto fail;
-            }
 
-            switch (input_pointer[1]) {
-            case 'b':
-                *output_pointer++ = '\b';
-                break;
-            case 'f':
-                *output_pointer++ = '\f';
-                break;
-            case 'n':
-                *output_pointer++ = '\n';
-                break;
-            case 'r':
-                *output_pointer++ = '\r';
-                break;
-            case 't':
-                *output_pointer++ = '\t';
-                break;
-            case '\"':
-            case '\\':
-            case '/':
-                *output_pointer++ = input_pointer[1];
-                break;
+        if (!item->is_reference && item->is_packed) {
+            free_packed(item->u.packed);
+        }
 
-            /* UTF-16 literal */
-            case 'u':
-                sequence_length = utf16_literal_to_utf8(
-                    input_pointer, input_end, &output_pointer);
-                if (sequence_length == 0) {
-                    /* failed to convert UTF16-literal to UTF-8 */
-                    goto fail;
-                }
-                break;
+        if ((!item->string_is_const) && (item->string != NULL)) {
+            hooks->deallocate(item->string);
+        }
 
-            default:
-                goto fail;
-            }
-            input_pointer += sequence_length;
+        if (!item->is_arena_owned) {
+            hooks->deallocate(item);
+            stats_add(hooks, nodes_freed, 1);
         }
+        item = next;
     }
+}
 
-    /* zero terminate the output */
-    *output_pointer = '\0';
+void sbj_delete(sbJSON *item) { delete_item(item, &global_hooks); }
 
-    item->type = sbJSON_String;
-    item->u.valuestring = (char *)output;
+/* helper function to cast away const */
+static void *cast_away_const(void const *string) { return (void *)string; }
 
-    input_buffer->offset = (size_t)(input_end - input_buffer->content);
-    input_buffer->offset++;
+typedef struct {
+    unsigned char const *content;
+    size_t length;
+    size_t offset;
+    size_t depth; /* How deeply nested (in arrays/objects) is the input at the
+                     current offset. */
+    internal_hooks hooks;
+    sbj_arena *arena; /* if set, nodes and strings are allocated from here */
+    size_t nesting_limit; /* 0 means SBJSON_NESTING_LIMIT */
+    bool in_situ; /* content is writable, strings are unescaped in place */
+    bool lazy;    /* skip over arrays and objects, see sbj_parse_lazy */
+    sbj_keys *keys; /* if set, object keys are shared from here */
+    bool packed;    /* numeric arrays are packed, see sbj_parse_packed */
+} parse_buffer;
 
-    return true;
+/* initializer of a parse_buffer with all fields zero */
+#define empty_parse_buffer                                                     \
+    {0, 0, 0, 0, hooks_initializer(0, 0, 0), NULL, 0, false, false, NULL, false}
+
+/* check if the buffer may go one level deeper */
+#define can_nest_deeper(buffer)                                                \
+    ((buffer)->depth < (((buffer)->nesting_limit != 0)                         \
+                            ? (buffer)->nesting_limit                          \
+                            : (size_t)SBJSON_NESTING_LIMIT))
+
+/* allocate a node for the parser, from the arena if there is one. In a
+ * SBJSON_COMPACT build inline_storage asks for SBJSON_INLINE_SIZE bytes
+ * behind it. */
+static sbJSON *parse_new_node(parse_buffer *const input_buffer,
+                              bool const inline_storage) {
+    sbJSON *node = NULL;
+
+    if (input_buffer->arena != NULL) {
+        node = (sbJSON *)arena_allocate(input_buffer->arena, sizeof(sbJSON));
+        if (node) {
+            memset(node, '\0', sizeof(sbJSON));
+            node->is_arena_owned = true;
+        }
+        return node;
+    }
+
+#ifdef SBJSON_COMPACT
+    /* in situ strings stay in the input, so they need no storage */
+    if (inline_storage && !input_buffer->in_situ) {
+        node = (sbJSON *)input_buffer->hooks.allocate(sizeof(sbJSON) +
+                                                      SBJSON_INLINE_SIZE);
+        if (node) {
+            memset(node, '\0', sizeof(sbJSON));
+            node->has_inline_storage = true;
+            stats_add(&(input_buffer->hooks), nodes_allocated, 1);
+        }
+        return node;
+    }
+#else
+    (void)inline_storage;
+#endif
 
-fail:
-    if (output != NULL) {
-        input_buffer->hooks.deallocate(output);
+    return sbJSON_New_Item(&(input_buffer->hooks));
+}
+
+#ifdef SBJSON_COMPACT
+/* only strings the parser copies to the heap can go to the inline storage */
+#define can_store_inline(buffer)                                               \
+    (((buffer)->arena == NULL) && !(buffer)->in_situ)
+
+static size_t skip_whitespace_at(parse_buffer const *const buffer,
+                                 size_t position) {
+    while ((position < buffer->length) &&
+           (buffer->content[position] <= 32)) {
+        position++;
     }
 
-    if (input_pointer != NULL) {
-        input_buffer->offset = (size_t)(input_pointer - input_buffer->content);
+    return position;
+}
+
+/* Where the element starts that follows the buffer offset, which is at the
+ * bracket or comma in front of it, whitespace or the element itself. */
+static size_t element_start(parse_buffer const *const buffer) {
+    size_t position = buffer->offset;
+
+    if ((position < buffer->length) &&
+        ((buffer->content[position] == '[') ||
+         (buffer->content[position] == '{') ||
+         (buffer->content[position] == ','))) {
+        position++;
     }
 
-    return false;
+    return skip_whitespace_at(buffer, position);
 }
 
-/* Render the cstring provided to an escaped version that can be printed. */
-static bool print_string_ptr(unsigned char const *const input,
-                             printbuffer *const output_buffer) {
-    unsigned char const *input_pointer = NULL;
+/* Whether there is a string literal at position that fits into the inline
+ * storage. Escapes count with their full length, which is never less than
+ * what they unescape to. */
+static bool fits_inline(parse_buffer const *const buffer, size_t position) {
+    size_t length = 0;
+
+    if ((position >= buffer->length) || (buffer->content[position] != '\"')) {
+        return false;
+    }
+
+    for (position++;
+         (position < buffer->length) && (length < SBJSON_INLINE_SIZE);
+         position++, length++) {
+        if (buffer->content[position] == '\"') {
+            return true;
+        }
+        if (buffer->content[position] == '\\') {
+            position++;
+            length++;
+        }
+    }
+
+    return false;
+}
+#endif
+
+/* allocate a node for the element that follows the buffer offset, with
+ * inline storage only if it starts with a string that fits */
+static sbJSON *parse_new_item(parse_buffer *const input_buffer) {
+#ifdef SBJSON_COMPACT
+    return parse_new_node(input_buffer,
+                          can_store_inline(input_buffer) &&
+                              fits_inline(input_buffer,
+                                          element_start(input_buffer)));
+#else
+    return parse_new_node(input_buffer, false);
+#endif
+}
+
+/* Strings in the inline storage of a node are released together with it. */
+static bool is_inline_string(sbJSON const *const item,
+                             char const *const string) {
+    char const *const storage = (char const *)(item + 1);
+
+    return item->has_inline_storage && (string >= storage) &&
+           (string < storage + SBJSON_INLINE_SIZE);
+}
+
+/* Room for size bytes in the inline storage of item behind its key, NULL if
+ * there isn't enough left. */
+static unsigned char *inline_space(sbJSON *const item, size_t const size) {
+    unsigned char *const storage = (unsigned char *)(item + 1);
+    size_t used = 0;
+
+    if (!item->has_inline_storage) {
+        return NULL;
+    }
+    if (is_inline_string(item, item->string)) {
+        used = (size_t)((unsigned char *)item->string - storage) +
+               strlen(item->string) + sizeof("");
+    }
+
+    return (size <= SBJSON_INLINE_SIZE - used) ? storage + used : NULL;
+}
+
+/* check if the given size is left to read in a given parse buffer (starting
+ * with 1) */
+#define can_read(buffer, size)                                                 \
+    ((buffer != NULL) && (((buffer)->offset + size) <= (buffer)->length))
+/* check if the buffer can be accessed at the given index (starting with 0) */
+#define can_access_at_index(buffer, index)                                     \
+    ((buffer != NULL) && (((buffer)->offset + index) < (buffer)->length))
+#define cannot_access_at_index(buffer, index)                                  \
+    (!can_access_at_index(buffer, index))
+/* get a pointer to the buffer at the position */
+#define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
+
+/* Parse the input text to generate a number, and populate the result into item.
+ */
+#define is_decimal_digit(c) (((c) >= '0') && ((c) <= '9'))
+
+/* Larger mantissas lose precision in a double. */
+#define max_exact_mantissa ((uint64_t)1 << 53)
+/* The decimal digits that always fit into a uint64_t. */
+#define max_mantissa_digits 19
+
+static double const exact_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* 5^q for q in [smallest_power_of_five, largest_power_of_five], truncated to
+ * 128 bits with the highest bit set (rounded up for negative q), high word
+ * first. Numbers outside of this range are rare enough to go to strtod. */
+#define smallest_power_of_five (-64)
+#define largest_power_of_five 64
+static uint64_t const powers_of_five[][2] = {
+    {0xa87fea27a539e9a5, 0x3f2398d747b36224},
+    {0xd29fe4b18e88640e, 0x8eec7f0d19a03aad},
+    {0x83a3eeeef9153e89, 0x1953cf68300424ac},
+    {0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7},
+    {0xcdb02555653131b6, 0x3792f412cb06794d},
+    {0x808e17555f3ebf11, 0xe2bbd88bbee40bd0},
+    {0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4},
+    {0xc8de047564d20a8b, 0xf245825a5a445275},
+    {0xfb158592be068d2e, 0xeed6e2f0f0d56712},
+    {0x9ced737bb6c4183d, 0x55464dd69685606b},
+    {0xc428d05aa4751e4c, 0xaa97e14c3c26b886},
+    {0xf53304714d9265df, 0xd53dd99f4b3066a8},
+    {0x993fe2c6d07b7fab, 0xe546a8038efe4029},
+    {0xbf8fdb78849a5f96, 0xde98520472bdd033},
+    {0xef73d256a5c0f77c, 0x963e66858f6d4440},
+    {0x95a8637627989aad, 0xdde7001379a44aa8},
+    {0xbb127c53b17ec159, 0x5560c018580d5d52},
+    {0xe9d71b689dde71af, 0xaab8f01e6e10b4a6},
+    {0x9226712162ab070d, 0xcab3961304ca70e8},
+    {0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22},
+    {0xe45c10c42a2b3b05, 0x8cb89a7db77c506a},
+    {0x8eb98a7a9a5b04e3, 0x77f3608e92adb242},
+    {0xb267ed1940f1c61c, 0x55f038b237591ed3},
+    {0xdf01e85f912e37a3, 0x6b6c46dec52f6688},
+    {0x8b61313bbabce2c6, 0x2323ac4b3b3da015},
+    {0xae397d8aa96c1b77, 0xabec975e0a0d081a},
+    {0xd9c7dced53c72255, 0x96e7bd358c904a21},
+    {0x881cea14545c7575, 0x7e50d64177da2e54},
+    {0xaa242499697392d2, 0xdde50bd1d5d0b9e9},
+    {0xd4ad2dbfc3d07787, 0x955e4ec64b44e864},
+    {0x84ec3c97da624ab4, 0xbd5af13bef0b113e},
+    {0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e},
+    {0xcfb11ead453994ba, 0x67de18eda5814af2},
+    {0x81ceb32c4b43fcf4, 0x80eacf948770ced7},
+    {0xa2425ff75e14fc31, 0xa1258379a94d028d},
+    {0xcad2f7f5359a3b3e, 0x096ee45813a04330},
+    {0xfd87b5f28300ca0d, 0x8bca9d6e188853fc},
+    {0x9e74d1b791e07e48, 0x775ea264cf55347e},
+    {0xc612062576589dda, 0x95364afe032a819e},
+    {0xf79687aed3eec551, 0x3a83ddbd83f52205},
+    {0x9abe14cd44753b52, 0xc4926a9672793543},
+    {0xc16d9a0095928a27, 0x75b7053c0f178294},
+    {0xf1c90080baf72cb1, 0x5324c68b12dd6339},
+    {0x971da05074da7bee, 0xd3f6fc16ebca5e04},
+    {0xbce5086492111aea, 0x88f4bb1ca6bcf585},
+    {0xec1e4a7db69561a5, 0x2b31e9e3d06c32e6},
+    {0x9392ee8e921d5d07, 0x3aff322e62439fd0},
+    {0xb877aa3236a4b449, 0x09befeb9fad487c3},
+    {0xe69594bec44de15b, 0x4c2ebe687989a9b4},
+    {0x901d7cf73ab0acd9, 0x0f9d37014bf60a11},
+    {0xb424dc35095cd80f, 0x538484c19ef38c95},
+    {0xe12e13424bb40e13, 0x2865a5f206b06fba},
+    {0x8cbccc096f5088cb, 0xf93f87b7442e45d4},
+    {0xafebff0bcb24aafe, 0xf78f69a51539d749},
+    {0xdbe6fecebdedd5be, 0xb573440e5a884d1c},
+    {0x89705f4136b4a597, 0x31680a88f8953031},
+    {0xabcc77118461cefc, 0xfdc20d2b36ba7c3e},
+    {0xd6bf94d5e57a42bc, 0x3d32907604691b4d},
+    {0x8637bd05af6c69b5, 0xa63f9a49c2c1b110},
+    {0xa7c5ac471b478423, 0x0fcf80dc33721d54},
+    {0xd1b71758e219652b, 0xd3c36113404ea4a9},
+    {0x83126e978d4fdf3b, 0x645a1cac083126ea},
+    {0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a4},
+    {0xcccccccccccccccc, 0xcccccccccccccccd},
+    {0x8000000000000000, 0x0000000000000000},
+    {0xa000000000000000, 0x0000000000000000},
+    {0xc800000000000000, 0x0000000000000000},
+    {0xfa00000000000000, 0x0000000000000000},
+    {0x9c40000000000000, 0x0000000000000000},
+    {0xc350000000000000, 0x0000000000000000},
+    {0xf424000000000000, 0x0000000000000000},
+    {0x9896800000000000, 0x0000000000000000},
+    {0xbebc200000000000, 0x0000000000000000},
+    {0xee6b280000000000, 0x0000000000000000},
+    {0x9502f90000000000, 0x0000000000000000},
+    {0xba43b74000000000, 0x0000000000000000},
+    {0xe8d4a51000000000, 0x0000000000000000},
+    {0x9184e72a00000000, 0x0000000000000000},
+    {0xb5e620f480000000, 0x0000000000000000},
+    {0xe35fa931a0000000, 0x0000000000000000},
+    {0x8e1bc9bf04000000, 0x0000000000000000},
+    {0xb1a2bc2ec5000000, 0x0000000000000000},
+    {0xde0b6b3a76400000, 0x0000000000000000},
+    {0x8ac7230489e80000, 0x0000000000000000},
+    {0xad78ebc5ac620000, 0x0000000000000000},
+    {0xd8d726b7177a8000, 0x0000000000000000},
+    {0x878678326eac9000, 0x0000000000000000},
+    {0xa968163f0a57b400, 0x0000000000000000},
+    {0xd3c21bcecceda100, 0x0000000000000000},
+    {0x84595161401484a0, 0x0000000000000000},
+    {0xa56fa5b99019a5c8, 0x0000000000000000},
+    {0xcecb8f27f4200f3a, 0x0000000000000000},
+    {0x813f3978f8940984, 0x4000000000000000},
+    {0xa18f07d736b90be5, 0x5000000000000000},
+    {0xc9f2c9cd04674ede, 0xa400000000000000},
+    {0xfc6f7c4045812296, 0x4d00000000000000},
+    {0x9dc5ada82b70b59d, 0xf020000000000000},
+    {0xc5371912364ce305, 0x6c28000000000000},
+    {0xf684df56c3e01bc6, 0xc732000000000000},
+    {0x9a130b963a6c115c, 0x3c7f400000000000},
+    {0xc097ce7bc90715b3, 0x4b9f100000000000},
+    {0xf0bdc21abb48db20, 0x1e86d40000000000},
+    {0x96769950b50d88f4, 0x1314448000000000},
+    {0xbc143fa4e250eb31, 0x17d955a000000000},
+    {0xeb194f8e1ae525fd, 0x5dcfab0800000000},
+    {0x92efd1b8d0cf37be, 0x5aa1cae500000000},
+    {0xb7abc627050305ad, 0xf14a3d9e40000000},
+    {0xe596b7b0c643c719, 0x6d9ccd05d0000000},
+    {0x8f7e32ce7bea5c6f, 0xe4820023a2000000},
+    {0xb35dbf821ae4f38b, 0xdda2802c8a800000},
+    {0xe0352f62a19e306e, 0xd50b2037ad200000},
+    {0x8c213d9da502de45, 0x4526f422cc340000},
+    {0xaf298d050e4395d6, 0x9670b12b7f410000},
+    {0xdaf3f04651d47b4c, 0x3c0cdd765f114000},
+    {0x88d8762bf324cd0f, 0xa5880a69fb6ac800},
+    {0xab0e93b6efee0053, 0x8eea0d047a457a00},
+    {0xd5d238a4abe98068, 0x72a4904598d6d880},
+    {0x85a36366eb71f041, 0x47a6da2b7f864750},
+    {0xa70c3c40a64e6c51, 0x999090b65f67d924},
+    {0xd0cf4b50cfe20765, 0xfff4b4e3f741cf6d},
+    {0x82818f1281ed449f, 0xbff8f10e7a8921a4},
+    {0xa321f2d7226895c7, 0xaff72d52192b6a0d},
+    {0xcbea6f8ceb02bb39, 0x9bf4f8a69f764490},
+    {0xfee50b7025c36a08, 0x02f236d04753d5b4},
+    {0x9f4f2726179a2245, 0x01d762422c946590},
+    {0xc722f0ef9d80aad6, 0x424d3ad2b7b97ef5},
+    {0xf8ebad2b84e0d58b, 0xd2e0898765a7deb2},
+    {0x9b934c3b330c8577, 0x63cc55f49f88eb2f},
+    {0xc2781f49ffcfa6d5, 0x3cbf6b71c76b25fb},
+};
+
+static void multiply_64(uint64_t const a, uint64_t const b,
+                        uint64_t *const high, uint64_t *const low) {
+    uint64_t const a_low = a & 0xffffffff;
+    uint64_t const a_high = a >> 32;
+    uint64_t const b_low = b & 0xffffffff;
+    uint64_t const b_high = b >> 32;
+    uint64_t const low_low = a_low * b_low;
+    uint64_t const high_low = a_high * b_low;
+    uint64_t const cross =
+        (low_low >> 32) + (high_low & 0xffffffff) + (a_low * b_high);
+
+    *high = (a_high * b_high) + (high_low >> 32) + (cross >> 32);
+    *low = (cross << 32) | (low_low & 0xffffffff);
+}
+
+static int leading_zeros(uint64_t bits) {
+    int count = 0;
+    if ((bits >> 32) == 0) {
+        count += 32;
+        bits <<= 32;
+    }
+    if ((bits >> 48) == 0) {
+        count += 16;
+        bits <<= 16;
+    }
+    if ((bits >> 56) == 0) {
+        count += 8;
+        bits <<= 8;
+    }
+    if ((bits >> 60) == 0) {
+        count += 4;
+        bits <<= 4;
+    }
+    if ((bits >> 62) == 0) {
+        count += 2;
+        bits <<= 2;
+    }
+    if ((bits >> 63) == 0) {
+        count += 1;
+    }
+
+    return count;
+}
+
+/* Correctly rounded mantissa * 10^exponent for a nonzero mantissa, following
+ * Eisel and Lemire, "Number Parsing at a Gigabyte per Second". false if the
+ * exponent is out of the range of the table. */
+static bool eisel_lemire(uint64_t mantissa, int const exponent,
+                         double *const number) {
+    uint64_t high = 0;
+    uint64_t low = 0;
+    uint64_t bits = 0;
+    int zeros = 0;
+    int upper_bit = 0;
+    int shift = 0;
+    int power = 0;
+
+    if ((DBL_MANT_DIG != 53) || (DBL_MAX_EXP != 1024) ||
+        (exponent < smallest_power_of_five) ||
+        (exponent > largest_power_of_five)) {
+        return false;
+    }
+
+    zeros = leading_zeros(mantissa);
+    mantissa <<= zeros;
+    multiply_64(mantissa, powers_of_five[exponent - smallest_power_of_five][0],
+                &high, &low);
+    if ((high & 0x1ff) == 0x1ff) {
+        /* the low bits could still change the result, include the next
+         * word of the power */
+        uint64_t second_high = 0;
+        uint64_t second_low = 0;
+        multiply_64(mantissa,
+                    powers_of_five[exponent - smallest_power_of_five][1],
+                    &second_high, &second_low);
+        low += second_high;
+        if (second_high > low) {
+            high++;
+        }
+    }
+
+    upper_bit = (int)(high >> 63);
+    shift = upper_bit + 64 - 52 - 3;
+    bits = high >> shift;
+    /* floor(exponent * log2(10)), offset to keep the shifted value
+     * positive */
+    power = ((217706 * exponent + 65536 * 213) >> 16) - 213 + 63 + upper_bit -
+            zeros + 1023;
+    if ((power <= 0) || (power >= 0x7ff)) {
+        /* subnormal or infinite, can't happen in the range of the table */
+        return false;
+    }
+
+    /* exactly halfway between two doubles, round to even */
+    if ((low <= 1) && (exponent >= -4) && (exponent <= 23) &&
+        ((bits & 3) == 1) && ((bits << shift) == high)) {
+        bits &= ~(uint64_t)1;
+    }
+
+    bits += bits & 1;
+    bits >>= 1;
+    if (bits >= ((uint64_t)2 << 52)) {
+        bits = (uint64_t)1 << 52;
+        power++;
+    }
+    bits &= ~((uint64_t)1 << 52);
+    bits |= (uint64_t)power << 52;
+
+    memcpy(number, &bits, sizeof(*number));
+    return true;
+}
+
+/* Exact conversion for the numbers the fast paths can't handle. The digits are
+ * handed to strtod without the decimal point, which it would expect in the
+ * format of the current locale. */
+static bool strtod_without_locale(unsigned char const *const start,
+                                  unsigned char const *const end,
+                                  internal_hooks const *const hooks,
+                                  double *const number) {
+    unsigned char short_copy[96];
+    size_t const size = (size_t)(end - start) + sizeof("e-9223372036854775808");
+    unsigned char *copy = short_copy;
     unsigned char *output = NULL;
-    unsigned char *output_pointer = NULL;
-    size_t output_length = 0;
-    /* numbers of additional characters needed for escaping */
-    size_t escape_characters = 0;
+    unsigned char const *input = start;
+    int64_t exponent = 0;
+    bool fraction = false;
+
+    if (size > sizeof(short_copy)) {
+        copy = (unsigned char *)hooks->allocate(size);
+        if (copy == NULL) {
+            return false;
+        }
+    }
+
+    output = copy;
+    for (; (input < end) && (*input != 'e') && (*input != 'E'); input++) {
+        if (*input == '.') {
+            fraction = true;
+            continue;
+        }
+        if (fraction) {
+            exponent--;
+        }
+        *output++ = *input;
+    }
+
+    if (input < end) {
+        int64_t explicit_exponent = 0;
+        bool negative = false;
+
+        input++;
+        if ((*input == '+') || (*input == '-')) {
+            negative = (*input == '-');
+            input++;
+        }
+        for (; input < end; input++) {
+            if (explicit_exponent < 1000000000) {
+                explicit_exponent = explicit_exponent * 10 + (*input - '0');
+            }
+        }
+        exponent += negative ? -explicit_exponent : explicit_exponent;
+    }
+
+    sprintf((char *)output, "e%" PRId64, exponent);
+    *number = strtod((char const *)copy, NULL);
+
+    if (copy != short_copy) {
+        hooks->deallocate(copy);
+    }
+
+    return true;
+}
+
+/* Parse the input text to generate a number, and populate the result into
+ * item. Integers that fit into an int64_t are kept exactly, everything else
+ * becomes a correctly rounded double. */
+static bool parse_number(sbJSON *const item, parse_buffer *const input_buffer) {
+    unsigned char const *start = NULL;
+    unsigned char const *end = NULL;
+    unsigned char const *current = NULL;
+    /* the first max_mantissa_digits significant digits */
+    uint64_t mantissa = 0;
+    int significant_digits = 0;
+    /* the number is mantissa * 10^exponent */
+    int64_t exponent = 0;
+    /* nonzero digits after the significant ones were dropped */
+    bool truncated = false;
+    bool negative = false;
+    bool has_digits = false;
+    bool is_double = false;
+    double number = 0;
+
+    if ((input_buffer == NULL) || (input_buffer->content == NULL)) {
+        return false;
+    }
+
+    start = current = buffer_at_offset(input_buffer);
+    end = input_buffer->content + input_buffer->length;
+
+    if ((current < end) && ((*current == '-') || (*current == '+'))) {
+        negative = (*current == '-');
+        current++;
+    }
+
+    for (; (current < end) && is_decimal_digit(*current); current++) {
+        has_digits = true;
+        if ((mantissa == 0) && (*current == '0')) {
+            /* leading zero */
+            continue;
+        }
+        if (significant_digits < max_mantissa_digits) {
+            mantissa = mantissa * 10 + (uint64_t)(*current - '0');
+            significant_digits++;
+        } else {
+            exponent++;
+            truncated |= (*current != '0');
+        }
+    }
+
+    if ((current < end) && (*current == '.')) {
+        is_double = true;
+        for (current++; (current < end) && is_decimal_digit(*current);
+             current++) {
+            has_digits = true;
+            if ((mantissa == 0) && (*current == '0')) {
+                exponent--;
+                continue;
+            }
+            if (significant_digits < max_mantissa_digits) {
+                mantissa = mantissa * 10 + (uint64_t)(*current - '0');
+                significant_digits++;
+                exponent--;
+            } else {
+                truncated |= (*current != '0');
+            }
+        }
+    }
+
+    if (!has_digits) {
+        return false; /* parse_error */
+    }
+
+    if ((current < end) && ((*current == 'e') || (*current == 'E'))) {
+        unsigned char const *exponent_end = current + 1;
+        int64_t explicit_exponent = 0;
+        bool negative_exponent = false;
+
+        if ((exponent_end < end) &&
+            ((*exponent_end == '+') || (*exponent_end == '-'))) {
+            negative_exponent = (*exponent_end == '-');
+            exponent_end++;
+        }
+
+        /* without digits the 'e' isn't part of the number */
+        if ((exponent_end < end) && is_decimal_digit(*exponent_end)) {
+            for (; (exponent_end < end) && is_decimal_digit(*exponent_end);
+                 exponent_end++) {
+                if (explicit_exponent < 1000000000) {
+                    explicit_exponent =
+                        explicit_exponent * 10 + (*exponent_end - '0');
+                }
+            }
+            exponent += negative_exponent ? -explicit_exponent
+                                          : explicit_exponent;
+            is_double = true;
+            current = exponent_end;
+        }
+    }
+
+    item->type = sbJSON_Number;
+
+    if (!is_double && (exponent == 0) &&
+        (mantissa <= (uint64_t)INT64_MAX + (negative ? 1 : 0))) {
+        int64_t integer = (int64_t)mantissa;
+        if (negative && (mantissa != 0)) {
+            integer = -(int64_t)(mantissa - 1) - 1;
+        }
+        sbj_set_integer_number_value(item, integer);
+        input_buffer->offset += (size_t)(current - start);
+        return true;
+    }
+
+#if defined(FLT_EVAL_METHOD) &&                                                \
+    ((FLT_EVAL_METHOD == 0) || (FLT_EVAL_METHOD == 1))
+    /* Both operands are exact doubles, so the one rounding of the operation
+     * gives the correct result (Clinger's fast path). */
+    if (!truncated && (mantissa <= max_exact_mantissa) && (exponent >= -22) &&
+        (exponent <= 22)) {
+        number = (double)mantissa;
+        if (exponent < 0) {
+            number /= exact_powers_of_ten[-exponent];
+        } else {
+            number *= exact_powers_of_ten[exponent];
+        }
+        goto done;
+    }
+#endif
+
+    if (mantissa == 0) {
+        number = 0;
+        goto done;
+    }
+
+    if ((exponent >= smallest_power_of_five) &&
+        (exponent <= largest_power_of_five) &&
+        eisel_lemire(mantissa, (int)exponent, &number)) {
+        double rounded_up = 0;
+        /* the dropped digits are somewhere between mantissa and mantissa + 1,
+         * good enough if both round to the same double */
+        if (!truncated ||
+            (eisel_lemire(mantissa + 1, (int)exponent, &rounded_up) &&
+             (memcmp(&number, &rounded_up, sizeof(number)) == 0))) {
+            goto done;
+        }
+    }
+
+    if (!strtod_without_locale(start + (negative ? 1 : 0), current,
+                               &input_buffer->hooks, &number)) {
+        return false; /* allocation failure */
+    }
+
+done:
+    sbj_set_double_number_value(item, negative ? -number : number);
+    input_buffer->offset += (size_t)(current - start);
+    return true;
+}
+
+void sbj_set_double_number_value(sbJSON *object, double number) {
+    if (object == NULL) {
+        return;
+    }
+
+    assert(object->type == sbJSON_Number);
+    object->u.valuedouble = number;
+    object->is_number_double = true;
+}
+
+void sbj_set_integer_number_value(sbJSON *object, int64_t number) {
+    if (object == NULL) {
+        return;
+    }
+
+    assert(object->type == sbJSON_Number);
+    object->u.valueint = number;
+    object->is_number_double = false;
+}
+
+char *sbj_set_valuestring(sbJSON *object, char const *valuestring) {
+    if (object == NULL) {
+        return NULL;
+    }
+
+    /* Strings of arena nodes are references into the arena, those of
+     * sbj_duplicate_shared into the original; they are copied to the heap on
+     * write. */
+    assert(object->type == sbJSON_String &&
+           (!object->is_reference || object->is_arena_owned ||
+            object->is_shared ||
+            is_inline_string(object, object->u.valuestring)) &&
+           valuestring != NULL);
+
+    if (!object->is_reference &&
+        strlen(valuestring) <= strlen(object->u.valuestring)) {
+        strcpy(object->u.valuestring, valuestring);
+        return object->u.valuestring;
+    }
+
+    char *copy = (char *)sbJSON_strdup((unsigned char const *)valuestring,
+                                       &global_hooks);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    if (!object->is_reference) {
+        sbJSON_free(object->u.valuestring);
+    }
+    object->u.valuestring = copy;
+    object->is_reference = false;
+    return copy;
+}
+
+bool sbj_set_bool_value(sbJSON *object, bool boolValue) {
+    if (object == NULL) {
+        return false;
+    }
+
+    if (object->type != sbJSON_Bool) {
+        return false;
+    }
+
+    assert(!object->is_reference && !object->string_is_const);
+    object->type = sbJSON_Bool;
+    object->u.valuebool = boolValue;
+    return true;
+}
+
+typedef struct {
+    unsigned char *buffer;
+    size_t length;
+    size_t offset;
+    size_t depth; /* current nesting depth (for formatted printing) */
+    bool noalloc;
+    bool format; /* is this print a formatted print */
+    internal_hooks hooks;
+    /* if set, full buffers are handed to write_fn instead of growing them */
+    sbj_write_fn write_fn;
+    void *user;
+    /* sbj_print_parallel: threads for containers with many children */
+    size_t threads;
+} printbuffer;
+
+/* initializer of a printbuffer with all fields zero */
+#define empty_printbuffer                                                      \
+    {0, 0, 0, 0, 0, 0, hooks_initializer(0, 0, 0), NULL, NULL, 0}
+
+/* realloc printbuffer if necessary to have at least "needed" bytes more */
+static unsigned char *ensure(printbuffer *const p, size_t needed) {
+    unsigned char *newbuffer = NULL;
+    size_t newsize = 0;
+
+    if ((p == NULL) || (p->buffer == NULL)) {
+        return NULL;
+    }
+
+    if ((p->length > 0) && (p->offset > p->length)) {
+        /* make sure that offset is valid */
+        return NULL;
+    }
+
+    if (needed > INT_MAX) {
+        /* sizes bigger than INT_MAX are currently not supported */
+        return NULL;
+    }
+
+    needed += p->offset;
+    if (needed <= p->length) {
+        return p->buffer + p->offset;
+    }
+
+    if (p->write_fn != NULL) {
+        /* pass on what was printed so far and start over at the beginning */
+        if ((p->offset > 0) &&
+            !p->write_fn(p->user, (char const *)p->buffer, p->offset)) {
+            return NULL;
+        }
+        stats_add(&p->hooks, bytes_printed, p->offset);
+        needed -= p->offset;
+        p->offset = 0;
+        if (needed <= p->length) {
+            return p->buffer;
+        }
+    }
+
+    if (p->noalloc) {
+        return NULL;
+    }
+
+    /* calculate new buffer size */
+    if (needed > (INT_MAX / 2)) {
+        /* overflow of int, use INT_MAX if possible */
+        if (needed <= INT_MAX) {
+            newsize = INT_MAX;
+        } else {
+            return NULL;
+        }
+    } else {
+        newsize = needed * 2;
+    }
+
+    /* realloc may get away without moving, count what it might have to */
+    stats_add(&p->hooks, print_buffer_grows, 1);
+    stats_add(&p->hooks, print_buffer_bytes_copied,
+              (p->offset < p->length) ? p->offset + 1 : p->length);
+
+    if (p->hooks.reallocate != NULL) {
+        /* reallocate with realloc if available */
+        newbuffer = (unsigned char *)p->hooks.reallocate(p->buffer, newsize);
+        if (newbuffer == NULL) {
+            p->hooks.deallocate(p->buffer);
+            p->length = 0;
+            p->buffer = NULL;
+
+            return NULL;
+        }
+    } else {
+        /* otherwise reallocate manually */
+        newbuffer = (unsigned char *)p->hooks.allocate(newsize);
+        if (!newbuffer) {
+            p->hooks.deallocate(p->buffer);
+            p->length = 0;
+            p->buffer = NULL;
+
+            return NULL;
+        }
+
+        /* with the terminating zero, unless the buffer was filled up */
+        memcpy(newbuffer, p->buffer,
+               (p->offset < p->length) ? p->offset + 1 : p->length);
+        p->hooks.deallocate(p->buffer);
+    }
+    p->length = newsize;
+    p->buffer = newbuffer;
+
+    return newbuffer + p->offset;
+}
+
+/* calculate the new length of the string in a printbuffer and update the offset
+ */
+static void update_offset(printbuffer *const buffer) {
+    unsigned char const *buffer_pointer = NULL;
+    if (buffer->buffer == NULL) {
+        return;
+    }
+    buffer_pointer = buffer->buffer + buffer->offset;
+
+    buffer->offset += strlen((char const *)buffer_pointer);
+}
+
+/* securely comparison of floating-point variables */
+static bool compare_double(double a, double b) {
+    double maxVal = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
+    return (fabs(a - b) <= maxVal * DBL_EPSILON);
+}
+
+static char const digit_pairs[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+/* Writes the decimal digits of number and returns their count. */
+static int print_int64(int64_t const number, unsigned char *const output) {
+    unsigned char digits[20];
+    int length = 0;
+    int position = sizeof(digits);
+    uint64_t magnitude = (uint64_t)number;
+
+    if (number < 0) {
+        magnitude = 0 - magnitude;
+        output[length++] = '-';
+    }
+
+    while (magnitude >= 100) {
+        unsigned const pair = (unsigned)(magnitude % 100) * 2;
+        magnitude /= 100;
+        digits[--position] = (unsigned char)digit_pairs[pair + 1];
+        digits[--position] = (unsigned char)digit_pairs[pair];
+    }
+    if (magnitude >= 10) {
+        unsigned const pair = (unsigned)magnitude * 2;
+        digits[--position] = (unsigned char)digit_pairs[pair + 1];
+        digits[--position] = (unsigned char)digit_pairs[pair];
+    } else {
+        digits[--position] = (unsigned char)('0' + magnitude);
+    }
+
+    memcpy(output + length, digits + position, sizeof(digits) - (size_t)position);
+    return length + (int)sizeof(digits) - position;
+}
+
+/* Shortest digits of a double that parse back to it, following Loitsch,
+ * "Printing Floating-Point Numbers Quickly and Accurately with Integers"
+ * (Grisu2). In rare cases one more digit than necessary is produced, the
+ * result always round-trips. */
+typedef struct {
+    uint64_t f;
+    int e;
+} diy_fp; /* f * 2^e */
+
+static diy_fp diy_fp_multiply(diy_fp const x, diy_fp const y) {
+    uint64_t const x_low = x.f & 0xffffffff;
+    uint64_t const x_high = x.f >> 32;
+    uint64_t const y_low = y.f & 0xffffffff;
+    uint64_t const y_high = y.f >> 32;
+    uint64_t const low_low = x_low * y_low;
+    uint64_t const low_high = x_low * y_high;
+    uint64_t const high_low = x_high * y_low;
+    uint64_t const high_high = x_high * y_high;
+    /* the upper half of the product, rounded */
+    uint64_t const middle = (low_low >> 32) + (low_high & 0xffffffff) +
+                            (high_low & 0xffffffff) + ((uint64_t)1 << 31);
+    diy_fp result;
+
+    result.f =
+        high_high + (low_high >> 32) + (high_low >> 32) + (middle >> 32);
+    result.e = x.e + y.e + 64;
+    return result;
+}
+
+static diy_fp diy_fp_normalize(diy_fp x) {
+    while ((x.f >> 63) == 0) {
+        x.f <<= 1;
+        x.e--;
+    }
+
+    return x;
+}
+
+/* 10^k for every 8th k, normalized to 64 bits */
+typedef struct {
+    uint64_t f;
+    int e;
+    int k;
+} cached_power;
+
+static cached_power const cached_powers[] = {
+    {0xab70fe17c79ac6ca, -1060, -300},
+    {0xff77b1fcbebcdc4f, -1034, -292},
+    {0xbe5691ef416bd60c, -1007, -284},
+    {0x8dd01fad907ffc3c, -980, -276},
+    {0xd3515c2831559a83, -954, -268},
+    {0x9d71ac8fada6c9b5, -927, -260},
+    {0xea9c227723ee8bcb, -901, -252},
+    {0xaecc49914078536d, -874, -244},
+    {0x823c12795db6ce57, -847, -236},
+    {0xc21094364dfb5637, -821, -228},
+    {0x9096ea6f3848984f, -794, -220},
+    {0xd77485cb25823ac7, -768, -212},
+    {0xa086cfcd97bf97f4, -741, -204},
+    {0xef340a98172aace5, -715, -196},
+    {0xb23867fb2a35b28e, -688, -188},
+    {0x84c8d4dfd2c63f3b, -661, -180},
+    {0xc5dd44271ad3cdba, -635, -172},
+    {0x936b9fcebb25c996, -608, -164},
+    {0xdbac6c247d62a584, -582, -156},
+    {0xa3ab66580d5fdaf6, -555, -148},
+    {0xf3e2f893dec3f126, -529, -140},
+    {0xb5b5ada8aaff80b8, -502, -132},
+    {0x87625f056c7c4a8b, -475, -124},
+    {0xc9bcff6034c13053, -449, -116},
+    {0x964e858c91ba2655, -422, -108},
+    {0xdff9772470297ebd, -396, -100},
+    {0xa6dfbd9fb8e5b88f, -369, -92},
+    {0xf8a95fcf88747d94, -343, -84},
+    {0xb94470938fa89bcf, -316, -76},
+    {0x8a08f0f8bf0f156b, -289, -68},
+    {0xcdb02555653131b6, -263, -60},
+    {0x993fe2c6d07b7fac, -236, -52},
+    {0xe45c10c42a2b3b06, -210, -44},
+    {0xaa242499697392d3, -183, -36},
+    {0xfd87b5f28300ca0e, -157, -28},
+    {0xbce5086492111aeb, -130, -20},
+    {0x8cbccc096f5088cc, -103, -12},
+    {0xd1b71758e219652c, -77, -4},
+    {0x9c40000000000000, -50, 4},
+    {0xe8d4a51000000000, -24, 12},
+    {0xad78ebc5ac620000, 3, 20},
+    {0x813f3978f8940984, 30, 28},
+    {0xc097ce7bc90715b3, 56, 36},
+    {0x8f7e32ce7bea5c70, 83, 44},
+    {0xd5d238a4abe98068, 109, 52},
+    {0x9f4f2726179a2245, 136, 60},
+    {0xed63a231d4c4fb27, 162, 68},
+    {0xb0de65388cc8ada8, 189, 76},
+    {0x83c7088e1aab65db, 216, 84},
+    {0xc45d1df942711d9a, 242, 92},
+    {0x924d692ca61be758, 269, 100},
+    {0xda01ee641a708dea, 295, 108},
+    {0xa26da3999aef774a, 322, 116},
+    {0xf209787bb47d6b85, 348, 124},
+    {0xb454e4a179dd1877, 375, 132},
+    {0x865b86925b9bc5c2, 402, 140},
+    {0xc83553c5c8965d3d, 428, 148},
+    {0x952ab45cfa97a0b3, 455, 156},
+    {0xde469fbd99a05fe3, 481, 164},
+    {0xa59bc234db398c25, 508, 172},
+    {0xf6c69a72a3989f5c, 534, 180},
+    {0xb7dcbf5354e9bece, 561, 188},
+    {0x88fcf317f22241e2, 588, 196},
+    {0xcc20ce9bd35c78a5, 614, 204},
+    {0x98165af37b2153df, 641, 212},
+    {0xe2a0b5dc971f303a, 667, 220},
+    {0xa8d9d1535ce3b396, 694, 228},
+    {0xfb9b7cd9a4a7443c, 720, 236},
+    {0xbb764c4ca7a44410, 747, 244},
+    {0x8bab8eefb6409c1a, 774, 252},
+    {0xd01fef10a657842c, 800, 260},
+    {0x9b10a4e5e9913129, 827, 268},
+    {0xe7109bfba19c0c9d, 853, 276},
+    {0xac2820d9623bf429, 880, 284},
+    {0x80444b5e7aa7cf85, 907, 292},
+    {0xbf21e44003acdd2d, 933, 300},
+    {0x8e679c2f5e44ff8f, 960, 308},
+    {0xd433179d9c8cb841, 986, 316},
+    {0x9e19db92b4e31ba9, 1013, 324},
+};
+
+/* Digit generation works best if the cached power scales the upper boundary
+ * into [2^(alpha + 64), 2^(gamma + 64)]. */
+#define grisu_alpha (-60)
+#define grisu_gamma (-32)
+
+static cached_power cached_power_for(int const e) {
+    /* k = ceil((alpha - e - 1) * log10(2)) */
+    int const f = grisu_alpha - e - 1;
+    int const k = (f * 78913) / (1 << 18) + (f > 0);
+    return cached_powers[(300 + k + 7) / 8];
+}
+
+static void grisu_round(unsigned char *const buffer, int const length,
+                        uint64_t const distance, uint64_t const delta,
+                        uint64_t rest, uint64_t const ten_kappa) {
+    /* move the last digit towards the exact value while staying inside the
+     * rounding interval */
+    while ((rest < distance) && (delta - rest >= ten_kappa) &&
+           ((rest + ten_kappa < distance) ||
+            (distance - rest > rest + ten_kappa - distance))) {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+/* value is positive and finite, returns the digit count and the decimal
+ * exponent of the last digit */
+static int grisu2(double const value, unsigned char *const buffer,
+                  int *const decimal_exponent) {
+    uint64_t bits = 0;
+    uint64_t fraction = 0;
+    int exponent = 0;
+    diy_fp v;
+    diy_fp plus;
+    diy_fp minus;
+    diy_fp power;
+    diy_fp one;
+    cached_power cached;
+    uint64_t delta = 0;
+    uint64_t distance = 0;
+    uint32_t integral = 0;
+    uint64_t fractional = 0;
+    uint32_t divisor = 0;
+    int kappa = 0;
+    int length = 0;
+
+    memcpy(&bits, &value, sizeof(bits));
+    fraction = bits & (((uint64_t)1 << 52) - 1);
+    exponent = (int)(bits >> 52);
+    if (exponent == 0) {
+        /* subnormal */
+        v.f = fraction;
+        v.e = 1 - 1075;
+    } else {
+        v.f = fraction + ((uint64_t)1 << 52);
+        v.e = exponent - 1075;
+    }
+
+    /* the boundaries halfway to the neighbouring doubles */
+    plus.f = (v.f << 1) + 1;
+    plus.e = v.e - 1;
+    plus = diy_fp_normalize(plus);
+    if ((fraction == 0) && (exponent > 1)) {
+        /* the lower neighbour is closer */
+        minus.f = (v.f << 2) - 1;
+        minus.e = v.e - 2;
+    } else {
+        minus.f = (v.f << 1) - 1;
+        minus.e = v.e - 1;
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    v = diy_fp_normalize(v);
+
+    cached = cached_power_for(plus.e);
+    power.f = cached.f;
+    power.e = cached.e;
+    v = diy_fp_multiply(v, power);
+    minus = diy_fp_multiply(minus, power);
+    plus = diy_fp_multiply(plus, power);
+    /* stay inside of the interval despite the rounding of the products */
+    minus.f++;
+    plus.f--;
+    *decimal_exponent = -cached.k;
+
+    delta = plus.f - minus.f;
+    distance = plus.f - v.f;
+    one.e = plus.e;
+    one.f = (uint64_t)1 << -one.e;
+    integral = (uint32_t)(plus.f >> -one.e);
+    fractional = plus.f & (one.f - 1);
+
+    divisor = 1000000000;
+    kappa = 10;
+    while (divisor > integral) {
+        divisor /= 10;
+        kappa--;
+    }
+
+    while (kappa > 0) {
+        uint64_t rest = 0;
+        buffer[length++] = (unsigned char)('0' + integral / divisor);
+        integral %= divisor;
+        kappa--;
+        rest = ((uint64_t)integral << -one.e) + fractional;
+        if (rest <= delta) {
+            *decimal_exponent += kappa;
+            grisu_round(buffer, length, distance, delta, rest,
+                        (uint64_t)divisor << -one.e);
+            return length;
+        }
+        divisor /= 10;
+    }
+
+    for (;;) {
+        fractional *= 10;
+        buffer[length++] = (unsigned char)('0' + (fractional >> -one.e));
+        fractional &= one.f - 1;
+        kappa--;
+        delta *= 10;
+        distance *= 10;
+        if (fractional <= delta) {
+            break;
+        }
+    }
+    *decimal_exponent += kappa;
+    grisu_round(buffer, length, distance, delta, fractional, one.f);
+
+    return length;
+}
+
+/* Lays out the digits like %.17g would. */
+static int print_double(double const number, unsigned char *const output) {
+    unsigned char digits[18];
+    int decimal_exponent = 0;
+    int count = grisu2(fabs(number), digits, &decimal_exponent);
+    /* exponent of the first digit */
+    int const exponent = count + decimal_exponent - 1;
+    int length = 0;
+
+    if (number < 0) {
+        output[length++] = '-';
+    }
+
+    if ((exponent < -4) || (exponent >= 17)) {
+        int magnitude = (exponent < 0) ? -exponent : exponent;
+        output[length++] = digits[0];
+        if (count > 1) {
+            output[length++] = '.';
+            memcpy(output + length, digits + 1, (size_t)count - 1);
+            length += count - 1;
+        }
+        output[length++] = 'e';
+        output[length++] = (exponent < 0) ? '-' : '+';
+        if (magnitude >= 100) {
+            output[length++] = (unsigned char)('0' + magnitude / 100);
+            magnitude %= 100;
+        }
+        output[length++] = (unsigned char)digit_pairs[magnitude * 2];
+        output[length++] = (unsigned char)digit_pairs[magnitude * 2 + 1];
+    } else if (exponent < 0) {
+        output[length++] = '0';
+        output[length++] = '.';
+        memset(output + length, '0', (size_t)(-exponent - 1));
+        length += -exponent - 1;
+        memcpy(output + length, digits, (size_t)count);
+        length += count;
+    } else if (count <= exponent + 1) {
+        memcpy(output + length, digits, (size_t)count);
+        length += count;
+        memset(output + length, '0', (size_t)(exponent + 1 - count));
+        length += exponent + 1 - count;
+    } else {
+        memcpy(output + length, digits, (size_t)exponent + 1);
+        length += exponent + 1;
+        output[length++] = '.';
+        memcpy(output + length, digits + exponent + 1,
+               (size_t)(count - exponent - 1));
+        length += count - exponent - 1;
+    }
+
+    return length;
+}
+
+/* Render the text of a number into number_buffer, which has to have room for
+ * 26 characters, and return its length */
+static int format_number(sbJSON const *const item,
+                         unsigned char *const number_buffer) {
+    int length = 0;
+
+    if (item->is_number_double) {
+        double d = item->u.valuedouble;
+
+        /* This checks for NaN and Infinity */
+        if (isnan(d) || isinf(d)) {
+            // TODO: This behavior should be controllable. Crashing is at least
+            // as valid. Also think about rountrip ability.
+            memcpy(number_buffer, "null", static_strlen("null"));
+            length = static_strlen("null");
+        } else if ((d >= -9223372036854775808.0) &&
+                   (d < 9223372036854775808.0) && (d == (int64_t)d)) {
+            length = print_int64((int64_t)d, number_buffer);
+        } else {
+            length = print_double(d, number_buffer);
+        }
+    } else {
+        length = print_int64(item->u.valueint, number_buffer);
+    }
+
+    return length;
+}
+
+/* Render the number nicely from the given item into a string. */
+static bool print_number(sbJSON const *const item,
+                         printbuffer *const output_buffer) {
+    unsigned char *output_pointer = NULL;
+    int length = 0;
+    unsigned char number_buffer[26]; /* temporary buffer to print the number
+                                        into */
+
+    if (output_buffer == NULL) {
+        return false;
+    }
+
+    length = format_number(item, number_buffer);
+
+    /* reserve appropriate space in the output */
+    output_pointer = ensure(output_buffer, (size_t)length + sizeof(""));
+    if (output_pointer == NULL) {
+        return false;
+    }
+
+    memcpy(output_pointer, number_buffer, (size_t)length);
+    output_pointer[length] = '\0';
+
+    output_buffer->offset += (size_t)length;
+
+    return true;
+}
+
+/* parse 4 digit hexadecimal number */
+static unsigned parse_hex4(unsigned char const *const input) {
+    unsigned int h = 0;
+    size_t i = 0;
+
+    for (i = 0; i < 4; i++) {
+        /* parse digit */
+        if ((input[i] >= '0') && (input[i] <= '9')) {
+            h += (unsigned int)input[i] - '0';
+        } else if ((input[i] >= 'A') && (input[i] <= 'F')) {
+            h += (unsigned int)10 + input[i] - 'A';
+        } else if ((input[i] >= 'a') && (input[i] <= 'f')) {
+            h += (unsigned int)10 + input[i] - 'a';
+        } else /* invalid */
+        {
+            return 0;
+        }
+
+        if (i < 3) {
+            /* shift left to make place for the next nibble */
+            h = h << 4;
+        }
+    }
+
+    return h;
+}
+
+/* Reads the code point of a UTF-16 literal, one or two sequences of the form
+ * \uXXXX. Returns the number of input bytes used, 0 for an invalid literal. */
+static unsigned char
+utf16_literal_codepoint(unsigned char const *const input_pointer,
+                        unsigned char const *const input_end,
+                        long unsigned int *const codepoint) {
+    unsigned int first_code = 0;
+    unsigned char const *first_sequence = input_pointer;
+
+    if ((input_end - first_sequence) < 6) {
+        /* input ends unexpectedly */
+        return 0;
+    }
+
+    /* get the first utf16 sequence */
+    first_code = parse_hex4(first_sequence + 2);
+
+    /* check that the code is valid */
+    if (((first_code >= 0xDC00) && (first_code <= 0xDFFF))) {
+        return 0;
+    }
+
+    /* UTF16 surrogate pair */
+    if ((first_code >= 0xD800) && (first_code <= 0xDBFF)) {
+        unsigned char const *second_sequence = first_sequence + 6;
+        unsigned int second_code = 0;
+
+        if ((input_end - second_sequence) < 6) {
+            /* input ends unexpectedly */
+            return 0;
+        }
+
+        if ((second_sequence[0] != '\\') || (second_sequence[1] != 'u')) {
+            /* missing second half of the surrogate pair */
+            return 0;
+        }
+
+        /* get the second utf16 sequence */
+        second_code = parse_hex4(second_sequence + 2);
+        /* check that the code is valid */
+        if ((second_code < 0xDC00) || (second_code > 0xDFFF)) {
+            /* invalid second half of the surrogate pair */
+            return 0;
+        }
+
+        /* calculate the unicode codepoint from the surrogate pair */
+        *codepoint =
+            0x10000 + (((first_code & 0x3FF) << 10) | (second_code & 0x3FF));
+        return 12; /* \uXXXX\uXXXX */
+    }
+
+    *codepoint = first_code;
+    return 6; /* \uXXXX */
+}
+
+/* converts a UTF-16 literal to UTF-8
+ * A literal can be one or two sequences of the form \uXXXX */
+static unsigned char
+utf16_literal_to_utf8(unsigned char const *const input_pointer,
+                      unsigned char const *const input_end,
+                      unsigned char **output_pointer) {
+    long unsigned int codepoint = 0;
+    unsigned char utf8_length = 0;
+    unsigned char utf8_position = 0;
+    unsigned char const sequence_length =
+        utf16_literal_codepoint(input_pointer, input_end, &codepoint);
+    unsigned char first_byte_mark = 0;
+
+    if (sequence_length == 0) {
+        goto fail;
+    }
+
+    /* encode as UTF-8
+     * takes at maximum 4 bytes to encode:
+     * 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx */
+    if (codepoint < 0x80) {
+        /* normal ascii, encoding 0xxxxxxx */
+        utf8_length = 1;
+    } else if (codepoint < 0x800) {
+        /* two bytes, encoding 110xxxxx 10xxxxxx */
+        utf8_length = 2;
+        first_byte_mark = 0xC0; /* 11000000 */
+    } else if (codepoint < 0x10000) {
+        /* three bytes, encoding 1110xxxx 10xxxxxx 10xxxxxx */
+        utf8_length = 3;
+        first_byte_mark = 0xE0; /* 11100000 */
+    } else if (codepoint <= 0x10FFFF) {
+        /* four bytes, encoding 1110xxxx 10xxxxxx 10xxxxxx 10xxxxxx */
+        utf8_length = 4;
+        first_byte_mark = 0xF0; /* 11110000 */
+    } else {
+        /* invalid unicode codepoint */
+        goto fail;
+    }
+
+    /* encode as utf8 */
+    for (utf8_position = (unsigned char)(utf8_length - 1); utf8_position > 0;
+         utf8_position--) {
+        /* 10xxxxxx */
+        (*output_pointer)[utf8_position] =
+            (unsigned char)((codepoint | 0x80) & 0xBF);
+        codepoint >>= 6;
+    }
+    /* encode first byte */
+    if (utf8_length > 1) {
+        (*output_pointer)[0] =
+            (unsigned char)((codepoint | first_byte_mark) & 0xFF);
+    } else {
+        (*output_pointer)[0] = (unsigned char)(codepoint & 0x7F);
+    }
+
+    *output_pointer += utf8_length;
+
+    return sequence_length;
+
+fail:
+    return 0;
+}
+
+/* Word at a time scanning (SWAR): look at eight bytes per step using plain
+ * 64-bit arithmetic, which works the same on every target. A byte of a word
+ * is zero iff the high bit of that byte is set in has_zero_byte(word); bytes
+ * after a match may be flagged too, which doesn't matter for finding the first
+ * one with a scalar loop. */
+#define swar_ones ((uint64_t)0x0101010101010101)
+#define swar_highs ((uint64_t)0x8080808080808080)
+#define has_zero_byte(word) (((word)-swar_ones) & ~(word)&swar_highs)
+#define has_byte(word, c) has_zero_byte((word) ^ (swar_ones * (uint64_t)(c)))
+#define has_byte_less_than(word, n)                                            \
+    (((word) - (swar_ones * (uint64_t)(n))) & ~(word)&swar_highs)
+/* exact for every byte, n has to be below 128 */
+#define has_byte_greater_than(word, n)                                         \
+    (((((word) & ~swar_highs) + swar_ones * (uint64_t)(127 - (n))) | (word)) & \
+     swar_highs)
+
+static uint64_t load_word(unsigned char const *const input) {
+    uint64_t word;
+    memcpy(&word, input, sizeof(word));
+    return word;
+}
+
+/* Length of the run at the start of input that contains no '"' or '\\' (and
+ * no control characters if requested), i.e. bytes that can be copied as is. */
+static size_t plain_string_run(unsigned char const *const input,
+                               size_t const length, bool const stop_at_control) {
+    size_t i = 0;
+
+    for (; i + 2 * sizeof(uint64_t) <= length; i += 2 * sizeof(uint64_t)) {
+        uint64_t const first = load_word(input + i);
+        uint64_t const second = load_word(input + i + sizeof(uint64_t));
+        uint64_t special = has_byte(first, '\"') | has_byte(first, '\\') |
+                           has_byte(second, '\"') | has_byte(second, '\\');
+        if (stop_at_control) {
+            special |= has_byte_less_than(first, 32) |
+                       has_byte_less_than(second, 32);
+        }
+        if (special != 0) {
+            break;
+        }
+    }
+
+    for (; i < length; i++) {
+        if ((input[i] == '\"') || (input[i] == '\\') ||
+            (stop_at_control && (input[i] < 32))) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/* Unescape the string contents in [*input, input_end) into output, which has
+ * room for at least as many bytes. Returns the end of the output, or NULL with
+ * *input pointing at the invalid escape sequence. */
+static unsigned char *unescape_string(unsigned char const **const input,
+                                      unsigned char const *const input_end,
+                                      unsigned char *output_pointer) {
+    unsigned char const *input_pointer = *input;
+
+    while (input_pointer < input_end) {
+        /* copy runs without escape sequences in bulk, in place the output
+         * trails the input */
+        size_t const run = plain_string_run(
+            input_pointer, (size_t)(input_end - input_pointer), false);
+        memmove(output_pointer, input_pointer, run);
+        output_pointer += run;
+        input_pointer += run;
+
+        if (input_pointer >= input_end) {
+            break;
+        }
+        /* escape sequence */
+        {
+            unsigned char sequence_length = 2;
+            if ((input_end - input_pointer) < 1) {
+                goto fail;
+            }
+
+            switch (input_pointer[1]) {
+            case 'b':
+                *output_pointer++ = '\b';
+                break;
+            case 'f':
+                *output_pointer++ = '\f';
+                break;
+            case 'n':
+                *output_pointer++ = '\n';
+                break;
+            case 'r':
+                *output_pointer++ = '\r';
+                break;
+            case 't':
+                *output_pointer++ = '\t';
+                break;
+            case '\"':
+            case '\\':
+            case '/':
+                *output_pointer++ = input_pointer[1];
+                break;
+
+            /* UTF-16 literal */
+            case 'u':
+                sequence_length = utf16_literal_to_utf8(
+                    input_pointer, input_end, &output_pointer);
+                if (sequence_length == 0) {
+                    /* failed to convert UTF16-literal to UTF-8 */
+                    goto fail;
+                }
+                break;
+
+            default:
+                goto fail;
+            }
+            input_pointer += sequence_length;
+        }
+    }
+
+    *input = input_pointer;
+    return output_pointer;
+
+fail:
+    *input = input_pointer;
+    return NULL;
+}
+
+/* Unescape the string at the buffer offset, that ends with the quote at
+ * input_end, into item. allocation_length is at least the unescaped length. */
+static bool parse_string_contents(sbJSON *const item,
+                                  parse_buffer *const input_buffer,
+                                  unsigned char const *const input_end,
+                                  size_t const allocation_length) {
+    unsigned char const *input_pointer = buffer_at_offset(input_buffer) + 1;
+    unsigned char *output_pointer = NULL;
+    unsigned char *output = NULL;
+
+    if (input_buffer->in_situ) {
+        /* the unescaped string and its terminator replace the literal */
+        output = (unsigned char *)cast_away_const(input_pointer);
+    } else if (input_buffer->arena != NULL) {
+        output = (unsigned char *)arena_allocate(input_buffer->arena,
+                                                 allocation_length + sizeof(""));
+    } else {
+        output = inline_space(item, allocation_length + sizeof(""));
+        if (output == NULL) {
+            output = (unsigned char *)input_buffer->hooks.allocate(
+                allocation_length + sizeof(""));
+            stats_add(&(input_buffer->hooks), string_bytes,
+                      (output != NULL) ? allocation_length + sizeof("") : 0);
+        }
+    }
+    if (output == NULL) {
+        goto fail; /* allocation failure */
+    }
+
+    output_pointer = unescape_string(&input_pointer, input_end, output);
+    if (output_pointer == NULL) {
+        goto fail;
+    }
+
+    /* zero terminate the output */
+    *output_pointer = '\0';
+
+    item->type = sbJSON_String;
+    item->u.valuestring = (char *)output;
+    /* arena strings are released together with the arena, in situ strings
+     * belong to the caller's buffer and inline ones to the node */
+    item->is_reference = (input_buffer->arena != NULL) ||
+                         input_buffer->in_situ ||
+                         is_inline_string(item, (char *)output);
+
+    input_buffer->offset = (size_t)(input_end - input_buffer->content);
+    input_buffer->offset++;
+
+    return true;
+
+fail:
+    if ((output != NULL) && (input_buffer->arena == NULL) &&
+        !input_buffer->in_situ && !is_inline_string(item, (char *)output)) {
+        input_buffer->hooks.deallocate(output);
+    }
+
+    input_buffer->offset = (size_t)(input_pointer - input_buffer->content);
+
+    return false;
+}
+
+/* Find the closing quote of the string at the buffer offset. skipped_bytes
+ * counts the bytes unescaping will drop, 0 means there is nothing to unescape.
+ */
+static unsigned char const *
+find_string_end(parse_buffer const *const input_buffer,
+                size_t *const skipped_bytes) {
+    unsigned char const *input_end = buffer_at_offset(input_buffer) + 1;
+    unsigned char const *const content_end =
+        input_buffer->content + input_buffer->length;
+
+    *skipped_bytes = 0;
+
+    /* not a string */
+    if (cannot_access_at_index(input_buffer, 0) ||
+        buffer_at_offset(input_buffer)[0] != '\"') {
+        return NULL;
+    }
+
+    while (input_end < content_end) {
+        /* skip everything up to the next '"' or '\\' */
+        input_end += plain_string_run(input_end,
+                                      (size_t)(content_end - input_end), false);
+        if ((input_end >= content_end) || (*input_end == '\"')) {
+            break;
+        }
+
+        /* is escape sequence */
+        if (input_end + 1 >= content_end) {
+            /* prevent buffer overflow when last input character is a
+             * backslash */
+            return NULL;
+        }
+        (*skipped_bytes)++;
+        input_end += 2;
+    }
+    if (((size_t)(input_end - input_buffer->content) >=
+         input_buffer->length) ||
+        (*input_end != '\"')) {
+        return NULL; /* string ended unexpectedly */
+    }
+
+    return input_end;
+}
+
+/* Parse the input text into an unescaped cinput, and populate item. */
+static bool parse_string(sbJSON *const item, parse_buffer *const input_buffer) {
+    size_t skipped_bytes = 0;
+    unsigned char const *const input_end =
+        find_string_end(input_buffer, &skipped_bytes);
+
+    if (input_end == NULL) {
+        input_buffer->offset++;
+        return false;
+    }
+
+    /* This is at most how much we need for the output: the bytes between
+     * the quotes less what unescaping drops */
+    return parse_string_contents(
+        item, input_buffer, input_end,
+        (size_t)(input_end - (buffer_at_offset(input_buffer) + 1)) -
+            skipped_bytes);
+}
+
+/* Length of the input once its special characters are escaped, without the
+ * quotes */
+static size_t escaped_length(unsigned char const *const input,
+                             size_t const input_length) {
+    unsigned char const *input_pointer = NULL;
+    /* numbers of additional characters needed for escaping */
+    size_t escape_characters = 0;
+
+    for (input_pointer = input; input_pointer < input + input_length;
+         input_pointer++) {
+        input_pointer += plain_string_run(
+            input_pointer, input_length - (size_t)(input_pointer - input),
+            true);
+        if (input_pointer >= input + input_length) {
+            break;
+        }
+
+        switch (*input_pointer) {
+        case '\"':
+        case '\\':
+        case '\b':
+        case '\f':
+        case '\n':
+        case '\r':
+        case '\t':
+            /* one character escape sequence */
+            escape_characters++;
+            break;
+        default:
+            if (*input_pointer < 32) {
+                /* UTF-16 escape sequence uXXXX */
+                escape_characters += 5;
+            }
+            break;
+        }
+    }
+
+    return input_length + escape_characters;
+}
+
+static bool print_string_ptr(unsigned char const *const input,
+                             printbuffer *const output_buffer) {
+    unsigned char const *input_pointer = NULL;
+    unsigned char *output = NULL;
+    unsigned char *output_pointer = NULL;
+    size_t input_length = 0;
+    size_t output_length = 0;
+    /* numbers of additional characters needed for escaping */
+    size_t escape_characters = 0;
+
+    if (output_buffer == NULL) {
+        return false;
+    }
+
+    /* empty string */
+    if (input == NULL) {
+        output = ensure(output_buffer, sizeof("\"\""));
+        if (output == NULL) {
+            return false;
+        }
+        strcpy((char *)output, "\"\"");
+
+        return true;
+    }
+
+    input_length = strlen((char const *)input);
+
+    output_length = escaped_length(input, input_length);
+    escape_characters = output_length - input_length;
+
+    output = ensure(output_buffer, output_length + sizeof("\"\""));
+    if (output == NULL) {
+        return false;
+    }
+
+    /* no characters have to be escaped */
+    if (escape_characters == 0) {
+        output[0] = '\"';
+        memcpy(output + 1, input, output_length);
+        output[output_length + 1] = '\"';
+        output[output_length + 2] = '\0';
+
+        return true;
+    }
+
+    output[0] = '\"';
+    output_pointer = output + 1;
+    /* copy the string */
+    for (input_pointer = input; *input_pointer != '\0';
+         (void)input_pointer++, output_pointer++) {
+        /* normal characters are copied in bulk */
+        size_t const run = plain_string_run(
+            input_pointer, input_length - (size_t)(input_pointer - input),
+            true);
+        memcpy(output_pointer, input_pointer, run);
+        output_pointer += run;
+        input_pointer += run;
+
+        if (*input_pointer == '\0') {
+            break;
+        }
+
+        {
+            /* character needs to be escaped */
+            *output_pointer++ = '\\';
+            switch (*input_pointer) {
+            case '\\':
+                *output_pointer = '\\';
+                break;
+            case '\"':
+                *output_pointer = '\"';
+                break;
+            case '\b':
+                *output_pointer = 'b';
+                break;
+            case '\f':
+                *output_pointer = 'f';
+                break;
+            case '\n':
+                *output_pointer = 'n';
+                break;
+            case '\r':
+                *output_pointer = 'r';
+                break;
+            case '\t':
+                *output_pointer = 't';
+                break;
+            default:
+                /* escape and print as unicode codepoint */
+                sprintf((char *)output_pointer, "u%04x", *input_pointer);
+                output_pointer += 4;
+                break;
+            }
+        }
+    }
+    output[output_length + 1] = '\"';
+    output[output_length + 2] = '\0';
+
+    return true;
+}
+
+/* Invoke print_string_ptr (which is useful) on an item. */
+static bool print_string(sbJSON const *const item, printbuffer *const p) {
+    return print_string_ptr((unsigned char *)item->u.valuestring, p);
+}
+
+/* Predeclare these prototypes. */
+static bool parse_value(sbJSON *const item, parse_buffer *const input_buffer);
+static bool print_value(sbJSON const *const item,
+                        printbuffer *const output_buffer);
+static bool parse_array(sbJSON *const item, parse_buffer *const input_buffer);
+static bool print_array(sbJSON const *const item,
+                        printbuffer *const output_buffer);
+static bool parse_object(sbJSON *const item, parse_buffer *const input_buffer);
+static bool parse_lazy_container(sbJSON *const item,
+                                 parse_buffer *const input_buffer);
+static bool print_object(sbJSON const *const item,
+                         printbuffer *const output_buffer);
+static bool print_children(sbJSON const *const item,
+                           printbuffer *const output_buffer);
+
+/* Utility to jump whitespace and cr/lf */
+static parse_buffer *buffer_skip_whitespace(parse_buffer *const buffer) {
+    if ((buffer == NULL) || (buffer->content == NULL)) {
+        return NULL;
+    }
+
+    if (cannot_access_at_index(buffer, 0)) {
+        return buffer;
+    }
+
+    while (can_access_at_index(buffer, 0) &&
+           (buffer_at_offset(buffer)[0] <= 32)) {
+        buffer->offset++;
+    }
+
+    if (buffer->offset == buffer->length) {
+        buffer->offset--;
+    }
+
+    return buffer;
+}
+
+/* skip the UTF-8 BOM (byte order mark) if it is at the beginning of a buffer */
+static parse_buffer *skip_utf8_bom(parse_buffer *const buffer) {
+    if ((buffer == NULL) || (buffer->content == NULL) ||
+        (buffer->offset != 0)) {
+        return NULL;
+    }
+
+    if (can_access_at_index(buffer, 4) &&
+        (strncmp((char const *)buffer_at_offset(buffer), "\xEF\xBB\xBF", 3) ==
+         0)) {
+        buffer->offset += 3;
+    }
+
+    return buffer;
+}
+
+sbJSON *sbj_parse_with_opts(char const *value, char const **return_parse_end,
+                            bool require_null_terminated) {
+    size_t buffer_length;
+
+    if (NULL == value) {
+        return NULL;
+    }
+
+    /* Adding null character size due to require_null_terminated. */
+    buffer_length = strlen(value) + sizeof("");
+
+    return sbj_parse_with_length_opts(value, buffer_length, return_parse_end,
+                                      require_null_terminated);
+}
+
+/* Parse an object - create a new root, and populate. The caller sets up the
+ * allocation related fields of the buffer, errors are reported through
+ * error_out. */
+static sbJSON *parse_document(parse_buffer *const buffer_pointer,
+                              char const *value, size_t buffer_length,
+                              char const **return_parse_end,
+                              bool require_null_terminated,
+                              error *const error_out) {
+    parse_buffer buffer = *buffer_pointer;
+    sbJSON *item = NULL;
+
+    /* reset error position */
+    error_out->json = NULL;
+    error_out->position = 0;
+
+    if (value == NULL || 0 == buffer_length) {
+        goto fail;
+    }
+
+    buffer.content = (unsigned char const *)value;
+    buffer.length = buffer_length;
+    buffer.offset = 0;
+    buffer.depth = 0;
+
+    item = parse_new_item(&buffer);
+    if (item == NULL) /* memory fail */
+    {
+        goto fail;
+    }
+
+    if (!parse_value(item, buffer_skip_whitespace(skip_utf8_bom(&buffer)))) {
+        /* parse failure. ep is set. */
+        goto fail;
+    }
+
+    /* if we require null-terminated JSON without appended garbage, skip and
+     * then check for a null terminator */
+    if (require_null_terminated) {
+        buffer_skip_whitespace(&buffer);
+        if ((buffer.offset >= buffer.length) ||
+            buffer_at_offset(&buffer)[0] != '\0') {
+            goto fail;
+        }
+    }
+    if (return_parse_end) {
+        *return_parse_end = (char const *)buffer_at_offset(&buffer);
+    }
+
+    return item;
+
+fail:
+    if (item != NULL) {
+        delete_item(item, &buffer.hooks);
+    }
+
+    if (value != NULL) {
+        error local_error;
+        local_error.json = (unsigned char const *)value;
+        local_error.position = 0;
+
+        if (buffer.offset < buffer.length) {
+            local_error.position = buffer.offset;
+        } else if (buffer.length > 0) {
+            local_error.position = buffer.length - 1;
+        }
+
+        if (return_parse_end != NULL) {
+            *return_parse_end =
+                (char const *)local_error.json + local_error.position;
+        }
+
+        *error_out = local_error;
+    }
+
+    return NULL;
+}
+
+sbJSON *sbj_parse_with_length_opts(char const *value, size_t buffer_length,
+                                   char const **return_parse_end,
+                                   bool require_null_terminated) {
+    parse_buffer buffer = empty_parse_buffer;
+    buffer.hooks = global_hooks;
+
+    return parse_document(&buffer, value, buffer_length, return_parse_end,
+                          require_null_terminated, &global_error);
+}
+
+sbJSON *sbj_parse_into_arena(sbj_arena *arena, char const *value,
+                             size_t buffer_length) {
+    parse_buffer buffer = empty_parse_buffer;
+
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    buffer.hooks = global_hooks;
+    buffer.arena = arena;
+
+    return parse_document(&buffer, value, buffer_length, NULL, false,
+                          &global_error);
+}
+
+sbJSON *sbj_parse_in_situ(char *value, size_t buffer_length) {
+    parse_buffer buffer = empty_parse_buffer;
+
+    buffer.hooks = global_hooks;
+    buffer.in_situ = true;
+
+    return parse_document(&buffer, value, buffer_length, NULL, false,
+                          &global_error);
+}
+
+/* The contents of a file, mapped where the platform supports it and read into
+ * an allocation otherwise */
+struct sbj_mapped_file {
+    internal_hooks hooks;
+    char *data;
+    size_t length;
+    bool is_mapped;
+};
+
+/* Makes the file's pages available to the parser. With writable the mapping
+ * is private, so writes of the in situ parser only copy the pages they touch
+ * and never reach the file. */
+static bool map_file(char const *const path, bool const writable,
+                     sbj_mapped_file *const file) {
+#ifdef SBJSON_MMAP
+    struct stat status;
+    void *data = NULL;
+    int const descriptor = open(path, O_RDONLY);
+
+    if (descriptor < 0) {
+        return false;
+    }
+    if ((fstat(descriptor, &status) != 0) || (status.st_size < 0) ||
+        ((uint64_t)status.st_size > (uint64_t)SIZE_MAX)) {
+        close(descriptor);
+        return false;
+    }
+
+    file->length = (size_t)status.st_size;
+    if (file->length == 0) {
+        /* nothing to map, parsing reports the error */
+        close(descriptor);
+        return true;
+    }
+
+    data = mmap(NULL, file->length,
+                writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_PRIVATE,
+                descriptor, 0);
+    /* the mapping stays valid without the descriptor */
+    close(descriptor);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+#ifdef MADV_SEQUENTIAL
+    /* the parser reads front to back */
+    madvise(data, file->length, MADV_SEQUENTIAL);
+#endif
+
+    file->data = (char *)data;
+    file->is_mapped = true;
+    return true;
+#else
+    FILE *const stream = fopen(path, "rb");
+    long length = 0;
+    bool success = false;
+
+    (void)writable;
+    if (stream == NULL) {
+        return false;
+    }
+
+    if ((fseek(stream, 0, SEEK_END) != 0) || ((length = ftell(stream)) < 0) ||
+        (fseek(stream, 0, SEEK_SET) != 0)) {
+        goto cleanup;
+    }
+
+    file->length = (size_t)length;
+    if (file->length > 0) {
+        file->data = (char *)file->hooks.allocate(file->length);
+        if ((file->data == NULL) ||
+            (fread(file->data, 1, file->length, stream) != file->length)) {
+            goto cleanup;
+        }
+    }
+    success = true;
+
+cleanup:
+    fclose(stream);
+    return success;
+#endif
+}
+
+void sbj_mapped_file_free(sbj_mapped_file *file) {
+    if (file == NULL) {
+        return;
+    }
+
+    if (file->data != NULL) {
+#ifdef SBJSON_MMAP
+        if (file->is_mapped) {
+            munmap(file->data, file->length);
+        } else
+#endif
+        {
+            file->hooks.deallocate(file->data);
+        }
+    }
+    file->hooks.deallocate(file);
+}
+
+/* First non-whitespace character in [start, end), end if there is none */
+static char const *skip_whitespace_until(char const *start,
+                                         char const *const end) {
+    while ((start < end) && (*(unsigned char const *)start <= 32)) {
+        start++;
+    }
+
+    return start;
+}
+
+/* Parses the whole file as one document: only whitespace may follow it */
+static sbJSON *parse_mapped_file(char const *const path, bool const in_situ,
+                                 sbj_mapped_file **const mapping,
+                                 size_t *const error_offset) {
+    parse_buffer buffer = empty_parse_buffer;
+    sbj_mapped_file *file = NULL;
+    char const *end = NULL;
+    sbJSON *item = NULL;
+
+    if (path != NULL) {
+        file = (sbj_mapped_file *)global_hooks.allocate(
+            sizeof(sbj_mapped_file));
+    }
+    if (file != NULL) {
+        memset(file, 0, sizeof(sbj_mapped_file));
+        file->hooks = global_hooks;
+        if (!map_file(path, in_situ, file)) {
+            sbj_mapped_file_free(file);
+            file = NULL;
+        }
+    }
+    if (file == NULL) {
+        if (error_offset != NULL) {
+            *error_offset = (size_t)-1;
+        }
+        return NULL;
+    }
+
+    buffer.hooks = global_hooks;
+    buffer.in_situ = in_situ;
+    item = parse_document(&buffer, file->data, file->length, &end, false,
+                          &global_error);
+    if (item != NULL) {
+        end = skip_whitespace_until(end, file->data + file->length);
+        if (end != file->data + file->length) {
+            sbj_delete(item);
+            item = NULL;
+        }
+    }
+
+    if ((item == NULL) && (error_offset != NULL)) {
+        *error_offset = (end != NULL) ? (size_t)(end - file->data) : 0;
+    }
+    /* the error pointer would point into the released file */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((item != NULL) && (mapping != NULL)) {
+        *mapping = file;
+    } else {
+        sbj_mapped_file_free(file);
+    }
+
+    return item;
+}
+
+sbJSON *sbj_parse_file(char const *path, size_t *error_offset) {
+    return parse_mapped_file(path, false, NULL, error_offset);
+}
+
+sbJSON *sbj_parse_file_in_situ(char const *path, sbj_mapped_file **mapping,
+                               size_t *error_offset) {
+    if (mapping == NULL) {
+        if (error_offset != NULL) {
+            *error_offset = (size_t)-1;
+        }
+        return NULL;
+    }
+    *mapping = NULL;
+
+    return parse_mapped_file(path, true, mapping, error_offset);
+}
+
+/* Length of the array or object text at start up to its matching bracket, 0
+ * if it doesn't end within length. Only the nesting of brackets is checked, a
+ * '}' may close a '['. */
+static size_t skip_container(unsigned char const *const start,
+                             size_t const length) {
+    size_t depth = 0;
+    size_t i = 0;
+
+    for (i = 0; i < length; i++) {
+        switch (start[i]) {
+        case '[':
+        case '{':
+            depth++;
+            break;
+        case ']':
+        case '}':
+            if (--depth == 0) {
+                return i + 1;
+            }
+            break;
+        case '\"':
+            for (i++; (i < length) && (start[i] != '\"'); i++) {
+                if (start[i] == '\\') {
+                    i++; /* skip the escaped character */
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/* the text of a lazy container, which was checked to end when it was parsed */
+static size_t lazy_length(sbJSON const *const item) {
+    return skip_container((unsigned char const *)item->u.valuestring,
+                          (size_t)-1);
+}
+
+static bool parse_lazy_container(sbJSON *const item,
+                                 parse_buffer *const input_buffer) {
+    unsigned char const *const start = buffer_at_offset(input_buffer);
+    size_t const length =
+        skip_container(start, input_buffer->length - input_buffer->offset);
+
+    if (length == 0) {
+        return false; /* unbalanced brackets or unterminated string */
+    }
+
+    item->type = (start[0] == '[') ? sbJSON_Array : sbJSON_Object;
+    item->is_lazy = true;
+    item->u.valuestring = (char *)cast_away_const(start);
+    input_buffer->offset += length;
+
+    return true;
+}
+
+/* The numbers of a packed array in a block of their own, NULL if out of
+ * memory */
+static struct sbj_packed *copy_packed(sbJSON const *const array,
+                                      internal_hooks const *const hooks) {
+    struct sbj_packed *const copy = new_packed(
+        (size_t)array->child_count, array->u.packed->is_double, hooks);
+
+    if (copy != NULL) {
+        memcpy(copy->numbers, array->u.packed->numbers,
+               (size_t)array->child_count * sizeof(union sbj_packed_number));
+    }
+
+    return copy;
+}
+
+/* Turn the numbers of a packed array into element nodes, it stays packed if
+ * that fails */
+static bool unpack_array(sbJSON *const array) {
+    sbJSON *head = NULL;
+    sbJSON *last = NULL;
+    size_t i = 0;
+
+    for (i = 0; i < (size_t)array->child_count; i++) {
+        sbJSON *const element = sbJSON_New_Item(&global_hooks);
+        if (element == NULL) {
+            delete_item(head, &global_hooks);
+            return false;
+        }
+        packed_element(array, i, element);
+        if (head == NULL) {
+            head = element;
+        } else {
+            last->next = element;
+            element->prev = last;
+        }
+        last = element;
+    }
+    if (head != NULL) {
+        head->prev = last;
+    }
+
+    free_packed(array->u.packed);
+    array->u.vector = NULL;
+    array->is_packed = false;
+    array->child = head;
+
+    return true;
+}
+
+/* A node of sbj_duplicate_shared for item, sharing its key and its string or
+ * children. NULL if out of memory. */
+static sbJSON *share_item(sbJSON const *const item,
+                          internal_hooks const *const hooks) {
+    sbJSON *const copy = sbJSON_New_Item(hooks);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    memcpy(copy, item, sizeof(sbJSON));
+    copy->next = NULL;
+    copy->prev = NULL;
+    copy->is_arena_owned = false;
+    copy->has_inline_storage = false;
+    copy->is_shared = true;
+    copy->string_is_const = true;
+    if ((item->type == sbJSON_String) || (item->type == sbJSON_Raw)) {
+        copy->is_reference = true;
+    } else if (item->is_packed) {
+        /* the numbers are copied, there are no nodes to share */
+        copy->u.packed = copy_packed(item, hooks);
+        if (copy->u.packed == NULL) {
+            hooks->deallocate(copy);
+            return NULL;
+        }
+    } else if (((item->type == sbJSON_Array) ||
+                (item->type == sbJSON_Object)) &&
+               !item->is_lazy) {
+        /* a lazy container refers to its text and expands on its own */
+        copy->is_reference = true;
+        copy->u.index = NULL;
+    }
+
+    return copy;
+}
+
+/* Give a container of sbj_duplicate_shared children of its own, which share
+ * the next level of the original in turn */
+static bool unshare_children(sbJSON *const container) {
+    sbJSON const *child = NULL;
+    sbJSON *first = NULL;
+    sbJSON *last = NULL;
+
+    for (child = container->child; child != NULL; child = child->next) {
+        sbJSON *const copy = share_item(child, &global_hooks);
+        if (copy == NULL) {
+            delete_item(first, &global_hooks);
+            return false;
+        }
+        if (last == NULL) {
+            first = copy;
+        } else {
+            last->next = copy;
+            copy->prev = last;
+        }
+        last = copy;
+    }
+    if (first != NULL) {
+        first->prev = last;
+    }
+
+    container->child = first;
+    container->is_reference = false;
+
+    return true;
+}
+
+/* Parse the children of a lazy container, which stays empty if that fails.
+ * Containers of sbj_duplicate_shared get their own children here too, and
+ * packed arrays their element nodes, as every access to the children of an
+ * item goes through this. */
+static bool expand_lazy(sbJSON const *const item) {
+    sbJSON *const container = (sbJSON *)cast_away_const(item);
+    parse_buffer buffer = empty_parse_buffer;
+    sbJSON expanded;
+
+    if ((item != NULL) && item->is_shared && item->is_reference &&
+        ((item->type == sbJSON_Array) || (item->type == sbJSON_Object))) {
+        return unshare_children(container);
+    }
+
+    if ((item != NULL) && item->is_packed) {
+        return unpack_array(container);
+    }
+
+    if ((item == NULL) || !item->is_lazy) {
+        return true;
+    }
+
+    buffer.content = (unsigned char const *)item->u.valuestring;
+    buffer.length = lazy_length(item);
+    buffer.hooks = global_hooks;
+    buffer.lazy = true;
+
+    memset(&expanded, 0, sizeof(expanded));
+    if (!((item->type == sbJSON_Array) ? parse_array(&expanded, &buffer)
+                                       : parse_object(&expanded, &buffer))) {
+        return false;
+    }
+
+    container->child = expanded.child;
+    container->child_count = expanded.child_count;
+    container->u.index = NULL;
+    container->is_lazy = false;
+
+    return true;
+}
+
+sbJSON *sbj_parse_lazy(char const *value, size_t buffer_length) {
+    parse_buffer buffer = empty_parse_buffer;
+
+    buffer.hooks = global_hooks;
+    buffer.lazy = true;
+
+    return parse_document(&buffer, value, buffer_length, NULL, false,
+                          &global_error);
+}
+
+sbJSON *sbj_parse_packed(char const *value, size_t buffer_length) {
+    parse_buffer buffer = empty_parse_buffer;
+
+    buffer.hooks = global_hooks;
+    buffer.packed = true;
+
+    return parse_document(&buffer, value, buffer_length, NULL, false,
+                          &global_error);
+}
+
+bool sbj_expand(sbJSON *item, bool recurse) {
+    sbJSON *child = NULL;
+    bool success = true;
+
+    if (item == NULL) {
+        return false;
+    }
+
+    if (!expand_lazy(item)) {
+        return false;
+    }
+
+    if (recurse) {
+        for (child = item->child; child != NULL; child = child->next) {
+            success = sbj_expand(child, true) && success;
+        }
+    }
+
+    return success;
+}
+
+/* Default options for sbj_parse */
+sbJSON *sbj_parse(char const *value) {
+    return sbj_parse_with_opts(value, 0, 0);
+}
+
+sbJSON *sbj_parse_with_length(char const *value, size_t buffer_length) {
+    return sbj_parse_with_length_opts(value, buffer_length, 0, 0);
+}
+
+/* Two stage parsing for sbj_parse_fast. Stage 1 classifies the input 64 bytes
+ * at a time and records where every token starts: structural characters, both
+ * quotes of strings and the first byte of any other scalar. Stage 2 walks those
+ * positions with an explicit stack instead of recursion and hands each scalar
+ * to the same functions the recursive engine uses, so both build identical
+ * trees. Stage 1 runs ahead of stage 2 in small batches, which keeps the
+ * positions in cache and the memory use independent of the input size. */
+#define index_batch 256
+
+typedef struct {
+    unsigned char const *content;
+    size_t length;
+    size_t block_start; /* next block stage 1 has to look at */
+    /* whether the first byte of that block is escaped, inside a string or
+     * continues a scalar */
+    uint64_t previous_escaped;
+    uint64_t previous_in_string;
+    uint64_t previous_scalar;
+    size_t next;  /* first position stage 2 hasn't consumed yet */
+    size_t count; /* number of positions */
+    size_t positions[index_batch];
+} structural_index;
+
+typedef struct {
+    sbJSON *container;
+    sbJSON *last_child;
+} parse_frame;
+
+/* exact byte comparison, sets the high bit of every byte of word equal to c */
+static uint64_t bytes_equal(uint64_t const word, unsigned char const c) {
+    uint64_t const x = word ^ (swar_ones * c);
+    return ~(((x & ~swar_highs) + ~swar_highs) | x) & swar_highs;
+}
+
+/* gather the high bits of the bytes into the low eight bits */
+static uint64_t high_bits_to_mask(uint64_t const high) {
+    return ((high >> 7) * (uint64_t)0x0102040810204080) >> 56;
+}
+
+/* bytes in input order whatever the endianness, so bit i is input[i] */
+static uint64_t load_word_little_endian(unsigned char const *const input) {
+    return (uint64_t)input[0] | ((uint64_t)input[1] << 8) |
+           ((uint64_t)input[2] << 16) | ((uint64_t)input[3] << 24) |
+           ((uint64_t)input[4] << 32) | ((uint64_t)input[5] << 40) |
+           ((uint64_t)input[6] << 48) | ((uint64_t)input[7] << 56);
+}
+
+/* bit i of the result is the xor of bits 0 to i, that turns quote positions
+ * into a mask of everything from an opening quote up to its closing one */
+static uint64_t prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+static unsigned char const lowest_bit_positions[64] = {
+    0,  1,  48, 2,  57, 49, 28, 3,  61, 58, 50, 42, 38, 29, 17, 4,
+    62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+    63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+    46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9,  13, 8,  7,  6};
+
+/* index of the lowest set bit, bits can't be 0 */
+static unsigned int lowest_bit(uint64_t const bits) {
+    return lowest_bit_positions[((bits & (0 - bits)) *
+                                 (uint64_t)0x03F79D71B4CB0A89) >>
+                                58];
+}
+
+/* Stage 1 for the next block: turn it into bit masks of quotes, backslashes,
+ * structural characters and whitespace, drop quotes escaped by an odd run of
+ * backslashes and use the remaining ones to mask out string contents. There
+ * has to be room for 64 more positions. */
+static void index_block(structural_index *const index) {
+    uint64_t const even_bits = (uint64_t)0x5555555555555555;
+    unsigned char padded[64];
+    unsigned char const *block = index->content + index->block_start;
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t structural = 0;
+    uint64_t whitespace = 0;
+    uint64_t follows_escape = 0;
+    uint64_t odd_sequence_starts = 0;
+    uint64_t sequences_on_even_bits = 0;
+    uint64_t escaped = 0;
+    uint64_t in_string = 0;
+    uint64_t outside = 0;
+    uint64_t scalar = 0;
+    uint64_t tokens = 0;
+    size_t k = 0;
+
+    if (index->length - index->block_start < 64) {
+        /* pad the last block with whitespace */
+        memset(padded, ' ', sizeof(padded));
+        memcpy(padded, block, index->length - index->block_start);
+        block = padded;
+    }
+
+    for (k = 0; k < 8; k++) {
+        uint64_t const word = load_word_little_endian(block + 8 * k);
+        unsigned int const shift = (unsigned int)(8 * k);
+
+        quote |= high_bits_to_mask(bytes_equal(word, '\"')) << shift;
+        backslash |= high_bits_to_mask(bytes_equal(word, '\\')) << shift;
+    }
+
+    if ((quote == 0) && (backslash == 0) && (index->previous_in_string != 0)) {
+        /* all of it is the inside of a long string */
+        index->previous_escaped = 0;
+        index->block_start += 64;
+        return;
+    }
+
+    for (k = 0; k < 8; k++) {
+        uint64_t const word = load_word_little_endian(block + 8 * k);
+        /* '[' and ']' only differ from '{' and '}' in the 0x20 bit */
+        uint64_t const folded = word | (swar_ones * 0x20);
+        unsigned int const shift = (unsigned int)(8 * k);
+
+        structural |=
+            high_bits_to_mask(bytes_equal(folded, '{') |
+                              bytes_equal(folded, '}') |
+                              bytes_equal(word, ',') | bytes_equal(word, ':'))
+            << shift;
+        whitespace |=
+            high_bits_to_mask(~has_byte_greater_than(word, 32) & swar_highs)
+            << shift;
+    }
+
+    /* a character is escaped if it follows an odd run of backslashes */
+    backslash &= ~index->previous_escaped;
+    follows_escape = (backslash << 1) | index->previous_escaped;
+    odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+    sequences_on_even_bits = odd_sequence_starts + backslash;
+    index->previous_escaped = (sequences_on_even_bits < backslash) ? 1 : 0;
+    escaped = (even_bits ^ (sequences_on_even_bits << 1)) & follows_escape;
+
+    quote &= ~escaped;
+    /* from each opening quote up to, but not including, the closing one */
+    in_string = prefix_xor(quote) ^ index->previous_in_string;
+    index->previous_in_string = 0 - (in_string >> 63);
+    outside = ~(in_string | quote);
+
+    scalar = ~(whitespace | structural) & outside;
+    tokens = (structural & outside) | quote |
+             (scalar & ~((scalar << 1) | index->previous_scalar));
+    index->previous_scalar = scalar >> 63;
+
+    while (tokens != 0) {
+        index->positions[index->count++] =
+            index->block_start + lowest_bit(tokens);
+        tokens &= tokens - 1;
+    }
+    index->block_start += 64;
+}
+
+/* make sure that at least needed positions are available to stage 2, false if
+ * the input has fewer tokens left */
+static bool index_has_tokens(structural_index *const index,
+                             size_t const needed) {
+    if (index->count - index->next >= needed) {
+        return true;
+    }
+
+    /* drop the consumed positions and run stage 1 for a batch of blocks */
+    memmove(index->positions, index->positions + index->next,
+            (index->count - index->next) * sizeof(size_t));
+    index->count -= index->next;
+    index->next = 0;
+    while ((index->block_start < index->length) &&
+           (index->count + 64 <= index_batch)) {
+        index_block(index);
+    }
+
+    return index->count >= needed;
+}
+
+/* Position buffer at the next token, which must only be separated by
+ * whitespace from the end of the previous one. Stage 1 records the first byte
+ * after whitespace, so anything else in between can only be the rest of a
+ * scalar that parse_value stopped short of (like the x in nullx) and checking
+ * the byte at previous_end is enough. */
+static bool next_token(parse_buffer *const buffer,
+                       structural_index *const index,
+                       size_t const previous_end) {
+    size_t position = 0;
+
+    if (!index_has_tokens(index, 1)) {
+        buffer->offset = (previous_end < buffer->length) ? previous_end
+                                                         : buffer->length - 1;
+        return false;
+    }
+
+    position = index->positions[index->next];
+    if ((position < previous_end) ||
+        ((position > previous_end) && (buffer->content[previous_end] > 32))) {
+        buffer->offset = previous_end;
+        return false;
+    }
+
+    buffer->offset = position;
+    return true;
+}
+
+/* Parse the string token at the buffer offset. Its closing quote is the next
+ * position, so only the contents have to be looked at; consumes the opening
+ * quote. */
+static bool parse_indexed_string(sbJSON *const item, parse_buffer *const buffer,
+                                 structural_index *const index) {
+    unsigned char const *input_end = NULL;
+
+    if ((buffer_at_offset(buffer)[0] != '\"') ||
+        !index_has_tokens(index, 2)) {
+        /* not a string or unterminated, leave the error to parse_string */
+        return parse_string(item, buffer);
+    }
+
+    index->next++;
+    input_end = buffer->content + index->positions[index->next];
+    return parse_string_contents(
+        item, buffer, input_end,
+        (size_t)(input_end - (buffer_at_offset(buffer) + 1)));
+}
+
+/* allocate the next child of the container on top of the stack */
+static sbJSON *append_child(parse_buffer *const buffer,
+                            parse_frame *const frame) {
+    sbJSON *const child = parse_new_item(buffer);
+    if (child == NULL) {
+        return NULL;
+    }
+
+    if (frame->last_child == NULL) {
+        frame->container->child = child;
+    } else {
+        frame->last_child->next = child;
+        child->prev = frame->last_child;
+    }
+    frame->last_child = child;
+    frame->container->child_count++;
+
+    return child;
+}
+
+/* grow the stack of open containers, freeing it on failure */
+static parse_frame *grow_stack(internal_hooks const *const hooks,
+                               parse_frame *const stack, size_t const used,
+                               size_t const capacity) {
+    parse_frame *grown = NULL;
+
+    if (hooks->reallocate != NULL) {
+        grown = (parse_frame *)hooks->reallocate(stack,
+                                                 capacity * sizeof(parse_frame));
+        if (grown == NULL) {
+            hooks->deallocate(stack);
+        }
+        return grown;
+    }
+
+    grown = (parse_frame *)hooks->allocate(capacity * sizeof(parse_frame));
+    if (stack != NULL) {
+        if (grown != NULL) {
+            memcpy(grown, stack, used * sizeof(parse_frame));
+        }
+        hooks->deallocate(stack);
+    }
+
+    return grown;
+}
+
+typedef enum {
+    expect_value,
+    expect_first_element,
+    expect_first_member,
+    expect_key,
+    expect_colon,
+    expect_comma_or_end
+} fast_parse_state;
+
+sbJSON *sbj_parse_fast(char const *value, size_t buffer_length) {
+    parse_buffer buffer = empty_parse_buffer;
+    structural_index index;
+    parse_frame *stack = NULL;
+    size_t stack_capacity = 0;
+    size_t end = 0; /* offset just past the last token consumed */
+    fast_parse_state state = expect_value;
+    sbJSON *root = NULL;
+    sbJSON *item = NULL;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((value == NULL) || (0 == buffer_length)) {
+        return NULL;
+    }
+
+    buffer.content = (unsigned char const *)value;
+    buffer.length = buffer_length;
+    buffer.hooks = global_hooks;
+    skip_utf8_bom(&buffer);
+    end = buffer.offset;
+
+    index.content = buffer.content;
+    index.length = buffer.length;
+    index.block_start = buffer.offset;
+    index.previous_escaped = 0;
+    index.previous_in_string = 0;
+    index.previous_scalar = 0;
+    index.next = 0;
+    index.count = 0;
+
+    root = item = parse_new_item(&buffer);
+    if (root == NULL) {
+        goto fail; /* allocation failure */
+    }
+
+    for (;;) {
+        parse_frame *const top =
+            (buffer.depth > 0) ? &stack[buffer.depth - 1] : NULL;
+        unsigned char c = 0;
+
+        if (!next_token(&buffer, &index, end)) {
+            goto fail;
+        }
+        c = buffer_at_offset(&buffer)[0];
+
+        switch (state) {
+        case expect_first_element:
+        case expect_first_member:
+            if (c == ((state == expect_first_element) ? ']' : '}')) {
+                break; /* empty, close it below */
+            }
+            item = append_child(&buffer, top);
+            if (item == NULL) {
+                goto fail; /* allocation failure */
+            }
+            state = (state == expect_first_element) ? expect_value : expect_key;
+            continue; /* the same token starts the child */
+
+        case expect_value:
+            if ((c == '[') || (c == '{')) {
+                if (!can_nest_deeper(&buffer)) {
+                    goto fail; /* to deeply nested */
+                }
+                if (buffer.depth == stack_capacity) {
+                    stack_capacity = (stack_capacity == 0) ? 16
+                                                           : stack_capacity * 2;
+                    stack = grow_stack(&buffer.hooks, stack, buffer.depth,
+                                       stack_capacity);
+                    if (stack == NULL) {
+                        goto fail; /* allocation failure */
+                    }
+                }
+                item->type = (c == '[') ? sbJSON_Array : sbJSON_Object;
+                stack[buffer.depth].container = item;
+                stack[buffer.depth].last_child = NULL;
+                buffer.depth++;
+                state = (c == '[') ? expect_first_element : expect_first_member;
+                index.next++;
+                end = buffer.offset + 1;
+                continue;
+            }
+            if (c == '\"') {
+                if (!parse_indexed_string(item, &buffer, &index)) {
+                    goto fail;
+                }
+            } else if ((c == '-') || ((c >= '0') && (c <= '9'))) {
+                if (!parse_number(item, &buffer)) {
+                    goto fail;
+                }
+            } else if (!parse_value(item, &buffer)) {
+                goto fail;
+            }
+            index.next++;
+            end = buffer.offset;
+            if (buffer.depth == 0) {
+                goto success;
+            }
+            state = expect_comma_or_end;
+            continue;
+
+        case expect_key:
+            if (!parse_indexed_string(item, &buffer, &index)) {
+                goto fail; /* failed to parse name */
+            }
+            /* swap valuestring and string, because we parsed the name */
+            item->string = item->u.valuestring;
+            item->u.valuestring = NULL;
+            item->string_is_const = item->is_reference;
+            item->is_reference = false;
+            index.next++;
+            end = buffer.offset;
+            state = expect_colon;
+            continue;
+
+        case expect_colon:
+            if (c != ':') {
+                goto fail; /* invalid object */
+            }
+            index.next++;
+            end = buffer.offset + 1;
+            state = expect_value;
+            continue;
+
+        case expect_comma_or_end:
+            if (c == ',') {
+                item = append_child(&buffer, top);
+                if (item == NULL) {
+                    goto fail; /* allocation failure */
+                }
+                index.next++;
+                end = buffer.offset + 1;
+                state = (top->container->type == sbJSON_Array) ? expect_value
+                                                               : expect_key;
+                continue;
+            }
+            if (c != ((top->container->type == sbJSON_Array) ? ']' : '}')) {
+                goto fail; /* expected end of array/object */
+            }
+            break;
+        }
+
+        /* c closes the container on top of the stack */
+        if (top->container->child != NULL) {
+            top->container->child->prev = top->last_child;
+        }
+        item = top->container;
+        buffer.depth--;
+        index.next++;
+        end = buffer.offset + 1;
+        if (buffer.depth == 0) {
+            goto success;
+        }
+        state = expect_comma_or_end;
+    }
+
+success:
+    if (stack != NULL) {
+        buffer.hooks.deallocate(stack);
+    }
+
+    return root;
+
+fail:
+    if (stack != NULL) {
+        buffer.hooks.deallocate(stack);
+    }
+    if (root != NULL) {
+        delete_item(root, &buffer.hooks);
+    }
+
+    global_error.json = (unsigned char const *)value;
+    global_error.position =
+        (buffer.offset < buffer.length) ? buffer.offset : buffer.length - 1;
+
+    return NULL;
+}
+
+typedef enum {
+    stream_no_token,
+    stream_string,
+    stream_number,
+    stream_literal
+} stream_token;
+
+struct sbj_stream_parser {
+    parse_buffer buffer; /* hooks and nesting, the content changes per token */
+    parse_frame *stack;
+    size_t stack_capacity;
+    fast_parse_state state;
+    sbJSON *root;
+    sbJSON *item;    /* where the next value goes */
+    size_t position; /* offset of the current chunk in the whole input */
+    size_t error_position;
+    bool done;
+    bool failed;
+    /* the token that started in an earlier chunk, if any */
+    stream_token token;
+    bool is_key;
+    bool escaped; /* the last byte of the string so far was a backslash */
+    char const *literal;
+    size_t literal_matched;
+    /* the bytes of a string or number token from earlier chunks */
+    unsigned char *scratch;
+    size_t scratch_length;
+    size_t scratch_capacity;
+};
+
+sbj_stream_parser *sbj_stream_parser_new(void) {
+    sbj_stream_parser *parser = (sbj_stream_parser *)global_hooks.allocate(
+        sizeof(sbj_stream_parser));
+    if (parser == NULL) {
+        return NULL;
+    }
+
+    memset(parser, 0, sizeof(sbj_stream_parser));
+    parser->buffer.hooks = global_hooks;
+    parser->state = expect_value;
+    parser->root = parser->item = parse_new_item(&parser->buffer);
+    if (parser->root == NULL) {
+        global_hooks.deallocate(parser);
+        return NULL;
+    }
+
+    return parser;
+}
+
+static bool append_to_scratch(sbj_stream_parser *const parser,
+                              unsigned char const *const bytes,
+                              size_t const length) {
+    internal_hooks const *const hooks = &parser->buffer.hooks;
+
+    if (parser->scratch_length + length > parser->scratch_capacity) {
+        size_t capacity = (parser->scratch_capacity == 0)
+                              ? 64
+                              : parser->scratch_capacity * 2;
+        unsigned char *grown = NULL;
+
+        while (capacity < parser->scratch_length + length) {
+            capacity *= 2;
+        }
+        if (hooks->reallocate != NULL) {
+            grown =
+                (unsigned char *)hooks->reallocate(parser->scratch, capacity);
+            if (grown == NULL) {
+                return false;
+            }
+        } else {
+            grown = (unsigned char *)hooks->allocate(capacity);
+            if (grown == NULL) {
+                return false;
+            }
+            if (parser->scratch != NULL) {
+                memcpy(grown, parser->scratch, parser->scratch_length);
+                hooks->deallocate(parser->scratch);
+            }
+        }
+        parser->scratch = grown;
+        parser->scratch_capacity = capacity;
+    }
+
+    memcpy(parser->scratch + parser->scratch_length, bytes, length);
+    parser->scratch_length += length;
+
+    return true;
+}
+
+/* the current item got its value */
+static void stream_value_parsed(sbj_stream_parser *const parser) {
+    if (parser->buffer.depth == 0) {
+        parser->done = true;
+    } else {
+        parser->state = expect_comma_or_end;
+    }
+}
+
+/* Parse the complete string or number token in content[offset, length) into
+ * the current item. */
+static bool stream_parse_token(sbj_stream_parser *const parser,
+                               unsigned char const *const content,
+                               size_t const offset, size_t const length) {
+    parse_buffer buffer = parser->buffer;
+    sbJSON *const item = parser->item;
+    stream_token const token = parser->token;
+
+    buffer.content = content;
+    buffer.offset = offset;
+    buffer.length = length;
+    parser->token = stream_no_token;
+
+    if (token == stream_number) {
+        if (!parse_number(item, &buffer)) {
+            return false;
+        }
+        /* what follows a number inside a container can't continue the
+         * token, e.g. the 'e' of "1e]". After the root it is ignored. */
+        if ((buffer.offset != length) && (parser->buffer.depth > 0)) {
+            return false;
+        }
+        stream_value_parsed(parser);
+        return true;
+    }
+
+    if (!parse_string(item, &buffer)) {
+        return false;
+    }
+    if (parser->is_key) {
+        /* swap valuestring and string, because we parsed the name */
+        item->string = item->u.valuestring;
+        item->u.valuestring = NULL;
+        item->string_is_const = item->is_reference;
+        item->is_reference = false;
+        parser->state = expect_colon;
+    } else {
+        stream_value_parsed(parser);
+    }
+
+    return true;
+}
+
+/* Consume as much of the current token as input[*position, length) holds.
+ * token_start is where the token began if that was in this chunk. */
+static bool stream_continue_token(sbj_stream_parser *const parser,
+                                  unsigned char const *const input,
+                                  size_t const length, size_t *const position,
+                                  size_t const token_start) {
+    size_t end = *position;
+    bool complete = false;
+
+    switch (parser->token) {
+    case stream_literal:
+        for (; (end < length) && (parser->literal[parser->literal_matched] !=
+                                  '\0');
+             end++, parser->literal_matched++) {
+            if (input[end] !=
+                (unsigned char)parser->literal[parser->literal_matched]) {
+                *position = end;
+                return false;
+            }
+        }
+        *position = end;
+        if (parser->literal[parser->literal_matched] != '\0') {
+            return true; /* continues in the next chunk */
+        }
+        parser->token = stream_no_token;
+        switch (parser->literal[0]) {
+        case 'n':
+            parser->item->type = sbJSON_Null;
+            break;
+        case 't':
+        case 'f':
+            parser->item->type = sbJSON_Bool;
+            parser->item->u.valuebool = (parser->literal[0] == 't');
+            break;
+        default:
+            return true; /* byte order mark */
+        }
+        stream_value_parsed(parser);
+        return true;
+
+    case stream_string:
+        while (end < length) {
+            if (parser->escaped) {
+                parser->escaped = false;
+                end++;
+                continue;
+            }
+            end += plain_string_run(input + end, length - end, false);
+            if (end >= length) {
+                break;
+            }
+            end++;
+            if (input[end - 1] == '\\') {
+                parser->escaped = true;
+                continue;
+            }
+            complete = true; /* closing quote */
+            break;
+        }
+        break;
+
+    case stream_number:
+        while ((end < length) &&
+               (is_decimal_digit(input[end]) || (input[end] == '.') ||
+                (input[end] == 'e') || (input[end] == 'E') ||
+                (input[end] == '+') || (input[end] == '-'))) {
+            end++;
+        }
+        complete = (end < length);
+        break;
+
+    default:
+        return false;
+    }
+
+    *position = end;
+    if (complete && (parser->scratch_length == 0)) {
+        /* the whole token is in this chunk, parse it where it is */
+        return stream_parse_token(parser, input, token_start, end);
+    }
+    if (!append_to_scratch(parser, input + token_start, end - token_start)) {
+        return false;
+    }
+    if (!complete) {
+        return true;
+    }
+    end = parser->scratch_length;
+    parser->scratch_length = 0;
+
+    return stream_parse_token(parser, parser->scratch, 0, end);
+}
+
+/* start a token with the byte at input[*position] */
+static bool stream_start_token(sbj_stream_parser *const parser,
+                               unsigned char const *const input,
+                               size_t const length, size_t *const position) {
+    unsigned char const c = input[*position];
+
+    if (c == '\"') {
+        parser->token = stream_string;
+        parser->escaped = false;
+        parser->is_key = (parser->state == expect_key);
+        /* scan from after the opening quote */
+        (*position)++;
+        return stream_continue_token(parser, input, length, position,
+                                     *position - 1);
+    }
+
+    if (parser->state == expect_key) {
+        return false; /* failed to parse name */
+    }
+
+    if ((c == '-') || is_decimal_digit(c)) {
+        parser->token = stream_number;
+    } else if ((c == 0xEF) && (parser->position + *position == 0)) {
+        parser->token = stream_literal;
+        parser->literal = "\xEF\xBB\xBF";
+    } else if ((c == 'n') || (c == 't') || (c == 'f')) {
+        parser->token = stream_literal;
+        parser->literal = (c == 'n') ? "null" : ((c == 't') ? "true" : "false");
+    } else {
+        return false;
+    }
+    parser->literal_matched = 0;
+
+    return stream_continue_token(parser, input, length, position, *position);
+}
+
+bool sbj_stream_feed(sbj_stream_parser *parser, char const *chunk,
+                     size_t length) {
+    unsigned char const *const input = (unsigned char const *)chunk;
+    size_t position = 0;
+
+    if ((parser == NULL) || parser->failed) {
+        return false;
+    }
+    if (chunk == NULL) {
+        return length == 0;
+    }
+
+    if (parser->token != stream_no_token) {
+        if (!stream_continue_token(parser, input, length, &position, 0)) {
+            goto fail;
+        }
+    }
+
+    while ((position < length) && !parser->done) {
+        size_t const depth = parser->buffer.depth;
+        parse_frame *const top = (depth > 0) ? &parser->stack[depth - 1] : NULL;
+        unsigned char const c = input[position];
+
+        if (c <= 32) {
+            position++; /* whitespace */
+            continue;
+        }
+
+        switch (parser->state) {
+        case expect_first_element:
+        case expect_first_member:
+            if (c == ((parser->state == expect_first_element) ? ']' : '}')) {
+                break; /* empty, close it below */
+            }
+            parser->item = append_child(&parser->buffer, top);
+            if (parser->item == NULL) {
+                goto fail; /* allocation failure */
+            }
+            parser->state = (parser->state == expect_first_element)
+                                ? expect_value
+                                : expect_key;
+            continue; /* the same byte starts the child */
+
+        case expect_value:
+            if ((c == '[') || (c == '{')) {
+                if (!can_nest_deeper(&parser->buffer)) {
+                    goto fail; /* to deeply nested */
+                }
+                if (depth == parser->stack_capacity) {
+                    parser->stack_capacity = (parser->stack_capacity == 0)
+                                                 ? 16
+                                                 : parser->stack_capacity * 2;
+                    parser->stack =
+                        grow_stack(&parser->buffer.hooks, parser->stack, depth,
+                                   parser->stack_capacity);
+                    if (parser->stack == NULL) {
+                        goto fail; /* allocation failure */
+                    }
+                }
+                parser->item->type = (c == '[') ? sbJSON_Array : sbJSON_Object;
+                parser->stack[depth].container = parser->item;
+                parser->stack[depth].last_child = NULL;
+                parser->buffer.depth++;
+                parser->state =
+                    (c == '[') ? expect_first_element : expect_first_member;
+                position++;
+                continue;
+            }
+            /* fall through */
+        case expect_key:
+            if (!stream_start_token(parser, input, length, &position)) {
+                goto fail;
+            }
+            continue;
+
+        case expect_colon:
+            if (c != ':') {
+                goto fail; /* invalid object */
+            }
+            position++;
+            parser->state = expect_value;
+            continue;
+
+        case expect_comma_or_end:
+            if (c == ',') {
+                parser->item = append_child(&parser->buffer, top);
+                if (parser->item == NULL) {
+                    goto fail; /* allocation failure */
+                }
+                position++;
+                parser->state = (top->container->type == sbJSON_Array)
+                                    ? expect_value
+                                    : expect_key;
+                continue;
+            }
+            if (c != ((top->container->type == sbJSON_Array) ? ']' : '}')) {
+                goto fail; /* expected end of array/object */
+            }
+            break;
+        }
+
+        /* c closes the container on top of the stack */
+        if (top->container->child != NULL) {
+            top->container->child->prev = top->last_child;
+        }
+        parser->item = top->container;
+        parser->buffer.depth--;
+        position++;
+        stream_value_parsed(parser);
+    }
+
+    parser->position += length;
+
+    return true;
+
+fail:
+    parser->failed = true;
+    parser->error_position = parser->position + position;
+
+    return false;
+}
+
+size_t sbj_stream_error_position(sbj_stream_parser const *parser) {
+    return ((parser != NULL) && parser->failed) ? parser->error_position : 0;
+}
+
+sbJSON *sbj_stream_finish(sbj_stream_parser *parser) {
+    internal_hooks hooks;
+    sbJSON *root = NULL;
+
+    if (parser == NULL) {
+        return NULL;
+    }
+    hooks = parser->buffer.hooks;
+
+    /* only a number can end with the input */
+    if (!parser->failed && (parser->token == stream_number)) {
+        parser->failed = !stream_parse_token(parser, parser->scratch, 0,
+                                             parser->scratch_length);
+        if (parser->failed) {
+            parser->error_position = parser->position;
+        }
+    }
+
+    if (!parser->failed && parser->done) {
+        root = parser->root;
+    } else if (parser->root != NULL) {
+        delete_item(parser->root, &hooks);
+    }
+
+    if (parser->stack != NULL) {
+        hooks.deallocate(parser->stack);
+    }
+    if (parser->scratch != NULL) {
+        hooks.deallocate(parser->scratch);
+    }
+    hooks.deallocate(parser);
+
+    return root;
+}
+
+typedef struct {
+    parse_buffer buffer;
+    sbj_sax_handler const *handler;
+    void *user;
+    /* unescaped strings go here */
+    unsigned char *scratch;
+    size_t scratch_size;
+} sax_parser;
+
+static bool sax_parse_value(sax_parser *const parser);
+
+static bool sax_parse_string(sax_parser *const parser, bool const is_key) {
+    parse_buffer *const input_buffer = &parser->buffer;
+    bool (*const callback)(void *, char const *, size_t) =
+        is_key ? parser->handler->key : parser->handler->string;
+    unsigned char const *input_pointer = buffer_at_offset(input_buffer) + 1;
+    size_t skipped_bytes = 0;
+    unsigned char const *const input_end =
+        find_string_end(input_buffer, &skipped_bytes);
+    char const *string = (char const *)input_pointer;
+    size_t length = 0;
+
+    if (input_end == NULL) {
+        input_buffer->offset++;
+        return false;
+    }
+
+    if (skipped_bytes == 0) {
+        /* nothing to unescape, pass the input on */
+        length = (size_t)(input_end - input_pointer);
+    } else {
+        /* unescape even without a callback to reject invalid sequences */
+        size_t const needed = (size_t)(input_end - input_pointer) + sizeof("");
+        unsigned char *output_end = NULL;
+
+        if (needed > parser->scratch_size) {
+            if (parser->scratch != NULL) {
+                input_buffer->hooks.deallocate(parser->scratch);
+            }
+            parser->scratch_size = 0;
+            parser->scratch =
+                (unsigned char *)input_buffer->hooks.allocate(needed);
+            if (parser->scratch == NULL) {
+                return false; /* allocation failure */
+            }
+            parser->scratch_size = needed;
+        }
+
+        output_end =
+            unescape_string(&input_pointer, input_end, parser->scratch);
+        if (output_end == NULL) {
+            input_buffer->offset =
+                (size_t)(input_pointer - input_buffer->content);
+            return false;
+        }
+        *output_end = '\0';
+        string = (char const *)parser->scratch;
+        length = (size_t)(output_end - parser->scratch);
+    }
+
+    if ((callback != NULL) && !callback(parser->user, string, length)) {
+        return false;
+    }
+
+    input_buffer->offset = (size_t)(input_end - input_buffer->content) + 1;
+
+    return true;
+}
+
+static bool sax_parse_number(sax_parser *const parser) {
+    sbJSON number;
+
+    memset(&number, 0, sizeof(number));
+    if (!parse_number(&number, &parser->buffer)) {
+        return false;
+    }
+
+    if (number.is_number_double) {
+        return (parser->handler->double_number == NULL) ||
+               parser->handler->double_number(parser->user,
+                                              number.u.valuedouble);
+    }
+
+    return (parser->handler->integer == NULL) ||
+           parser->handler->integer(parser->user, number.u.valueint);
+}
+
+static bool sax_parse_array(sax_parser *const parser) {
+    parse_buffer *const input_buffer = &parser->buffer;
+    sbj_sax_handler const *const handler = parser->handler;
+
+    if (!can_nest_deeper(input_buffer)) {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    if ((handler->start_array != NULL) && !handler->start_array(parser->user)) {
+        return false;
+    }
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) &&
+        (buffer_at_offset(input_buffer)[0] == ']')) {
+        goto success; /* empty array */
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0)) {
+        input_buffer->offset--;
+        return false;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    /* loop through the comma separated array elements */
+    do {
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!sax_parse_value(parser)) {
+            return false; /* failed to parse value */
+        }
+        buffer_skip_whitespace(input_buffer);
+    } while (can_access_at_index(input_buffer, 0) &&
+             (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) ||
+        buffer_at_offset(input_buffer)[0] != ']') {
+        return false; /* expected end of array */
+    }
+
+success:
+    input_buffer->depth--;
+    input_buffer->offset++;
+
+    return (handler->end_array == NULL) || handler->end_array(parser->user);
+}
+
+static bool sax_parse_object(sax_parser *const parser) {
+    parse_buffer *const input_buffer = &parser->buffer;
+    sbj_sax_handler const *const handler = parser->handler;
+
+    if (!can_nest_deeper(input_buffer)) {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    if ((handler->start_object != NULL) &&
+        !handler->start_object(parser->user)) {
+        return false;
+    }
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) &&
+        (buffer_at_offset(input_buffer)[0] == '}')) {
+        goto success; /* empty object */
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0)) {
+        input_buffer->offset--;
+        return false;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    /* loop through the comma separated object members */
+    do {
+        /* parse the name of the child */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!sax_parse_string(parser, true)) {
+            return false; /* failed to parse name */
+        }
+        buffer_skip_whitespace(input_buffer);
+
+        if (cannot_access_at_index(input_buffer, 0) ||
+            (buffer_at_offset(input_buffer)[0] != ':')) {
+            return false; /* invalid object */
+        }
+
+        /* parse the value */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!sax_parse_value(parser)) {
+            return false; /* failed to parse value */
+        }
+        buffer_skip_whitespace(input_buffer);
+    } while (can_access_at_index(input_buffer, 0) &&
+             (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) ||
+        (buffer_at_offset(input_buffer)[0] != '}')) {
+        return false; /* expected end of object */
+    }
+
+success:
+    input_buffer->depth--;
+    input_buffer->offset++;
+
+    return (handler->end_object == NULL) || handler->end_object(parser->user);
+}
+
+/* parse_value without a tree */
+static bool sax_parse_value(sax_parser *const parser) {
+    parse_buffer *const input_buffer = &parser->buffer;
+    sbj_sax_handler const *const handler = parser->handler;
+    unsigned char c = 0;
+
+    if (can_read(input_buffer, 4) &&
+        (strncmp((char const *)buffer_at_offset(input_buffer), "null", 4) ==
+         0)) {
+        input_buffer->offset += 4;
+        return (handler->null == NULL) || handler->null(parser->user);
+    }
+    if (can_read(input_buffer, 5) &&
+        (strncmp((char const *)buffer_at_offset(input_buffer), "false", 5) ==
+         0)) {
+        input_buffer->offset += 5;
+        return (handler->boolean == NULL) ||
+               handler->boolean(parser->user, false);
+    }
+    if (can_read(input_buffer, 4) &&
+        (strncmp((char const *)buffer_at_offset(input_buffer), "true", 4) ==
+         0)) {
+        input_buffer->offset += 4;
+        return (handler->boolean == NULL) ||
+               handler->boolean(parser->user, true);
+    }
+
+    if (cannot_access_at_index(input_buffer, 0)) {
+        return false;
+    }
+    c = buffer_at_offset(input_buffer)[0];
+    if (c == '\"') {
+        return sax_parse_string(parser, false);
+    }
+    if ((c == '-') || is_decimal_digit(c)) {
+        return sax_parse_number(parser);
+    }
+    if (c == '[') {
+        return sax_parse_array(parser);
+    }
+    if (c == '{') {
+        return sax_parse_object(parser);
+    }
+
+    return false;
+}
+
+bool sbj_parse_sax(char const *value, size_t buffer_length,
+                   sbj_sax_handler const *handler, void *user) {
+    sax_parser parser;
+    bool success = false;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((value == NULL) || (0 == buffer_length) || (handler == NULL)) {
+        /* like sbj_parse_with_length, point at the start of the input */
+        global_error.json = (unsigned char const *)value;
+        return false;
+    }
+
+    memset(&parser, 0, sizeof(parser));
+    parser.buffer.content = (unsigned char const *)value;
+    parser.buffer.length = buffer_length;
+    parser.buffer.hooks = global_hooks;
+    parser.handler = handler;
+    parser.user = user;
+
+    buffer_skip_whitespace(skip_utf8_bom(&parser.buffer));
+    success = sax_parse_value(&parser);
+
+    if (parser.scratch != NULL) {
+        parser.buffer.hooks.deallocate(parser.scratch);
+    }
+
+    if (!success) {
+        global_error.json = (unsigned char const *)value;
+        global_error.position = (parser.buffer.offset < parser.buffer.length)
+                                    ? parser.buffer.offset
+                                    : parser.buffer.length - 1;
+    }
+
+    return success;
+}
+
+/* The validator walks the input like parse_value, without building a tree or
+ * calling anything that allocates. */
+static bool validate_value(parse_buffer *const input_buffer);
+
+/* Checks the string at the buffer offset like parse_string, the escape
+ * sequences like unescape_string, without writing the unescaped string. */
+static bool validate_string(parse_buffer *const input_buffer) {
+    unsigned char const *input_pointer = buffer_at_offset(input_buffer) + 1;
+    size_t skipped_bytes = 0;
+    unsigned char const *const input_end =
+        find_string_end(input_buffer, &skipped_bytes);
+
+    if (input_end == NULL) {
+        input_buffer->offset++;
+        return false;
+    }
+
+    while ((skipped_bytes != 0) && (input_pointer < input_end)) {
+        input_pointer += plain_string_run(
+            input_pointer, (size_t)(input_end - input_pointer), false);
+        if (input_pointer >= input_end) {
+            break;
+        }
+
+        switch (input_pointer[1]) {
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+        case '\"':
+        case '\\':
+        case '/':
+            input_pointer += 2;
+            break;
+
+        /* UTF-16 literal */
+        case 'u': {
+            long unsigned int codepoint = 0;
+            unsigned char const sequence_length =
+                utf16_literal_codepoint(input_pointer, input_end, &codepoint);
+            if (sequence_length == 0) {
+                goto fail;
+            }
+            input_pointer += sequence_length;
+            break;
+        }
+
+        default:
+            goto fail;
+        }
+    }
+
+    input_buffer->offset = (size_t)(input_end - input_buffer->content) + 1;
+
+    return true;
+
+fail:
+    input_buffer->offset = (size_t)(input_pointer - input_buffer->content);
+
+    return false;
+}
+
+/* Accepts the same numbers as parse_number without converting them */
+static bool validate_number(parse_buffer *const input_buffer) {
+    unsigned char const *const start = buffer_at_offset(input_buffer);
+    unsigned char const *const end =
+        input_buffer->content + input_buffer->length;
+    unsigned char const *current = start;
+    bool has_digits = false;
+
+    if ((current < end) && (*current == '-')) {
+        current++;
+    }
+    for (; (current < end) && is_decimal_digit(*current); current++) {
+        has_digits = true;
+    }
+    if ((current < end) && (*current == '.')) {
+        for (current++; (current < end) && is_decimal_digit(*current);
+             current++) {
+            has_digits = true;
+        }
+    }
+
+    if (!has_digits) {
+        return false; /* parse_error */
+    }
+
+    if ((current < end) && ((*current == 'e') || (*current == 'E'))) {
+        unsigned char const *exponent_end = current + 1;
+
+        if ((exponent_end < end) &&
+            ((*exponent_end == '+') || (*exponent_end == '-'))) {
+            exponent_end++;
+        }
+
+        /* without digits the 'e' isn't part of the number */
+        if ((exponent_end < end) && is_decimal_digit(*exponent_end)) {
+            while ((exponent_end < end) && is_decimal_digit(*exponent_end)) {
+                exponent_end++;
+            }
+            current = exponent_end;
+        }
+    }
+
+    input_buffer->offset += (size_t)(current - start);
+
+    return true;
+}
+
+static bool validate_array(parse_buffer *const input_buffer) {
+    if (!can_nest_deeper(input_buffer)) {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) &&
+        (buffer_at_offset(input_buffer)[0] == ']')) {
+        goto success; /* empty array */
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0)) {
+        input_buffer->offset--;
+        return false;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    /* loop through the comma separated array elements */
+    do {
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!validate_value(input_buffer)) {
+            return false; /* failed to parse value */
+        }
+        buffer_skip_whitespace(input_buffer);
+    } while (can_access_at_index(input_buffer, 0) &&
+             (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) ||
+        buffer_at_offset(input_buffer)[0] != ']') {
+        return false; /* expected end of array */
+    }
+
+success:
+    input_buffer->depth--;
+    input_buffer->offset++;
+
+    return true;
+}
+
+static bool validate_object(parse_buffer *const input_buffer) {
+    if (!can_nest_deeper(input_buffer)) {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) &&
+        (buffer_at_offset(input_buffer)[0] == '}')) {
+        goto success; /* empty object */
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0)) {
+        input_buffer->offset--;
+        return false;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    /* loop through the comma separated object members */
+    do {
+        /* check the name of the child */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!validate_string(input_buffer)) {
+            return false; /* failed to parse name */
+        }
+        buffer_skip_whitespace(input_buffer);
+
+        if (cannot_access_at_index(input_buffer, 0) ||
+            (buffer_at_offset(input_buffer)[0] != ':')) {
+            return false; /* invalid object */
+        }
+
+        /* check the value */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!validate_value(input_buffer)) {
+            return false; /* failed to parse value */
+        }
+        buffer_skip_whitespace(input_buffer);
+    } while (can_access_at_index(input_buffer, 0) &&
+             (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) ||
+        (buffer_at_offset(input_buffer)[0] != '}')) {
+        return false; /* expected end of object */
+    }
+
+success:
+    input_buffer->depth--;
+    input_buffer->offset++;
+
+    return true;
+}
+
+/* parse_value without a result */
+static bool validate_value(parse_buffer *const input_buffer) {
+    unsigned char c = 0;
+
+    if (can_read(input_buffer, 4) &&
+        (strncmp((char const *)buffer_at_offset(input_buffer), "null", 4) ==
+         0)) {
+        input_buffer->offset += 4;
+        return true;
+    }
+    if (can_read(input_buffer, 5) &&
+        (strncmp((char const *)buffer_at_offset(input_buffer), "false", 5) ==
+         0)) {
+        input_buffer->offset += 5;
+        return true;
+    }
+    if (can_read(input_buffer, 4) &&
+        (strncmp((char const *)buffer_at_offset(input_buffer), "true", 4) ==
+         0)) {
+        input_buffer->offset += 4;
+        return true;
+    }
+
+    if (cannot_access_at_index(input_buffer, 0)) {
+        return false;
+    }
+    c = buffer_at_offset(input_buffer)[0];
+    if (c == '\"') {
+        return validate_string(input_buffer);
+    }
+    if ((c == '-') || is_decimal_digit(c)) {
+        return validate_number(input_buffer);
+    }
+    if (c == '[') {
+        return validate_array(input_buffer);
+    }
+    if (c == '{') {
+        return validate_object(input_buffer);
+    }
+
+    return false;
+}
+
+bool sbj_validate(char const *value, size_t buffer_length,
+                  size_t *error_offset) {
+    parse_buffer buffer = empty_parse_buffer;
+    bool valid = false;
+
+    if (error_offset != NULL) {
+        *error_offset = 0;
+    }
+    if ((value == NULL) || (0 == buffer_length)) {
+        return false;
+    }
+
+    buffer.content = (unsigned char const *)value;
+    buffer.length = buffer_length;
+
+    valid = validate_value(buffer_skip_whitespace(skip_utf8_bom(&buffer)));
+    if (valid) {
+        /* only whitespace may follow the value */
+        char const *const end = skip_whitespace_until(
+            (char const *)buffer_at_offset(&buffer), value + buffer_length);
+        buffer.offset = (size_t)(end - value);
+        valid = (buffer.offset == buffer.length);
+    }
+
+    if (!valid && (error_offset != NULL)) {
+        /* the same position parse_document reports */
+        *error_offset = (buffer.offset < buffer.length) ? buffer.offset
+                                                        : buffer.length - 1;
+    }
+
+    return valid;
+}
+
+/* Decoding into structs: the parser's string and number functions fill
+ * fields through a node on the stack, members without a field are skipped
+ * with the validator. */
+static bool decode_fields(sbj_binding const *const binding, void *const out,
+                          parse_buffer *const input_buffer);
+static void release_value(sbj_field_kind const kind,
+                          sbj_field const *const field, void *const value);
+static bool grow_array(internal_hooks const *const hooks, void **const array,
+                       size_t const used, size_t *const capacity,
+                       size_t const needed, size_t const element_size);
+
+/* size of one element of an array field */
+static size_t element_size(sbj_field const *const field) {
+    switch (field->element_kind) {
+    case sbj_field_bool:
+        return sizeof(bool);
+    case sbj_field_integer:
+        return sizeof(int64_t);
+    case sbj_field_double:
+        return sizeof(double);
+    case sbj_field_string:
+        return sizeof(char *);
+    case sbj_field_object:
+        return field->binding->size;
+    default:
+        return 0;
+    }
+}
+
+static void release_array(sbj_field const *const field, void *const base) {
+    unsigned char **const elements =
+        (unsigned char **)((unsigned char *)base + field->offset);
+    size_t *const count =
+        (size_t *)((unsigned char *)base + field->count_offset);
+    size_t const size = element_size(field);
+    size_t i = 0;
+
+    if (*elements != NULL) {
+        for (i = 0; i < *count; i++) {
+            release_value(field->element_kind, field, *elements + i * size);
+        }
+        global_hooks.deallocate(*elements);
+    }
+    *elements = NULL;
+    *count = 0;
+}
+
+/* Release a string or object value, arrays are released with their count by
+ * release_array */
+static void release_value(sbj_field_kind const kind,
+                          sbj_field const *const field, void *const value) {
+    if (kind == sbj_field_string) {
+        char **const string = (char **)value;
+        if (*string != NULL) {
+            global_hooks.deallocate(*string);
+            *string = NULL;
+        }
+    } else if (kind == sbj_field_object) {
+        sbj_binding_free(value, field->binding);
+    }
+}
+
+/* Decode a value that isn't an array into value */
+static bool decode_field(sbj_field_kind const kind,
+                         sbj_field const *const field, void *const value,
+                         parse_buffer *const input_buffer) {
+    sbJSON item;
+
+    if (cannot_access_at_index(input_buffer, 0)) {
+        return false;
+    }
+
+    if (can_read(input_buffer, 4) &&
+        (strncmp((char const *)buffer_at_offset(input_buffer), "null", 4) ==
+         0)) {
+        release_value(kind, field, value);
+        input_buffer->offset += 4;
+        return true;
+    }
+
+    memset(&item, 0, sizeof(item));
+    switch (kind) {
+    case sbj_field_bool:
+        if (can_read(input_buffer, 4) &&
+            (strncmp((char const *)buffer_at_offset(input_buffer), "true",
+                     4) == 0)) {
+            *(bool *)value = true;
+            input_buffer->offset += 4;
+            return true;
+        }
+        if (can_read(input_buffer, 5) &&
+            (strncmp((char const *)buffer_at_offset(input_buffer), "false",
+                     5) == 0)) {
+            *(bool *)value = false;
+            input_buffer->offset += 5;
+            return true;
+        }
+        return false;
+
+    case sbj_field_integer:
+    case sbj_field_double: {
+        size_t const start = input_buffer->offset;
+
+        if ((buffer_at_offset(input_buffer)[0] != '-') &&
+            !is_decimal_digit(buffer_at_offset(input_buffer)[0])) {
+            return false;
+        }
+        if (!parse_number(&item, input_buffer)) {
+            return false;
+        }
+        if (kind == sbj_field_double) {
+            *(double *)value = item.is_number_double ? item.u.valuedouble
+                                                     : (double)item.u.valueint;
+        } else if (item.is_number_double) {
+            /* not an integer, the error points at the number */
+            input_buffer->offset = start;
+            return false;
+        } else {
+            *(int64_t *)value = item.u.valueint;
+        }
+        return true;
+    }
+
+    case sbj_field_string:
+        if ((buffer_at_offset(input_buffer)[0] != '\"') ||
+            !parse_string(&item, input_buffer)) {
+            return false;
+        }
+        release_value(kind, field, value);
+        *(char **)value = item.u.valuestring;
+        return true;
+
+    case sbj_field_object:
+        if (buffer_at_offset(input_buffer)[0] != '{') {
+            return false;
+        }
+        release_value(kind, field, value);
+        return decode_fields(field->binding, value, input_buffer);
+
+    default:
+        return false;
+    }
+}
+
+static bool decode_field_array(sbj_field const *const field, void *const base,
+                               parse_buffer *const input_buffer) {
+    size_t const size = element_size(field);
+    unsigned char *elements = NULL;
+    size_t capacity = 0;
+    size_t count = 0;
+
+    if ((size == 0) || !can_nest_deeper(input_buffer) ||
+        cannot_access_at_index(input_buffer, 0) ||
+        (buffer_at_offset(input_buffer)[0] != '[')) {
+        return false;
+    }
+    input_buffer->depth++;
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) &&
+        (buffer_at_offset(input_buffer)[0] == ']')) {
+        goto success; /* empty array */
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0)) {
+        input_buffer->offset--;
+        goto fail;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    /* loop through the comma separated array elements */
+    do {
+        if (!grow_array(&global_hooks, (void **)&elements, count, &capacity, 1,
+                        size)) {
+            goto fail; /* allocation failure */
+        }
+        memset(elements + count * size, 0, size);
+        count++;
+
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!decode_field(field->element_kind, field,
+                          elements + (count - 1) * size, input_buffer)) {
+            goto fail; /* failed to parse value */
+        }
+        buffer_skip_whitespace(input_buffer);
+    } while (can_access_at_index(input_buffer, 0) &&
+             (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) ||
+        buffer_at_offset(input_buffer)[0] != ']') {
+        goto fail; /* expected end of array */
+    }
+
+success:
+    input_buffer->depth--;
+    input_buffer->offset++;
+
+    release_array(field, base);
+    *(unsigned char **)((unsigned char *)base + field->offset) = elements;
+    *(size_t *)((unsigned char *)base + field->count_offset) = count;
+
+    return true;
+
+fail:
+    if (elements != NULL) {
+        while (count > 0) {
+            count--;
+            release_value(field->element_kind, field, elements + count * size);
+        }
+        global_hooks.deallocate(elements);
+    }
+
+    return false;
+}
+
+/* The field named by the key at the buffer offset, NULL if there is none.
+ * Advances past the key, false if it is invalid. */
+static bool decode_field_name(sbj_binding const *const binding,
+                              parse_buffer *const input_buffer,
+                              sbj_field const **const field) {
+    unsigned char const *input_pointer = buffer_at_offset(input_buffer) + 1;
+    size_t skipped_bytes = 0;
+    unsigned char const *const input_end =
+        find_string_end(input_buffer, &skipped_bytes);
+    unsigned char stack_key[256];
+    unsigned char *key = stack_key;
+    size_t length = 0;
+    size_t i = 0;
+
+    *field = NULL;
+    if (input_end == NULL) {
+        input_buffer->offset++;
+        return false;
+    }
+
+    length = (size_t)(input_end - input_pointer);
+    if (skipped_bytes == 0) {
+        /* nothing to unescape, compare with the input */
+        key = (unsigned char *)cast_away_const(input_pointer);
+    } else {
+        unsigned char *key_end = NULL;
+
+        if (length - skipped_bytes > sizeof(stack_key)) {
+            key = (unsigned char *)global_hooks.allocate(length -
+                                                         skipped_bytes);
+            if (key == NULL) {
+                return false; /* allocation failure */
+            }
+        }
+        key_end = unescape_string(&input_pointer, input_end, key);
+        if (key_end == NULL) {
+            if (key != stack_key) {
+                global_hooks.deallocate(key);
+            }
+            input_buffer->offset =
+                (size_t)(input_pointer - input_buffer->content);
+            return false;
+        }
+        length = (size_t)(key_end - key);
+    }
+
+    for (i = 0; (i < binding->field_count) && (*field == NULL); i++) {
+        char const *const name = binding->fields[i].name;
+        if ((strncmp(name, (char const *)key, length) == 0) &&
+            (name[length] == '\0')) {
+            *field = &binding->fields[i];
+        }
+    }
+
+    if ((key != stack_key) && (skipped_bytes != 0)) {
+        global_hooks.deallocate(key);
+    }
+    input_buffer->offset = (size_t)(input_end - input_buffer->content) + 1;
+
+    return true;
+}
+
+static bool decode_fields(sbj_binding const *const binding, void *const out,
+                          parse_buffer *const input_buffer) {
+    sbj_field const *field = NULL;
+
+    if (!can_nest_deeper(input_buffer)) {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) &&
+        (buffer_at_offset(input_buffer)[0] == '}')) {
+        goto success; /* empty object */
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0)) {
+        input_buffer->offset--;
+        return false;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    /* loop through the comma separated object members */
+    do {
+        /* find the field of the member */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!decode_field_name(binding, input_buffer, &field)) {
+            return false; /* failed to parse name */
+        }
+        buffer_skip_whitespace(input_buffer);
+
+        if (cannot_access_at_index(input_buffer, 0) ||
+            (buffer_at_offset(input_buffer)[0] != ':')) {
+            return false; /* invalid object */
+        }
+
+        /* decode the value into the field, or skip it */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (field == NULL) {
+            if (!validate_value(input_buffer)) {
+                return false;
+            }
+        } else if (field->kind == sbj_field_array) {
+            if (can_read(input_buffer, 4) &&
+                (strncmp((char const *)buffer_at_offset(input_buffer), "null",
+                         4) == 0)) {
+                release_array(field, out);
+                input_buffer->offset += 4;
+            } else if (!decode_field_array(field, out, input_buffer)) {
+                return false;
+            }
+        } else if (!decode_field(field->kind, field,
+                                 (unsigned char *)out + field->offset,
+                                 input_buffer)) {
+            return false;
+        }
+        buffer_skip_whitespace(input_buffer);
+    } while (can_access_at_index(input_buffer, 0) &&
+             (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) ||
+        (buffer_at_offset(input_buffer)[0] != '}')) {
+        return false; /* expected end of object */
+    }
+
+success:
+    input_buffer->depth--;
+    input_buffer->offset++;
+
+    return true;
+}
+
+bool sbj_decode(char const *value, size_t buffer_length,
+                sbj_binding const *binding, void *out) {
+    parse_buffer buffer = empty_parse_buffer;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((binding == NULL) || (out == NULL)) {
+        return false;
+    }
+    memset(out, 0, binding->size);
+    if ((value == NULL) || (0 == buffer_length)) {
+        return false;
+    }
+
+    buffer.content = (unsigned char const *)value;
+    buffer.length = buffer_length;
+    buffer.hooks = global_hooks;
+
+    buffer_skip_whitespace(skip_utf8_bom(&buffer));
+    if (can_access_at_index(&buffer, 0) &&
+        (buffer_at_offset(&buffer)[0] == '{') &&
+        decode_fields(binding, out, &buffer)) {
+        return true;
+    }
+
+    sbj_binding_free(out, binding);
+    global_error.json = (unsigned char const *)value;
+    global_error.position = (buffer.offset < buffer.length)
+                                ? buffer.offset
+                                : buffer.length - 1;
+
+    return false;
+}
+
+void sbj_binding_free(void *object, sbj_binding const *binding) {
+    size_t i = 0;
+
+    if ((object == NULL) || (binding == NULL)) {
+        return;
+    }
+
+    for (i = 0; i < binding->field_count; i++) {
+        sbj_field const *const field = &binding->fields[i];
+        if (field->kind == sbj_field_array) {
+            release_array(field, object);
+        } else {
+            release_value(field->kind, field,
+                          (unsigned char *)object + field->offset);
+        }
+    }
+}
+
+/* Write text of the given length into the output */
+static bool encode_literal(char const *const text, size_t const length,
+                           printbuffer *const output_buffer) {
+    unsigned char *const output = ensure(output_buffer, length + sizeof(""));
+    if (output == NULL) {
+        return false;
+    }
+
+    memcpy(output, text, length);
+    output[length] = '\0';
+    output_buffer->offset += length;
+
+    return true;
+}
+
+/* Indent to the depth when formatting */
+static bool encode_indent(printbuffer *const output_buffer) {
+    unsigned char *output = NULL;
+
+    if (!output_buffer->format) {
+        return true;
+    }
+    output = ensure(output_buffer, output_buffer->depth + sizeof(""));
+    if (output == NULL) {
+        return false;
+    }
+
+    memset(output, '\t', output_buffer->depth);
+    output[output_buffer->depth] = '\0';
+    output_buffer->offset += output_buffer->depth;
+
+    return true;
+}
+
+static bool encode_fields(sbj_binding const *const binding,
+                          void const *const in,
+                          printbuffer *const output_buffer);
+
+/* Print a value that isn't an array like print_value */
+static bool encode_field(sbj_field_kind const kind,
+                         sbj_field const *const field, void const *const value,
+                         printbuffer *const output_buffer) {
+    sbJSON item;
+
+    memset(&item, 0, sizeof(item));
+    switch (kind) {
+    case sbj_field_bool:
+        return *(bool const *)value ? encode_literal("true", 4, output_buffer)
+                                    : encode_literal("false", 5, output_buffer);
+    case sbj_field_integer:
+        item.type = sbJSON_Number;
+        item.u.valueint = *(int64_t const *)value;
+        return print_number(&item, output_buffer);
+    case sbj_field_double:
+        item.type = sbJSON_Number;
+        item.is_number_double = true;
+        item.u.valuedouble = *(double const *)value;
+        return print_number(&item, output_buffer);
+    case sbj_field_string:
+        if (*(char *const *)value == NULL) {
+            return encode_literal("null", 4, output_buffer);
+        }
+        if (!print_string_ptr(*(unsigned char *const *)value, output_buffer)) {
+            return false;
+        }
+        update_offset(output_buffer);
+        return true;
+    case sbj_field_object:
+        return encode_fields(field->binding, value, output_buffer);
+    default:
+        return false;
+    }
+}
+
+/* Print an array field like print_array */
+static bool encode_field_array(sbj_field const *const field,
+                               void const *const in,
+                               printbuffer *const output_buffer) {
+    unsigned char const *const elements = *(unsigned char *const *)(
+        (unsigned char const *)in + field->offset);
+    size_t const count =
+        *(size_t const *)((unsigned char const *)in + field->count_offset);
+    size_t const size = element_size(field);
+    size_t i = 0;
+
+    if ((size == 0) || ((elements == NULL) && (count != 0)) ||
+        !encode_literal("[", 1, output_buffer)) {
+        return false;
+    }
+    output_buffer->depth++;
+
+    for (i = 0; i < count; i++) {
+        if (!encode_field(field->element_kind, field, elements + i * size,
+                          output_buffer)) {
+            return false;
+        }
+        if ((i + 1 < count) &&
+            !encode_literal(", ", output_buffer->format ? 2 : 1,
+                            output_buffer)) {
+            return false;
+        }
+    }
+
+    output_buffer->depth--;
+
+    return encode_literal("]", 1, output_buffer);
+}
+
+/* Print a struct like print_object */
+static bool encode_fields(sbj_binding const *const binding,
+                          void const *const in,
+                          printbuffer *const output_buffer) {
+    size_t i = 0;
+
+    if (!encode_literal("{\n", output_buffer->format ? 2 : 1, output_buffer)) {
+        return false;
+    }
+    output_buffer->depth++;
+
+    for (i = 0; i < binding->field_count; i++) {
+        sbj_field const *const field = &binding->fields[i];
+        void const *const value = (unsigned char const *)in + field->offset;
+
+        if (!encode_indent(output_buffer)) {
+            return false;
+        }
+
+        if (!print_string_ptr((unsigned char const *)field->name,
+                              output_buffer)) {
+            return false;
+        }
+        update_offset(output_buffer);
+        if (!encode_literal(":\t", output_buffer->format ? 2 : 1,
+                            output_buffer)) {
+            return false;
+        }
+
+        if (!((field->kind == sbj_field_array)
+                  ? encode_field_array(field, in, output_buffer)
+                  : encode_field(field->kind, field, value, output_buffer))) {
+            return false;
+        }
+
+        if ((i + 1 < binding->field_count) &&
+            !encode_literal(",", 1, output_buffer)) {
+            return false;
+        }
+        if (output_buffer->format && !encode_literal("\n", 1, output_buffer)) {
+            return false;
+        }
+    }
+
+    output_buffer->depth--;
+    if (!encode_indent(output_buffer)) {
+        return false;
+    }
+
+    return encode_literal("}", 1, output_buffer);
+}
+
+char *sbj_encode(void const *in, sbj_binding const *binding, bool format) {
+    printbuffer buffer = empty_printbuffer;
+
+    if ((in == NULL) || (binding == NULL)) {
+        return NULL;
+    }
+
+    buffer.buffer = (unsigned char *)global_hooks.allocate(256);
+    if (buffer.buffer == NULL) {
+        return NULL;
+    }
+    buffer.length = 256;
+    buffer.format = format;
+    buffer.hooks = global_hooks;
+
+    if (!encode_fields(binding, in, &buffer)) {
+        if (buffer.buffer != NULL) {
+            global_hooks.deallocate(buffer.buffer);
+        }
+        return NULL;
+    }
+
+    return (char *)buffer.buffer;
+}
+
+/* Tape layout: every value starts with a word holding a tag in the top byte
+ * and a payload below it. null, true and false are that word only. Integers
+ * and doubles are followed by a word with their bits, strings, raw values and
+ * keys by their length, their payload is their offset in the string buffer
+ * where they are stored zero terminated. Arrays and objects are followed by
+ * their number of items and their payload is the position just past their last
+ * item. An object member is a key followed by the value. */
+struct sbj_tape {
+    internal_hooks hooks;
+    uint64_t *words;
+    size_t word_count;
+    size_t word_capacity;
+    char *strings;
+    size_t strings_length;
+    size_t strings_capacity;
+};
+
+typedef enum {
+    tape_null = 'n',
+    tape_true = 't',
+    tape_false = 'f',
+    tape_integer = 'l',
+    tape_double = 'd',
+    tape_string = 's',
+    tape_raw = 'r',
+    tape_key = 'k',
+    tape_array = '[',
+    tape_object = '{'
+} tape_tag;
+
+#define tape_payload_bits 56
+#define tape_word(tag, payload)                                                \
+    (((uint64_t)(tag) << tape_payload_bits) | (uint64_t)(payload))
+#define tape_tag_of(word) ((tape_tag)((word) >> tape_payload_bits))
+#define tape_payload_of(word)                                                  \
+    ((size_t)((word) & (((uint64_t)1 << tape_payload_bits) - 1)))
+
+/* make room for needed more elements, doubling the capacity */
+static bool grow_array(internal_hooks const *const hooks, void **const array,
+                       size_t const used, size_t *const capacity,
+                       size_t const needed, size_t const element_size) {
+    size_t new_capacity = (*capacity == 0) ? 64 : *capacity;
+    void *grown = NULL;
+
+    if (used + needed <= *capacity) {
+        return true;
+    }
+    while (new_capacity < used + needed) {
+        new_capacity *= 2;
+    }
+
+    if (hooks->reallocate != NULL) {
+        grown = hooks->reallocate(*array, new_capacity * element_size);
+        if (grown == NULL) {
+            return false;
+        }
+    } else {
+        grown = hooks->allocate(new_capacity * element_size);
+        if (grown == NULL) {
+            return false;
+        }
+        if (*array != NULL) {
+            memcpy(grown, *array, used * element_size);
+            hooks->deallocate(*array);
+        }
+    }
+
+    *array = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+static bool tape_push(sbj_tape *const tape, uint64_t const first,
+                      uint64_t const second) {
+    if (!grow_array(&tape->hooks, (void **)&tape->words, tape->word_count,
+                    &tape->word_capacity, 2, sizeof(uint64_t))) {
+        return false;
+    }
+
+    tape->words[tape->word_count++] = first;
+    tape->words[tape->word_count++] = second;
+    return true;
+}
+
+static bool tape_push_string(sbj_tape *const tape, tape_tag const tag,
+                             char const *const string, size_t const length) {
+    size_t const offset = tape->strings_length;
+
+    if (!grow_array(&tape->hooks, (void **)&tape->strings,
+                    tape->strings_length, &tape->strings_capacity,
+                    length + sizeof(""), 1)) {
+        return false;
+    }
+
+    memcpy(tape->strings + offset, string, length);
+    tape->strings[offset + length] = '\0';
+    tape->strings_length += length + sizeof("");
+
+    return tape_push(tape, tape_word(tag, offset), length);
+}
+
+static bool tape_push_scalar(sbj_tape *const tape, tape_tag const tag) {
+    if (!grow_array(&tape->hooks, (void **)&tape->words, tape->word_count,
+                    &tape->word_capacity, 1, sizeof(uint64_t))) {
+        return false;
+    }
+
+    tape->words[tape->word_count++] = tape_word(tag, 0);
+    return true;
+}
+
+static bool tape_push_double(sbj_tape *const tape, double const number) {
+    uint64_t bits = 0;
+    memcpy(&bits, &number, sizeof(bits));
+    return tape_push(tape, tape_word(tape_double, 0), bits);
+}
+
+static sbj_tape *tape_new(void) {
+    sbj_tape *const tape =
+        (sbj_tape *)global_hooks.allocate(sizeof(sbj_tape));
+    if (tape != NULL) {
+        memset(tape, 0, sizeof(sbj_tape));
+        tape->hooks = global_hooks;
+    }
+
+    return tape;
+}
+
+void sbj_tape_free(sbj_tape *tape) {
+    if (tape == NULL) {
+        return;
+    }
+
+    if (tape->words != NULL) {
+        tape->hooks.deallocate(tape->words);
+    }
+    if (tape->strings != NULL) {
+        tape->hooks.deallocate(tape->strings);
+    }
+    tape->hooks.deallocate(tape);
+}
+
+/* Writes the events of sbj_parse_sax to a tape */
+typedef struct {
+    sbj_tape *tape;
+    size_t *open; /* positions of the containers that haven't ended yet */
+    size_t depth;
+    size_t capacity;
+} tape_writer;
+
+/* a value starts in the innermost open container */
+static void tape_count_item(tape_writer *const writer) {
+    if (writer->depth > 0) {
+        writer->tape->words[writer->open[writer->depth - 1] + 1]++;
+    }
+}
+
+static bool tape_writer_start(tape_writer *const writer, tape_tag const tag) {
+    sbj_tape *const tape = writer->tape;
+
+    tape_count_item(writer);
+    if (!grow_array(&tape->hooks, (void **)&writer->open, writer->depth,
+                    &writer->capacity, 1, sizeof(size_t))) {
+        return false;
+    }
+    writer->open[writer->depth++] = tape->word_count;
+
+    return tape_push(tape, tape_word(tag, 0), 0);
+}
+
+static bool tape_writer_end(void *user) {
+    tape_writer *const writer = (tape_writer *)user;
+    size_t const start = writer->open[--writer->depth];
+
+    writer->tape->words[start] |= (uint64_t)writer->tape->word_count;
+    return true;
+}
+
+static bool tape_writer_start_object(void *user) {
+    return tape_writer_start((tape_writer *)user, tape_object);
+}
+
+static bool tape_writer_start_array(void *user) {
+    return tape_writer_start((tape_writer *)user, tape_array);
+}
+
+static bool tape_writer_key(void *user, char const *key, size_t length) {
+    return tape_push_string(((tape_writer *)user)->tape, tape_key, key, length);
+}
+
+static bool tape_writer_string(void *user, char const *string,
+                               size_t length) {
+    tape_count_item((tape_writer *)user);
+    return tape_push_string(((tape_writer *)user)->tape, tape_string, string,
+                            length);
+}
+
+static bool tape_writer_integer(void *user, int64_t number) {
+    tape_count_item((tape_writer *)user);
+    return tape_push(((tape_writer *)user)->tape, tape_word(tape_integer, 0),
+                     (uint64_t)number);
+}
+
+static bool tape_writer_double(void *user, double number) {
+    tape_count_item((tape_writer *)user);
+    return tape_push_double(((tape_writer *)user)->tape, number);
+}
+
+static bool tape_writer_bool(void *user, bool value) {
+    tape_count_item((tape_writer *)user);
+    return tape_push_scalar(((tape_writer *)user)->tape,
+                            value ? tape_true : tape_false);
+}
+
+static bool tape_writer_null(void *user) {
+    tape_count_item((tape_writer *)user);
+    return tape_push_scalar(((tape_writer *)user)->tape, tape_null);
+}
+
+sbj_tape *sbj_tape_parse(char const *value, size_t buffer_length) {
+    static sbj_sax_handler const handler = {
+        tape_writer_start_object, tape_writer_end, tape_writer_start_array,
+        tape_writer_end,          tape_writer_key, tape_writer_string,
+        tape_writer_integer,      tape_writer_double, tape_writer_bool,
+        tape_writer_null};
+    tape_writer writer;
+    bool success = false;
+
+    memset(&writer, 0, sizeof(writer));
+    writer.tape = tape_new();
+    if (writer.tape == NULL) {
+        return NULL;
+    }
+
+    success = sbj_parse_sax(value, buffer_length, &handler, &writer);
+    if (writer.open != NULL) {
+        writer.tape->hooks.deallocate(writer.open);
+    }
+    if (!success) {
+        sbj_tape_free(writer.tape);
+        return NULL;
+    }
+
+    return writer.tape;
+}
+
+static bool tape_add_tree(sbj_tape *const tape, sbJSON const *const item) {
+    switch (item->type) {
+    case sbJSON_Null:
+        return tape_push_scalar(tape, tape_null);
+    case sbJSON_Bool:
+        return tape_push_scalar(tape,
+                                item->u.valuebool ? tape_true : tape_false);
+    case sbJSON_Number:
+        if (item->is_number_double) {
+            return tape_push_double(tape, item->u.valuedouble);
+        }
+        return tape_push(tape, tape_word(tape_integer, 0),
+                         (uint64_t)item->u.valueint);
+    case sbJSON_String:
+    case sbJSON_Raw:
+        if (item->u.valuestring == NULL) {
+            return false;
+        }
+        return tape_push_string(
+            tape, (item->type == sbJSON_String) ? tape_string : tape_raw,
+            item->u.valuestring, strlen(item->u.valuestring));
+    case sbJSON_Array:
+    case sbJSON_Object: {
+        sbJSON const *child = sbj_get_child(item);
+        size_t const start = tape->word_count;
+
+        if (item->is_lazy || item->is_packed) {
+            return false; /* invalid contents or out of memory */
+        }
+        if (!tape_push(tape,
+                       tape_word((item->type == sbJSON_Array) ? tape_array
+                                                              : tape_object,
+                                 0),
+                       (uint64_t)item->child_count)) {
+            return false;
+        }
+        for (; child != NULL; child = child->next) {
+            char const *const key =
+                (child->string != NULL) ? child->string : "";
+            if ((item->type == sbJSON_Object) &&
+                !tape_push_string(tape, tape_key, key, strlen(key))) {
+                return false;
+            }
+            if (!tape_add_tree(tape, child)) {
+                return false;
+            }
+        }
+        tape->words[start] |= (uint64_t)tape->word_count;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+sbj_tape *sbj_tape_from_tree(sbJSON const *item) {
+    sbj_tape *tape = NULL;
+
+    if (item == NULL) {
+        return NULL;
+    }
+
+    tape = tape_new();
+    if ((tape != NULL) && !tape_add_tree(tape, item)) {
+        sbj_tape_free(tape);
+        return NULL;
+    }
+
+    return tape;
+}
+
+/* the value at position, skipping the key of an object member */
+static size_t tape_value(sbj_tape const *const tape, size_t const position) {
+    if ((tape == NULL) || (position >= tape->word_count)) {
+        return SBJ_TAPE_NONE;
+    }
+
+    return (tape_tag_of(tape->words[position]) == tape_key) ? position + 2
+                                                            : position;
+}
+
+/* the position after the value or member at position */
+static size_t tape_skip(sbj_tape const *const tape, size_t const position) {
+    size_t const value = tape_value(tape, position);
+    uint64_t const word = tape->words[value];
+
+    switch (tape_tag_of(word)) {
+    case tape_null:
+    case tape_true:
+    case tape_false:
+        return value + 1;
+    case tape_array:
+    case tape_object:
+        return tape_payload_of(word);
+    default:
+        return value + 2;
+    }
+}
+
+size_t sbj_tape_root(sbj_tape const *tape) {
+    return ((tape != NULL) && (tape->word_count > 0)) ? 0 : SBJ_TAPE_NONE;
+}
+
+int sbj_tape_type(sbj_tape const *tape, size_t position) {
+    size_t const value = tape_value(tape, position);
+
+    if (value == SBJ_TAPE_NONE) {
+        return sbJSON_Invalid;
+    }
+
+    switch (tape_tag_of(tape->words[value])) {
+    case tape_null:
+        return sbJSON_Null;
+    case tape_true:
+    case tape_false:
+        return sbJSON_Bool;
+    case tape_integer:
+    case tape_double:
+        return sbJSON_Number;
+    case tape_string:
+        return sbJSON_String;
+    case tape_raw:
+        return sbJSON_Raw;
+    case tape_array:
+        return sbJSON_Array;
+    case tape_object:
+        return sbJSON_Object;
+    default:
+        return sbJSON_Invalid;
+    }
+}
+
+/* the position of the container at position, SBJ_TAPE_NONE for other values */
+static size_t tape_container(sbj_tape const *const tape, size_t const position,
+                             tape_tag const tag) {
+    size_t const value = tape_value(tape, position);
+
+    if ((value == SBJ_TAPE_NONE) || (tape_tag_of(tape->words[value]) != tag)) {
+        return SBJ_TAPE_NONE;
+    }
+
+    return value;
+}
+
+size_t sbj_tape_count(sbj_tape const *tape, size_t position) {
+    size_t value = tape_container(tape, position, tape_array);
+
+    if (value == SBJ_TAPE_NONE) {
+        value = tape_container(tape, position, tape_object);
+    }
+
+    return (value != SBJ_TAPE_NONE) ? (size_t)tape->words[value + 1] : 0;
+}
+
+size_t sbj_tape_child(sbj_tape const *tape, size_t container) {
+    return (sbj_tape_count(tape, container) > 0)
+               ? tape_value(tape, container) + 2
+               : SBJ_TAPE_NONE;
+}
+
+size_t sbj_tape_next(sbj_tape const *tape, size_t container, size_t item) {
+    size_t next = 0;
+
+    if ((sbj_tape_count(tape, container) == 0) || (item >= tape->word_count)) {
+        return SBJ_TAPE_NONE;
+    }
+
+    next = tape_skip(tape, item);
+    return (next < tape_skip(tape, container)) ? next : SBJ_TAPE_NONE;
+}
+
+size_t sbj_tape_get_item(sbj_tape const *tape, size_t array, size_t index) {
+    size_t const value = tape_container(tape, array, tape_array);
+    size_t item = 0;
+
+    if ((value == SBJ_TAPE_NONE) || (index >= (size_t)tape->words[value + 1])) {
+        return SBJ_TAPE_NONE;
+    }
+
+    for (item = value + 2; index > 0; index--) {
+        item = tape_skip(tape, item);
+    }
+
+    return item;
+}
+
+size_t sbj_tape_get_member(sbj_tape const *tape, size_t object,
+                           char const *key) {
+    size_t const value = tape_container(tape, object, tape_object);
+    size_t const end = (value != SBJ_TAPE_NONE)
+                           ? tape_payload_of(tape->words[value])
+                           : 0;
+    size_t length = 0;
+    size_t member = 0;
+
+    if ((value == SBJ_TAPE_NONE) || (key == NULL)) {
+        return SBJ_TAPE_NONE;
+    }
+
+    length = strlen(key);
+    for (member = value + 2; member < end; member = tape_skip(tape, member)) {
+        if ((tape->words[member + 1] == length) &&
+            (memcmp(tape->strings + tape_payload_of(tape->words[member]), key,
+                    length) == 0)) {
+            return member;
+        }
+    }
+
+    return SBJ_TAPE_NONE;
+}
+
+char const *sbj_tape_get_key(sbj_tape const *tape, size_t member) {
+    if ((tape == NULL) || (member >= tape->word_count) ||
+        (tape_tag_of(tape->words[member]) != tape_key)) {
+        return NULL;
+    }
+
+    return tape->strings + tape_payload_of(tape->words[member]);
+}
+
+char const *sbj_tape_get_string(sbj_tape const *tape, size_t position,
+                                size_t *length) {
+    size_t const value = tape_value(tape, position);
+    tape_tag tag = tape_null;
+
+    if (value == SBJ_TAPE_NONE) {
+        return NULL;
+    }
+    tag = tape_tag_of(tape->words[value]);
+    if ((tag != tape_string) && (tag != tape_raw)) {
+        return NULL;
+    }
+
+    if (length != NULL) {
+        *length = (size_t)tape->words[value + 1];
+    }
+    return tape->strings + tape_payload_of(tape->words[value]);
+}
+
+int64_t sbj_tape_get_integer(sbj_tape const *tape, size_t position) {
+    size_t const value = tape_value(tape, position);
+
+    if (value == SBJ_TAPE_NONE) {
+        return 0;
+    }
+
+    switch (tape_tag_of(tape->words[value])) {
+    case tape_integer:
+        return (int64_t)tape->words[value + 1];
+    case tape_double: {
+        double const number = sbj_tape_get_double(tape, value);
+        if (number >= (double)INT64_MAX) {
+            return INT64_MAX;
+        }
+        if (number <= (double)INT64_MIN) {
+            return INT64_MIN;
+        }
+        return (number == number) ? (int64_t)number : 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+double sbj_tape_get_double(sbj_tape const *tape, size_t position) {
+    size_t const value = tape_value(tape, position);
+    double number = 0;
+
+    if (value == SBJ_TAPE_NONE) {
+        return 0;
+    }
+
+    switch (tape_tag_of(tape->words[value])) {
+    case tape_integer:
+        return (double)(int64_t)tape->words[value + 1];
+    case tape_double:
+        memcpy(&number, &tape->words[value + 1], sizeof(number));
+        return number;
+    default:
+        return 0;
+    }
+}
+
+bool sbj_tape_get_bool(sbj_tape const *tape, size_t position) {
+    size_t const value = tape_value(tape, position);
+
+    return (value != SBJ_TAPE_NONE) &&
+           (tape_tag_of(tape->words[value]) == tape_true);
+}
+
+static sbJSON *tape_to_tree(sbj_tape const *const tape, size_t const value) {
+    uint64_t const word = tape->words[value];
+    sbJSON *item = NULL;
+
+    switch (tape_tag_of(word)) {
+    case tape_null:
+        return sbj_create_null();
+    case tape_true:
+    case tape_false:
+        return sbj_create_bool(tape_tag_of(word) == tape_true);
+    case tape_integer:
+        return sbj_create_integer_number((int64_t)tape->words[value + 1]);
+    case tape_double:
+        return sbj_create_double_number(sbj_tape_get_double(tape, value));
+    case tape_string:
+        return sbJSON_CreateString(tape->strings + tape_payload_of(word));
+    case tape_raw:
+        return sbj_create_raw(tape->strings + tape_payload_of(word));
+    case tape_array:
+    case tape_object: {
+        size_t child = 0;
+
+        item = (tape_tag_of(word) == tape_array) ? sbj_create_array()
+                                                 : sbj_create_object();
+        if (item == NULL) {
+            return NULL;
+        }
+        for (child = sbj_tape_child(tape, value); child != SBJ_TAPE_NONE;
+             child = sbj_tape_next(tape, value, child)) {
+            sbJSON *const new_item =
+                tape_to_tree(tape, tape_value(tape, child));
+            bool const added =
+                (new_item != NULL) &&
+                ((tape_tag_of(word) == tape_array)
+                     ? sbj_add_item_to_array(item, new_item)
+                     : sbj_add_item_to_object(
+                           item, sbj_tape_get_key(tape, child), new_item));
+            if (!added) {
+                sbj_delete(new_item);
+                sbj_delete(item);
+                return NULL;
+            }
+        }
+        return item;
+    }
+    default:
+        return NULL;
+    }
+}
+
+sbJSON *sbj_tape_to_tree(sbj_tape const *tape, size_t position) {
+    size_t const value = tape_value(tape, position);
+
+    if (value == SBJ_TAPE_NONE) {
+        return NULL;
+    }
+
+    return tape_to_tree(tape, value);
+}
+
+#define sbjson_min(a, b) (((a) < (b)) ? (a) : (b))
+
+/* A line of NDJSON input and what became of it */
+typedef struct {
+    char const *start;
+    size_t length;
+    sbJSON *item;
+    size_t error_position; /* within the line, if item is NULL */
+} ndjson_record;
+
+/* A contiguous run of records parsed by one thread */
+typedef struct {
+    ndjson_record *records;
+    size_t count;
+} ndjson_slice;
+
+/* Input bytes per thread and batch. Big enough that starting the threads is
+ * cheap next to parsing, small enough to keep the trees of a batch in cache. */
+#define ndjson_batch_bytes ((size_t)1 << 20)
+
+/* Upper bound of the threads the parallel functions start at once */
+#define max_threads 64
+
+static size_t default_thread_count(void) {
+#if defined(SBJSON_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+    long const processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return (processors > 0) ? (size_t)processors : 1;
+#else
+    return 1;
+#endif
+}
+
+#ifdef SBJSON_THREADS
+typedef struct {
+    void (*work)(void *task);
+    void *task;
+#if defined(SBJSON_STATS) && defined(sbjson_thread_local)
+    sbj_stats stats; /* what the thread counted, for the one it works for */
+#endif
+} thread_task;
 
-    if (output_buffer == NULL) {
+static void *run_thread_task(void *task) {
+    ((thread_task *)task)->work(((thread_task *)task)->task);
+#if defined(SBJSON_STATS) && defined(sbjson_thread_local)
+    ((thread_task *)task)->stats = thread_stats;
+#endif
+    return NULL;
+}
+
+#if defined(SBJSON_STATS) && defined(sbjson_thread_local)
+static void stats_merge(sbj_stats *const to, sbj_stats const *const from) {
+    to->nodes_allocated += from->nodes_allocated;
+    to->nodes_freed += from->nodes_freed;
+    to->string_bytes += from->string_bytes;
+    to->print_buffer_grows += from->print_buffer_grows;
+    to->print_buffer_bytes_copied += from->print_buffer_bytes_copied;
+    if (from->max_depth > to->max_depth) {
+        to->max_depth = from->max_depth;
+    }
+    to->bytes_parsed += from->bytes_parsed;
+    to->bytes_printed += from->bytes_printed;
+    to->parse_cycles += from->parse_cycles;
+    to->print_cycles += from->print_cycles;
+}
+#endif
+#endif
+
+/* Calls work for count (at most max_threads) tasks that are task_size bytes
+ * apart: the first on the calling thread, the others on threads of their own
+ * if the build and the system allow it, and returns when all have finished. */
+static void run_tasks(void (*const work)(void *task), void *const tasks,
+                      size_t const task_size, size_t const count) {
+    char *const first = (char *)tasks;
+    size_t i = 0;
+#ifdef SBJSON_THREADS
+    pthread_t thread_ids[max_threads];
+    bool started[max_threads];
+    thread_task thread_tasks[max_threads];
+
+    assert(count <= max_threads);
+    for (i = 1; i < count; i++) {
+        thread_tasks[i].work = work;
+        thread_tasks[i].task = first + i * task_size;
+        started[i] = pthread_create(&thread_ids[i], NULL, run_thread_task,
+                                    &thread_tasks[i]) == 0;
+    }
+    if (count > 0) {
+        work(first);
+    }
+    for (i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(thread_ids[i], NULL);
+#if defined(SBJSON_STATS) && defined(sbjson_thread_local)
+            /* the work of the threads counts for the calling thread */
+            stats_merge(&thread_stats, &thread_tasks[i].stats);
+#endif
+        } else {
+            work(first + i * task_size);
+        }
+    }
+#else
+    for (i = 0; i < count; i++) {
+        work(first + i * task_size);
+    }
+#endif
+}
+
+/* Parses every record of an ndjson_slice, stopping at the first invalid one */
+static void parse_ndjson_slice(void *const task) {
+    ndjson_slice *const slice = (ndjson_slice *)task;
+    size_t i = 0;
+
+    for (i = 0; i < slice->count; i++) {
+        ndjson_record *const record = &slice->records[i];
+        parse_buffer buffer = empty_parse_buffer;
+        error local_error = {NULL, 0};
+        char const *end = NULL;
+
+        buffer.hooks = global_hooks;
+        record->item = parse_document(&buffer, record->start, record->length,
+                                      &end, false, &local_error);
+        if (record->item == NULL) {
+            record->error_position = local_error.position;
+            return;
+        }
+
+        /* only whitespace may follow the value on its line */
+        end = skip_whitespace_until(end, record->start + record->length);
+        if (end != record->start + record->length) {
+            sbj_delete(record->item);
+            record->item = NULL;
+            record->error_position = (size_t)(end - record->start);
+            return;
+        }
+    }
+}
+
+/* Splits count records into threads slices of about the same number of bytes
+ * and parses them concurrently */
+static void parse_ndjson_batch(ndjson_record *const records, size_t const count,
+                               size_t const bytes, size_t threads) {
+    ndjson_slice slices[max_threads];
+    size_t slice_count = 0;
+    size_t sliced_bytes = 0;
+    size_t i = 0;
+
+    threads = sbjson_min(sbjson_min(threads, (size_t)max_threads), count);
+    if (count == 0) {
+        return;
+    }
+
+    slices[0].records = records;
+    slices[0].count = 0;
+    for (i = 0; i < count; i++) {
+        /* start the next slice once this one has its share of the bytes */
+        if ((slices[slice_count].count > 0) && (slice_count + 1 < threads) &&
+            (sliced_bytes >= bytes / threads * (slice_count + 1))) {
+            slice_count++;
+            slices[slice_count].records = &records[i];
+            slices[slice_count].count = 0;
+        }
+        slices[slice_count].count++;
+        sliced_bytes += records[i].length;
+    }
+
+    run_tasks(parse_ndjson_slice, slices, sizeof(ndjson_slice),
+              slice_count + 1);
+}
+
+bool sbj_parse_ndjson(char const *value, size_t buffer_length, size_t threads,
+                      sbj_record_fn callback, void *user) {
+    char const *const input_end = value + buffer_length;
+    char const *line = value;
+    ndjson_record *records = NULL;
+    size_t capacity = 0;
+    bool success = true;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((value == NULL) || (callback == NULL)) {
         return false;
     }
+    if (threads == 0) {
+        threads = default_thread_count();
+    }
+
+    while (success && (line < input_end)) {
+        size_t count = 0;
+        size_t bytes = 0;
+        size_t i = 0;
+
+        /* collect a batch of lines. A valid record can't contain a raw
+         * newline, not even in a string, so memchr finds its end. */
+        while ((line < input_end) && (bytes < threads * ndjson_batch_bytes)) {
+            char const *newline =
+                (char const *)memchr(line, '\n', (size_t)(input_end - line));
+            char const *const line_end =
+                (newline != NULL) ? newline : input_end;
+
+            /* blank lines separate nothing */
+            if (skip_whitespace_until(line, line_end) != line_end) {
+                if (!grow_array(&global_hooks, (void **)&records, count,
+                                &capacity, 1, sizeof(ndjson_record))) {
+                    success = false;
+                    break;
+                }
+                records[count].start = line;
+                records[count].length = (size_t)(line_end - line);
+                records[count].item = NULL;
+                records[count].error_position = 0;
+                bytes += records[count].length;
+                count++;
+            }
+            line = (newline != NULL) ? newline + 1 : input_end;
+        }
+        if (!success) {
+            count = 0;
+        }
+
+        parse_ndjson_batch(records, count, bytes, threads);
+
+        /* hand out the results in order */
+        for (i = 0; i < count; i++) {
+            if (success && (records[i].item == NULL)) {
+                global_error.json = (unsigned char const *)value;
+                global_error.position =
+                    (size_t)(records[i].start - value) +
+                    records[i].error_position;
+                success = false;
+            }
+            if (success) {
+                success = callback(user, records[i].item);
+            } else {
+                /* the tail of a batch that won't be delivered */
+                sbj_delete(records[i].item);
+            }
+        }
+    }
 
-    /* empty string */
-    if (input == NULL) {
-        output = ensure(output_buffer, sizeof("\"\""));
-        if (output == NULL) {
+    if (records != NULL) {
+        global_hooks.deallocate(records);
+    }
+
+    return success;
+}
+
+/* A run of elements of the top-level array for sbj_parse_parallel: the text
+ * from offset up to length, the comma or bracket after the last element */
+typedef struct {
+    parse_buffer buffer;
+    sbJSON *head;
+    sbJSON *tail;
+    int32_t count;
+    bool success;
+} array_slice;
+
+/* Smallest input worth splitting, below it starting threads costs more than
+ * it gains */
+#define parallel_min_bytes ((size_t)1 << 16)
+
+static void parse_array_slice(void *const task) {
+    array_slice *const slice = (array_slice *)task;
+    parse_buffer *const buffer = &slice->buffer;
+
+    slice->success = false;
+    for (;;) {
+        sbJSON *const new_item = parse_new_item(buffer);
+        if (new_item == NULL) {
+            return; /* allocation failure */
+        }
+        if (slice->head == NULL) {
+            slice->head = new_item;
+        } else {
+            slice->tail->next = new_item;
+            new_item->prev = slice->tail;
+        }
+        slice->tail = new_item;
+        slice->count++;
+
+        /* buffer_skip_whitespace can't be used at the end of the slice, it
+         * steps back from the end of the buffer */
+        while (can_access_at_index(buffer, 0) &&
+               (buffer_at_offset(buffer)[0] <= 32)) {
+            buffer->offset++;
+        }
+        if (cannot_access_at_index(buffer, 0) ||
+            !parse_value(new_item, buffer)) {
+            return;
+        }
+        while (can_access_at_index(buffer, 0) &&
+               (buffer_at_offset(buffer)[0] <= 32)) {
+            buffer->offset++;
+        }
+        if (cannot_access_at_index(buffer, 0)) {
+            break;
+        }
+        if (buffer_at_offset(buffer)[0] != ',') {
+            return;
+        }
+        buffer->offset++;
+    }
+
+    slice->success = true;
+}
+
+/* Finds the commas between the elements of the array whose '[' is at open
+ * that are closest after the ideal boundaries of slice_count slices, and the
+ * bracket closing it. Returns the number of slices found, 0 if the array
+ * doesn't end. Only quotes, escapes and brackets are tracked, which in a
+ * plain loop is several times faster than parsing (the token index of
+ * sbj_parse_fast records far more than is needed here). */
+static size_t split_array(unsigned char const *const content,
+                          size_t const length, size_t const open,
+                          size_t *const ends, size_t const slice_count) {
+    size_t const share = (length - open) / slice_count;
+    size_t found = 0;
+    size_t depth = 0;
+    size_t i = 0;
+
+    for (i = open + 1; i < length; i++) {
+        switch (content[i]) {
+        case '\"':
+            for (i++; (i < length) && (content[i] != '\"'); i++) {
+                if (content[i] == '\\') {
+                    i++;
+                }
+            }
+            break;
+        case '[':
+        case '{':
+            depth++;
+            break;
+        case ']':
+        case '}':
+            if (depth == 0) {
+                ends[found] = i;
+                return found + 1;
+            }
+            depth--;
+            break;
+        case ',':
+            if ((depth == 0) && (found + 1 < slice_count) &&
+                (i - open >= share * (found + 1))) {
+                ends[found++] = i;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return 0;
+}
+
+sbJSON *sbj_parse_parallel(char const *value, size_t buffer_length,
+                           size_t threads) {
+    parse_buffer buffer = empty_parse_buffer;
+    array_slice slices[max_threads];
+    size_t ends[max_threads];
+    size_t slice_count = 0;
+    size_t open = 0;
+    size_t i = 0;
+    sbJSON *array = NULL;
+
+    if (threads == 0) {
+        threads = default_thread_count();
+    }
+    threads = sbjson_min(threads, (size_t)max_threads);
+    if ((value == NULL) || (buffer_length < parallel_min_bytes) ||
+        (threads <= 1)) {
+        goto serial;
+    }
+
+    buffer.content = (unsigned char const *)value;
+    buffer.length = buffer_length;
+    buffer.hooks = global_hooks;
+    buffer_skip_whitespace(skip_utf8_bom(&buffer));
+    open = buffer.offset;
+    if (buffer.content[open] != '[') {
+        goto serial;
+    }
+
+    slice_count = split_array(buffer.content, buffer_length, open, ends,
+                              threads);
+    if ((slice_count <= 1) ||
+        (buffer.content[ends[slice_count - 1]] != ']')) {
+        goto serial;
+    }
+
+    for (i = 0; i < slice_count; i++) {
+        slices[i].buffer = buffer;
+        slices[i].buffer.offset = (i == 0) ? open + 1 : ends[i - 1] + 1;
+        slices[i].buffer.length = ends[i];
+        slices[i].buffer.depth = 1;
+        slices[i].head = NULL;
+        slices[i].tail = NULL;
+        slices[i].count = 0;
+        slices[i].success = false;
+    }
+    run_tasks(parse_array_slice, slices, sizeof(array_slice), slice_count);
+
+    array = parse_new_item(&buffer);
+    for (i = 0; i < slice_count; i++) {
+        if ((array == NULL) || !slices[i].success ||
+            (slices[i].count > INT32_MAX - array->child_count)) {
+            break;
+        }
+        /* splice the children together, add_item_to_array style */
+        if (array->child == NULL) {
+            array->child = slices[i].head;
+        } else {
+            array->child->prev->next = slices[i].head;
+            slices[i].head->prev = array->child->prev;
+        }
+        array->child->prev = slices[i].tail;
+        array->child_count += slices[i].count;
+        slices[i].head = NULL;
+    }
+    if (i < slice_count) {
+        /* leave the error to the serial parser, which also reports where */
+        for (i = 0; i < slice_count; i++) {
+            if (slices[i].head != NULL) {
+                delete_item(slices[i].head, &global_hooks);
+            }
+        }
+        if (array != NULL) {
+            delete_item(array, &global_hooks);
+        }
+        goto serial;
+    }
+
+    array->type = sbJSON_Array;
+    global_error.json = NULL;
+    global_error.position = 0;
+    /* the slices only count the time and bytes of their elements */
+    stats_add(&buffer.hooks, bytes_parsed, buffer_length);
+    stats_depth(&buffer.hooks, 1);
+    return array;
+
+serial:
+    return sbj_parse_with_length(value, buffer_length);
+}
+
+/* Adds the number of characters print_value writes for item to length, which
+ * depends on the depth only if format is set. False if item can't be
+ * printed. */
+static bool measure_value(sbJSON const *const item, bool const format,
+                          size_t const depth, size_t *const length) {
+    unsigned char number_buffer[26];
+    sbJSON const *child = NULL;
+
+    switch (item->type) {
+    case sbJSON_Null:
+        *length += static_strlen("null");
+        return true;
+    case sbJSON_Bool:
+        *length += item->u.valuebool ? static_strlen("true")
+                                     : static_strlen("false");
+        return true;
+    case sbJSON_Number:
+        *length += (size_t)format_number(item, number_buffer);
+        return true;
+    case sbJSON_Raw:
+        if (item->u.valuestring == NULL) {
             return false;
         }
-        strcpy((char *)output, "\"\"");
+        *length += strlen(item->u.valuestring);
+        return true;
+    case sbJSON_String:
+        *length += static_strlen("\"\"");
+        if (item->u.valuestring != NULL) {
+            *length += escaped_length(
+                (unsigned char const *)item->u.valuestring,
+                strlen(item->u.valuestring));
+        }
+        return true;
+    case sbJSON_Array:
+    case sbJSON_Object:
+        if (item->is_lazy) {
+            *length += lazy_length(item);
+            return true;
+        }
+        break;
+    default:
+        return false;
+    }
 
+    if (item->is_packed) {
+        sbJSON element;
+        size_t i = 0;
+
+        *length += static_strlen("[]");
+        for (i = 0; i < (size_t)item->child_count; i++) {
+            packed_element(item, i, &element);
+            *length += (size_t)format_number(&element, number_buffer);
+        }
+        /* the separators */
+        *length += (size_t)(item->child_count - 1) * (format ? 2 : 1);
+        return true;
+    }
+
+    if (item->type == sbJSON_Array) {
+        /* [a, b] or [a,b] */
+        *length += static_strlen("[]");
+        for (child = item->child; child != NULL; child = child->next) {
+            if (!measure_value(child, format, depth + 1, length)) {
+                return false;
+            }
+            if (child->next != NULL) {
+                *length += format ? 2 : 1;
+            }
+        }
         return true;
     }
 
-    /* set "flag" to 1 if something needs to be escaped */
-    for (input_pointer = input; *input_pointer; input_pointer++) {
-        switch (*input_pointer) {
-        case '\"':
-        case '\\':
-        case '\b':
-        case '\f':
-        case '\n':
-        case '\r':
-        case '\t':
-            /* one character escape sequence */
-            escape_characters++;
-            break;
-        default:
-            if (*input_pointer < 32) {
-                /* UTF-16 escape sequence uXXXX */
-                escape_characters += 5;
-            }
-            break;
-        }
+    /* {\n\t"key":\tvalue,\n}, the closing brace indented by depth */
+    *length += static_strlen("{}") + (format ? 1 + depth : 0);
+    for (child = item->child; child != NULL; child = child->next) {
+        *length += static_strlen("\"\":") +
+                   ((child->string != NULL)
+                        ? escaped_length((unsigned char const *)child->string,
+                                         strlen(child->string))
+                        : 0);
+        if (format) {
+            /* indentation, tab after the colon and newline */
+            *length += depth + 1 + 2;
+        }
+        if (!measure_value(child, format, depth + 1, length)) {
+            return false;
+        }
+        if (child->next != NULL) {
+            *length += 1;
+        }
+    }
+
+    return true;
+}
+
+size_t sbj_print_length(sbJSON const *item, bool format) {
+    size_t length = 0;
+
+    if ((item == NULL) || !measure_value(item, format, 0, &length)) {
+        return 0;
+    }
+
+    return length;
+}
+
+static unsigned char *print(sbJSON const *const item, bool format,
+                            internal_hooks const *const hooks,
+                            size_t const threads) {
+    printbuffer buffer[1];
+    size_t length = 0;
+
+    if ((item == NULL) || !measure_value(item, format, 0, &length)) {
+        return NULL;
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+
+    /* the exact size, so the buffer never has to grow or be trimmed */
+    buffer->buffer = (unsigned char *)hooks->allocate(length + sizeof(""));
+    buffer->length = length + sizeof("");
+    buffer->format = format;
+    buffer->hooks = *hooks;
+    buffer->threads = threads;
+    if (buffer->buffer == NULL) {
+        return NULL;
+    }
+
+    /* print the value */
+    if (!print_value(item, buffer)) {
+        hooks->deallocate(buffer->buffer);
+        return NULL;
+    }
+    assert(strlen((char const *)buffer->buffer) == length);
+
+    return buffer->buffer;
+}
+
+/* Render a sbJSON item/entity/structure to text. */
+char *sbj_print(sbJSON const *item) {
+    return (char *)print(item, true, &global_hooks, 0);
+}
+
+char *sbj_print_unformatted(sbJSON const *item) {
+    return (char *)print(item, false, &global_hooks, 0);
+}
+
+char *sbj_print_parallel(sbJSON const *item, bool format, size_t threads) {
+    if (threads == 0) {
+        threads = default_thread_count();
+    }
+
+    return (char *)print(item, format, &global_hooks,
+                         sbjson_min(threads, (size_t)max_threads));
+}
+
+char *sbj_print_buffered(sbJSON const *item, int prebuffer, bool fmt) {
+    printbuffer p = empty_printbuffer;
+
+    if (prebuffer < 0) {
+        return NULL;
+    }
+
+    p.buffer = (unsigned char *)global_hooks.allocate((size_t)prebuffer);
+    if (!p.buffer) {
+        return NULL;
+    }
+
+    p.length = (size_t)prebuffer;
+    p.offset = 0;
+    p.noalloc = false;
+    p.format = fmt;
+    p.hooks = global_hooks;
+
+    if (!print_value(item, &p)) {
+        global_hooks.deallocate(p.buffer);
+        return NULL;
+    }
+
+    return (char *)p.buffer;
+}
+
+bool sbj_print_preallocated(sbJSON *item, char *buffer, int const length,
+                            bool const format) {
+    printbuffer p = empty_printbuffer;
+
+    if ((length < 0) || (buffer == NULL)) {
+        return false;
+    }
+
+    p.buffer = (unsigned char *)buffer;
+    p.length = (size_t)length;
+    p.offset = 0;
+    p.noalloc = true;
+    p.format = format;
+    p.hooks = global_hooks;
+
+    return print_value(item, &p);
+}
+
+struct sbj_printer {
+    internal_hooks hooks;
+    unsigned char *buffer;
+    size_t size;
+};
+
+sbj_printer *sbj_printer_new(size_t initial_size) {
+    static const size_t default_buffer_size = 256;
+    sbj_printer *const printer =
+        (sbj_printer *)global_hooks.allocate(sizeof(sbj_printer));
+
+    if (printer == NULL) {
+        return NULL;
+    }
+
+    printer->hooks = global_hooks;
+    printer->size = (initial_size != 0) ? initial_size : default_buffer_size;
+    printer->buffer = (unsigned char *)printer->hooks.allocate(printer->size);
+    if (printer->buffer == NULL) {
+        printer->hooks.deallocate(printer);
+        return NULL;
+    }
+
+    return printer;
+}
+
+void sbj_printer_free(sbj_printer *printer) {
+    if (printer == NULL) {
+        return;
     }
-    output_length = (size_t)(input_pointer - input) + escape_characters;
 
-    output = ensure(output_buffer, output_length + sizeof("\"\""));
-    if (output == NULL) {
-        return false;
+    if (printer->buffer != NULL) {
+        printer->hooks.deallocate(printer->buffer);
     }
+    printer->hooks.deallocate(printer);
+}
 
-    /* no characters have to be escaped */
-    if (escape_characters == 0) {
-        output[0] = '\"';
-        memcpy(output + 1, input, output_length);
-        output[output_length + 1] = '\"';
-        output[output_length + 2] = '\0';
+char const *sbj_printer_print(sbj_printer *printer, sbJSON const *item,
+                              bool format, size_t *length) {
+    printbuffer buffer = empty_printbuffer;
+    bool printed_value = false;
 
-        return true;
+    if ((printer == NULL) || (item == NULL)) {
+        return NULL;
     }
 
-    output[0] = '\"';
-    output_pointer = output + 1;
-    /* copy the string */
-    for (input_pointer = input; *input_pointer != '\0';
-         (void)input_pointer++, output_pointer++) {
-        if ((*input_pointer > 31) && (*input_pointer != '\"') &&
-            (*input_pointer != '\\')) {
-            /* normal character, copy */
-            *output_pointer = *input_pointer;
-        } else {
-            /* character needs to be escaped */
-            *output_pointer++ = '\\';
-            switch (*input_pointer) {
-            case '\\':
-                *output_pointer = '\\';
-                break;
-            case '\"':
-                *output_pointer = '\"';
-                break;
-            case '\b':
-                *output_pointer = 'b';
-                break;
-            case '\f':
-                *output_pointer = 'f';
-                break;
-            case '\n':
-                *output_pointer = 'n';
-                break;
-            case '\r':
-                *output_pointer = 'r';
-                break;
-            case '\t':
-                *output_pointer = 't';
-                break;
-            default:
-                /* escape and print as unicode codepoint */
-                sprintf((char *)output_pointer, "u%04x", *input_pointer);
-                output_pointer += 4;
-                break;
-            }
+    if (printer->buffer == NULL) {
+        /* a failed print released it */
+        printer->buffer =
+            (unsigned char *)printer->hooks.allocate(printer->size);
+        if (printer->buffer == NULL) {
+            return NULL;
         }
     }
-    output[output_length + 1] = '\"';
-    output[output_length + 2] = '\0';
 
-    return true;
-}
+    /* print into the kept buffer, it keeps its size for the next call */
+    buffer.buffer = printer->buffer;
+    buffer.length = printer->size;
+    buffer.format = format;
+    buffer.hooks = printer->hooks;
 
-/* Invoke print_string_ptr (which is useful) on an item. */
-static bool print_string(sbJSON const *const item, printbuffer *const p) {
-    return print_string_ptr((unsigned char *)item->u.valuestring, p);
+    printed_value = print_value(item, &buffer);
+
+    /* ensure may have moved or released the buffer */
+    printer->buffer = buffer.buffer;
+    if (buffer.buffer != NULL) {
+        printer->size = buffer.length;
+    }
+    if (!printed_value) {
+        return NULL;
+    }
+    update_offset(&buffer);
+
+    if (length != NULL) {
+        *length = buffer.offset;
+    }
+    return (char const *)buffer.buffer;
 }
 
-/* Predeclare these prototypes. */
-static bool parse_value(sbJSON *const item, parse_buffer *const input_buffer);
-static bool print_value(sbJSON const *const item,
-                        printbuffer *const output_buffer);
-static bool parse_array(sbJSON *const item, parse_buffer *const input_buffer);
-static bool print_array(sbJSON const *const item,
-                        printbuffer *const output_buffer);
-static bool parse_object(sbJSON *const item, parse_buffer *const input_buffer);
-static bool print_object(sbJSON const *const item,
-                         printbuffer *const output_buffer);
+bool sbj_print_to_sink(sbJSON const *item, bool format, sbj_write_fn write_fn,
+                       void *user, size_t chunk_size) {
+    static const size_t default_chunk_size = 16 * 1024;
+    printbuffer p = empty_printbuffer;
+    bool success = false;
 
-/* Utility to jump whitespace and cr/lf */
-static parse_buffer *buffer_skip_whitespace(parse_buffer *const buffer) {
-    if ((buffer == NULL) || (buffer->content == NULL)) {
-        return NULL;
+    if ((item == NULL) || (write_fn == NULL)) {
+        return false;
     }
 
-    if (cannot_access_at_index(buffer, 0)) {
-        return buffer;
+    if (chunk_size == 0) {
+        chunk_size = default_chunk_size;
     }
 
-    while (can_access_at_index(buffer, 0) &&
-           (buffer_at_offset(buffer)[0] <= 32)) {
-        buffer->offset++;
+    p.buffer = (unsigned char *)global_hooks.allocate(chunk_size);
+    if (p.buffer == NULL) {
+        return false;
     }
 
-    if (buffer->offset == buffer->length) {
-        buffer->offset--;
+    p.length = chunk_size;
+    p.format = format;
+    p.hooks = global_hooks;
+    p.write_fn = write_fn;
+    p.user = user;
+
+    if (print_value(item, &p)) {
+        update_offset(&p);
+        success = (p.offset == 0) ||
+                  write_fn(user, (char const *)p.buffer, p.offset);
+        stats_add(&p.hooks, bytes_printed, success ? p.offset : 0);
     }
 
-    return buffer;
+    /* ensure releases the buffer if it fails to grow it */
+    if (p.buffer != NULL) {
+        global_hooks.deallocate(p.buffer);
+    }
+
+    return success;
 }
 
-/* skip the UTF-8 BOM (byte order mark) if it is at the beginning of a buffer */
-static parse_buffer *skip_utf8_bom(parse_buffer *const buffer) {
-    if ((buffer == NULL) || (buffer->content == NULL) ||
-        (buffer->offset != 0)) {
-        return NULL;
+/* Binary encoding: a header, then every value as a tag byte and its payload.
+ * Lengths, counts and integers (zigzag encoded) are variable length with 7 bits
+ * per byte, least significant first, doubles are 8 bytes little endian. Object
+ * members are the key as a string without tag followed by the value. */
+static unsigned char const binary_header[4] = {'s', 'b', 'J', 1};
+
+typedef enum {
+    binary_null,
+    binary_false,
+    binary_true,
+    binary_integer,
+    binary_double,
+    binary_string,
+    binary_raw,
+    binary_array,
+    binary_object
+} binary_tag;
+
+#define max_varint_length 10
+
+static bool encode_varint(printbuffer *const p, uint64_t value) {
+    unsigned char *const output = ensure(p, max_varint_length);
+    size_t length = 0;
+
+    if (output == NULL) {
+        return false;
     }
 
-    if (can_access_at_index(buffer, 4) &&
-        (strncmp((char const *)buffer_at_offset(buffer), "\xEF\xBB\xBF", 3) ==
-         0)) {
-        buffer->offset += 3;
+    while (value >= 0x80) {
+        output[length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
     }
+    output[length++] = (unsigned char)value;
+    p->offset += length;
 
-    return buffer;
+    return true;
 }
 
-sbJSON *sbj_parse_with_opts(char const *value, char const **return_parse_end,
-                            bool require_null_terminated) {
-    size_t buffer_length;
+static bool encode_bytes(printbuffer *const p, void const *const bytes,
+                         size_t const length) {
+    unsigned char *output = NULL;
 
-    if (NULL == value) {
-        return NULL;
+    if (!encode_varint(p, length)) {
+        return false;
+    }
+    output = ensure(p, length);
+    if (output == NULL) {
+        return false;
     }
+    memcpy(output, bytes, length);
+    p->offset += length;
 
-    /* Adding null character size due to require_null_terminated. */
-    buffer_length = strlen(value) + sizeof("");
+    return true;
+}
 
-    return sbj_parse_with_length_opts(value, buffer_length, return_parse_end,
-                                      require_null_terminated);
+static bool encode_string(printbuffer *const p, char const *const string) {
+    return encode_bytes(p, (string != NULL) ? string : "",
+                        (string != NULL) ? strlen(string) : 0);
 }
 
-/* Parse an object - create a new root, and populate. */
-sbJSON *sbj_parse_with_length_opts(char const *value, size_t buffer_length,
-                                   char const **return_parse_end,
-                                   bool require_null_terminated) {
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
-    sbJSON *item = NULL;
+static bool encode_tag(printbuffer *const p, binary_tag const tag) {
+    unsigned char *const output = ensure(p, 1);
+    if (output == NULL) {
+        return false;
+    }
+    *output = (unsigned char)tag;
+    p->offset++;
 
-    /* reset error position */
-    global_error.json = NULL;
-    global_error.position = 0;
+    return true;
+}
 
-    if (value == NULL || 0 == buffer_length) {
-        goto fail;
+static bool encode_value(sbJSON const *const item, printbuffer *const p) {
+    switch (item->type) {
+    case sbJSON_Null:
+        return encode_tag(p, binary_null);
+    case sbJSON_Bool:
+        return encode_tag(p, item->u.valuebool ? binary_true : binary_false);
+    case sbJSON_Number:
+        if (item->is_number_double) {
+            unsigned char *output = NULL;
+            uint64_t bits = 0;
+            int i;
+
+            if (!encode_tag(p, binary_double)) {
+                return false;
+            }
+            output = ensure(p, sizeof(bits));
+            if (output == NULL) {
+                return false;
+            }
+            memcpy(&bits, &item->u.valuedouble, sizeof(bits));
+            for (i = 0; i < 8; i++) {
+                output[i] = (unsigned char)(bits >> (8 * i));
+            }
+            p->offset += sizeof(bits);
+            return true;
+        }
+        /* zigzag moves the sign into the lowest bit, so small negative
+         * numbers stay short */
+        return encode_tag(p, binary_integer) &&
+               encode_varint(p, ((uint64_t)item->u.valueint << 1) ^
+                                    (uint64_t)(item->u.valueint >> 63));
+    case sbJSON_String:
+        return encode_tag(p, binary_string) &&
+               encode_string(p, item->u.valuestring);
+    case sbJSON_Raw:
+        return encode_tag(p, binary_raw) &&
+               encode_string(p, item->u.valuestring);
+    case sbJSON_Array:
+    case sbJSON_Object: {
+        sbJSON const *child = sbj_get_child(item);
+
+        if (item->is_lazy || item->is_packed) {
+            return false; /* invalid contents or out of memory */
+        }
+        if (!encode_tag(p, (item->type == sbJSON_Array) ? binary_array
+                                                        : binary_object) ||
+            !encode_varint(p, (uint64_t)item->child_count)) {
+            return false;
+        }
+        for (; child != NULL; child = child->next) {
+            if ((item->type == sbJSON_Object) &&
+                !encode_string(p, child->string)) {
+                return false;
+            }
+            if (!encode_value(child, p)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    default:
+        return false;
     }
+}
 
-    buffer.content = (unsigned char const *)value;
-    buffer.length = buffer_length;
-    buffer.offset = 0;
-    buffer.hooks = global_hooks;
+unsigned char *sbj_encode_binary(sbJSON const *item, size_t *length) {
+    static const size_t default_buffer_size = 256;
+    printbuffer p = empty_printbuffer;
 
-    item = sbJSON_New_Item(&global_hooks);
-    if (item == NULL) /* memory fail */
-    {
-        goto fail;
+    if ((item == NULL) || (length == NULL)) {
+        return NULL;
     }
 
-    if (!parse_value(item, buffer_skip_whitespace(skip_utf8_bom(&buffer)))) {
-        /* parse failure. ep is set. */
-        goto fail;
+    p.buffer = (unsigned char *)global_hooks.allocate(default_buffer_size);
+    if (p.buffer == NULL) {
+        return NULL;
     }
+    p.length = default_buffer_size;
+    p.hooks = global_hooks;
 
-    /* if we require null-terminated JSON without appended garbage, skip and
-     * then check for a null terminator */
-    if (require_null_terminated) {
-        buffer_skip_whitespace(&buffer);
-        if ((buffer.offset >= buffer.length) ||
-            buffer_at_offset(&buffer)[0] != '\0') {
-            goto fail;
+    memcpy(p.buffer, binary_header, sizeof(binary_header));
+    p.offset = sizeof(binary_header);
+
+    if (!encode_value(item, &p)) {
+        /* ensure releases the buffer if it fails to grow it */
+        if (p.buffer != NULL) {
+            global_hooks.deallocate(p.buffer);
         }
-    }
-    if (return_parse_end) {
-        *return_parse_end = (char const *)buffer_at_offset(&buffer);
+        return NULL;
     }
 
-    return item;
+    *length = p.offset;
+    return p.buffer;
+}
 
-fail:
-    if (item != NULL) {
-        sbj_delete(item);
-    }
+static bool decode_varint(parse_buffer *const buffer, uint64_t *const value) {
+    unsigned int shift = 0;
 
-    if (value != NULL) {
-        error local_error;
-        local_error.json = (unsigned char const *)value;
-        local_error.position = 0;
+    *value = 0;
+    for (; can_access_at_index(buffer, 0); shift += 7) {
+        unsigned char const byte = buffer_at_offset(buffer)[0];
 
-        if (buffer.offset < buffer.length) {
-            local_error.position = buffer.offset;
-        } else if (buffer.length > 0) {
-            local_error.position = buffer.length - 1;
+        if ((shift == 63) && (byte > 1)) {
+            return false; /* more than 64 bits */
         }
-
-        if (return_parse_end != NULL) {
-            *return_parse_end =
-                (char const *)local_error.json + local_error.position;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        buffer->offset++;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+        if (shift == 63) {
+            return false;
         }
-
-        global_error = local_error;
     }
 
-    return NULL;
+    return false; /* ends within the number */
 }
 
-/* Default options for sbj_parse */
-sbJSON *sbj_parse(char const *value) {
-    return sbj_parse_with_opts(value, 0, 0);
-}
+/* a zero terminated copy of a length prefixed string */
+static char *decode_string(parse_buffer *const buffer) {
+    uint64_t length = 0;
+    char *string = NULL;
 
-sbJSON *sbj_parse_with_length(char const *value, size_t buffer_length) {
-    return sbj_parse_with_length_opts(value, buffer_length, 0, 0);
-}
+    if (!decode_varint(buffer, &length) ||
+        (length > buffer->length - buffer->offset)) {
+        return NULL;
+    }
 
-#define sbjson_min(a, b) (((a) < (b)) ? (a) : (b))
+    string = (char *)buffer->hooks.allocate((size_t)length + sizeof(""));
+    if (string == NULL) {
+        return NULL;
+    }
+    memcpy(string, buffer_at_offset(buffer), (size_t)length);
+    string[length] = '\0';
+    buffer->offset += (size_t)length;
 
-static unsigned char *print(sbJSON const *const item, bool format,
-                            internal_hooks const *const hooks) {
-    static const size_t default_buffer_size = 256;
-    printbuffer buffer[1];
-    unsigned char *printed = NULL;
+    return string;
+}
 
-    memset(buffer, 0, sizeof(buffer));
+static bool decode_value(sbJSON *const item, parse_buffer *const buffer) {
+    unsigned char tag = 0;
 
-    /* create buffer */
-    buffer->buffer = (unsigned char *)hooks->allocate(default_buffer_size);
-    buffer->length = default_buffer_size;
-    buffer->format = format;
-    buffer->hooks = *hooks;
-    if (buffer->buffer == NULL) {
-        goto fail;
+    if (cannot_access_at_index(buffer, 0)) {
+        return false;
     }
+    tag = buffer_at_offset(buffer)[0];
+    buffer->offset++;
 
-    /* print the value */
-    if (!print_value(item, buffer)) {
-        goto fail;
+    switch (tag) {
+    case binary_null:
+        item->type = sbJSON_Null;
+        return true;
+    case binary_false:
+    case binary_true:
+        item->type = sbJSON_Bool;
+        item->u.valuebool = (tag == binary_true);
+        return true;
+    case binary_integer: {
+        uint64_t zigzag = 0;
+        if (!decode_varint(buffer, &zigzag)) {
+            return false;
+        }
+        item->type = sbJSON_Number;
+        item->u.valueint = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        return true;
     }
-    update_offset(buffer);
+    case binary_double: {
+        uint64_t bits = 0;
+        int i;
 
-    /* check if reallocate is available */
-    if (hooks->reallocate != NULL) {
-        printed = (unsigned char *)hooks->reallocate(buffer->buffer,
-                                                     buffer->offset + 1);
-        if (printed == NULL) {
-            goto fail;
+        if (!can_read(buffer, sizeof(bits))) {
+            return false;
         }
-        buffer->buffer = NULL;
-    } else /* otherwise copy the JSON over to a new buffer */
-    {
-        printed = (unsigned char *)hooks->allocate(buffer->offset + 1);
-        if (printed == NULL) {
-            goto fail;
+        for (i = 0; i < 8; i++) {
+            bits |= (uint64_t)buffer_at_offset(buffer)[i] << (8 * i);
         }
-        memcpy(printed, buffer->buffer,
-               sbjson_min(buffer->length, buffer->offset + 1));
-        printed[buffer->offset] = '\0'; /* just to be sure */
-
-        /* free the buffer */
-        hooks->deallocate(buffer->buffer);
+        buffer->offset += sizeof(bits);
+        item->type = sbJSON_Number;
+        item->is_number_double = true;
+        memcpy(&item->u.valuedouble, &bits, sizeof(bits));
+        return true;
     }
+    case binary_string:
+    case binary_raw:
+        item->u.valuestring = decode_string(buffer);
+        if (item->u.valuestring == NULL) {
+            return false;
+        }
+        item->type = (tag == binary_string) ? sbJSON_String : sbJSON_Raw;
+        return true;
+    case binary_array:
+    case binary_object: {
+        uint64_t count = 0;
+        uint64_t i = 0;
+        sbJSON *head = NULL;
+        sbJSON *current_item = NULL;
+
+        /* every item takes at least one byte, which limits what a corrupt
+         * count can allocate */
+        if (!decode_varint(buffer, &count) || (count > INT32_MAX) ||
+            (count > buffer->length - buffer->offset)) {
+            return false;
+        }
+        if (!can_nest_deeper(buffer)) {
+            return false; /* to deeply nested */
+        }
+        buffer->depth++;
 
-    return printed;
-
-fail:
-    if (buffer->buffer != NULL) {
-        hooks->deallocate(buffer->buffer);
-    }
+        for (i = 0; i < count; i++) {
+            /* decode_value allocates strings itself, never inline */
+            sbJSON *const new_item = parse_new_node(buffer, false);
+            if (new_item == NULL) {
+                goto fail; /* allocation failure */
+            }
+            if (head == NULL) {
+                current_item = head = new_item;
+            } else {
+                current_item->next = new_item;
+                new_item->prev = current_item;
+                current_item = new_item;
+            }
 
-    if (printed != NULL) {
-        hooks->deallocate(printed);
-    }
+            if (tag == binary_object) {
+                current_item->string = decode_string(buffer);
+                if (current_item->string == NULL) {
+                    goto fail;
+                }
+            }
+            if (!decode_value(current_item, buffer)) {
+                goto fail;
+            }
+        }
 
-    return NULL;
-}
+        buffer->depth--;
+        if (head != NULL) {
+            head->prev = current_item;
+        }
+        item->type = (tag == binary_array) ? sbJSON_Array : sbJSON_Object;
+        item->child = head;
+        item->child_count = (int32_t)count;
+        return true;
 
-/* Render a sbJSON item/entity/structure to text. */
-char *sbj_print(sbJSON const *item) {
-    return (char *)print(item, true, &global_hooks);
+    fail:
+        if (head != NULL) {
+            delete_item(head, &buffer->hooks);
+        }
+        return false;
+    }
+    default:
+        return false;
+    }
 }
 
-char *sbj_print_unformatted(sbJSON const *item) {
-    return (char *)print(item, false, &global_hooks);
-}
+sbJSON *sbj_decode_binary(unsigned char const *data, size_t length) {
+    parse_buffer buffer = empty_parse_buffer;
+    sbJSON *item = NULL;
 
-char *sbj_print_buffered(sbJSON const *item, int prebuffer, bool fmt) {
-    printbuffer p = {0, 0, 0, 0, 0, 0, {0, 0, 0}};
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
 
-    if (prebuffer < 0) {
+    if ((data == NULL) || (length < sizeof(binary_header)) ||
+        (memcmp(data, binary_header, sizeof(binary_header)) != 0)) {
         return NULL;
     }
 
-    p.buffer = (unsigned char *)global_hooks.allocate((size_t)prebuffer);
-    if (!p.buffer) {
+    buffer.content = data;
+    buffer.length = length;
+    buffer.offset = sizeof(binary_header);
+    buffer.hooks = global_hooks;
+
+    item = parse_new_node(&buffer, false);
+    if (item == NULL) {
         return NULL;
     }
 
-    p.length = (size_t)prebuffer;
-    p.offset = 0;
-    p.noalloc = false;
-    p.format = fmt;
-    p.hooks = global_hooks;
-
-    if (!print_value(item, &p)) {
-        global_hooks.deallocate(p.buffer);
+    /* nothing may follow the value */
+    if (!decode_value(item, &buffer) || (buffer.offset != buffer.length)) {
+        delete_item(item, &buffer.hooks);
+        global_error.json = data;
+        global_error.position =
+            (buffer.offset < buffer.length) ? buffer.offset : buffer.length - 1;
         return NULL;
     }
 
-    return (char *)p.buffer;
+    return item;
 }
 
-bool sbj_print_preallocated(sbJSON *item, char *buffer, int const length,
-                            bool const format) {
-    printbuffer p = {0, 0, 0, 0, 0, 0, {0, 0, 0}};
+static bool parse_any_value(sbJSON *const item,
+                            parse_buffer *const input_buffer);
 
-    if ((length < 0) || (buffer == NULL)) {
-        return false;
-    }
+#ifdef SBJSON_STATS
+/* parse_value for the value at the top, counting its time and bytes */
+static bool parse_timed_value(sbJSON *const item,
+                              parse_buffer *const input_buffer) {
+    size_t const start = input_buffer->offset;
+    uint64_t const start_ticks = SBJSON_STATS_CLOCK();
+    bool const parsed = parse_any_value(item, input_buffer);
 
-    p.buffer = (unsigned char *)buffer;
-    p.length = (size_t)length;
-    p.offset = 0;
-    p.noalloc = true;
-    p.format = format;
-    p.hooks = global_hooks;
+    stats_add(&input_buffer->hooks, parse_cycles,
+              SBJSON_STATS_CLOCK() - start_ticks);
+    if (parsed) {
+        stats_add(&input_buffer->hooks, bytes_parsed,
+                  input_buffer->offset - start);
+    }
+    return parsed;
+}
+#endif
 
-    return print_value(item, &p);
+/* Nested values are counted as part of the one at the top */
+static bool parse_value(sbJSON *const item, parse_buffer *const input_buffer) {
+#ifdef SBJSON_STATS
+    if ((input_buffer != NULL) && (input_buffer->depth == 0)) {
+        return parse_timed_value(item, input_buffer);
+    }
+#endif
+    return parse_any_value(item, input_buffer);
 }
 
 /* Parser core - when encountering text, process appropriately. */
-static bool parse_value(sbJSON *const item, parse_buffer *const input_buffer) {
+static bool parse_any_value(sbJSON *const item,
+                            parse_buffer *const input_buffer) {
     if ((input_buffer == NULL) || (input_buffer->content == NULL)) {
         return false; /* no input */
     }
@@ -1222,6 +7249,12 @@ static bool parse_value(sbJSON *const item, parse_buffer *const input_buffer) {
           (buffer_at_offset(input_buffer)[0] <= '9')))) {
         return parse_number(item, input_buffer);
     }
+    /* array or object that is parsed later */
+    if (input_buffer->lazy && can_access_at_index(input_buffer, 0) &&
+        ((buffer_at_offset(input_buffer)[0] == '[') ||
+         (buffer_at_offset(input_buffer)[0] == '{'))) {
+        return parse_lazy_container(item, input_buffer);
+    }
     /* array */
     if (can_access_at_index(input_buffer, 0) &&
         (buffer_at_offset(input_buffer)[0] == '[')) {
@@ -1236,9 +7269,58 @@ static bool parse_value(sbJSON *const item, parse_buffer *const input_buffer) {
     return false;
 }
 
-/* Render a value to text. */
+/* Copy text such as a raw item into the output as is */
+static bool print_verbatim(char const *const text, size_t const length,
+                           printbuffer *const output_buffer) {
+    unsigned char *const output = ensure(output_buffer, length + sizeof(""));
+    if (output == NULL) {
+        return false;
+    }
+
+    memcpy(output, text, length);
+    output[length] = '\0';
+    return true;
+}
+
+static bool print_any_value(sbJSON const *const item,
+                            printbuffer *const output_buffer);
+
+#ifdef SBJSON_STATS
+/* print_value for the value at the top, counting its time and output */
+static bool print_timed_value(sbJSON const *const item,
+                              printbuffer *const output_buffer) {
+    size_t const start = output_buffer->offset;
+    uint64_t const start_ticks = SBJSON_STATS_CLOCK();
+    bool const printed = print_any_value(item, output_buffer);
+
+    stats_add(&output_buffer->hooks, print_cycles,
+              SBJSON_STATS_CLOCK() - start_ticks);
+    /* with a write_fn the bytes are counted as they are written; the offset
+     * may not include what was written last yet */
+    if (printed && (output_buffer->write_fn == NULL)) {
+        stats_add(&output_buffer->hooks, bytes_printed,
+                  output_buffer->offset - start +
+                      strlen((char const *)output_buffer->buffer +
+                             output_buffer->offset));
+    }
+    return printed;
+}
+#endif
+
+/* Nested values are counted as part of the one at the top */
 static bool print_value(sbJSON const *const item,
                         printbuffer *const output_buffer) {
+#ifdef SBJSON_STATS
+    if ((output_buffer != NULL) && (output_buffer->depth == 0)) {
+        return print_timed_value(item, output_buffer);
+    }
+#endif
+    return print_any_value(item, output_buffer);
+}
+
+/* Render a value to text. */
+static bool print_any_value(sbJSON const *const item,
+                            printbuffer *const output_buffer) {
     unsigned char *output = NULL;
 
     if ((item == NULL) || (output_buffer == NULL)) {
@@ -1271,39 +7353,133 @@ static bool print_value(sbJSON const *const item,
         }
     case sbJSON_Number:
         return print_number(item, output_buffer);
-    case sbJSON_Raw: {
-        size_t raw_length = 0;
+    case sbJSON_Raw:
         if (item->u.valuestring == NULL) {
             return false;
         }
 
-        raw_length = strlen(item->u.valuestring) + sizeof("");
-        output = ensure(output_buffer, raw_length);
-        if (output == NULL) {
-            return false;
-        }
-        memcpy(output, item->u.valuestring, raw_length);
-        return true;
-    }
+        return print_verbatim(item->u.valuestring,
+                              strlen(item->u.valuestring), output_buffer);
     case sbJSON_String:
         return print_string(item, output_buffer);
     case sbJSON_Array:
-        return print_array(item, output_buffer);
     case sbJSON_Object:
-        return print_object(item, output_buffer);
+        /* untouched lazy containers are printed as they were parsed */
+        if (item->is_lazy) {
+            return print_verbatim(item->u.valuestring, lazy_length(item),
+                                  output_buffer);
+        }
+        return (item->type == sbJSON_Array) ? print_array(item, output_buffer)
+                                            : print_object(item, output_buffer);
     default:
         return false;
     }
 }
 
+/* Numbers a packed array collects on the stack before it needs the heap */
+#define packed_stack_size 64
+
+/* Build a packed array from input text of only integers or only doubles. For
+ * any other array, or if out of memory, false with the buffer unchanged for
+ * parse_array to parse it into nodes, which also reports errors. */
+static bool parse_packed_array(sbJSON *const item,
+                               parse_buffer *const input_buffer) {
+    union sbj_packed_number stack_numbers[packed_stack_size];
+    union sbj_packed_number *numbers = stack_numbers;
+    size_t capacity = packed_stack_size;
+    size_t count = 0;
+    size_t const start = input_buffer->offset;
+    struct sbj_packed *packed = NULL;
+    bool is_double = false;
+    sbJSON number;
+
+    /* loop through the comma separated array elements */
+    do {
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (cannot_access_at_index(input_buffer, 0) ||
+            ((buffer_at_offset(input_buffer)[0] != '-') &&
+             !is_decimal_digit(buffer_at_offset(input_buffer)[0]))) {
+            goto fail; /* not a number, e.g. an empty array */
+        }
+
+        memset(&number, 0, sizeof(number));
+        if (!parse_number(&number, input_buffer) ||
+            ((count != 0) && (number.is_number_double != is_double))) {
+            goto fail;
+        }
+        is_double = number.is_number_double;
+
+        if (count == (size_t)INT32_MAX) {
+            goto fail; /* more than child_count can count */
+        }
+        if (count == capacity) {
+            void *grown = (numbers == stack_numbers) ? NULL : numbers;
+            size_t const used = (numbers == stack_numbers) ? 0 : count;
+
+            if (!grow_array(&input_buffer->hooks, &grown, used, &capacity,
+                            count + 1 - used, sizeof(*numbers))) {
+                goto fail;
+            }
+            if (numbers == stack_numbers) {
+                memcpy(grown, stack_numbers, sizeof(stack_numbers));
+            }
+            numbers = (union sbj_packed_number *)grown;
+        }
+        if (is_double) {
+            numbers[count++].number = number.u.valuedouble;
+        } else {
+            numbers[count++].integer = number.u.valueint;
+        }
+
+        buffer_skip_whitespace(input_buffer);
+    } while (can_access_at_index(input_buffer, 0) &&
+             (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) ||
+        (buffer_at_offset(input_buffer)[0] != ']')) {
+        goto fail; /* expected end of array */
+    }
+
+    packed = new_packed(count, is_double, &input_buffer->hooks);
+    if (packed == NULL) {
+        goto fail;
+    }
+    memcpy(packed->numbers, numbers, count * sizeof(*numbers));
+    if (numbers != stack_numbers) {
+        input_buffer->hooks.deallocate(numbers);
+    }
+
+    item->type = sbJSON_Array;
+    item->is_packed = true;
+    item->child_count = (int32_t)count;
+    item->u.packed = packed;
+    input_buffer->offset++;
+
+    return true;
+
+fail:
+    if (numbers != stack_numbers) {
+        input_buffer->hooks.deallocate(numbers);
+    }
+    input_buffer->offset = start;
+
+    return false;
+}
+
 /* Build an array from input text. */
 static bool parse_array(sbJSON *const item, parse_buffer *const input_buffer) {
     sbJSON *head = NULL; /* head of the linked list */
     sbJSON *current_item = NULL;
+    int32_t count = 0;
 
-    if (input_buffer->depth >= SBJSON_NESTING_LIMIT) {
+    if (!can_nest_deeper(input_buffer)) {
         return false; /* to deeply nested */
     }
+    stats_depth(&input_buffer->hooks, input_buffer->depth + 1);
+    if (input_buffer->packed && parse_packed_array(item, input_buffer)) {
+        return true;
+    }
     input_buffer->depth++;
 
     if (buffer_at_offset(input_buffer)[0] != '[') {
@@ -1330,7 +7506,7 @@ static bool parse_array(sbJSON *const item, parse_buffer *const input_buffer) {
     /* loop through the comma separated array elements */
     do {
         /* allocate next item */
-        sbJSON *new_item = sbJSON_New_Item(&(input_buffer->hooks));
+        sbJSON *new_item = parse_new_item(input_buffer);
         if (new_item == NULL) {
             goto fail; /* allocation failure */
         }
@@ -1345,6 +7521,7 @@ static bool parse_array(sbJSON *const item, parse_buffer *const input_buffer) {
             new_item->prev = current_item;
             current_item = new_item;
         }
+        count++;
 
         /* parse next value */
         input_buffer->offset++;
@@ -1370,6 +7547,7 @@ success:
 
     item->type = sbJSON_Array;
     item->child = head;
+    item->child_count = count;
 
     input_buffer->offset++;
 
@@ -1377,31 +7555,21 @@ success:
 
 fail:
     if (head != NULL) {
-        sbj_delete(head);
+        delete_item(head, &(input_buffer->hooks));
     }
 
     return false;
 }
 
-/* Render an array to text */
-static bool print_array(sbJSON const *const item,
-                        printbuffer *const output_buffer) {
+/* Render the elements from first up to stop, each followed by a separator if
+ * it isn't the last one of the array */
+static bool print_array_elements(sbJSON const *first, sbJSON const *const stop,
+                                 printbuffer *const output_buffer) {
     unsigned char *output_pointer = NULL;
     size_t length = 0;
-    sbJSON *current_element = item->child;
-
-    /* Compose the output array. */
-    /* opening square bracket */
-    output_pointer = ensure(output_buffer, 1);
-    if (output_pointer == NULL) {
-        return false;
-    }
-
-    *output_pointer = '[';
-    output_buffer->offset++;
-    output_buffer->depth++;
+    sbJSON const *current_element = first;
 
-    while (current_element != NULL) {
+    while (current_element != stop) {
         if (!print_value(current_element, output_buffer)) {
             return false;
         }
@@ -1422,25 +7590,171 @@ static bool print_array(sbJSON const *const item,
         current_element = current_element->next;
     }
 
-    output_pointer = ensure(output_buffer, 2);
-    if (output_pointer == NULL) {
+    return true;
+}
+
+/* Render the numbers of a packed array with their separators */
+static bool print_packed_elements(sbJSON const *const array,
+                                  printbuffer *const output_buffer) {
+    unsigned char *output_pointer = NULL;
+    size_t const length = (size_t)(output_buffer->format ? 2 : 1);
+    sbJSON element;
+    size_t i = 0;
+
+    for (i = 0; i < (size_t)array->child_count; i++) {
+        packed_element(array, i, &element);
+        if (!print_number(&element, output_buffer)) {
+            return false;
+        }
+        if (i + 1 < (size_t)array->child_count) {
+            output_pointer = ensure(output_buffer, length + 1);
+            if (output_pointer == NULL) {
+                return false;
+            }
+            *output_pointer++ = ',';
+            if (output_buffer->format) {
+                *output_pointer++ = ' ';
+            }
+            *output_pointer = '\0';
+            output_buffer->offset += length;
+        }
+    }
+
+    return true;
+}
+
+/* Render an array to text */
+static bool print_array(sbJSON const *const item,
+                        printbuffer *const output_buffer) {
+    unsigned char *output_pointer = NULL;
+
+    /* Compose the output array. */
+    /* opening square bracket */
+    output_pointer = ensure(output_buffer, 1);
+    if (output_pointer == NULL) {
+        return false;
+    }
+
+    *output_pointer = '[';
+    output_buffer->offset++;
+    output_buffer->depth++;
+
+    if (!print_children(item, output_buffer)) {
+        return false;
+    }
+
+    output_pointer = ensure(output_buffer, 2);
+    if (output_pointer == NULL) {
+        return false;
+    }
+    *output_pointer++ = ']';
+    *output_pointer = '\0';
+    output_buffer->depth--;
+
+    return true;
+}
+
+/* Parse the name of an object member into item->string, with a key table the
+ * table's copy of it. */
+static bool parse_key(sbJSON *const item, parse_buffer *const input_buffer) {
+    char const *key = NULL;
+
+    if (input_buffer->keys != NULL) {
+        size_t skipped_bytes = 0;
+        unsigned char const *const input_end =
+            find_string_end(input_buffer, &skipped_bytes);
+
+        /* names without escapes are looked up without copying them */
+        if ((input_end != NULL) && (skipped_bytes == 0)) {
+            unsigned char const *const name =
+                buffer_at_offset(input_buffer) + 1;
+            key = intern_key(input_buffer->keys, name,
+                             (size_t)(input_end - name));
+        }
+        if (key != NULL) {
+            item->string = (char *)cast_away_const(key);
+            item->string_is_const = true;
+            input_buffer->offset = (size_t)(input_end - input_buffer->content);
+            input_buffer->offset++;
+            return true;
+        }
+    }
+
+    if (!parse_string(item, input_buffer)) {
+        return false;
+    }
+
+    /* swap valuestring and string, because we parsed the name */
+    item->string = item->u.valuestring;
+    item->u.valuestring = NULL;
+    /* a key that isn't owned by the node is treated like a constant one */
+    item->string_is_const = item->is_reference;
+    item->is_reference = false;
+
+    if ((input_buffer->keys != NULL) && !item->string_is_const) {
+        key = intern_key(input_buffer->keys, (unsigned char *)item->string,
+                         strlen(item->string));
+        if (key != NULL) {
+            input_buffer->hooks.deallocate(item->string);
+            item->string = (char *)cast_away_const(key);
+            item->string_is_const = true;
+        }
+    }
+
+    return true;
+}
+
+#ifdef SBJSON_COMPACT
+/* Whether the member that follows the buffer offset has a key that can go to
+ * the inline storage, or else a string value that can. */
+static bool member_fits_inline(parse_buffer const *const input_buffer) {
+    parse_buffer key = *input_buffer;
+    unsigned char const *key_end = NULL;
+    size_t skipped_bytes = 0;
+    size_t position = 0;
+
+    key.offset = element_start(input_buffer);
+    /* interned keys don't take the storage */
+    if ((input_buffer->keys == NULL) && fits_inline(&key, key.offset)) {
+        return true;
+    }
+
+    key_end = find_string_end(&key, &skipped_bytes);
+    if (key_end == NULL) {
+        return false;
+    }
+    position = skip_whitespace_at(
+        input_buffer, (size_t)(key_end - input_buffer->content) + 1);
+    if ((position >= input_buffer->length) ||
+        (input_buffer->content[position] != ':')) {
         return false;
     }
-    *output_pointer++ = ']';
-    *output_pointer = '\0';
-    output_buffer->depth--;
 
-    return true;
+    return fits_inline(input_buffer,
+                       skip_whitespace_at(input_buffer, position + 1));
+}
+#endif
+
+/* allocate a node for the member that follows the buffer offset */
+static sbJSON *parse_new_member(parse_buffer *const input_buffer) {
+#ifdef SBJSON_COMPACT
+    return parse_new_node(input_buffer, can_store_inline(input_buffer) &&
+                                            member_fits_inline(input_buffer));
+#else
+    return parse_new_node(input_buffer, false);
+#endif
 }
 
 /* Build an object from the text. */
 static bool parse_object(sbJSON *const item, parse_buffer *const input_buffer) {
     sbJSON *head = NULL; /* linked list head */
     sbJSON *current_item = NULL;
+    int32_t count = 0;
 
-    if (input_buffer->depth >= SBJSON_NESTING_LIMIT) {
+    if (!can_nest_deeper(input_buffer)) {
         return false; /* to deeply nested */
     }
+    stats_depth(&input_buffer->hooks, input_buffer->depth + 1);
     input_buffer->depth++;
 
     if (cannot_access_at_index(input_buffer, 0) ||
@@ -1466,7 +7780,7 @@ static bool parse_object(sbJSON *const item, parse_buffer *const input_buffer) {
     /* loop through the comma separated array elements */
     do {
         /* allocate next item */
-        sbJSON *new_item = sbJSON_New_Item(&(input_buffer->hooks));
+        sbJSON *new_item = parse_new_member(input_buffer);
         if (new_item == NULL) {
             goto fail; /* allocation failure */
         }
@@ -1481,19 +7795,16 @@ static bool parse_object(sbJSON *const item, parse_buffer *const input_buffer) {
             new_item->prev = current_item;
             current_item = new_item;
         }
+        count++;
 
         /* parse the name of the child */
         input_buffer->offset++;
         buffer_skip_whitespace(input_buffer);
-        if (!parse_string(current_item, input_buffer)) {
+        if (!parse_key(current_item, input_buffer)) {
             goto fail; /* failed to parse name */
         }
         buffer_skip_whitespace(input_buffer);
 
-        /* swap valuestring and string, because we parsed the name */
-        current_item->string = current_item->u.valuestring;
-        current_item->u.valuestring = NULL;
-
         if (cannot_access_at_index(input_buffer, 0) ||
             (buffer_at_offset(input_buffer)[0] != ':')) {
             goto fail; /* invalid object */
@@ -1514,184 +7825,737 @@ static bool parse_object(sbJSON *const item, parse_buffer *const input_buffer) {
         goto fail; /* expected end of object */
     }
 
-success:
-    input_buffer->depth--;
+success:
+    input_buffer->depth--;
+
+    if (head != NULL) {
+        head->prev = current_item;
+    }
+
+    item->type = sbJSON_Object;
+    item->child = head;
+    item->child_count = count;
+
+    input_buffer->offset++;
+    return true;
+
+fail:
+    if (head != NULL) {
+        delete_item(head, &(input_buffer->hooks));
+    }
+
+    return false;
+}
+
+/* Render the members from first up to stop, each followed by a separator if
+ * it isn't the last one of the object */
+static bool print_object_members(sbJSON const *first, sbJSON const *const stop,
+                                 printbuffer *const output_buffer) {
+    unsigned char *output_pointer = NULL;
+    size_t length = 0;
+    sbJSON const *current_item = first;
+
+    while (current_item != stop) {
+        if (output_buffer->format) {
+            size_t i;
+            output_pointer = ensure(output_buffer, output_buffer->depth);
+            if (output_pointer == NULL) {
+                return false;
+            }
+            for (i = 0; i < output_buffer->depth; i++) {
+                *output_pointer++ = '\t';
+            }
+            output_buffer->offset += output_buffer->depth;
+        }
+
+        /* print key */
+        if (!print_string_ptr((unsigned char *)current_item->string,
+                              output_buffer)) {
+            return false;
+        }
+        update_offset(output_buffer);
+
+        length = (size_t)(output_buffer->format ? 2 : 1);
+        output_pointer = ensure(output_buffer, length);
+        if (output_pointer == NULL) {
+            return false;
+        }
+        *output_pointer++ = ':';
+        if (output_buffer->format) {
+            *output_pointer++ = '\t';
+        }
+        output_buffer->offset += length;
+
+        /* print value */
+        if (!print_value(current_item, output_buffer)) {
+            return false;
+        }
+        update_offset(output_buffer);
+
+        /* print comma if not last */
+        length = ((size_t)(output_buffer->format ? 1 : 0) +
+                  (size_t)(current_item->next ? 1 : 0));
+        output_pointer = ensure(output_buffer, length + 1);
+        if (output_pointer == NULL) {
+            return false;
+        }
+        if (current_item->next) {
+            *output_pointer++ = ',';
+        }
+
+        if (output_buffer->format) {
+            *output_pointer++ = '\n';
+        }
+        *output_pointer = '\0';
+        output_buffer->offset += length;
+
+        current_item = current_item->next;
+    }
+
+    return true;
+}
+
+/* The children of a container for one thread of print_children */
+typedef struct {
+    sbJSON const *first;
+    sbJSON const *stop;
+    bool is_object;
+    printbuffer buffer;
+    bool success;
+} print_slice;
+
+static void print_slice_children(void *const task) {
+    print_slice *const slice = (print_slice *)task;
+
+    slice->success =
+        (slice->buffer.buffer != NULL) &&
+        (slice->is_object ? print_object_members(slice->first, slice->stop,
+                                                 &slice->buffer)
+                          : print_array_elements(slice->first, slice->stop,
+                                                 &slice->buffer));
+}
+
+/* Render the children of an array or object with their separators. Many
+ * children are split into runs that are rendered into buffers of their own
+ * at the same depth by several threads and then copied out in order, which
+ * gives the same text as rendering them one after the other. The slices are
+ * allocated, they would take a lot of stack for every level of nesting. */
+static bool print_children(sbJSON const *const item,
+                           printbuffer *const output_buffer) {
+    static const size_t slice_buffer_size = 4096;
+    bool const is_object = item->type == sbJSON_Object;
+    print_slice *slices = NULL;
+    sbJSON const *child = item->child;
+    size_t slice_count = 0;
+    size_t i = 0;
+    bool success = true;
+
+    if (item->is_packed) {
+        return print_packed_elements(item, output_buffer);
+    }
+
+    if ((output_buffer->threads <= 1) ||
+        (item->child_count < SBJSON_PARALLEL_THRESHOLD)) {
+        return is_object ? print_object_members(item->child, NULL,
+                                                output_buffer)
+                         : print_array_elements(item->child, NULL,
+                                                output_buffer);
+    }
+
+    slice_count = sbjson_min(output_buffer->threads, (size_t)max_threads);
+    slices = (print_slice *)output_buffer->hooks.allocate(slice_count *
+                                                          sizeof(print_slice));
+    if (slices == NULL) {
+        return false;
+    }
+    for (i = 0; i < slice_count; i++) {
+        /* as many children as the others, the first slices take the rest */
+        size_t count = (size_t)item->child_count / slice_count +
+                       ((i < (size_t)item->child_count % slice_count) ? 1 : 0);
+
+        slices[i].first = child;
+        while ((count-- > 0) && (child != NULL)) {
+            child = child->next;
+        }
+        slices[i].stop = child;
+        slices[i].is_object = is_object;
+        slices[i].success = false;
+        memset(&slices[i].buffer, 0, sizeof(printbuffer));
+        slices[i].buffer.depth = output_buffer->depth;
+        slices[i].buffer.format = output_buffer->format;
+        slices[i].buffer.hooks = output_buffer->hooks;
+        slices[i].buffer.buffer =
+            (unsigned char *)output_buffer->hooks.allocate(slice_buffer_size);
+        slices[i].buffer.length = slice_buffer_size;
+    }
+    /* a child_count that doesn't match the list leaves the rest to the last */
+    slices[slice_count - 1].stop = NULL;
+
+    run_tasks(print_slice_children, slices, sizeof(print_slice), slice_count);
+
+    for (i = 0; i < slice_count; i++) {
+        printbuffer *const printed = &slices[i].buffer;
+        unsigned char *output_pointer = NULL;
+
+        if (success && slices[i].success) {
+            output_pointer = ensure(output_buffer, printed->offset);
+            success = output_pointer != NULL;
+        } else {
+            success = false;
+        }
+        if (success) {
+            memcpy(output_pointer, printed->buffer, printed->offset);
+            output_pointer[printed->offset] = '\0';
+            output_buffer->offset += printed->offset;
+        }
+        if (printed->buffer != NULL) {
+            output_buffer->hooks.deallocate(printed->buffer);
+        }
+    }
+    output_buffer->hooks.deallocate(slices);
+
+    return success;
+}
+
+/* Render an object to text. */
+static bool print_object(sbJSON const *const item,
+                         printbuffer *const output_buffer) {
+    unsigned char *output_pointer = NULL;
+    size_t length = 0;
+
+    if (output_buffer == NULL) {
+        return false;
+    }
+
+    /* Compose the output: */
+    length = (size_t)(output_buffer->format ? 2 : 1); /* fmt: {\n */
+    output_pointer = ensure(output_buffer, length + 1);
+    if (output_pointer == NULL) {
+        return false;
+    }
+
+    *output_pointer++ = '{';
+    output_buffer->depth++;
+    if (output_buffer->format) {
+        *output_pointer++ = '\n';
+    }
+    output_buffer->offset += length;
+
+    if (!print_children(item, output_buffer)) {
+        return false;
+    }
+
+    output_pointer = ensure(
+        output_buffer, output_buffer->format ? (output_buffer->depth + 1) : 2);
+    if (output_pointer == NULL) {
+        return false;
+    }
+    if (output_buffer->format) {
+        size_t i;
+        for (i = 0; i < (output_buffer->depth - 1); i++) {
+            *output_pointer++ = '\t';
+        }
+    }
+    *output_pointer++ = '}';
+    *output_pointer = '\0';
+    output_buffer->depth--;
+
+    return true;
+}
+
+/* Get Array size/item / object item. */
+
+int sbj_get_array_size(sbJSON const *array) {
+    /* shared containers know their size without children of their own */
+    if ((array == NULL) || (array->is_lazy && !expand_lazy(array))) {
+        return 0;
+    }
+
+    return (int)array->child_count;
+}
+
+int32_t sbj_item_count(sbJSON const *item) {
+    if ((item == NULL) ||
+        ((item->type != sbJSON_Array) && (item->type != sbJSON_Object)) ||
+        (item->is_lazy && !expand_lazy(item))) {
+        return 0;
+    }
+
+    return item->child_count;
+}
+
+sbJSON *sbj_get_child(sbJSON const *item) {
+    if ((item == NULL) || !expand_lazy(item)) {
+        return NULL;
+    }
+
+    return item->child;
+}
+
+void sbj_get_items(sbJSON const *array, sbJSON const **out_items) {
+    sbJSON const *child = NULL;
+
+    if ((array == NULL) || (out_items == NULL) || !expand_lazy(array)) {
+        return;
+    }
+
+    if (has_vector(array)) {
+        memcpy(out_items, array->u.vector->items,
+               (size_t)array->child_count * sizeof(sbJSON *));
+        return;
+    }
+
+    for (child = array->child; child != NULL; child = child->next) {
+        *out_items++ = child;
+    }
+}
+
+bool sbj_get_integers(sbJSON const *array, int64_t *out_integers) {
+    sbJSON const *child = NULL;
+    size_t i = 0;
+
+    if ((array == NULL) || (out_integers == NULL) ||
+        (array->type != sbJSON_Array)) {
+        return false;
+    }
+
+    if (array->is_packed) {
+        if (array->u.packed->is_double) {
+            return false;
+        }
+        for (i = 0; i < (size_t)array->child_count; i++) {
+            out_integers[i] = array->u.packed->numbers[i].integer;
+        }
+        return true;
+    }
+
+    if (!expand_lazy(array)) {
+        return false;
+    }
+    for (child = array->child; child != NULL; child = child->next) {
+        if ((child->type != sbJSON_Number) || child->is_number_double) {
+            return false;
+        }
+        *out_integers++ = child->u.valueint;
+    }
+
+    return true;
+}
+
+bool sbj_get_doubles(sbJSON const *array, double *out_doubles) {
+    sbJSON const *child = NULL;
+    size_t i = 0;
+
+    if ((array == NULL) || (out_doubles == NULL) ||
+        (array->type != sbJSON_Array)) {
+        return false;
+    }
+
+    if (array->is_packed) {
+        struct sbj_packed const *const packed = array->u.packed;
+        for (i = 0; i < (size_t)array->child_count; i++) {
+            out_doubles[i] = packed->is_double
+                                 ? packed->numbers[i].number
+                                 : (double)packed->numbers[i].integer;
+        }
+        return true;
+    }
+
+    if (!expand_lazy(array)) {
+        return false;
+    }
+    for (child = array->child; child != NULL; child = child->next) {
+        if (child->type != sbJSON_Number) {
+            return false;
+        }
+        *out_doubles++ = child->is_number_double ? child->u.valuedouble
+                                                 : (double)child->u.valueint;
+    }
+
+    return true;
+}
+
+bool sbj_get_booleans(sbJSON const *array, bool *out_booleans) {
+    sbJSON const *child = NULL;
+
+    /* packed arrays hold numbers only */
+    if ((array == NULL) || (out_booleans == NULL) ||
+        (array->type != sbJSON_Array) || array->is_packed ||
+        !expand_lazy(array)) {
+        return false;
+    }
+
+    for (child = array->child; child != NULL; child = child->next) {
+        if (child->type != sbJSON_Bool) {
+            return false;
+        }
+        *out_booleans++ = child->u.valuebool;
+    }
+
+    return true;
+}
+
+/* NULL if out of memory */
+static struct sbj_vector *build_vector(sbJSON const *const array,
+                                       internal_hooks const *const hooks) {
+    size_t capacity = 16;
+    size_t position = 0;
+    sbJSON *child = NULL;
+    struct sbj_vector *vector = NULL;
+
+    while (capacity < (size_t)array->child_count) {
+        capacity *= 2;
+    }
+
+    vector = (struct sbj_vector *)hooks->allocate(
+        sizeof(struct sbj_vector) + capacity * sizeof(sbJSON *));
+    if (vector == NULL) {
+        return NULL;
+    }
+
+    vector->hooks = *hooks;
+    vector->capacity = capacity;
+    for (child = array->child; (child != NULL) && (position < capacity);
+         child = child->next) {
+        vector->items[position++] = child;
+    }
+
+    /* a chain changed behind child_count's back is left to the list walk */
+    if ((child != NULL) || (position != (size_t)array->child_count)) {
+        free_vector(vector);
+        return NULL;
+    }
+
+    return vector;
+}
 
-    if (head != NULL) {
-        head->prev = current_item;
+/* Make room for child_count elements, dropping the vector if that fails */
+static bool reserve_vector(sbJSON *const array) {
+    struct sbj_vector *vector = array->u.vector;
+    struct sbj_vector *grown = NULL;
+
+    if ((size_t)array->child_count <= vector->capacity) {
+        return true;
     }
 
-    item->type = sbJSON_Object;
-    item->child = head;
+    grown = (struct sbj_vector *)vector->hooks.allocate(
+        sizeof(struct sbj_vector) + vector->capacity * 2 * sizeof(sbJSON *));
+    if (grown == NULL) {
+        sbj_array_drop_index(array);
+        return false;
+    }
 
-    input_buffer->offset++;
+    memcpy(grown, vector,
+           sizeof(struct sbj_vector) + vector->capacity * sizeof(sbJSON *));
+    grown->capacity = vector->capacity * 2;
+    free_vector(vector);
+    array->u.vector = grown;
     return true;
+}
 
-fail:
-    if (head != NULL) {
-        sbj_delete(head);
+/* position of item in the vector of array, child_count if it's not there */
+static size_t vector_position(sbJSON const *const array,
+                              sbJSON const *const item) {
+    size_t position = 0;
+    while ((position < (size_t)array->child_count) &&
+           (array->u.vector->items[position] != item)) {
+        position++;
     }
 
-    return false;
+    return position;
 }
 
-/* Render an object to text. */
-static bool print_object(sbJSON const *const item,
-                         printbuffer *const output_buffer) {
-    unsigned char *output_pointer = NULL;
-    size_t length = 0;
-    sbJSON *current_item = item->child;
+bool sbj_array_build_index(sbJSON *array) {
+    struct sbj_vector *vector = NULL;
 
-    if (output_buffer == NULL) {
+    if ((array == NULL) || (array->type != sbJSON_Array) ||
+        !expand_lazy(array) || array->is_reference) {
         return false;
     }
 
-    /* Compose the output: */
-    length = (size_t)(output_buffer->format ? 2 : 1); /* fmt: {\n */
-    output_pointer = ensure(output_buffer, length + 1);
-    if (output_pointer == NULL) {
+    vector = build_vector(array, &global_hooks);
+    if (vector == NULL) {
         return false;
     }
 
-    *output_pointer++ = '{';
-    output_buffer->depth++;
-    if (output_buffer->format) {
-        *output_pointer++ = '\n';
+    sbj_array_drop_index(array);
+    array->u.vector = vector;
+    return true;
+}
+
+void sbj_array_drop_index(sbJSON *array) {
+    if ((array == NULL) || !has_vector(array)) {
+        return;
     }
-    output_buffer->offset += length;
 
-    while (current_item) {
-        if (output_buffer->format) {
-            size_t i;
-            output_pointer = ensure(output_buffer, output_buffer->depth);
-            if (output_pointer == NULL) {
-                return false;
-            }
-            for (i = 0; i < output_buffer->depth; i++) {
-                *output_pointer++ = '\t';
-            }
-            output_buffer->offset += output_buffer->depth;
-        }
+    free_vector(array->u.vector);
+    array->u.vector = NULL;
+}
 
-        /* print key */
-        if (!print_string_ptr((unsigned char *)current_item->string,
-                              output_buffer)) {
-            return false;
-        }
-        update_offset(output_buffer);
+static sbJSON *get_array_item(sbJSON const *array, size_t index) {
+    sbJSON *current_child = NULL;
 
-        length = (size_t)(output_buffer->format ? 2 : 1);
-        output_pointer = ensure(output_buffer, length);
-        if (output_pointer == NULL) {
-            return false;
-        }
-        *output_pointer++ = ':';
-        if (output_buffer->format) {
-            *output_pointer++ = '\t';
-        }
-        output_buffer->offset += length;
+    if ((array == NULL) || !expand_lazy(array)) {
+        return NULL;
+    }
 
-        /* print value */
-        if (!print_value(current_item, output_buffer)) {
-            return false;
-        }
-        update_offset(output_buffer);
+    if (has_vector(array)) {
+        return (index < (size_t)array->child_count)
+                   ? array->u.vector->items[index]
+                   : NULL;
+    }
 
-        /* print comma if not last */
-        length = ((size_t)(output_buffer->format ? 1 : 0) +
-                  (size_t)(current_item->next ? 1 : 0));
-        output_pointer = ensure(output_buffer, length + 1);
-        if (output_pointer == NULL) {
-            return false;
-        }
-        if (current_item->next) {
-            *output_pointer++ = ',';
+    /* Give large arrays a vector once an access had to walk far, arena trees
+     * are left alone because nothing would free it. */
+    if ((index >= SBJSON_INDEX_THRESHOLD) &&
+        (index < (size_t)array->child_count) &&
+        (array->type == sbJSON_Array) && !array->is_reference &&
+        !array->is_arena_owned) {
+        sbJSON *const mutable_array = (sbJSON *)cast_away_const(array);
+        mutable_array->u.vector = build_vector(array, &global_hooks);
+        if (mutable_array->u.vector != NULL) {
+            return mutable_array->u.vector->items[index];
         }
+    }
 
-        if (output_buffer->format) {
-            *output_pointer++ = '\n';
-        }
-        *output_pointer = '\0';
-        output_buffer->offset += length;
+    current_child = array->child;
+    while ((current_child != NULL) && (index > 0)) {
+        index--;
+        current_child = current_child->next;
+    }
 
-        current_item = current_item->next;
+    return current_child;
+}
+
+sbJSON *sbj_get_array_item(sbJSON const *array, int index) {
+    if (index < 0) {
+        return NULL;
     }
 
-    output_pointer = ensure(
-        output_buffer, output_buffer->format ? (output_buffer->depth + 1) : 2);
-    if (output_pointer == NULL) {
-        return false;
+    return get_array_item(array, (size_t)index);
+}
+
+static index_slot *find_slot(struct sbj_index *const index,
+                             char const *const name, size_t const hash) {
+    size_t position = hash & index->mask;
+    while (index->slots[position].item != NULL) {
+        index_slot *slot = &index->slots[position];
+        if ((slot->hash == hash) && (strcmp(name, slot->item->string) == 0)) {
+            return slot;
+        }
+        position = (position + 1) & index->mask;
     }
-    if (output_buffer->format) {
-        size_t i;
-        for (i = 0; i < (output_buffer->depth - 1); i++) {
-            *output_pointer++ = '\t';
+
+    return NULL;
+}
+
+static struct sbj_index *allocate_index(internal_hooks const *const hooks,
+                                        size_t const slots) {
+    size_t const size = sizeof(struct sbj_index) + slots * sizeof(index_slot);
+    struct sbj_index *index = (struct sbj_index *)hooks->allocate(size);
+    if (index == NULL) {
+        return NULL;
+    }
+
+    memset(index, '\0', size);
+    index->hooks = *hooks;
+    index->mask = slots - 1;
+    return index;
+}
+
+/* The caller makes sure that the table stays at most half full. Later members
+ * with a name that is already indexed are not, they can't be found by name. */
+static void index_insert(struct sbj_index *const index, sbJSON *const item,
+                         size_t const hash) {
+    size_t position = hash & index->mask;
+    while (index->slots[position].item != NULL) {
+        index_slot const *slot = &index->slots[position];
+        if ((slot->hash == hash) &&
+            (strcmp(item->string, slot->item->string) == 0)) {
+            index->has_duplicates = true;
+            return;
         }
+        position = (position + 1) & index->mask;
     }
-    *output_pointer++ = '}';
-    *output_pointer = '\0';
-    output_buffer->depth--;
 
-    return true;
+    index->slots[position].hash = hash;
+    index->slots[position].item = item;
+    index->count++;
 }
 
-/* Get Array size/item / object item. */
-int sbj_get_array_size(sbJSON const *array) {
+/* NULL if a member has no name, or out of memory */
+static struct sbj_index *build_index(sbJSON const *const object,
+                                     internal_hooks const *const hooks) {
     sbJSON *child = NULL;
-    size_t size = 0;
+    size_t members = 0;
+    size_t slots = 16;
+    struct sbj_index *index = NULL;
 
-    if (array == NULL) {
-        return 0;
+    for (child = object->child; child != NULL; child = child->next) {
+        if (child->string == NULL) {
+            return NULL;
+        }
+        members++;
     }
 
-    child = array->child;
+    while (slots < members * 2) {
+        slots *= 2;
+    }
 
-    while (child != NULL) {
-        size++;
-        child = child->next;
+    index = allocate_index(hooks, slots);
+    if (index == NULL) {
+        return NULL;
     }
 
-    /* FIXME: Can overflow here. Cannot be fixed without breaking the API */
+    for (child = object->child; child != NULL; child = child->next) {
+        index_insert(index, child, hash_name(child->string));
+    }
 
-    return (int)size;
+    return index;
 }
 
-static sbJSON *get_array_item(sbJSON const *array, size_t index) {
-    sbJSON *current_child = NULL;
+/* Keep the index of object up to date with item appended to it. If that isn't
+ * possible the index is dropped and lookups walk the list again. */
+static void index_append(sbJSON *const object, sbJSON *const item) {
+    struct sbj_index *index = object->u.index;
+    struct sbj_index *grown = NULL;
+    size_t position = 0;
 
-    if (array == NULL) {
-        return NULL;
+    if (item->string == NULL) {
+        sbj_object_drop_index(object);
+        return;
     }
 
-    current_child = array->child;
-    while ((current_child != NULL) && (index > 0)) {
-        index--;
-        current_child = current_child->next;
+    if ((index->count + 1) * 2 > index->mask + 1) {
+        grown = allocate_index(&index->hooks, (index->mask + 1) * 2);
+        if (grown == NULL) {
+            sbj_object_drop_index(object);
+            return;
+        }
+
+        grown->has_duplicates = index->has_duplicates;
+        for (position = 0; position <= index->mask; position++) {
+            if (index->slots[position].item != NULL) {
+                index_insert(grown, index->slots[position].item,
+                             index->slots[position].hash);
+            }
+        }
+        free_index(index);
+        object->u.index = index = grown;
     }
 
-    return current_child;
+    index_insert(index, item, hash_name(item->string));
 }
 
-sbJSON *sbj_get_array_item(sbJSON const *array, int index) {
-    if (index < 0) {
-        return NULL;
+static void index_remove(sbJSON *const object, sbJSON const *const item) {
+    struct sbj_index *const index = object->u.index;
+    index_slot *slot = NULL;
+    size_t hole = 0;
+    size_t position = 0;
+
+    if (item->string == NULL) {
+        return;
     }
 
-    return get_array_item(array, (size_t)index);
+    slot = find_slot(index, item->string, hash_name(item->string));
+    if ((slot == NULL) || (slot->item != item)) {
+        /* item is a later duplicate of an indexed name */
+        return;
+    }
+
+    if (index->has_duplicates) {
+        /* a later member with the same name might have to take its place */
+        sbj_object_drop_index(object);
+        return;
+    }
+
+    /* Shift back the entries after the hole that probed past it, so that every
+     * entry is still reachable from its home slot. */
+    hole = (size_t)(slot - index->slots);
+    position = hole;
+    for (;;) {
+        size_t home = 0;
+        position = (position + 1) & index->mask;
+        if (index->slots[position].item == NULL) {
+            break;
+        }
+
+        home = index->slots[position].hash & index->mask;
+        if (((position > hole) && ((home <= hole) || (home > position))) ||
+            ((position < hole) && (home <= hole) && (home > position))) {
+            index->slots[hole] = index->slots[position];
+            hole = position;
+        }
+    }
+
+    index->slots[hole].item = NULL;
+    index->count--;
 }
 
-static sbJSON *get_object_item(sbJSON const *const object,
-                               char const *const name) {
-    sbJSON *current_element = NULL;
+static void index_replace(sbJSON *const object, sbJSON const *const item,
+                          sbJSON *const replacement) {
+    index_slot *slot = NULL;
 
-    if ((object == NULL) || (name == NULL)) {
-        return NULL;
+    if ((item->string == NULL) || (replacement->string == NULL) ||
+        (strcmp(item->string, replacement->string) != 0)) {
+        sbj_object_drop_index(object);
+        return;
+    }
+
+    slot = find_slot(object->u.index, item->string, hash_name(item->string));
+    if ((slot != NULL) && (slot->item == item)) {
+        slot->item = replacement;
+    }
+}
+
+bool sbj_object_build_index(sbJSON *object) {
+    struct sbj_index *index = NULL;
+
+    if ((object == NULL) || (object->type != sbJSON_Object) ||
+        !expand_lazy(object) || object->is_reference) {
+        return false;
+    }
+
+    index = build_index(object, &global_hooks);
+    if (index == NULL) {
+        return false;
+    }
+
+    sbj_object_drop_index(object);
+    object->u.index = index;
+    return true;
+}
+
+void sbj_object_drop_index(sbJSON *object) {
+    if ((object == NULL) || !has_index(object)) {
+        return;
     }
 
-    current_element = object->child;
+    free_index(object->u.index);
+    object->u.index = NULL;
+}
+
+/* Walks the members of an object that hasn't got an index. */
+static sbJSON *walk_object(sbJSON const *const object,
+                           char const *const name) {
+    sbJSON *current_element = object->child;
+    size_t walked = 0;
+
+    /* shared keys (sbj_keys) are found by their address */
     while ((current_element != NULL) && (current_element->string != NULL) &&
+           (current_element->string != name) &&
            (strcmp(name, current_element->string) != 0)) {
         current_element = current_element->next;
+        walked++;
+    }
+
+    /* Index large objects once a lookup had to walk far, arena trees are left
+     * alone because nothing would free the index. */
+    if ((walked >= SBJSON_INDEX_THRESHOLD) &&
+        (object->type == sbJSON_Object) && !object->is_reference &&
+        !object->is_arena_owned) {
+        ((sbJSON *)cast_away_const(object))->u.index =
+            build_index(object, &global_hooks);
     }
 
     if ((current_element == NULL) || (current_element->string == NULL)) {
@@ -1701,11 +8565,44 @@ static sbJSON *get_object_item(sbJSON const *const object,
     return current_element;
 }
 
+static sbJSON *get_object_item(sbJSON const *const object,
+                               char const *const name) {
+    if ((object == NULL) || (name == NULL) || !expand_lazy(object)) {
+        return NULL;
+    }
+
+    if (has_index(object)) {
+        index_slot *slot =
+            find_slot(object->u.index, name, hash_name(name));
+        return (slot != NULL) ? slot->item : NULL;
+    }
+
+    return walk_object(object, name);
+}
+
 sbJSON *sbj_get_object_item(sbJSON const *const object,
                             char const *const string) {
     return get_object_item(object, string);
 }
 
+size_t sbj_hash_key(char const *string) {
+    return (string != NULL) ? hash_name(string) : 0;
+}
+
+sbJSON *sbj_get_object_item_hashed(sbJSON const *object, char const *string,
+                                   size_t hash) {
+    if ((object == NULL) || (string == NULL) || !expand_lazy(object)) {
+        return NULL;
+    }
+
+    if (has_index(object)) {
+        index_slot *slot = find_slot(object->u.index, string, hash);
+        return (slot != NULL) ? slot->item : NULL;
+    }
+
+    return walk_object(object, string);
+}
+
 bool sbj_has_object_item(sbJSON const *object, char const *string) {
     return sbj_get_object_item(object, string) ? 1 : 0;
 }
@@ -1720,7 +8617,8 @@ static void suffix_object(sbJSON *prev, sbJSON *item) {
 static sbJSON *create_reference(sbJSON const *item,
                                 internal_hooks const *const hooks) {
     sbJSON *reference = NULL;
-    if (item == NULL) {
+    /* the reference has to share the children instead of parsing its own */
+    if ((item == NULL) || !expand_lazy(item)) {
         return NULL;
     }
 
@@ -1732,14 +8630,22 @@ static sbJSON *create_reference(sbJSON const *item,
     memcpy(reference, item, sizeof(sbJSON));
     reference->string = NULL;
     reference->is_reference = true;
+    reference->is_arena_owned = false;
+    reference->has_inline_storage = false;
     reference->next = reference->prev = NULL;
+    if (reference->type == sbJSON_Object) {
+        /* the index stays with item */
+        reference->u.index = NULL;
+    } else if (reference->type == sbJSON_Array) {
+        reference->u.vector = NULL;
+    }
     return reference;
 }
 
 static bool add_item_to_array(sbJSON *array, sbJSON *item) {
     sbJSON *child = NULL;
 
-    if (array == NULL || item == NULL) {
+    if (array == NULL || item == NULL || !expand_lazy(array)) {
         return false;
     }
 
@@ -1762,6 +8668,13 @@ static bool add_item_to_array(sbJSON *array, sbJSON *item) {
         }
     }
 
+    array->child_count++;
+    if (has_index(array)) {
+        index_append(array, item);
+    } else if (has_vector(array) && reserve_vector(array)) {
+        array->u.vector->items[array->child_count - 1] = item;
+    }
+
     return true;
 }
 
@@ -1770,9 +8683,6 @@ bool sbj_add_item_to_array(sbJSON *array, sbJSON *item) {
     return add_item_to_array(array, item);
 }
 
-/* helper function to cast away const */
-static void *cast_away_const(void const *string) { return (void *)string; }
-
 static bool add_item_to_object(sbJSON *const object, char const *const string,
                                sbJSON *const item,
                                internal_hooks const *const hooks,
@@ -1791,6 +8701,7 @@ static bool add_item_to_object(sbJSON *const object, char const *const string,
     if (constant_key) {
         new_key = (char *)cast_away_const(string);
         new_type = item->type;
+        is_reference = item->is_reference;
         string_is_const = true;
     } else {
         new_key = (char *)sbJSON_strdup((unsigned char const *)string, hooks);
@@ -1948,6 +8859,19 @@ sbJSON *sbj_detach_item_via_pointer(sbJSON *parent, sbJSON *const item) {
         return NULL;
     }
 
+    if (has_index(parent)) {
+        index_remove(parent, item);
+    } else if (has_vector(parent)) {
+        sbJSON **const items = parent->u.vector->items;
+        size_t const position = vector_position(parent, item);
+        if (position < (size_t)parent->child_count) {
+            memmove(items + position, items + position + 1,
+                    ((size_t)parent->child_count - position - 1) *
+                        sizeof(sbJSON *));
+        }
+    }
+    parent->child_count--;
+
     if (item != parent->child) {
         /* not the first element */
         item->prev->next = item->next;
@@ -2013,6 +8937,17 @@ bool sbj_insert_item_in_array(sbJSON *array, int which, sbJSON *newitem) {
         return false;
     }
 
+    /* the new member could hide a later one with the same name */
+    sbj_object_drop_index(array);
+    array->child_count++;
+    if (has_vector(array) && reserve_vector(array)) {
+        sbJSON **const items = array->u.vector->items;
+        memmove(items + which + 1, items + which,
+                ((size_t)array->child_count - (size_t)which - 1) *
+                    sizeof(sbJSON *));
+        items[which] = newitem;
+    }
+
     newitem->next = after_inserted;
     newitem->prev = after_inserted->prev;
     after_inserted->prev = newitem;
@@ -2035,6 +8970,15 @@ bool sbj_replace_item_via_pointer(sbJSON *const parent, sbJSON *const item,
         return true;
     }
 
+    if (has_index(parent)) {
+        index_replace(parent, item, replacement);
+    } else if (has_vector(parent)) {
+        size_t const position = vector_position(parent, item);
+        if (position < (size_t)parent->child_count) {
+            parent->u.vector->items[position] = replacement;
+        }
+    }
+
     replacement->next = item->next;
     replacement->prev = item->prev;
 
@@ -2170,12 +9114,22 @@ sbJSON *sbj_create_string_reference(char const *string) {
     return item;
 }
 
+static int32_t chain_length(sbJSON const *item) {
+    int32_t length = 0;
+    for (; item != NULL; item = item->next) {
+        length++;
+    }
+
+    return length;
+}
+
 sbJSON *sbj_create_object_reference(sbJSON const *child) {
     sbJSON *item = sbJSON_New_Item(&global_hooks);
     if (item != NULL) {
         item->type = sbJSON_Object;
         item->is_reference = true;
         item->child = (sbJSON *)cast_away_const(child);
+        item->child_count = chain_length(child);
     }
 
     return item;
@@ -2187,6 +9141,7 @@ sbJSON *sbj_create_array_reference(sbJSON const *child) {
         item->type = sbJSON_Array;
         item->is_reference = true;
         item->child = (sbJSON *)cast_away_const(child);
+        item->child_count = chain_length(child);
     }
 
     return item;
@@ -2254,6 +9209,7 @@ sbJSON *sbj_create_int_array(int const *numbers, int count) {
 
     if (a && a->child) {
         a->child->prev = n;
+        a->child_count = count;
     }
 
     return a;
@@ -2287,6 +9243,7 @@ sbJSON *sbj_create_float_array(float const *numbers, int count) {
 
     if (a && a->child) {
         a->child->prev = n;
+        a->child_count = count;
     }
 
     return a;
@@ -2320,7 +9277,38 @@ sbJSON *sbj_create_double_array(double const *numbers, int count) {
 
     if (a && a->child) {
         a->child->prev = n;
+        a->child_count = count;
+    }
+
+    return a;
+}
+
+sbJSON *sbj_create_packed_double_array(double const *numbers, int count) {
+    size_t i = 0;
+    struct sbj_packed *packed = NULL;
+    sbJSON *a = NULL;
+
+    if ((count < 0) || (numbers == NULL)) {
+        return NULL;
+    }
+
+    a = sbj_create_array();
+    if ((a == NULL) || (count == 0)) {
+        return a;
+    }
+
+    packed = new_packed((size_t)count, true, &global_hooks);
+    if (packed == NULL) {
+        sbj_delete(a);
+        return NULL;
     }
+    for (i = 0; i < (size_t)count; i++) {
+        packed->numbers[i].number = numbers[i];
+    }
+
+    a->is_packed = true;
+    a->child_count = count;
+    a->u.packed = packed;
 
     return a;
 }
@@ -2353,14 +9341,24 @@ sbJSON *sbj_create_string_array(char const *const *strings, int count) {
 
     if (a && a->child) {
         a->child->prev = n;
+        a->child_count = count;
     }
 
     return a;
 }
 
 /* Duplication */
-// TODO: This is missing regular tests (outside of the utils tests)
-sbJSON *sbj_duplicate(sbJSON const *item, bool recurse) {
+
+/* Copies can keep referencing a constant key, except those of arena nodes
+ * that die with the arena, inline ones that die with the node and the
+ * original's keys in a shared copy. */
+static bool keeps_key(sbJSON const *const item) {
+    return item->string_is_const && !item->is_arena_owned &&
+           !item->is_shared && !is_inline_string(item, item->string);
+}
+
+static sbJSON *duplicate_item(sbJSON const *item, bool recurse,
+                              internal_hooks const *const hooks) {
     sbJSON *newitem = NULL;
     sbJSON *child = NULL;
     sbJSON *next = NULL;
@@ -2371,7 +9369,7 @@ sbJSON *sbj_duplicate(sbJSON const *item, bool recurse) {
         goto fail;
     }
     /* Create new item */
-    newitem = sbJSON_New_Item(&global_hooks);
+    newitem = sbJSON_New_Item(hooks);
     if (!newitem) {
         goto fail;
     }
@@ -2379,24 +9377,40 @@ sbJSON *sbj_duplicate(sbJSON const *item, bool recurse) {
     /* Copy over all vars */
     newitem->type = item->type;
     newitem->is_reference = false;
-    newitem->string_is_const = item->string_is_const;
+    newitem->string_is_const = keeps_key(item);
     newitem->u = item->u;
     newitem->is_number_double = item->is_number_double;
+    if (item->is_lazy) {
+        /* the copy refers to the same text */
+        newitem->is_lazy = true;
+    } else if (item->is_packed && recurse) {
+        newitem->u.packed = copy_packed(item, hooks);
+        if (newitem->u.packed == NULL) {
+            goto fail;
+        }
+        newitem->is_packed = true;
+        newitem->child_count = item->child_count;
+    } else if (item->type == sbJSON_Object) {
+        newitem->u.index = NULL;
+    } else if (item->type == sbJSON_Array) {
+        newitem->u.vector = NULL;
+    }
 
     if (item->type == sbJSON_String || item->type == sbJSON_Raw) {
-        newitem->u.valuestring = (char *)sbJSON_strdup(
-            (unsigned char *)item->u.valuestring, &global_hooks);
+        newitem->u.valuestring =
+            (char *)sbJSON_strdup((unsigned char *)item->u.valuestring, hooks);
         if (!newitem->u.valuestring) {
             goto fail;
         }
     }
 
     if (item->string) {
+        /* keys of arena nodes die with the arena and inline ones with the
+         * node, so they are copied too */
         newitem->string =
-            (item->string_is_const)
+            newitem->string_is_const
                 ? item->string
-                : (char *)sbJSON_strdup((unsigned char *)item->string,
-                                        &global_hooks);
+                : (char *)sbJSON_strdup((unsigned char *)item->string, hooks);
         if (!newitem->string) {
             goto fail;
         }
@@ -2410,9 +9424,9 @@ sbJSON *sbj_duplicate(sbJSON const *item, bool recurse) {
     /* Walk the ->next chain for the child. */
     child = item->child;
     while (child != NULL) {
-        newchild = sbj_duplicate(
-            child,
-            true); /* Duplicate (with recurse) each item in the ->next chain */
+        newchild = duplicate_item(
+            child, true,
+            hooks); /* Duplicate (with recurse) each item in the ->next chain */
         if (!newchild) {
             goto fail;
         }
@@ -2427,6 +9441,7 @@ sbJSON *sbj_duplicate(sbJSON const *item, bool recurse) {
             newitem->child = newchild;
             next = newchild;
         }
+        newitem->child_count++;
         child = child->next;
     }
     if (newitem && newitem->child) {
@@ -2437,91 +9452,498 @@ sbJSON *sbj_duplicate(sbJSON const *item, bool recurse) {
 
 fail:
     if (newitem != NULL) {
-        sbj_delete(newitem);
+        delete_item(newitem, hooks);
     }
 
     return NULL;
 }
 
-static void skip_oneline_comment(char **input) {
-    *input += static_strlen("//");
+sbJSON *sbj_duplicate(sbJSON const *item, bool recurse) {
+    return duplicate_item(item, recurse, &global_hooks);
+}
+
+/* Nodes and string bytes an arena copy of item takes. The children of shared
+ * containers are read where they are instead of being unshared. */
+static bool count_duplicate(sbJSON const *const item, size_t *const nodes,
+                            size_t *const bytes) {
+    sbJSON const *child = NULL;
 
-    for (; (*input)[0] != '\0'; ++(*input)) {
-        if ((*input)[0] == '\n') {
-            *input += static_strlen("\n");
-            return;
+    if ((item->is_lazy || item->is_packed) && !expand_lazy(item)) {
+        return false;
+    }
+
+    (*nodes)++;
+    if ((item->type == sbJSON_String) || (item->type == sbJSON_Raw)) {
+        *bytes += strlen(item->u.valuestring) + sizeof("");
+    }
+    if ((item->string != NULL) && !keeps_key(item)) {
+        *bytes += strlen(item->string) + sizeof("");
+    }
+
+    for (child = item->child; child != NULL; child = child->next) {
+        if (!count_duplicate(child, nodes, bytes)) {
+            return false;
         }
     }
+
+    return true;
 }
 
-static void skip_multiline_comment(char **input) {
-    *input += static_strlen("/*");
+static char *copy_string_into(char **const strings, char const *const string) {
+    char *const copy = *strings;
+    size_t const length = strlen(string) + sizeof("");
 
-    for (; (*input)[0] != '\0'; ++(*input)) {
-        if (((*input)[0] == '*') && ((*input)[1] == '/')) {
-            *input += static_strlen("*/");
-            return;
+    memcpy(copy, string, length);
+    *strings += length;
+
+    return copy;
+}
+
+/* Copies item into the nodes and strings counted by count_duplicate */
+static sbJSON *copy_into_arena(sbJSON const *const item, sbJSON **const nodes,
+                               char **const strings) {
+    sbJSON *const copy = (*nodes)++;
+    sbJSON const *child = NULL;
+    sbJSON *last = NULL;
+
+    memset(copy, 0, sizeof(sbJSON));
+    copy->type = item->type;
+    copy->is_number_double = item->is_number_double;
+    copy->is_arena_owned = true;
+    copy->u = item->u;
+    if ((item->type == sbJSON_String) || (item->type == sbJSON_Raw)) {
+        copy->u.valuestring = copy_string_into(strings, item->u.valuestring);
+        copy->is_reference = true;
+    } else if ((item->type == sbJSON_Array) || (item->type == sbJSON_Object)) {
+        copy->u.index = NULL;
+    }
+    if (item->string != NULL) {
+        copy->string = keeps_key(item)
+                           ? item->string
+                           : copy_string_into(strings, item->string);
+        copy->string_is_const = true;
+    }
+
+    for (child = item->child; child != NULL; child = child->next) {
+        sbJSON *const new_child = copy_into_arena(child, nodes, strings);
+        if (last == NULL) {
+            copy->child = new_child;
+        } else {
+            last->next = new_child;
+            new_child->prev = last;
         }
+        last = new_child;
+        copy->child_count++;
+    }
+    if (last != NULL) {
+        copy->child->prev = last;
     }
+
+    return copy;
 }
 
-static void minify_string(char **input, char **output) {
-    (*output)[0] = (*input)[0];
-    *input += static_strlen("\"");
-    *output += static_strlen("\"");
+sbJSON *sbj_duplicate_into_arena(sbj_arena *arena, sbJSON const *item) {
+    size_t nodes = 0;
+    size_t bytes = 0;
+    sbJSON *node_memory = NULL;
+    char *string_memory = NULL;
 
-    for (; (*input)[0] != '\0'; (void)++(*input), ++(*output)) {
-        (*output)[0] = (*input)[0];
+    if ((arena == NULL) || (item == NULL) ||
+        !count_duplicate(item, &nodes, &bytes)) {
+        return NULL;
+    }
 
-        if ((*input)[0] == '\"') {
-            (*output)[0] = '\"';
-            *input += static_strlen("\"");
-            *output += static_strlen("\"");
-            return;
-        } else if (((*input)[0] == '\\') && ((*input)[1] == '\"')) {
-            (*output)[1] = (*input)[1];
-            *input += static_strlen("\"");
-            *output += static_strlen("\"");
+    if (nodes > (SIZE_MAX - bytes) / sizeof(sbJSON)) {
+        return NULL;
+    }
+    /* one allocation for the whole tree, strings behind the nodes */
+    node_memory =
+        (sbJSON *)arena_allocate(arena, nodes * sizeof(sbJSON) + bytes);
+    if (node_memory == NULL) {
+        return NULL;
+    }
+    string_memory = (char *)(node_memory + nodes);
+
+    return copy_into_arena(item, &node_memory, &string_memory);
+}
+
+sbJSON *sbj_duplicate_shared(sbJSON const *item) {
+    sbJSON *copy = NULL;
+
+    if (item == NULL) {
+        return NULL;
+    }
+
+    copy = share_item(item, &global_hooks);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    /* the copy is a root, it has no key to share */
+    copy->string = NULL;
+    copy->string_is_const = false;
+
+    return copy;
+}
+
+/* The minifier works on blocks of 64 bytes: they are turned into bit masks
+ * like index_block does, string contents are masked out with prefix_xor and
+ * the runs of kept bytes are gathered with a few word copies each. Strings,
+ * comments and whitespace go on across blocks, so the bytes are only looked
+ * at once. minify_step does the same for the last bytes one token at a time,
+ * like the minifier always did. */
+typedef struct {
+    unsigned char const *input;
+    size_t length;
+    size_t position;
+    unsigned char *output; /* may be input, it never gets ahead of position */
+    size_t written;
+    bool in_string;
+    /* the last block ended with a backslash inside of a string */
+    uint64_t previous_escape;
+    /* '/' or '*' inside of a line or block comment that started before */
+    unsigned char comment;
+    /* the last block ended with a '*' inside of a block comment */
+    uint64_t previous_star;
+} minify_buffer;
+
+static void minify_copy(minify_buffer *const buffer, size_t const count) {
+    memmove(buffer->output + buffer->written,
+            buffer->input + buffer->position, count);
+    buffer->written += count;
+    buffer->position += count;
+}
+
+/* past the end of the comment that goes on at position: after the newline or
+ * the closing slash, or the end of input if it isn't closed */
+static void skip_comment(minify_buffer *const buffer, size_t position) {
+    unsigned char const *end = NULL;
+
+    if (buffer->comment == '/') {
+        end = (unsigned char const *)memchr(buffer->input + position, '\n',
+                                            buffer->length - position);
+    } else if ((buffer->previous_star != 0) && (position < buffer->length) &&
+               (buffer->input[position] == '/')) {
+        end = buffer->input + position;
+    } else {
+        while (position < buffer->length) {
+            unsigned char const *const star = (unsigned char const *)memchr(
+                buffer->input + position, '*', buffer->length - position);
+            if (star == NULL) {
+                break;
+            }
+            position = (size_t)(star - buffer->input) + static_strlen("*");
+            if ((position < buffer->length) &&
+                (buffer->input[position] == '/')) {
+                end = buffer->input + position;
+                break;
+            }
         }
     }
+
+    buffer->comment = 0;
+    buffer->previous_star = 0;
+    buffer->position =
+        (end == NULL) ? buffer->length : (size_t)(end - buffer->input) + 1;
 }
 
-void sbj_minify(char *json) {
-    char *into = json;
+static void minify_step(minify_buffer *const buffer) {
+    unsigned char const *const input = buffer->input + buffer->position;
+    size_t const left = buffer->length - buffer->position;
+    bool const escaped = buffer->previous_escape != 0;
+    size_t run = 0;
 
-    if (json == NULL) {
+    buffer->previous_escape = 0;
+    if (buffer->comment != 0) {
+        skip_comment(buffer, buffer->position);
         return;
     }
 
-    while (json[0] != '\0') {
-        switch (json[0]) {
-        case ' ':
-        case '\t':
-        case '\r':
-        case '\n':
-            json++;
-            break;
-        case '/':
-            if (json[1] == '/') {
-                skip_oneline_comment(&json);
-            } else if (json[1] == '*') {
-                skip_multiline_comment(&json);
-            } else {
-                json++;
+    if (buffer->in_string) {
+        run = plain_string_run(input, left, false);
+        if (run > 0) {
+            minify_copy(buffer, run);
+        } else if ((input[0] == '\"') && escaped) {
+            /* the second half of a backslash and quote split by a block */
+            minify_copy(buffer, static_strlen("\""));
+        } else if (input[0] == '\"') {
+            minify_copy(buffer, static_strlen("\""));
+            buffer->in_string = false;
+        } else if ((left > 1) && (input[1] == '\"')) {
+            /* a quote right after a backslash doesn't end the string, no
+             * matter if that backslash is escaped itself */
+            minify_copy(buffer, static_strlen("\\\""));
+        } else {
+            minify_copy(buffer, static_strlen("\\"));
+        }
+        return;
+    }
+
+    switch (input[0]) {
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+        buffer->position++;
+        break;
+    case '/':
+        if ((left > 1) && ((input[1] == '/') || (input[1] == '*'))) {
+            buffer->comment = input[1];
+            skip_comment(buffer, buffer->position + static_strlen("//"));
+        } else {
+            buffer->position++;
+        }
+        break;
+    case '\"':
+        minify_copy(buffer, static_strlen("\""));
+        buffer->in_string = true;
+        break;
+    default:
+        minify_copy(buffer, 1);
+    }
+}
+
+/* load_word_little_endian, but as a single load on little endian targets,
+ * which the compiler can tell from the constant */
+static uint64_t load_block_word(unsigned char const *const input) {
+    uint64_t const one = 1;
+    unsigned char first = 0;
+
+    memcpy(&first, &one, 1);
+    if (first == 1) {
+        return load_word(input);
+    }
+
+    return load_word_little_endian(input);
+}
+
+/* bits n to 63 */
+static uint64_t bits_from(unsigned int const n) {
+    return (n >= 64) ? 0 : ~(uint64_t)0 << n;
+}
+
+/* The comment in buffer->comment ends with a newline or closing slash at
+ * byte from of the block or later. Returns the bits after it, or 0 and keeps
+ * the state for the next block if it goes on past this one. Comments are
+ * short or rare, so memchr finds their end faster than building masks. */
+static uint64_t comment_rest(minify_buffer *const buffer,
+                             unsigned char const *const block,
+                             unsigned int const from) {
+    unsigned char const *end = NULL;
+    unsigned int position = (from > 0) ? from - 1 : 0;
+
+    if (buffer->comment == '/') {
+        end = (unsigned char const *)memchr(block + from, '\n', 64 - from);
+    } else if ((buffer->previous_star != 0) && (block[0] == '/')) {
+        end = block;
+    } else {
+        /* the star of "* /" can be right before from */
+        while (position < 63) {
+            unsigned char const *const star = (unsigned char const *)memchr(
+                block + position, '*', 63 - position);
+            if (star == NULL) {
+                break;
             }
+            if (star[1] == '/') {
+                end = star + 1;
+                break;
+            }
+            position = (unsigned int)(star - block) + 1;
+        }
+    }
+
+    buffer->previous_star = 0;
+    if (end == NULL) {
+        if ((buffer->comment == '*') && (block[63] == '*') && (from <= 64)) {
+            buffer->previous_star = 1;
+        }
+        return 0;
+    }
+
+    buffer->comment = 0;
+    return bits_from((unsigned int)(end - block) + 1);
+}
+
+/* Minify the next 64 bytes, false if it stopped short at a '/' in the last
+ * byte, which minify_step has to handle. */
+static bool minify_block(minify_buffer *const buffer) {
+    unsigned char const *const block = buffer->input + buffer->position;
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t slash = 0;
+    uint64_t whitespace = 0;
+    uint64_t rare = 0;
+    uint64_t escaped = 0;
+    uint64_t in_string = 0;
+    uint64_t keep = 0;
+    /* the bits that are still to be looked at, the ones below are done */
+    uint64_t rest = ~(uint64_t)0;
+    bool starts_in_string = buffer->in_string;
+    unsigned int end = 64;
+    size_t k = 0;
+
+    for (k = 0; k < 8; k++) {
+        uint64_t const word = load_block_word(block + 8 * k);
+        unsigned int const shift = (unsigned int)(8 * k);
+        uint64_t const space =
+            bytes_equal(word, ' ') | bytes_equal(word, '\n');
+
+        quote |= high_bits_to_mask(bytes_equal(word, '\"')) << shift;
+        slash |= high_bits_to_mask(bytes_equal(word, '/')) << shift;
+        whitespace |= high_bits_to_mask(space) << shift;
+        /* backslashes, tabs, carriage returns and the other control
+         * characters are rare, only check if there are any */
+        rare |= (~has_byte_greater_than(word, 31) & swar_highs & ~space) |
+                has_byte(word, '\\');
+    }
+
+    for (k = 0; (rare != 0) && (k < 8); k++) {
+        uint64_t const word = load_block_word(block + 8 * k);
+        unsigned int const shift = (unsigned int)(8 * k);
+
+        backslash |= high_bits_to_mask(bytes_equal(word, '\\')) << shift;
+        whitespace |= high_bits_to_mask(bytes_equal(word, '\t') |
+                                        bytes_equal(word, '\r'))
+                      << shift;
+    }
+
+    if (buffer->comment != 0) {
+        rest = comment_rest(buffer, block, 0);
+    }
+
+    /* Inside of strings any quote after a backslash is escaped. Assume that
+     * for all of them and correct the ones that turn out to be outside. */
+    escaped = quote & ((backslash << 1) | buffer->previous_escape);
+    while (rest != 0) {
+        uint64_t stop = 0;
+        unsigned int at = 0;
+
+        /* from each opening quote up to, but not including, the closing one */
+        in_string = prefix_xor(quote & ~escaped & rest) ^
+                    (starts_in_string ? ~(uint64_t)0 : 0);
+        /* whitespace outside of strings is dropped */
+        stop = (escaped | slash) & ~in_string & rest;
+        if (stop == 0) {
+            keep |= ~(whitespace & ~in_string) & rest;
             break;
-        case '\"':
-            minify_string(&json, (char **)&into);
+        }
+
+        at = lowest_bit(stop);
+        keep |= ~(whitespace & ~in_string) & rest & ~bits_from(at);
+        starts_in_string = false;
+        if ((quote >> at) & 1) {
+            /* outside of strings it opens one after all */
+            escaped &= ~((uint64_t)1 << at);
+            rest = bits_from(at);
+        } else if (at == 63) {
+            end = at;
             break;
-        default:
-            into[0] = json[0];
-            json++;
-            into++;
+        } else if ((block[at + 1] == '/') || (block[at + 1] == '*')) {
+            /* a line comment ends with a newline after the second slash, a
+             * block comment with a slash after a star after its own */
+            buffer->comment = block[at + 1];
+            rest = comment_rest(buffer, block,
+                                at + ((buffer->comment == '/') ? 2 : 3));
+        } else {
+            /* a '/' that doesn't start a comment is dropped */
+            rest = bits_from(at + 1);
+        }
+    }
+
+    if (keep == ~(uint64_t)0) {
+        minify_copy(buffer, 64);
+    } else {
+        /* Gather the runs of kept bytes, then move them to the output at
+         * once. Runs are copied eight bytes at a time and the copies may go
+         * up to seven bytes past them, minify makes sure that there is room
+         * for that behind the block. */
+        unsigned char gathered[64 + 8];
+        size_t count = 0;
+
+        while (keep != 0) {
+            uint64_t const lowest = keep & (0 - keep);
+            /* the bit after the run, 0 if the run goes to the end */
+            uint64_t const after = (keep + lowest) & ~keep;
+            unsigned int const start = lowest_bit(lowest);
+            size_t const run = ((after == 0) ? 64 : lowest_bit(after)) - start;
+
+            memcpy(gathered + count, block + start, 8);
+            for (k = 8; k < run; k += 8) {
+                memcpy(gathered + count + k, block + start + k, 8);
+            }
+            count += run;
+            keep &= keep + lowest;
+        }
+        memmove(buffer->output + buffer->written, gathered, count);
+        buffer->written += count;
+        buffer->position += end;
+    }
+
+    if ((rest == 0) || (end < 64)) {
+        /* in, right after or right before a comment */
+        buffer->in_string = false;
+        buffer->previous_escape = 0;
+        return end == 64;
+    }
+    buffer->in_string = (in_string >> 63) != 0;
+    buffer->previous_escape = (backslash & in_string) >> 63;
+    return true;
+}
+
+static size_t minify(unsigned char const *const input, size_t const length,
+                     unsigned char *const output) {
+    minify_buffer buffer;
+
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.input = input;
+    buffer.length = length;
+    buffer.output = output;
+
+    while (buffer.position < length) {
+        if (buffer.in_string && (buffer.previous_escape == 0)) {
+            /* long strings go faster without looking for whitespace */
+            minify_copy(&buffer, plain_string_run(input + buffer.position,
+                                                  length - buffer.position,
+                                                  false));
         }
+        /* minify_block needs room for copying past the end of the block */
+        if (length - buffer.position >= 64 + 8) {
+            if (minify_block(&buffer)) {
+                continue;
+            }
+        } else if (buffer.position == length) {
+            break;
+        }
+        minify_step(&buffer);
     }
 
     /* and null-terminate. */
-    *into = '\0';
+    output[buffer.written] = '\0';
+
+    return buffer.written;
+}
+
+void sbj_minify(char *json) {
+    if (json == NULL) {
+        return;
+    }
+
+    minify((unsigned char const *)json, strlen(json), (unsigned char *)json);
+}
+
+size_t sbj_minify_to_buffer(char const *json, size_t length, char *output) {
+    char const *end = NULL;
+
+    if ((json == NULL) || (output == NULL)) {
+        return 0;
+    }
+
+    end = (char const *)memchr(json, '\0', length);
+    if (end != NULL) {
+        length = (size_t)(end - json);
+    }
+
+    return minify((unsigned char const *)json, length, (unsigned char *)output);
 }
 
 bool sbj_is_invalid(sbJSON const *const item) {
@@ -2588,6 +10010,94 @@ bool sbj_is_raw(sbJSON const *const item) {
     return item->type == sbJSON_Raw;
 }
 
+/* the finalizer of splitmix64 */
+static uint64_t mix_hash(uint64_t hash) {
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111eb;
+    hash ^= hash >> 31;
+
+    return hash;
+}
+
+uint64_t sbj_hash(sbJSON const *item) {
+    uint64_t hash = 0;
+    uint64_t members = 0;
+    sbJSON const *child = NULL;
+
+    if (item == NULL) {
+        return 0;
+    }
+
+    hash = mix_hash((uint64_t)item->type + 1);
+    switch (item->type) {
+    case sbJSON_Bool:
+        return mix_hash(hash ^ (uint64_t)item->u.valuebool);
+    case sbJSON_Number:
+        if (item->is_number_double) {
+            uint64_t bits = 0;
+            /* sbj_compare finds 0.0 and -0.0 equal */
+            double const value =
+                (item->u.valuedouble == 0) ? 0 : item->u.valuedouble;
+            memcpy(&bits, &value, sizeof(bits));
+            return mix_hash(hash ^ mix_hash(bits + 1));
+        }
+        return mix_hash(hash ^ (uint64_t)item->u.valueint);
+    case sbJSON_String:
+    case sbJSON_Raw:
+        if (item->u.valuestring == NULL) {
+            return hash;
+        }
+        return mix_hash(hash ^ hash_string(item->u.valuestring));
+    case sbJSON_Array:
+        if (item->is_packed) {
+            sbJSON element;
+            size_t i = 0;
+
+            for (i = 0; i < (size_t)item->child_count; i++) {
+                packed_element(item, i, &element);
+                hash = mix_hash(hash + sbj_hash(&element));
+            }
+            return hash;
+        }
+        for (child = sbj_get_child(item); child != NULL; child = child->next) {
+            hash = mix_hash(hash + sbj_hash(child));
+        }
+        return hash;
+    case sbJSON_Object:
+        /* summing makes the order of the members irrelevant */
+        for (child = sbj_get_child(item); child != NULL; child = child->next) {
+            uint64_t const name =
+                (child->string != NULL) ? hash_string(child->string) : 0;
+            members += mix_hash(mix_hash(name) + sbj_hash(child));
+        }
+        return mix_hash(hash ^ members);
+    default:
+        return hash;
+    }
+}
+
+/* sbj_compare of two packed arrays, without making their nodes */
+static bool compare_packed(sbJSON const *const a, sbJSON const *const b) {
+    sbJSON a_element;
+    sbJSON b_element;
+    size_t i = 0;
+
+    if (a->child_count != b->child_count) {
+        return false;
+    }
+    for (i = 0; i < (size_t)a->child_count; i++) {
+        packed_element(a, i, &a_element);
+        packed_element(b, i, &b_element);
+        if (!sbj_compare(&a_element, &b_element)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 // TODO: https://github.com/DaveGamble/cJSON/issues/748
 // Duplicate keys make comparison impossible. Would need
 // keys to have an order as well. Starting to be ridiculous.
@@ -2605,6 +10115,25 @@ bool sbj_compare(sbJSON const *const a, sbJSON const *const b) {
         return false;
     }
 
+    if (a->is_packed && b->is_packed) {
+        return compare_packed(a, b);
+    }
+
+    /* containers of different sizes can't be equal */
+    if ((a->type == sbJSON_Array) || (a->type == sbJSON_Object)) {
+        if (((a->is_lazy || a->is_packed) && !expand_lazy(a)) ||
+            ((b->is_lazy || b->is_packed) && !expand_lazy(b))) {
+            return false;
+        }
+        if (a->child_count != b->child_count) {
+            return false;
+        }
+        /* e.g. a copy of sbj_duplicate_shared and its original */
+        if (a->child == b->child) {
+            return true;
+        }
+    }
+
     switch (a->type) {
     case sbJSON_Invalid:
         return true;
@@ -2627,14 +10156,15 @@ bool sbj_compare(sbJSON const *const a, sbJSON const *const b) {
         if ((a->u.valuestring == NULL) || (b->u.valuestring == NULL)) {
             return false;
         }
-        if (strcmp(a->u.valuestring, b->u.valuestring) == 0) {
+        if ((a->u.valuestring == b->u.valuestring) ||
+            (strcmp(a->u.valuestring, b->u.valuestring) == 0)) {
             return true;
         }
 
         return false;
     case sbJSON_Array: {
-        sbJSON *a_element = a->child;
-        sbJSON *b_element = b->child;
+        sbJSON *a_element = sbj_get_child(a);
+        sbJSON *b_element = sbj_get_child(b);
 
         for (; (a_element != NULL) && (b_element != NULL);) {
             if (!sbj_compare(a_element, b_element)) {
@@ -2667,16 +10197,17 @@ bool sbj_compare(sbJSON const *const a, sbJSON const *const b) {
             }
         }
 
-        /* doing this twice, once on a and b to prevent true comparison if a
-         * subset of b
-         * TODO: Do this the proper way, this is just a fix for now */
+        /* the other way around, so a subset of b isn't equal. The members
+         * the lookups above found were compared already, comparing them
+         * again would double the work with every level of nesting. */
         sbJSON_ArrayForEach(b_element, b) {
             a_element = get_object_item(a, b_element->string);
             if (a_element == NULL) {
                 return false;
             }
 
-            if (!sbj_compare(b_element, a_element)) {
+            if ((get_object_item(b, b_element->string) != b_element) &&
+                !sbj_compare(b_element, a_element)) {
                 return false;
             }
         }
@@ -2692,3 +10223,156 @@ void *sbJSON_malloc(size_t size) { return global_hooks.allocate(size); }
 
 // TODO: Is passing NULL valid?
 void sbJSON_free(void *object) { global_hooks.deallocate(object); }
+
+/* Contexts: the same operations as above, but with explicit per-call state
+ * instead of global_hooks and global_error. */
+void sbj_context_init(sbj_context *ctx, sbJSON_Hooks const *hooks) {
+    if (ctx == NULL) {
+        return;
+    }
+
+    memset(ctx, '\0', sizeof(sbj_context));
+    if (hooks != NULL) {
+        ctx->hooks = *hooks;
+    }
+    ctx->nesting_limit = SBJSON_NESTING_LIMIT;
+}
+
+void sbj_context_destroy(sbj_context *ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+
+    if (ctx->scratch != NULL) {
+        make_hooks(&ctx->hooks).deallocate(ctx->scratch);
+    }
+    ctx->scratch = NULL;
+    ctx->scratch_size = 0;
+}
+
+char const *sbj_context_get_error_ptr(sbj_context const *ctx) {
+    if ((ctx == NULL) || (ctx->error_json == NULL)) {
+        return NULL;
+    }
+
+    return ctx->error_json + ctx->error_position;
+}
+
+/* The hooks of ctx, counting into its stats */
+static internal_hooks context_hooks(sbj_context *const ctx) {
+    internal_hooks hooks = make_hooks(&ctx->hooks);
+#ifdef SBJSON_STATS
+    hooks.stats = &ctx->stats;
+#endif
+    return hooks;
+}
+
+sbJSON *sbj_parse_ctx(sbj_context *ctx, char const *value,
+                      size_t buffer_length, char const **return_parse_end,
+                      bool require_null_terminated) {
+    parse_buffer buffer = empty_parse_buffer;
+    error local_error = {NULL, 0};
+    sbJSON *item = NULL;
+
+    assert(ctx != NULL);
+
+    buffer.hooks = context_hooks(ctx);
+    buffer.nesting_limit = ctx->nesting_limit;
+    buffer.keys = ctx->keys;
+
+    item = parse_document(&buffer, value, buffer_length, return_parse_end,
+                          require_null_terminated, &local_error);
+
+    ctx->error_json = (char const *)local_error.json;
+    ctx->error_position = local_error.position;
+
+    return item;
+}
+
+char *sbj_print_ctx(sbj_context *ctx, sbJSON const *item, bool format) {
+    static const size_t default_buffer_size = 256;
+    internal_hooks hooks;
+    printbuffer buffer = empty_printbuffer;
+    unsigned char *printed = NULL;
+    bool printed_value = false;
+
+    assert(ctx != NULL);
+
+    hooks = context_hooks(ctx);
+    if (ctx->scratch == NULL) {
+        ctx->scratch = (unsigned char *)hooks.allocate(default_buffer_size);
+        if (ctx->scratch == NULL) {
+            return NULL;
+        }
+        ctx->scratch_size = default_buffer_size;
+    }
+
+    /* print into the scratch buffer, it keeps its size for the next call */
+    buffer.buffer = ctx->scratch;
+    buffer.length = ctx->scratch_size;
+    buffer.format = format;
+    buffer.hooks = hooks;
+
+    printed_value = print_value(item, &buffer);
+
+    /* ensure may have moved or released the buffer */
+    ctx->scratch = buffer.buffer;
+    ctx->scratch_size = buffer.length;
+    if (!printed_value) {
+        return NULL;
+    }
+    update_offset(&buffer);
+
+    printed = (unsigned char *)hooks.allocate(buffer.offset + 1);
+    if (printed == NULL) {
+        return NULL;
+    }
+    memcpy(printed, buffer.buffer, buffer.offset);
+    printed[buffer.offset] = '\0';
+
+    return (char *)printed;
+}
+
+sbJSON *sbj_duplicate_ctx(sbj_context *ctx, sbJSON const *item, bool recurse) {
+    internal_hooks hooks;
+
+    assert(ctx != NULL);
+
+    hooks = context_hooks(ctx);
+    return duplicate_item(item, recurse, &hooks);
+}
+
+void sbj_delete_ctx(sbj_context *ctx, sbJSON *item) {
+    internal_hooks hooks;
+
+    assert(ctx != NULL);
+
+    hooks = context_hooks(ctx);
+    delete_item(item, &hooks);
+}
+
+bool sbj_get_stats(sbj_context const *ctx, sbj_stats *stats) {
+    if (stats == NULL) {
+        return false;
+    }
+
+#ifdef SBJSON_STATS
+    *stats = (ctx != NULL) ? ctx->stats : thread_stats;
+    return true;
+#else
+    (void)ctx;
+    memset(stats, '\0', sizeof(sbj_stats));
+    return false;
+#endif
+}
+
+void sbj_reset_stats(sbj_context *ctx) {
+    if (ctx != NULL) {
+        memset(&ctx->stats, '\0', sizeof(sbj_stats));
+        return;
+    }
+
+#ifdef SBJSON_STATS
+    memset(&thread_stats, '\0', sizeof(sbj_stats));
+#endif
+}
@@ -54,15 +54,42 @@ typedef struct sbJSON {
 
     /* The type of the item, as above. */
     uint8_t type;
-    bool is_reference;
-    bool string_is_const;
-    bool is_number_double;
+    /* The flags are bits so that they and child_count share a word. */
+    bool is_reference : 1;
+    bool string_is_const : 1;
+    bool is_number_double : 1;
+    /* The node itself was allocated from an sbj_arena and is released with
+     * it, so sbj_delete won't free it. */
+    bool is_arena_owned : 1;
+    /* An array or object of a sbj_parse_lazy tree whose children haven't been
+     * parsed yet, valuestring points at its text. */
+    bool is_lazy : 1;
+    /* The node was made by the parser of a SBJSON_COMPACT build and has
+     * SBJSON_INLINE_SIZE bytes behind it for short strings. */
+    bool has_inline_storage : 1;
+    /* Made by sbj_duplicate_shared: a constant key, and while is_reference is
+     * set the string or the children, belong to the original tree. */
+    bool is_shared : 1;
+    /* An array of only integers or only doubles whose numbers are kept in
+     * u.packed instead of child nodes, see sbj_parse_packed. */
+    bool is_packed : 1;
+    /* Number of items in the child chain of an array or object. */
+    int32_t child_count;
 
     union U {
         char *valuestring;
         int64_t valueint;
         double valuedouble;
         bool valuebool;
+        /* Lookup index of an object, NULL until sbj_object_build_index or a
+         * long lookup builds one. */
+        struct sbj_index *index;
+        /* Element pointers of an array, NULL until sbj_array_build_index or
+         * an access far into the array builds them. */
+        struct sbj_vector *vector;
+        /* Numbers of a packed array, until an access to its children turns
+         * them into nodes. */
+        struct sbj_packed *packed;
     } u;
 
     /* The item's name string, if this item is the child of, or is in the list
@@ -81,9 +108,108 @@ typedef struct sbJSON_Hooks {
 #define SBJSON_NESTING_LIMIT 1000
 #endif
 
+/* Objects get a hash index once a lookup had to walk past this many members,
+ * arrays an element vector once an access had to walk this far. */
+#ifndef SBJSON_INDEX_THRESHOLD
+#define SBJSON_INDEX_THRESHOLD 32
+#endif
+
+/* sbj_print_parallel splits arrays and objects with at least this many
+ * children across its threads. */
+#ifndef SBJSON_PARALLEL_THRESHOLD
+#define SBJSON_PARALLEL_THRESHOLD 4096
+#endif
+
+/* With SBJSON_COMPACT defined, the parser keeps keys and strings that fit in
+ * this many bytes (terminator included) inside the node instead of
+ * allocating them separately. */
+#ifndef SBJSON_INLINE_SIZE
+#define SBJSON_INLINE_SIZE 8
+#endif
+
 /* Supply malloc, realloc and free functions to sbJSON */
 void sbJSON_InitHooks(sbJSON_Hooks *hooks);
 
+/* A pooling allocator for mutation heavy trees, install it with
+ *     sbJSON_Hooks hooks = {sbj_pool_malloc, sbj_pool_free};
+ *     sbJSON_InitHooks(&hooks);
+ * or in a sbj_context. Nodes and short strings come from slabs of equally
+ * sized blocks, and freed blocks are kept on per-thread free lists for the
+ * next allocation instead of going back to malloc, so creating and deleting
+ * items doesn't fragment the heap or contend for the allocator's locks. The
+ * memory stays with the pool for the life of the process. Memory from it,
+ * like printed text, has to be released with sbj_pool_free (or sbJSON_free
+ * while the hooks are installed). */
+void *sbj_pool_malloc(size_t size);
+void sbj_pool_free(void *pointer);
+
+/* Region allocator for whole-document parsing. Nodes, keys and strings parsed
+ * into an arena are bump allocated from large blocks and released all at once
+ * by sbj_arena_reset/sbj_arena_free instead of one free per allocation.
+ * Arena trees can be mutated with the regular API. Items created with the
+ * regular allocator and attached to an arena tree are still owned by the heap:
+ * call sbj_delete on the root (it skips arena memory) before resetting the
+ * arena if you did that. */
+typedef struct sbj_arena sbj_arena;
+
+/* block_size is the size of each block requested from the allocator, 0 picks
+ * a default. */
+sbj_arena *sbj_arena_new(size_t block_size);
+/* Invalidates every tree parsed into the arena, but keeps a block around so
+ * the next document doesn't have to go to the allocator. */
+void sbj_arena_reset(sbj_arena *arena);
+void sbj_arena_free(sbj_arena *arena);
+sbJSON *sbj_parse_into_arena(sbj_arena *arena, char const *value,
+                             size_t buffer_length);
+
+/* Parses a caller owned, writable buffer without copying strings: values and
+ * keys are unescaped and zero terminated in place, and the nodes reference
+ * them like sbj_create_string_reference does. The buffer has to outlive the
+ * tree and its contents are undefined afterwards, also if parsing fails. The
+ * keys are constant strings, so sbj_duplicate keeps referencing them. */
+sbJSON *sbj_parse_in_situ(char *value, size_t buffer_length);
+
+/* Parses the file at path as one document, nothing but whitespace may follow
+ * it. The file is mapped read-only instead of being copied into memory where
+ * the platform supports it (define SBJSON_NO_MMAP to always read it) and
+ * released before returning. As the text is gone, a failure is reported as
+ * a byte offset into the file in error_offset (may be NULL, left alone on
+ * success), which is (size_t)-1 if the file couldn't be read, and
+ * sbJSON_GetErrorPtr is NULL. */
+sbJSON *sbj_parse_file(char const *path, size_t *error_offset);
+
+/* sbj_parse_in_situ for a file: the strings of the tree point directly into a
+ * private mapping of the file, which stays alive in mapping and has to be
+ * released with sbj_mapped_file_free after the tree is deleted. The file
+ * itself is never written, only the pages the parser had to change are
+ * copied. On failure mapping is NULL. */
+typedef struct sbj_mapped_file sbj_mapped_file;
+
+sbJSON *sbj_parse_file_in_situ(char const *path, sbj_mapped_file **mapping,
+                               size_t *error_offset);
+void sbj_mapped_file_free(sbj_mapped_file *file);
+
+/* Parses scalars right away but only records where arrays and objects start.
+ * Their children are parsed when they are first accessed through this API,
+ * e.g. sbj_get_object_item, sbj_get_array_item or sbJSON_ArrayForEach, and
+ * printing an untouched container copies its text as is. The input has to stay
+ * unchanged while the tree exists. Brackets and strings are checked up front,
+ * the rest of a container when it is parsed: a container that turns out to be
+ * invalid then looks empty. */
+sbJSON *sbj_parse_lazy(char const *value, size_t buffer_length);
+/* Parses the children of a container from sbj_parse_lazy, and makes the
+ * element nodes of a packed array, with recurse the whole subtree, as code
+ * that reads child directly needs. Returns false if a container is invalid or
+ * out of memory. */
+bool sbj_expand(sbJSON *item, bool recurse);
+
+/* Parses arrays of only integers or only doubles into one block of numbers
+ * each instead of a node per element (see is_packed). Printing, the typed
+ * getters sbj_get_integers/sbj_get_doubles and sbj_get_array_size read the
+ * block, any other access to the elements turns them into nodes first. Other
+ * arrays, e.g. [1, 2.5], are parsed as usual. */
+sbJSON *sbj_parse_packed(char const *value, size_t buffer_length);
+
 sbJSON *sbj_parse(char const *value);
 sbJSON *sbj_parse_with_length(char const *value, size_t buffer_length);
 sbJSON *sbj_parse_with_opts(char const *value, char const **return_parse_end,
@@ -91,19 +217,337 @@ sbJSON *sbj_parse_with_opts(char const *value, char const **return_parse_end,
 sbJSON *sbj_parse_with_length_opts(char const *value, size_t buffer_length,
                                    char const **return_parse_end,
                                    bool require_null_terminated);
+/* Same result as sbj_parse_with_length, built by a second engine: one pass
+ * indexes every token of the input, a second walks the index without
+ * recursion. The error position may point at a different byte of the same
+ * broken input. */
+sbJSON *sbj_parse_fast(char const *value, size_t buffer_length);
+
+/* Push parser for input that arrives in pieces, e.g. from a socket. Feed the
+ * chunks in order, then sbj_stream_finish returns the same tree
+ * sbj_parse_with_length would have built from their concatenation. Chunks may
+ * end anywhere, even inside a string, escape sequence or number, and don't have
+ * to outlive the call. Only a string or number split between chunks is copied,
+ * the rest of the input is parsed where it is. */
+typedef struct sbj_stream_parser sbj_stream_parser;
+
+sbj_stream_parser *sbj_stream_parser_new(void);
+/* Returns false once the input is known to be invalid. Input after the end of
+ * the value is ignored. */
+bool sbj_stream_feed(sbj_stream_parser *parser, char const *chunk,
+                     size_t length);
+/* Offset into the whole input where parsing failed */
+size_t sbj_stream_error_position(sbj_stream_parser const *parser);
+/* Ends the input and frees the parser. Returns NULL if the input was invalid or
+ * incomplete. */
+sbJSON *sbj_stream_finish(sbj_stream_parser *parser);
+
+/* Event based parsing that builds no tree. Every callback may be NULL and can
+ * return false to stop parsing. Strings and keys are not zero terminated and
+ * point into the input unless they contain escape sequences, then into a
+ * buffer that is reused for the next string. Either way they are only valid
+ * during the callback. */
+typedef struct sbj_sax_handler {
+    bool (*start_object)(void *user);
+    bool (*end_object)(void *user);
+    bool (*start_array)(void *user);
+    bool (*end_array)(void *user);
+    bool (*key)(void *user, char const *key, size_t length);
+    bool (*string)(void *user, char const *string, size_t length);
+    bool (*integer)(void *user, int64_t number);
+    bool (*double_number)(void *user, double number);
+    bool (*boolean)(void *user, bool value);
+    bool (*null)(void *user);
+} sbj_sax_handler;
+
+/* Accepts the same input as sbj_parse_with_length. Returns false if the input
+ * is invalid (see sbJSON_GetErrorPtr) or a callback stopped it, events up to
+ * that point have already been delivered. */
+bool sbj_parse_sax(char const *value, size_t buffer_length,
+                   sbj_sax_handler const *handler, void *user);
+
+/* Checks that the input is one document sbj_parse_with_length accepts,
+ * followed by nothing but whitespace, without allocating anything. On failure
+ * error_offset (may be NULL) is the byte offset sbJSON_GetErrorPtr would point
+ * at for the same input, which is left untouched. */
+bool sbj_validate(char const *value, size_t buffer_length,
+                  size_t *error_offset);
+
+/* Describes a C struct to decode JSON objects straight into and encode back
+ * without a tree in between. Each field names a member of the object and
+ * where its value lives in the struct. */
+typedef enum sbj_field_kind {
+    sbj_field_bool,    /* bool */
+    sbj_field_integer, /* int64_t, only integer numbers */
+    sbj_field_double,  /* double, any number */
+    sbj_field_string,  /* char *, NULL for null */
+    sbj_field_object,  /* a struct described by binding */
+    sbj_field_array,   /* pointer to elements of element_kind */
+} sbj_field_kind;
+
+typedef struct sbj_field {
+    char const *name;
+    size_t offset; /* offsetof the member */
+    sbj_field_kind kind;
+    /* Arrays: the kind of the elements, which can't be arrays themselves,
+     * and offsetof the size_t member that holds their number. */
+    sbj_field_kind element_kind;
+    size_t count_offset;
+    /* Objects and arrays of objects: the struct of the value. */
+    struct sbj_binding const *binding;
+} sbj_field;
+
+typedef struct sbj_binding {
+    size_t size; /* sizeof the struct */
+    sbj_field const *fields;
+    size_t field_count;
+} sbj_binding;
+
+/* Decodes the object in value into out, which is zeroed first. Members without
+ * a field are checked and skipped without allocating anything (unless their
+ * name has escapes and is longer than 256 bytes), null leaves a field zero,
+ * and for repeated names the last member wins. Strings and arrays
+ * are allocated with the hooks and released by sbj_binding_free. Accepts the
+ * same input as sbj_parse_with_length. Returns false (see
+ * sbJSON_GetErrorPtr) if it isn't an object or a value doesn't fit its field,
+ * out holds nothing to release then. */
+bool sbj_decode(char const *value, size_t buffer_length,
+                sbj_binding const *binding, void *out);
+/* Prints the struct as sbj_print or sbj_print_unformatted would print the
+ * object it was decoded from, with the members in the order of the fields and
+ * NULL strings as null. Release the text with sbJSON_free. */
+char *sbj_encode(void const *in, sbj_binding const *binding, bool format);
+/* Releases the strings and arrays sbj_decode stored in object, but not object
+ * itself, and zeroes them. */
+void sbj_binding_free(void *object, sbj_binding const *binding);
+
+/* Receives the records of sbj_parse_ndjson in input order and owns them:
+ * delete them with sbj_delete. Return false to stop parsing. */
+typedef bool (*sbj_record_fn)(void *user, sbJSON *record);
+
+/* Parses newline delimited JSON: one document per line, blank lines are
+ * skipped. Batches of lines are parsed on up to threads threads (0 uses one
+ * per processor) when built with SBJSON_THREADS, so the allocator set with
+ * sbJSON_InitHooks has to be thread safe; callback always runs on the calling
+ * thread. Returns false if a record is invalid (see sbJSON_GetErrorPtr) or
+ * callback stopped it, the records before have already been delivered. */
+bool sbj_parse_ndjson(char const *value, size_t buffer_length, size_t threads,
+                      sbj_record_fn callback, void *user);
+
+/* Same result as sbj_parse_with_length. If the document is one large array,
+ * a quick scan splits its elements into runs that are parsed on up to threads
+ * threads (0 uses one per processor, see sbj_parse_ndjson) and joined in
+ * order. Anything else, and errors, go through the regular parser. */
+sbJSON *sbj_parse_parallel(char const *value, size_t buffer_length,
+                           size_t threads);
+
+/* Read-only alternative to the tree: all values of a document in one array of
+ * tagged 64-bit words plus one buffer for the strings. Containers store where
+ * they end, so skipping a subtree takes constant time. Values are addressed by
+ * their position on the tape: sbj_tape_root for the document, then
+ * sbj_tape_child/sbj_tape_next to iterate, sbj_tape_get_item and
+ * sbj_tape_get_member to look items up. A position of an object member can be
+ * passed wherever a value is expected and also gives its key. The functions
+ * return SBJ_TAPE_NONE (or 0, NULL, false) where there is no such item. */
+typedef struct sbj_tape sbj_tape;
+
+#define SBJ_TAPE_NONE ((size_t)-1)
+
+/* Accepts the same input as sbj_parse_with_length */
+sbj_tape *sbj_tape_parse(char const *value, size_t buffer_length);
+sbj_tape *sbj_tape_from_tree(sbJSON const *item);
+/* A mutable copy of the value at position */
+sbJSON *sbj_tape_to_tree(sbj_tape const *tape, size_t position);
+void sbj_tape_free(sbj_tape *tape);
+
+size_t sbj_tape_root(sbj_tape const *tape);
+/* One of the sbJSON_* types */
+int sbj_tape_type(sbj_tape const *tape, size_t position);
+/* Number of items of an array or object */
+size_t sbj_tape_count(sbj_tape const *tape, size_t position);
+size_t sbj_tape_child(sbj_tape const *tape, size_t container);
+/* The item after item in container */
+size_t sbj_tape_next(sbj_tape const *tape, size_t container, size_t item);
+size_t sbj_tape_get_item(sbj_tape const *tape, size_t array, size_t index);
+/* The first member called key, compared case sensitively */
+size_t sbj_tape_get_member(sbj_tape const *tape, size_t object,
+                           char const *key);
+char const *sbj_tape_get_key(sbj_tape const *tape, size_t member);
+/* Strings and raw values are zero terminated, length may be NULL */
+char const *sbj_tape_get_string(sbj_tape const *tape, size_t position,
+                                size_t *length);
+/* Integers and doubles are converted to the requested type */
+int64_t sbj_tape_get_integer(sbj_tape const *tape, size_t position);
+double sbj_tape_get_double(sbj_tape const *tape, size_t position);
+bool sbj_tape_get_bool(sbj_tape const *tape, size_t position);
+
+/* A table of shared object keys. A context with a key table parses each
+ * distinct name once into a string owned by the table, instead of a copy per
+ * member. Members point at it like at a constant key (see
+ * sbj_add_item_to_objectCS), so the table has to outlive the trees. The table
+ * can be shared by the contexts of several threads (with SBJSON_THREADS). */
+typedef struct sbj_keys sbj_keys;
+
+/* Keeps at most max_keys names (0 means no limit), further ones are copied
+ * into the members as usual. */
+sbj_keys *sbj_keys_new(size_t max_keys);
+void sbj_keys_free(sbj_keys *keys);
+/* The table's string equal to key, which is added if it is new. NULL if the
+ * table is full or out of memory. */
+char const *sbj_keys_intern(sbj_keys *keys, char const *key);
+size_t sbj_keys_count(sbj_keys const *keys);
+
+/* Counters of the work done, for finding out where time and memory go. They
+ * are only kept when built with SBJSON_STATS (the ENABLE_STATS CMake option),
+ * otherwise nothing is counted and the counting costs nothing. */
+typedef struct sbj_stats {
+    /* with the hooks, nodes of an sbj_arena aren't counted */
+    size_t nodes_allocated;
+    size_t nodes_freed;
+    size_t string_bytes; /* allocated with the hooks for strings and keys */
+    /* times a print buffer had to grow, and the bytes that moved with it */
+    size_t print_buffer_grows;
+    size_t print_buffer_bytes_copied;
+    size_t max_depth; /* deepest nesting of arrays/objects parsed into trees */
+    size_t bytes_parsed;
+    size_t bytes_printed;
+    /* Spent parsing and printing values, in ticks of SBJSON_STATS_CLOCK():
+     * the CPU's cycle counter on x86 and AArch64 with GCC or Clang, 0
+     * elsewhere unless it is defined to read another clock. */
+    uint64_t parse_cycles;
+    uint64_t print_cycles;
+} sbj_stats;
+
+/* Explicit per-call state for the functions below. The regular functions keep
+ * their allocator (sbJSON_InitHooks) and last error (sbJSON_GetErrorPtr) in
+ * process wide statics; give each thread its own context instead to parse,
+ * print, duplicate and delete without sharing anything. Trees must be deleted
+ * with a context using the same allocator they were created with. */
+typedef struct sbj_context {
+    sbJSON_Hooks hooks; /* NULL members mean malloc/free */
+    /* Maximum nesting of arrays/objects accepted by sbj_parse_ctx */
+    size_t nesting_limit;
+    /* Where the last sbj_parse_ctx call failed, see sbj_context_get_error_ptr */
+    char const *error_json;
+    size_t error_position;
+    /* Print buffer kept between sbj_print_ctx calls */
+    unsigned char *scratch;
+    size_t scratch_size;
+    /* Shared keys for sbj_parse_ctx, NULL copies every key */
+    sbj_keys *keys;
+    /* What the functions with this context did, see sbj_get_stats */
+    sbj_stats stats;
+} sbj_context;
+
+/* hooks may be NULL. Sets nesting_limit to SBJSON_NESTING_LIMIT. */
+void sbj_context_init(sbj_context *ctx, sbJSON_Hooks const *hooks);
+/* Releases the scratch buffer. The context can be reused afterwards. */
+void sbj_context_destroy(sbj_context *ctx);
+/* NULL if the last parse with this context succeeded */
+char const *sbj_context_get_error_ptr(sbj_context const *ctx);
+
+sbJSON *sbj_parse_ctx(sbj_context *ctx, char const *value,
+                      size_t buffer_length, char const **return_parse_end,
+                      bool require_null_terminated);
+/* The result is allocated with the context's hooks. */
+char *sbj_print_ctx(sbj_context *ctx, sbJSON const *item, bool format);
+sbJSON *sbj_duplicate_ctx(sbj_context *ctx, sbJSON const *item, bool recurse);
+void sbj_delete_ctx(sbj_context *ctx, sbJSON *item);
+
+/* Copies the counters of ctx into stats, or with a NULL ctx those of the
+ * functions without a context called on this thread (including the work they
+ * hand to other threads). False, with stats zeroed, if built without
+ * SBJSON_STATS. */
+bool sbj_get_stats(sbj_context const *ctx, sbj_stats *stats);
+/* Starts the counters of ctx, or of this thread with a NULL ctx, over. */
+void sbj_reset_stats(sbj_context *ctx);
 
 char *sbj_print(sbJSON const *item);
 char *sbj_print_unformatted(sbJSON const *item);
+/* Same text as sbj_print or sbj_print_unformatted. The children of arrays and
+ * objects with SBJSON_PARALLEL_THRESHOLD or more of them are rendered on up to
+ * threads threads (0 uses one per processor, see sbj_parse_ndjson). */
+char *sbj_print_parallel(sbJSON const *item, bool format, size_t threads);
+/* The exact number of characters sbj_print (with format) or
+ * sbj_print_unformatted write, without the terminating zero. A buffer of this
+ * length + 1 is enough for sbj_print_preallocated. 0 if item can't be
+ * printed. */
+size_t sbj_print_length(sbJSON const *item, bool format);
 char *sbj_print_buffered(sbJSON const *item, int prebuffer, bool fmt);
 bool sbj_print_preallocated(sbJSON *item, char *buffer, int const length,
                               bool const format);
+/* Keeps one output buffer across prints, so once it has grown to the size of
+ * the documents no print allocates again. initial_size may be 0 for a
+ * default. */
+typedef struct sbj_printer sbj_printer;
+
+sbj_printer *sbj_printer_new(size_t initial_size);
+void sbj_printer_free(sbj_printer *printer);
+/* The zero terminated text of item in the printer's buffer, valid until the
+ * next print with it, and its length if length isn't NULL. NULL on failure. */
+char const *sbj_printer_print(sbj_printer *printer, sbJSON const *item,
+                              bool format, size_t *length);
+/* Receives the output of sbj_print_to_sink piece by piece. Return false to
+ * stop printing. */
+typedef bool (*sbj_write_fn)(void *user, char const *data, size_t length);
+/* Prints into a buffer of chunk_size bytes (0 picks a default) that is handed
+ * to write_fn whenever it is full, so the document is never in memory as a
+ * whole. The buffer only grows for a single string or number that doesn't fit
+ * into it. Returns false if printing or write_fn failed, in which case write_fn
+ * may already have received part of the document. */
+bool sbj_print_to_sink(sbJSON const *item, bool format, sbj_write_fn write_fn,
+                       void *user, size_t chunk_size);
+/* Compact binary form of a tree for passing it between processes: strings are
+ * length prefixed, containers start with their number of items and numbers
+ * keep whether they are integers or doubles. Returns a buffer to release with
+ * sbJSON_free and stores its size in length, NULL if the tree contains invalid
+ * items. Decoding yields a tree that sbj_compare finds equal to the encoded
+ * one, NULL if data isn't exactly one encoded tree. The format may change
+ * between versions of this library. */
+unsigned char *sbj_encode_binary(sbJSON const *item, size_t *length);
+sbJSON *sbj_decode_binary(unsigned char const *data, size_t length);
 void sbj_delete(sbJSON *item);
 
 int sbj_get_array_size(sbJSON const *array);
 sbJSON *sbj_get_array_item(sbJSON const *array, int index);
+/* Number of members of an object or elements of an array, 0 for other items */
+int32_t sbj_item_count(sbJSON const *item);
+/* First item of an array or object, NULL for other items */
+sbJSON *sbj_get_child(sbJSON const *item);
+/* Stores the sbj_item_count(array) items of an array or object in
+ * out_items. */
+void sbj_get_items(sbJSON const *array, sbJSON const **out_items);
+/* Store the sbj_get_array_size(array) elements of an array in one pass, also
+ * from packed arrays without making nodes. sbj_get_doubles converts integers,
+ * sbj_get_integers takes no doubles. Return false if array isn't an array or
+ * has an element of another type, out may be written partially then. */
+bool sbj_get_integers(sbJSON const *array, int64_t *out_integers);
+bool sbj_get_doubles(sbJSON const *array, double *out_doubles);
+bool sbj_get_booleans(sbJSON const *array, bool *out_booleans);
+/* Keep the elements of an array in a vector for constant time
+ * sbj_get_array_item. Like the object index below it is kept up to date by the
+ * functions that add, insert, detach and replace items, accesses to large
+ * arrays can build it on their own, and on arena arrays it needs sbj_delete. */
+bool sbj_array_build_index(sbJSON *array);
+void sbj_array_drop_index(sbJSON *array);
 sbJSON *sbj_get_object_item(sbJSON const *const object,
                              char const *const string);
 bool sbj_has_object_item(sbJSON const *object, char const *string);
+/* For repeated lookups of the same name: sbj_get_object_item, but indexed
+ * objects use the hash from sbj_hash_key(string) instead of computing it. */
+size_t sbj_hash_key(char const *string);
+sbJSON *sbj_get_object_item_hashed(sbJSON const *object, char const *string,
+                                   size_t hash);
+/* Index the members of an object by name so that lookups don't walk the list.
+ * Adding, detaching and replacing members through the functions below keeps
+ * it up to date; changing ->string of a member directly requires building it
+ * again. Lookups on a large object can build the index on their own, so build
+ * it up front if several threads look up in the same object. Arena objects are
+ * only indexed by this call, and then need sbj_delete like other heap
+ * allocations attached to arena trees. */
+bool sbj_object_build_index(sbJSON *object);
+/* Releases the index, lookups go back to walking the list. */
+void sbj_object_drop_index(sbJSON *object);
 char const *sbJSON_GetErrorPtr(void);
 
 /* Get values of items of known type */
@@ -146,6 +590,9 @@ sbJSON *sbj_create_array_reference(sbJSON const *child);
 sbJSON *sbj_create_int_array(int const *numbers, int count);
 sbJSON *sbj_create_float_array(float const *numbers, int count);
 sbJSON *sbj_create_double_array(double const *numbers, int count);
+/* The same as sbj_create_double_array, but the numbers are stored in one
+ * block instead of a node each, see sbj_parse_packed. */
+sbJSON *sbj_create_packed_double_array(double const *numbers, int count);
 sbJSON *sbj_create_string_array(char const *const *strings, int count);
 
 /* Append item to the specified array/object. */
@@ -180,10 +627,34 @@ bool sbj_replace_item_in_object(sbJSON *object, char const *string,
 
 /* Duplicate a sbJSON item */
 sbJSON *sbj_duplicate(sbJSON const *item, bool recurse);
+/* Deep copy of item with all nodes and strings in one allocation from arena,
+ * sized by counting them first. The copy is an arena tree like the ones of
+ * sbj_parse_into_arena. */
+sbJSON *sbj_duplicate_into_arena(sbj_arena *arena, sbJSON const *item);
+/* Copy-on-write copy of item: the copy shares the children and strings of
+ * the original instead of copying them. Accessing the children of a shared
+ * array or object through this API (sbj_get_child, sbj_get_array_item,
+ * sbj_get_object_item, adding items, ...) gives it children of its own, which
+ * share the next level in turn, and sbj_set_valuestring copies a shared string
+ * first, so changes never reach the original and untouched subtrees are never
+ * copied. Code that changes child lists directly, like sbJSONUtils_SortObject,
+ * needs sbj_expand first. The original must stay unchanged and alive while
+ * the copy exists. */
+sbJSON *sbj_duplicate_shared(sbJSON const *item);
 
 bool sbj_compare(sbJSON const *const a, sbJSON const *const b);
+/* Structural hash of item: items that sbj_compare finds equal hash the same,
+ * except for doubles that are only equal within rounding. The order of object
+ * members doesn't matter. The hash is the same on every platform and in every
+ * run, so it can be stored. */
+uint64_t sbj_hash(sbJSON const *item);
 
 void sbj_minify(char *json);
+/* Same as sbj_minify, but reads up to length bytes of json (or up to its
+ * terminating zero) and writes the result to output, which needs room for
+ * length + 1 bytes and may be json itself. Returns the length of the result,
+ * output is zero terminated. */
+size_t sbj_minify_to_buffer(char const *json, size_t length, char *output);
 
 sbJSON *sbj_add_null_to_object(sbJSON *const object, char const *const name);
 sbJSON *sbj_add_true_to_object(sbJSON *const object, char const *const name);
@@ -211,7 +682,7 @@ bool sbj_set_bool_value(sbJSON *object, bool boolValue);
 
 /* Macro for iterating over an array or object */
 #define sbJSON_ArrayForEach(element, array)                                    \
-    for (element = (array != NULL) ? (array)->child : NULL; element != NULL;   \
+    for (element = sbj_get_child(array); element != NULL;                      \
          element = element->next)
 
 /* malloc/free objects using the malloc/free functions that have been set with
@@ -104,9 +104,9 @@ bool sbj_is_raw(SbJSON const* item);
 int32_t sbj_item_count(SbJSON const* item);
 void sbj_get_items(SbJSON const* array, SbJSON const** out_items);
 
-bool sbj_get_booleans(SbJSON const* array, bool** out_booleans);
-bool sbj_get_integers(SbJSON const* array, int64_t** out_integers);
-bool sbj_get_doubles(SbJSON const* array, double** out_doubles);
+bool sbj_get_booleans(SbJSON const* array, bool* out_booleans);
+bool sbj_get_integers(SbJSON const* array, int64_t* out_integers);
+bool sbj_get_doubles(SbJSON const* array, double* out_doubles);
 
 SbJSON *sbj_slow_get_array_item(SbJSON const *array, int index);
 
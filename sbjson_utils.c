@@ -65,39 +65,6 @@ static bool compare_double(double a, double b) {
     return (fabs(a - b) <= maxVal * DBL_EPSILON);
 }
 
-/* Compare the next path element of two JSON pointers, two NULL pointers are
- * considered unequal: */
-static bool compare_pointers(const unsigned char *name,
-                             const unsigned char *pointer) {
-    if ((name == NULL) || (pointer == NULL)) {
-        return false;
-    }
-
-    for (; (*name != '\0') && (*pointer != '\0') && (*pointer != '/');
-         (void)name++, pointer++) /* compare until next '/' */
-    {
-        if (*pointer == '~') {
-            /* check for escaped '~' (~0) and '/' (~1) */
-            if (((pointer[1] != '0') || (*name != '~')) &&
-                ((pointer[1] != '1') || (*name != '/'))) {
-                /* invalid escape sequence or wrong character in *name */
-                return false;
-            } else {
-                pointer++;
-            }
-        } else if (*name != *pointer) {
-            return false;
-        }
-    }
-    if (((*pointer != 0) && (*pointer != '/')) != (*name != 0)) {
-        /* one string has ended, the other not */
-        return false;
-        ;
-    }
-
-    return true;
-}
-
 /* calculate the length of a string if encoded as JSON pointer with ~0 and ~1
  * escape sequences */
 static size_t pointer_encoded_length(const unsigned char *string) {
@@ -148,7 +115,7 @@ char *sbJSONUtils_FindPointerFromObjectTo(const sbJSON *const object,
     }
 
     /* recursively search all children of the object or array */
-    for (current_child = object->child; current_child != NULL;
+    for (current_child = sbj_get_child(object); current_child != NULL;
          (void)(current_child = current_child->next), child_index++) {
         unsigned char *target_pointer =
             (unsigned char *)sbJSONUtils_FindPointerFromObjectTo(current_child,
@@ -203,13 +170,12 @@ char *sbJSONUtils_FindPointerFromObjectTo(const sbJSON *const object,
 
 /* non broken version of sbj_get_array_item */
 static sbJSON *get_array_item(const sbJSON *array, size_t item) {
-    sbJSON *child = array ? array->child : NULL;
-    while ((child != NULL) && (item > 0)) {
-        item--;
-        child = child->next;
+    if (item > INT_MAX) {
+        /* arrays can't be that long */
+        return NULL;
     }
 
-    return child;
+    return sbj_get_array_item(array, (int)item);
 }
 
 static bool decode_array_index_from_pointer(const unsigned char *const pointer,
@@ -222,7 +188,7 @@ static bool decode_array_index_from_pointer(const unsigned char *const pointer,
         return 0;
     }
 
-    for (position = 0; (pointer[position] >= '0') && (pointer[0] <= '9');
+    for (position = 0; (pointer[position] >= '0') && (pointer[position] <= '9');
          position++) {
         parsed_index = (10 * parsed_index) + (size_t)(pointer[position] - '0');
     }
@@ -236,6 +202,54 @@ static bool decode_array_index_from_pointer(const unsigned char *const pointer,
     return 1;
 }
 
+/* Look up the member named by the next path element of a JSON pointer, after
+ * decoding its ~0 and ~1 escape sequences. */
+static sbJSON *get_member_from_pointer(const sbJSON *const object,
+                                       const unsigned char *pointer) {
+    unsigned char short_name[256];
+    unsigned char *name = short_name;
+    size_t length = 0;
+    size_t position = 0;
+    sbJSON *member = NULL;
+
+    while ((pointer[length] != '\0') && (pointer[length] != '/')) {
+        length++;
+    }
+    if (length >= sizeof(short_name)) {
+        name = (unsigned char *)sbJSON_malloc(length + sizeof(""));
+        if (name == NULL) {
+            return NULL;
+        }
+    }
+
+    for (; (pointer[0] != '\0') && (pointer[0] != '/'); pointer++) {
+        if (pointer[0] == '~') {
+            if (pointer[1] == '0') {
+                name[position] = '~';
+            } else if (pointer[1] == '1') {
+                name[position] = '/';
+            } else {
+                /* invalid escape sequence */
+                goto cleanup;
+            }
+            pointer++;
+        } else {
+            name[position] = pointer[0];
+        }
+        position++;
+    }
+    name[position] = '\0';
+
+    member = sbj_get_object_item(object, (const char *)name);
+
+cleanup:
+    if (name != short_name) {
+        sbJSON_free(name);
+    }
+
+    return member;
+}
+
 static sbJSON *get_item_from_pointer(sbJSON *const object, const char *pointer) {
     sbJSON *current_element = object;
 
@@ -255,13 +269,8 @@ static sbJSON *get_item_from_pointer(sbJSON *const object, const char *pointer)
 
             current_element = get_array_item(current_element, index);
         } else if (sbj_is_object(current_element)) {
-            current_element = current_element->child;
-            /* GetObjectItem. */
-            while ((current_element != NULL) &&
-                   !compare_pointers((unsigned char *)current_element->string,
-                                     (const unsigned char *)pointer)) {
-                current_element = current_element->next;
-            }
+            current_element = get_member_from_pointer(
+                current_element, (const unsigned char *)pointer);
         } else {
             return NULL;
         }
@@ -279,107 +288,177 @@ sbJSON *sbJSONUtils_GetPointer(sbJSON *const object, const char *pointer) {
     return get_item_from_pointer(object, pointer);
 }
 
-/* JSON Patch implementation. */
-static void decode_pointer_inplace(unsigned char *string) {
-    unsigned char *decoded_string = string;
+/* A path element of a compiled pointer */
+typedef struct pointer_token {
+    const char *name; /* decoded and zero terminated */
+    size_t length;
+    size_t hash; /* sbj_hash_key(name) */
+    size_t index;
+    bool is_index; /* name is a valid array index, which is index */
+} pointer_token;
+
+struct sbJSONUtils_CompiledPointer {
+    size_t count;
+    pointer_token tokens[]; /* followed by the names */
+};
+
+sbJSONUtils_CompiledPointer *sbJSONUtils_CompilePointer(const char *pointer) {
+    sbJSONUtils_CompiledPointer *compiled = NULL;
+    unsigned char *names = NULL;
+    size_t count = 0;
+    size_t position = 0;
+    size_t i = 0;
 
-    if (string == NULL) {
-        return;
+    if ((pointer == NULL) || ((pointer[0] != '\0') && (pointer[0] != '/'))) {
+        return NULL;
     }
 
-    for (; *string; (void)decoded_string++, string++) {
-        if (string[0] == '~') {
-            if (string[1] == '0') {
-                decoded_string[0] = '~';
-            } else if (string[1] == '1') {
-                decoded_string[1] = '/';
+    for (position = 0; pointer[position] != '\0'; position++) {
+        if (pointer[position] == '/') {
+            count++;
+        }
+    }
+
+    /* the names take at most the length of the pointer */
+    compiled = (sbJSONUtils_CompiledPointer *)sbJSON_malloc(
+        sizeof(sbJSONUtils_CompiledPointer) + count * sizeof(pointer_token) +
+        position + sizeof(""));
+    if (compiled == NULL) {
+        return NULL;
+    }
+    compiled->count = count;
+    names = (unsigned char *)&compiled->tokens[count];
+
+    for (i = 0; i < count; i++) {
+        pointer_token *const token = &compiled->tokens[i];
+
+        pointer++; /* skip the '/' */
+        token->is_index = decode_array_index_from_pointer(
+            (const unsigned char *)pointer, &token->index);
+        token->name = (const char *)names;
+        for (; (pointer[0] != '\0') && (pointer[0] != '/'); pointer++) {
+            if (pointer[0] == '~') {
+                if ((pointer[1] != '0') && (pointer[1] != '1')) {
+                    /* invalid escape sequence */
+                    sbJSON_free(compiled);
+                    return NULL;
+                }
+                *names++ = (pointer[1] == '0') ? '~' : '/';
+                pointer++;
             } else {
-                /* invalid escape sequence */
-                return;
+                *names++ = (unsigned char)pointer[0];
             }
-
-            string++;
         }
+        *names++ = '\0';
+        token->length = (size_t)(names - (const unsigned char *)token->name) -
+                        sizeof("");
+        token->hash = sbj_hash_key(token->name);
     }
 
-    decoded_string[0] = '\0';
+    return compiled;
 }
 
-/* non-broken sbj_detach_item_from_array */
-static sbJSON *detach_item_from_array(sbJSON *array, size_t which) {
-    sbJSON *c = array->child;
-    while (c && (which > 0)) {
-        c = c->next;
-        which--;
-    }
-    if (!c) {
-        /* item doesn't exist */
-        return NULL;
+void sbJSONUtils_FreeCompiledPointer(sbJSONUtils_CompiledPointer *pointer) {
+    sbJSON_free(pointer);
+}
+
+/* Follows one path element like get_item_from_pointer does */
+static sbJSON *follow_token(const sbJSON *const item,
+                            const pointer_token *const token) {
+    if (sbj_is_array(item)) {
+        return token->is_index ? get_array_item(item, token->index) : NULL;
     }
-    if (c != array->child) {
-        /* not the first element */
-        c->prev->next = c->next;
+    if (sbj_is_object(item)) {
+        return sbj_get_object_item_hashed(item, token->name, token->hash);
     }
-    if (c->next) {
-        c->next->prev = c->prev;
+
+    return NULL;
+}
+
+sbJSON *sbJSONUtils_EvalPointer(const sbJSONUtils_CompiledPointer *pointer,
+                                sbJSON *const object) {
+    sbJSON *current_element = object;
+    size_t i = 0;
+
+    if (pointer == NULL) {
+        return NULL;
     }
-    if (c == array->child) {
-        array->child = c->next;
-    } else if (c->next == NULL) {
-        array->child->prev = c->prev;
+
+    for (i = 0; (i < pointer->count) && (current_element != NULL); i++) {
+        current_element = follow_token(current_element, &pointer->tokens[i]);
     }
-    /* make sure the detached item doesn't point anywhere anymore */
-    c->prev = c->next = NULL;
 
-    return c;
+    return current_element;
 }
 
-/* detach an item at the given path */
-static sbJSON *detach_path(sbJSON *object, const unsigned char *path) {
-    unsigned char *parent_pointer = NULL;
-    unsigned char *child_pointer = NULL;
-    sbJSON *parent = NULL;
-    sbJSON *detached_item = NULL;
+static bool tokens_equal(const pointer_token *const a,
+                         const pointer_token *const b) {
+    return (a->hash == b->hash) && (a->length == b->length) &&
+           (memcmp(a->name, b->name, a->length) == 0);
+}
 
-    /* copy path and split it in parent and child */
-    parent_pointer = sbJSONUtils_strdup(path);
-    if (parent_pointer == NULL) {
-        goto cleanup;
+void sbJSONUtils_EvalPointers(
+    const sbJSONUtils_CompiledPointer *const *const pointers, size_t count,
+    sbJSON *const object, sbJSON **const results) {
+    /* the items along the previous pointer, path[d] after d of its tokens */
+    sbJSON *short_path[32];
+    sbJSON **path = short_path;
+    const sbJSONUtils_CompiledPointer *previous = NULL;
+    size_t depth = 0; /* tokens of previous that path holds the items of */
+    size_t max_depth = 0;
+    size_t shared = 0;
+    size_t i = 0;
+
+    if ((pointers == NULL) || (results == NULL)) {
+        return;
     }
 
-    child_pointer =
-        (unsigned char *)strrchr((char *)parent_pointer, '/'); /* last '/' */
-    if (child_pointer == NULL) {
-        goto cleanup;
+    for (i = 0; i < count; i++) {
+        if ((pointers[i] != NULL) && (pointers[i]->count > max_depth)) {
+            max_depth = pointers[i]->count;
+        }
+    }
+    if (max_depth >= sizeof(short_path) / sizeof(short_path[0])) {
+        path = (sbJSON **)sbJSON_malloc((max_depth + 1) * sizeof(sbJSON *));
+        if (path == NULL) {
+            /* evaluate them one by one */
+            for (i = 0; i < count; i++) {
+                results[i] = sbJSONUtils_EvalPointer(pointers[i], object);
+            }
+            return;
+        }
     }
-    /* split strings */
-    child_pointer[0] = '\0';
-    child_pointer++;
 
-    parent =
-        get_item_from_pointer(object, (char *)parent_pointer);
-    decode_pointer_inplace(child_pointer);
+    path[0] = object;
+    for (i = 0; i < count; i++) {
+        const sbJSONUtils_CompiledPointer *const pointer = pointers[i];
 
-    if (sbj_is_array(parent)) {
-        size_t index = 0;
-        if (!decode_array_index_from_pointer(child_pointer, &index)) {
-            goto cleanup;
+        if (pointer == NULL) {
+            results[i] = NULL;
+            continue;
         }
-        detached_item = detach_item_from_array(parent, index);
-    } else if (sbj_is_object(parent)) {
-        detached_item =
-            sbj_detach_item_from_object(parent, (char *)child_pointer);
-    } else {
-        /* Couldn't find object to remove child from. */
-        goto cleanup;
-    }
 
-cleanup:
-    if (parent_pointer != NULL) {
-        sbJSON_free(parent_pointer);
+        /* continue from where the path of the previous pointer diverges */
+        if (depth > pointer->count) {
+            depth = pointer->count;
+        }
+        shared = 0;
+        while ((shared < depth) && tokens_equal(&previous->tokens[shared],
+                                                &pointer->tokens[shared])) {
+            shared++;
+        }
+        for (depth = shared;
+             (depth < pointer->count) && (path[depth] != NULL); depth++) {
+            path[depth + 1] =
+                follow_token(path[depth], &pointer->tokens[depth]);
+        }
+        results[i] = (depth == pointer->count) ? path[depth] : NULL;
+        previous = pointer;
     }
 
-    return detached_item;
+    if (path != short_path) {
+        sbJSON_free(path);
+    }
 }
 
 /* sort lists using mergesort */
@@ -480,10 +559,12 @@ static void sort_object(sbJSON *const object) {
     if (object == NULL) {
         return;
     }
-    object->child = sort_list(object->child);
+    /* the order of members with the same name isn't kept */
+    sbj_object_drop_index(object);
+    object->child = sort_list(sbj_get_child(object));
 }
 
-static bool numbers_match(sbJSON *a, sbJSON *b) {
+static bool numbers_match(const sbJSON *a, const sbJSON *b) {
     if (a->is_number_double != b->is_number_double) {
         return false;
     }
@@ -495,101 +576,69 @@ static bool numbers_match(sbJSON *a, sbJSON *b) {
     }
 }
 
-static bool compare_json(sbJSON *a, sbJSON *b) {
-    if ((a == NULL) || (b == NULL) || ((a->type != b->type))) {
-        /* mismatched type. */
+/* Structural equality, objects are equal regardless of the order of their
+ * members. */
+static bool compare_json(const sbJSON *a, const sbJSON *b) {
+    const sbJSON *member = NULL;
+
+    if ((a == NULL) || (b == NULL) || (a->type != b->type)) {
         return false;
     }
+
     switch (a->type) {
     case sbJSON_Number:
         return numbers_match(a, b);
 
     case sbJSON_String:
-        /* string mismatch. */
-        if (strcmp(a->u.valuestring, b->u.valuestring) != 0) {
-            return false;
-        } else {
-            return true;
-        }
+    case sbJSON_Raw:
+        return strcmp(a->u.valuestring, b->u.valuestring) == 0;
+
+    case sbJSON_Bool:
+        return a->u.valuebool == b->u.valuebool;
 
     case sbJSON_Array:
-        for ((void)(a = a->child), b = b->child; (a != NULL) && (b != NULL);
+        if (a->child_count != b->child_count) {
+            return false;
+        }
+        for ((void)(a = sbj_get_child(a)), b = sbj_get_child(b);
+             (a != NULL) && (b != NULL);
              (void)(a = a->next), b = b->next) {
-            bool identical = compare_json(a, b);
-            if (!identical) {
+            if (!compare_json(a, b)) {
                 return false;
             }
         }
+        return (a == NULL) && (b == NULL);
 
-        /* array size mismatch? (one of both children is not NULL) */
-        if ((a != NULL) || (b != NULL)) {
+    case sbJSON_Object:
+        if (a->child_count != b->child_count) {
             return false;
-        } else {
-            return true;
         }
-
-    case sbJSON_Object:
-        sort_object(a);
-        sort_object(b);
-        for ((void)(a = a->child), b = b->child; (a != NULL) && (b != NULL);
-             (void)(a = a->next), b = b->next) {
-            bool identical = false;
-            /* compare object keys */
-            if (compare_strings((unsigned char *)a->string,
-                                (unsigned char *)b->string)) {
-                /* missing member */
-                return false;
-            }
-            identical = compare_json(a, b);
-            if (!identical) {
+        for (member = sbj_get_child(a); member != NULL;
+             member = member->next) {
+            const sbJSON *const other = sbj_get_object_item(b, member->string);
+            if ((other == NULL) || !compare_json(member, other)) {
                 return false;
             }
         }
-
-        /* object length mismatch (one of both children is not null) */
-        if ((a != NULL) || (b != NULL)) {
-            return false;
-        } else {
-            return true;
-        }
+        return true;
 
     default:
-        break;
+        return true;
     }
-
-    /* null, true or false */
-    return true;
 }
 
 /* non broken version of sbj_insert_item_in_array */
 static bool insert_item_in_array(sbJSON *array, size_t which, sbJSON *newitem) {
-    sbJSON *child = array->child;
-    while (child && (which > 0)) {
-        child = child->next;
-        which--;
-    }
-    if (which > 0) {
+    if (which > (size_t)sbj_get_array_size(array)) {
         /* item is after the end of the array */
         return 0;
     }
-    if (child == NULL) {
+    if (which == (size_t)sbj_get_array_size(array)) {
         sbj_add_item_to_array(array, newitem);
         return 1;
     }
 
-    /* insert into the linked list */
-    newitem->next = child;
-    newitem->prev = child->prev;
-    child->prev = newitem;
-
-    /* was it at the beginning */
-    if (child == array->child) {
-        array->child = newitem;
-    } else {
-        newitem->prev->next = newitem;
-    }
-
-    return 1;
+    return sbj_insert_item_in_array(array, (int)which, newitem);
 }
 
 static sbJSON *get_object_item(const sbJSON *const object, const char *name) {
@@ -631,32 +680,317 @@ static enum patch_operation decode_patch_operation(const sbJSON *const patch) {
     return INVALID;
 }
 
-/* overwrite and existing item with another one and free resources on the way */
-static void overwrite_item(sbJSON *const root, const sbJSON replacement) {
+/* JSON Patch implementation. */
+
+/* The items along the path of the last pointer an operation resolved, so that
+ * consecutive operations on the same part of the document only walk from
+ * where their paths diverge. */
+typedef struct patch_cursor {
+    /* tokens of the path, path[d] is the item after d of them */
+    const sbJSONUtils_CompiledPointer *pointer;
+    sbJSON **path;
+    size_t depth; /* entries of path after path[0] that are valid */
+    size_t capacity;
+    /* pointer of a finished operation, freed once pointer moves on */
+    sbJSONUtils_CompiledPointer *owned;
+} patch_cursor;
+
+enum undo_kind { UNDO_DETACH, UNDO_ATTACH, UNDO_ROOT };
+
+/* A change of an atomic apply that is reverted if a later operation fails */
+typedef struct patch_undo {
+    enum undo_kind kind;
+    sbJSON *parent;
+    sbJSON *item;
+    /* UNDO_DETACH: the member item was in front of */
+    sbJSON *next;
+    /* UNDO_DETACH: the key of item, a move gives it a new one */
+    char *string;
+    bool string_is_const;
+    /* UNDO_DETACH: item was attached again by a move, UNDO_ATTACH: item was
+     * created by the patch */
+    bool flag;
+    /* UNDO_ROOT: the overwritten root */
+    sbJSON saved;
+} patch_undo;
+
+typedef struct patch_state {
+    sbJSON *root;
+    patch_cursor cursor;
+    patch_undo *undo; /* NULL unless atomic */
+    size_t undo_count;
+} patch_state;
+
+static void cursor_free(patch_cursor *const cursor) {
+    if (cursor->path != NULL) {
+        sbJSON_free(cursor->path);
+    }
+    sbJSONUtils_FreeCompiledPointer(cursor->owned);
+}
+
+/* the item after depth tokens of pointer, walked without the cursor */
+static sbJSON *walk_pointer(sbJSON *item,
+                            const sbJSONUtils_CompiledPointer *const pointer,
+                            size_t const depth) {
+    size_t i = 0;
+
+    for (i = 0; (i < depth) && (item != NULL); i++) {
+        item = follow_token(item, &pointer->tokens[i]);
+    }
+
+    return item;
+}
+
+/* The item after depth tokens of pointer */
+static sbJSON *resolve(patch_state *const state,
+                       const sbJSONUtils_CompiledPointer *const pointer,
+                       size_t const depth) {
+    patch_cursor *const cursor = &state->cursor;
+
+    if (pointer != cursor->pointer) {
+        size_t shared = 0;
+
+        if (pointer->count >= cursor->capacity) {
+            sbJSON **const path = (sbJSON **)sbJSON_malloc(
+                (pointer->count + 1) * sizeof(sbJSON *));
+            if (path == NULL) {
+                return walk_pointer(state->root, pointer, depth);
+            }
+            if (cursor->path != NULL) {
+                memcpy(path, cursor->path,
+                       (cursor->depth + 1) * sizeof(sbJSON *));
+                sbJSON_free(cursor->path);
+            }
+            cursor->path = path;
+            cursor->capacity = pointer->count + 1;
+        }
+
+        while ((shared < cursor->depth) && (shared < pointer->count) &&
+               tokens_equal(&cursor->pointer->tokens[shared],
+                            &pointer->tokens[shared])) {
+            shared++;
+        }
+        cursor->depth = shared;
+        cursor->pointer = pointer;
+        if (cursor->owned != pointer) {
+            sbJSONUtils_FreeCompiledPointer(cursor->owned);
+            cursor->owned = NULL;
+        }
+    }
+
+    cursor->path[0] = state->root;
+    while (cursor->depth < depth) {
+        sbJSON *const next = follow_token(cursor->path[cursor->depth],
+                                          &pointer->tokens[cursor->depth]);
+        if (next == NULL) {
+            return NULL;
+        }
+        cursor->path[++cursor->depth] = next;
+    }
+
+    return cursor->path[depth];
+}
+
+/* The children of item changed, forget what was found below it */
+static void cursor_changed(patch_cursor *const cursor,
+                           const sbJSON *const item) {
+    size_t depth = 0;
+
+    for (depth = 0; (cursor->path != NULL) && (depth <= cursor->depth);
+         depth++) {
+        if (cursor->path[depth] == item) {
+            cursor->depth = depth;
+            return;
+        }
+    }
+}
+
+/* The member of parent named by the last token of pointer */
+static sbJSON *last_member(const sbJSON *const parent,
+                           const sbJSONUtils_CompiledPointer *const pointer) {
+    return (pointer->count == 0)
+               ? NULL
+               : follow_token(parent, &pointer->tokens[pointer->count - 1]);
+}
+
+static patch_undo *add_undo(patch_state *const state, enum undo_kind kind,
+                            sbJSON *const parent, sbJSON *const item) {
+    patch_undo *const undo = &state->undo[state->undo_count++];
+
+    undo->kind = kind;
+    undo->parent = parent;
+    undo->item = item;
+    undo->next = NULL;
+    undo->string = NULL;
+    undo->string_is_const = false;
+    undo->flag = false;
+
+    return undo;
+}
+
+/* Takes item out of parent. The caller owns it unless the apply is atomic,
+ * then it stays with the undo log until the patches succeeded. The log also
+ * keeps its key, adding a moved item to an object would free it. */
+static sbJSON *patch_detach(patch_state *const state, sbJSON *const parent,
+                            sbJSON *const item) {
+    if (state->undo != NULL) {
+        patch_undo *const undo = add_undo(state, UNDO_DETACH, parent, item);
+        undo->next = item->next;
+        undo->string = item->string;
+        undo->string_is_const = item->string_is_const;
+        item->string = NULL;
+        item->string_is_const = false;
+    }
+    cursor_changed(&state->cursor, parent);
+
+    return sbj_detach_item_via_pointer(parent, item);
+}
+
+/* Deletes a detached item, atomic applies only do that once they are done */
+static void patch_discard(const patch_state *const state, sbJSON *const item) {
+    if (state->undo == NULL) {
+        sbj_delete(item);
+    }
+}
+
+static void patch_attached(patch_state *const state, sbJSON *const parent,
+                           sbJSON *const item, bool const moved) {
+    if (state->undo != NULL) {
+        size_t i = state->undo_count;
+        add_undo(state, UNDO_ATTACH, parent, item)->flag = !moved;
+        while (moved && (i-- > 0)) {
+            if ((state->undo[i].kind == UNDO_DETACH) &&
+                (state->undo[i].item == item)) {
+                state->undo[i].flag = true;
+                break;
+            }
+        }
+    }
+    cursor_changed(&state->cursor, parent);
+}
+
+/* Frees what an item holds, leaving its struct in place */
+static void release_contents(sbJSON *const item) {
+    if (!item->string_is_const && (item->string != NULL)) {
+        sbJSON_free(item->string);
+    }
+    if (((item->type == sbJSON_String) || (item->type == sbJSON_Raw)) &&
+        !item->is_reference && (item->u.valuestring != NULL)) {
+        sbJSON_free(item->u.valuestring);
+    }
+    sbj_object_drop_index(item);
+    sbj_array_drop_index(item);
+    if (sbj_get_child(item) != NULL) {
+        sbj_delete(item->child);
+    }
+}
+
+/* overwrite the root with another item and free resources on the way */
+static void overwrite_item(patch_state *const state,
+                           const sbJSON replacement) {
+    sbJSON *const root = state->root;
+
     if (root == NULL) {
         return;
     }
 
-    if (root->string != NULL) {
-        sbJSON_free(root->string);
+    if (state->undo != NULL) {
+        add_undo(state, UNDO_ROOT, NULL, root)->saved = *root;
+    } else {
+        release_contents(root);
     }
-    if (root->u.valuestring != NULL) {
-        sbJSON_free(root->u.valuestring);
+    cursor_changed(&state->cursor, root);
+
+    memcpy(root, &replacement, sizeof(sbJSON));
+}
+
+/* Puts a member detached by patch_detach back in front of next, with the key
+ * it had there */
+static void reattach(patch_undo const *const undo) {
+    sbJSON *const parent = undo->parent;
+    sbJSON *const item = undo->item;
+    sbJSON *const next = undo->next;
+
+    /* the indexes would need the position of item */
+    sbj_object_drop_index(parent);
+    sbj_array_drop_index(parent);
+
+    if (!item->string_is_const && (item->string != NULL)) {
+        sbJSON_free(item->string);
     }
-    if (root->child != NULL) {
-        sbj_delete(root->child);
+    item->string = undo->string;
+    item->string_is_const = undo->string_is_const;
+
+    item->next = next;
+    if (next != NULL) {
+        item->prev = next->prev;
+        if (next == parent->child) {
+            parent->child = item;
+        } else {
+            next->prev->next = item;
+        }
+        next->prev = item;
+    } else if (parent->child == NULL) {
+        item->prev = item;
+        parent->child = item;
+    } else {
+        item->prev = parent->child->prev;
+        parent->child->prev->next = item;
+        parent->child->prev = item;
     }
+    parent->child_count++;
+}
 
-    memcpy(root, &replacement, sizeof(sbJSON));
+/* Finishes an atomic apply: keeps its changes or reverts all of them */
+static void finish_undo(patch_state *const state, bool const keep) {
+    size_t i = state->undo_count;
+
+    while (i-- > 0) {
+        patch_undo *const undo = &state->undo[i];
+
+        switch (undo->kind) {
+        case UNDO_DETACH:
+            if (!keep) {
+                reattach(undo);
+                break;
+            }
+            if (!undo->string_is_const && (undo->string != NULL)) {
+                sbJSON_free(undo->string);
+            }
+            if (!undo->flag) {
+                sbj_delete(undo->item);
+            }
+            break;
+
+        case UNDO_ATTACH:
+            if (!keep) {
+                sbj_detach_item_via_pointer(undo->parent, undo->item);
+                if (undo->flag) {
+                    sbj_delete(undo->item);
+                }
+            }
+            break;
+
+        case UNDO_ROOT:
+            if (keep) {
+                release_contents(&undo->saved);
+            } else {
+                release_contents(undo->item);
+                memcpy(undo->item, &undo->saved, sizeof(sbJSON));
+            }
+            break;
+        }
+    }
 }
 
-static int apply_patch(sbJSON *object, const sbJSON *patch) {
+static int apply_patch(patch_state *const state, const sbJSON *patch) {
     sbJSON *path = NULL;
     sbJSON *value = NULL;
     sbJSON *parent = NULL;
     enum patch_operation opcode = INVALID;
-    unsigned char *parent_pointer = NULL;
-    unsigned char *child_pointer = NULL;
+    sbJSONUtils_CompiledPointer *path_pointer = NULL;
+    sbJSONUtils_CompiledPointer *from_pointer = NULL;
+    bool moved = false;
     int status = 0;
 
     path = get_object_item(patch, "path");
@@ -670,21 +1004,29 @@ static int apply_patch(sbJSON *object, const sbJSON *patch) {
     if (opcode == INVALID) {
         status = 3;
         goto cleanup;
-    } else if (opcode == TEST) {
+    }
+
+    /* NULL for invalid paths, which then don't lead anywhere */
+    path_pointer = sbJSONUtils_CompilePointer(path->u.valuestring);
+
+    if (opcode == TEST) {
         /* compare value: {...} with the given path */
         status = !compare_json(
-            get_item_from_pointer(object, path->u.valuestring),
+            (path_pointer != NULL)
+                ? resolve(state, path_pointer, path_pointer->count)
+                : NULL,
             get_object_item(patch, "value"));
         goto cleanup;
     }
 
     /* special case for replacing the root */
-    if (path->u.valuestring[0] == '\0') {
+    if ((path_pointer != NULL) && (path_pointer->count == 0)) {
         if (opcode == REMOVE) {
             static const sbJSON invalid = {
-                NULL, NULL, NULL, sbJSON_Invalid, 0, 0, false, {0}, NULL};
+                NULL,  NULL,  NULL,  sbJSON_Invalid, 0, 0,   false, false,
+                false, false, false, false,          0, {0}, NULL};
 
-            overwrite_item(object, invalid);
+            overwrite_item(state, invalid);
 
             status = 0;
             goto cleanup;
@@ -705,18 +1047,18 @@ static int apply_patch(sbJSON *object, const sbJSON *patch) {
                 goto cleanup;
             }
 
-            overwrite_item(object, *value);
+            /* the string "value" isn't needed */
+            if (value->string != NULL) {
+                sbJSON_free(value->string);
+                value->string = NULL;
+            }
+
+            overwrite_item(state, *value);
 
             /* delete the duplicated value */
             sbJSON_free(value);
             value = NULL;
 
-            /* the string "value" isn't needed */
-            if (object->string != NULL) {
-                sbJSON_free(object->string);
-                object->string = NULL;
-            }
-
             status = 0;
             goto cleanup;
         }
@@ -724,13 +1066,16 @@ static int apply_patch(sbJSON *object, const sbJSON *patch) {
 
     if ((opcode == REMOVE) || (opcode == REPLACE)) {
         /* Get rid of old. */
-        sbJSON *old_item = detach_path(
-            object, (unsigned char *)path->u.valuestring);
+        sbJSON *old_item = NULL;
+        if ((path_pointer != NULL) && (path_pointer->count > 0)) {
+            parent = resolve(state, path_pointer, path_pointer->count - 1);
+            old_item = last_member(parent, path_pointer);
+        }
         if (old_item == NULL) {
             status = 13;
             goto cleanup;
         }
-        sbj_delete(old_item);
+        patch_discard(state, patch_detach(state, parent, old_item));
         if (opcode == REMOVE) {
             /* For Remove, this job is done. */
             status = 0;
@@ -741,17 +1086,24 @@ static int apply_patch(sbJSON *object, const sbJSON *patch) {
     /* Copy/Move uses "from". */
     if ((opcode == MOVE) || (opcode == COPY)) {
         sbJSON *from = get_object_item(patch, "from");
-        if (from == NULL) {
+        if (!sbj_is_string(from)) {
             /* missing "from" for copy/move. */
             status = 4;
             goto cleanup;
         }
 
-        if (opcode == MOVE) {
-            value = detach_path(object, (unsigned char *)from->u.valuestring);
+        from_pointer = sbJSONUtils_CompilePointer(from->u.valuestring);
+        if ((from_pointer != NULL) && (opcode == MOVE) &&
+            (from_pointer->count > 0)) {
+            parent = resolve(state, from_pointer, from_pointer->count - 1);
+            value = last_member(parent, from_pointer);
+            if (value != NULL) {
+                value = patch_detach(state, parent, value);
+                moved = true;
+            }
         }
-        if (opcode == COPY) {
-            value = get_item_from_pointer(object, from->u.valuestring);
+        if ((from_pointer != NULL) && (opcode == COPY)) {
+            value = resolve(state, from_pointer, from_pointer->count);
         }
         if (value == NULL) {
             /* missing "from" for copy/move. */
@@ -783,45 +1135,50 @@ static int apply_patch(sbJSON *object, const sbJSON *patch) {
     }
 
     /* Now, just add "value" to "path". */
-
-    /* split pointer in parent and child */
-    parent_pointer = sbJSONUtils_strdup((unsigned char *)path->u.valuestring);
-    if (parent_pointer) {
-        child_pointer = (unsigned char *)strrchr((char *)parent_pointer, '/');
+    parent = NULL;
+    if ((path_pointer != NULL) && (path_pointer->count > 0)) {
+        parent = resolve(state, path_pointer, path_pointer->count - 1);
     }
-    if (child_pointer != NULL) {
-        child_pointer[0] = '\0';
-        child_pointer++;
-    }
-    parent =
-        get_item_from_pointer(object, (char *)parent_pointer);
-    decode_pointer_inplace(child_pointer);
 
-    /* add, remove, replace, move, copy, test. */
-    if ((parent == NULL) || (child_pointer == NULL)) {
+    if (parent == NULL) {
         /* Couldn't find object to add to. */
         status = 9;
         goto cleanup;
     } else if (sbj_is_array(parent)) {
-        if (strcmp((char *)child_pointer, "-") == 0) {
-            sbj_add_item_to_array(parent, value);
-            value = NULL;
+        const pointer_token *const child =
+            &path_pointer->tokens[path_pointer->count - 1];
+        if (strcmp(child->name, "-") == 0) {
+            if (!sbj_add_item_to_array(parent, value)) {
+                status = 10;
+                goto cleanup;
+            }
         } else {
-            size_t index = 0;
-            if (!decode_array_index_from_pointer(child_pointer, &index)) {
+            if (!child->is_index) {
                 status = 11;
                 goto cleanup;
             }
 
-            if (!insert_item_in_array(parent, index, value)) {
+            if (!insert_item_in_array(parent, child->index, value)) {
                 status = 10;
                 goto cleanup;
             }
-            value = NULL;
         }
+        patch_attached(state, parent, value, moved);
+        value = NULL;
     } else if (sbj_is_object(parent)) {
-        sbj_delete_item_from_object(parent, (char *)child_pointer);
-        sbj_add_item_to_object(parent, (char *)child_pointer, value);
+        const pointer_token *const child =
+            &path_pointer->tokens[path_pointer->count - 1];
+        sbJSON *const existing =
+            sbj_get_object_item_hashed(parent, child->name, child->hash);
+        if (existing != NULL) {
+            patch_discard(state, patch_detach(state, parent, existing));
+        }
+        if (!sbj_add_item_to_object(parent, child->name, value)) {
+            /* out of memory for the name. */
+            status = 8;
+            goto cleanup;
+        }
+        patch_attached(state, parent, value, moved);
         value = NULL;
     } else /* parent is not an object */
     {
@@ -831,19 +1188,30 @@ static int apply_patch(sbJSON *object, const sbJSON *patch) {
     }
 
 cleanup:
-    if (value != NULL) {
+    /* a value moved by an atomic apply is still in the undo log */
+    if ((value != NULL) && !(moved && (state->undo != NULL))) {
         sbj_delete(value);
     }
-    if (parent_pointer != NULL) {
-        sbJSON_free(parent_pointer);
+    /* the cursor keeps the tokens of its path */
+    if ((path_pointer != NULL) && (path_pointer == state->cursor.pointer)) {
+        state->cursor.owned = path_pointer;
+    } else {
+        sbJSONUtils_FreeCompiledPointer(path_pointer);
+    }
+    if ((from_pointer != NULL) && (from_pointer == state->cursor.pointer)) {
+        state->cursor.owned = from_pointer;
+    } else {
+        sbJSONUtils_FreeCompiledPointer(from_pointer);
     }
 
     return status;
 }
 
-int sbJSONUtils_ApplyPatches(sbJSON *const object,
-                             const sbJSON *const patches) {
+static int apply_patches(sbJSON *const object, const sbJSON *const patches,
+                         bool const atomic) {
     const sbJSON *current_patch = NULL;
+    patch_state state;
+    size_t count = 0;
     int status = 0;
 
     if (!sbj_is_array(patches)) {
@@ -851,19 +1219,44 @@ int sbJSONUtils_ApplyPatches(sbJSON *const object,
         return 1;
     }
 
-    if (patches != NULL) {
-        current_patch = patches->child;
+    memset(&state, 0, sizeof(state));
+    state.root = object;
+    count = (size_t)sbj_get_array_size(patches);
+    if (atomic && (count > 0)) {
+        /* an operation detaches at most two items and attaches one */
+        state.undo =
+            (patch_undo *)sbJSON_malloc(count * 3 * sizeof(patch_undo));
+        if (state.undo == NULL) {
+            /* out of memory for the undo log. */
+            return 14;
+        }
     }
 
-    while (current_patch != NULL) {
-        status = apply_patch(object, current_patch);
+    for (current_patch = sbj_get_child(patches); current_patch != NULL;
+         current_patch = current_patch->next) {
+        status = apply_patch(&state, current_patch);
         if (status != 0) {
-            return status;
+            break;
         }
-        current_patch = current_patch->next;
     }
 
-    return 0;
+    if (state.undo != NULL) {
+        finish_undo(&state, status == 0);
+        sbJSON_free(state.undo);
+    }
+    cursor_free(&state.cursor);
+
+    return status;
+}
+
+int sbJSONUtils_ApplyPatches(sbJSON *const object,
+                             const sbJSON *const patches) {
+    return apply_patches(object, patches, false);
+}
+
+int sbJSONUtils_AtomicApplyPatches(sbJSON *const object,
+                                   const sbJSON *const patches) {
+    return apply_patches(object, patches, true);
 }
 
 static void compose_patch(sbJSON *const patches,
@@ -944,8 +1337,8 @@ static void create_patches(sbJSON *const patches,
 
     case sbJSON_Array: {
         size_t index = 0;
-        sbJSON *from_child = from->child;
-        sbJSON *to_child = to->child;
+        sbJSON *from_child = sbj_get_child(from);
+        sbJSON *to_child = sbj_get_child(to);
         unsigned char *new_path = (unsigned char *)sbJSON_malloc(
             strlen((const char *)path) + 20 +
             sizeof("/")); /* Allow space for 64bit int. log10(2^64) = 20 */
@@ -998,8 +1391,8 @@ static void create_patches(sbJSON *const patches,
         sort_object(from);
         sort_object(to);
 
-        from_child = from->child;
-        to_child = to->child;
+        from_child = sbj_get_child(from);
+        to_child = sbj_get_child(to);
         /* for all object values in the object with more of them */
         while ((from_child != NULL) || (to_child != NULL)) {
             int diff;
@@ -1065,6 +1458,395 @@ sbJSON *sbJSONUtils_GeneratePatches(sbJSON *const from, sbJSON *const to) {
     return patches;
 }
 
+/* Patch generation that leaves both documents alone, see sbJSONUtils_Diff */
+
+/* path joined with an array index, NULL on allocation failure */
+static unsigned char *index_path(const unsigned char *const path,
+                                 size_t const index) {
+    /* Allow space for 64bit int. log10(2^64) = 20 */
+    unsigned char *const new_path = (unsigned char *)sbJSON_malloc(
+        strlen((const char *)path) + 20 + sizeof("/"));
+    if (new_path != NULL) {
+        sprintf((char *)new_path, "%s/%lu", (const char *)path,
+                (unsigned long)index);
+    }
+
+    return new_path;
+}
+
+/* the index as a path suffix for compose_patch */
+static void index_suffix(unsigned char suffix[21], size_t const index) {
+    sprintf((char *)suffix, "%lu", (unsigned long)index);
+}
+
+static void diff_values(sbJSON *const patches, const unsigned char *const path,
+                        const sbJSON *const from, const sbJSON *const to);
+
+static void diff_objects(sbJSON *const patches,
+                         const unsigned char *const path,
+                         const sbJSON *const from, const sbJSON *const to) {
+    size_t const path_length = strlen((const char *)path);
+    const sbJSON *member = NULL;
+
+    for (member = sbj_get_child(from); member != NULL; member = member->next) {
+        const sbJSON *const other = get_object_item(to, member->string);
+        unsigned char *new_path = NULL;
+
+        if (other == NULL) {
+            /* object element doesn't exist in 'to' --> remove it */
+            compose_patch(patches, (const unsigned char *)"remove", path,
+                          (unsigned char *)member->string, NULL);
+            continue;
+        }
+
+        new_path = (unsigned char *)sbJSON_malloc(
+            path_length +
+            pointer_encoded_length((unsigned char *)member->string) +
+            sizeof("/"));
+        if (new_path == NULL) {
+            return;
+        }
+        sprintf((char *)new_path, "%s/", path);
+        encode_string_as_pointer(new_path + path_length + 1,
+                                 (unsigned char *)member->string);
+        diff_values(patches, new_path, member, other);
+        sbJSON_free(new_path);
+    }
+
+    for (member = sbj_get_child(to); member != NULL; member = member->next) {
+        if (get_object_item(from, member->string) == NULL) {
+            /* object element doesn't exist in 'from' --> add it */
+            compose_patch(patches, (const unsigned char *)"add", path,
+                          (unsigned char *)member->string, member);
+        }
+    }
+}
+
+/* The elements of an array with their hashes */
+typedef struct diff_side {
+    const sbJSON **items;
+    uint64_t *hashes;
+    size_t count;
+} diff_side;
+
+static bool load_diff_side(diff_side *const side, const sbJSON *const array) {
+    const sbJSON *child = NULL;
+    size_t count = 0;
+
+    side->count = (size_t)sbj_get_array_size(array);
+    side->items = (const sbJSON **)sbJSON_malloc(
+        (side->count + 1) * sizeof(const sbJSON *));
+    side->hashes =
+        (uint64_t *)sbJSON_malloc((side->count + 1) * sizeof(uint64_t));
+    if ((side->items == NULL) || (side->hashes == NULL)) {
+        return false;
+    }
+
+    for (child = sbj_get_child(array);
+         (child != NULL) && (count < side->count); child = child->next) {
+        side->items[count] = child;
+        side->hashes[count] = sbj_hash(child);
+        count++;
+    }
+    side->count = count;
+
+    return true;
+}
+
+static void free_diff_side(diff_side *const side) {
+    if (side->items != NULL) {
+        sbJSON_free(side->items);
+    }
+    if (side->hashes != NULL) {
+        sbJSON_free(side->hashes);
+    }
+}
+
+static bool same_element(const diff_side *const a, size_t const i,
+                         const diff_side *const b, size_t const j) {
+    return (a->hashes[i] == b->hashes[j]) &&
+           compare_json(a->items[i], b->items[j]);
+}
+
+/* Steps of an edit script from one array to the other */
+typedef enum { keep_element, remove_element, add_element } diff_operation;
+
+typedef struct diff_step {
+    diff_operation operation;
+    size_t from; /* element of the first array for keep and remove */
+    size_t to;   /* element of the second array for keep and add */
+} diff_step;
+
+/* beyond this many additions and removals the arrays are compared by
+ * position, Myers' algorithm takes quadratic memory in it */
+#define diff_max_edits 512
+
+/* Fills steps (room for n + m of them) with a shortest edit script from
+ * a[start, start + n) to b[start, start + m) following Myers' O(ND) greedy
+ * algorithm. Returns the number of steps, 0 if it takes more than
+ * diff_max_edits edits or memory. */
+static size_t shortest_edit_script(const diff_side *const a,
+                                   const diff_side *const b,
+                                   size_t const start, size_t const n,
+                                   size_t const m, diff_step *const steps) {
+    ptrdiff_t const max_edits =
+        (ptrdiff_t)((n + m < diff_max_edits) ? n + m : diff_max_edits);
+    ptrdiff_t const offset = max_edits + 1;
+    /* v[offset + k] is the furthest x reached on diagonal k = x - y */
+    ptrdiff_t *v = NULL;
+    /* v of the start of each d, d * d + 2 * d entries before that of d */
+    ptrdiff_t *trace = NULL;
+    ptrdiff_t d = 0;
+    ptrdiff_t k = 0;
+    ptrdiff_t x = 0;
+    ptrdiff_t y = 0;
+    size_t count = 0;
+    size_t i = 0;
+    bool found = false;
+
+    v = (ptrdiff_t *)sbJSON_malloc((size_t)(2 * offset + 1) *
+                                   sizeof(ptrdiff_t));
+    trace = (ptrdiff_t *)sbJSON_malloc((size_t)((max_edits + 1) *
+                                                (max_edits + 3)) *
+                                       sizeof(ptrdiff_t));
+    if ((v == NULL) || (trace == NULL)) {
+        goto cleanup;
+    }
+    memset(v, '\0', (size_t)(2 * offset + 1) * sizeof(ptrdiff_t));
+
+    for (d = 0; (d <= max_edits) && !found; d++) {
+        memcpy(&trace[d * d + 2 * d], &v[offset - d - 1],
+               (size_t)(2 * d + 3) * sizeof(ptrdiff_t));
+        for (k = -d; k <= d; k += 2) {
+            if ((k == -d) || ((k != d) && (v[offset + k - 1] <
+                                           v[offset + k + 1]))) {
+                x = v[offset + k + 1]; /* an addition */
+            } else {
+                x = v[offset + k - 1] + 1; /* a removal */
+            }
+            y = x - k;
+            while ((x < (ptrdiff_t)n) && (y < (ptrdiff_t)m) &&
+                   same_element(a, start + (size_t)x, b, start + (size_t)y)) {
+                x++;
+                y++;
+            }
+            v[offset + k] = x;
+            if ((x >= (ptrdiff_t)n) && (y >= (ptrdiff_t)m)) {
+                found = true;
+                break;
+            }
+        }
+    }
+    if (!found) {
+        goto cleanup;
+    }
+
+    /* walk back from the end, the steps come out in reverse */
+    x = (ptrdiff_t)n;
+    y = (ptrdiff_t)m;
+    for (d = d - 1; d >= 0; d--) {
+        ptrdiff_t const *const previous_v = &trace[d * d + 2 * d] + d + 1;
+        ptrdiff_t previous_k = 0;
+        ptrdiff_t previous_x = 0;
+        ptrdiff_t previous_y = 0;
+
+        k = x - y;
+        if ((k == -d) ||
+            ((k != d) && (previous_v[k - 1] < previous_v[k + 1]))) {
+            previous_k = k + 1;
+        } else {
+            previous_k = k - 1;
+        }
+        previous_x = previous_v[previous_k];
+        previous_y = previous_x - previous_k;
+
+        while ((x > previous_x) && (y > previous_y) && (x > 0) && (y > 0)) {
+            x--;
+            y--;
+            steps[count].operation = keep_element;
+            steps[count].from = start + (size_t)x;
+            steps[count].to = start + (size_t)y;
+            count++;
+        }
+        if (d > 0) {
+            if (x == previous_x) {
+                steps[count].operation = add_element;
+                steps[count].to = start + (size_t)previous_y;
+            } else {
+                steps[count].operation = remove_element;
+                steps[count].from = start + (size_t)previous_x;
+            }
+            count++;
+        }
+        x = previous_x;
+        y = previous_y;
+    }
+
+    for (i = 0; i < count / 2; i++) {
+        diff_step const step = steps[i];
+        steps[i] = steps[count - 1 - i];
+        steps[count - 1 - i] = step;
+    }
+
+cleanup:
+    if (v != NULL) {
+        sbJSON_free(v);
+    }
+    if (trace != NULL) {
+        sbJSON_free(trace);
+    }
+
+    return count;
+}
+
+static void diff_arrays(sbJSON *const patches, const unsigned char *const path,
+                        const sbJSON *const from, const sbJSON *const to) {
+    diff_side a = {NULL, NULL, 0};
+    diff_side b = {NULL, NULL, 0};
+    diff_step *steps = NULL;
+    size_t prefix = 0;
+    size_t n = 0;
+    size_t m = 0;
+    size_t step_count = 0;
+    size_t position = 0; /* of the next element in the patched array */
+    size_t i = 0;
+
+    if (!load_diff_side(&a, from) || !load_diff_side(&b, to)) {
+        goto cleanup;
+    }
+
+    /* identical elements at either end need no edit script */
+    while ((prefix < a.count) && (prefix < b.count) &&
+           same_element(&a, prefix, &b, prefix)) {
+        prefix++;
+    }
+    n = a.count - prefix;
+    m = b.count - prefix;
+    while ((n > 0) && (m > 0) &&
+           same_element(&a, prefix + n - 1, &b, prefix + m - 1)) {
+        n--;
+        m--;
+    }
+
+    steps = (diff_step *)sbJSON_malloc((n + m + 1) * sizeof(diff_step));
+    if (steps == NULL) {
+        goto cleanup;
+    }
+    step_count = shortest_edit_script(&a, &b, prefix, n, m, steps);
+    if ((step_count == 0) && (n + m > 0)) {
+        /* too different, remove everything and let the pairing below
+         * compare the elements by position */
+        for (i = 0; i < n; i++) {
+            steps[step_count].operation = remove_element;
+            steps[step_count].from = prefix + i;
+            step_count++;
+        }
+        for (i = 0; i < m; i++) {
+            steps[step_count].operation = add_element;
+            steps[step_count].to = prefix + i;
+            step_count++;
+        }
+    }
+
+    position = prefix;
+    i = 0;
+    while (i < step_count) {
+        size_t removals = 0;
+        size_t additions = 0;
+        size_t run_end = i;
+        size_t removed = i;
+        size_t added = i;
+        unsigned char suffix[21];
+
+        if (steps[i].operation == keep_element) {
+            position++;
+            i++;
+            continue;
+        }
+
+        while ((run_end < step_count) &&
+               (steps[run_end].operation != keep_element)) {
+            if (steps[run_end].operation == remove_element) {
+                removals++;
+            } else {
+                additions++;
+            }
+            run_end++;
+        }
+
+        /* an element replaced by another one becomes a patch of it */
+        for (; (removals > 0) && (additions > 0); removals--, additions--) {
+            unsigned char *new_path = NULL;
+
+            while (steps[removed].operation != remove_element) {
+                removed++;
+            }
+            while (steps[added].operation != add_element) {
+                added++;
+            }
+            new_path = index_path(path, position);
+            if (new_path == NULL) {
+                goto cleanup;
+            }
+            diff_values(patches, new_path, a.items[steps[removed].from],
+                        b.items[steps[added].to]);
+            sbJSON_free(new_path);
+            removed++;
+            added++;
+            position++;
+        }
+        for (; removals > 0; removals--) {
+            index_suffix(suffix, position);
+            compose_patch(patches, (const unsigned char *)"remove", path,
+                          suffix, NULL);
+        }
+        for (; additions > 0; additions--) {
+            while (steps[added].operation != add_element) {
+                added++;
+            }
+            index_suffix(suffix, position);
+            compose_patch(patches, (const unsigned char *)"add", path, suffix,
+                          b.items[steps[added].to]);
+            added++;
+            position++;
+        }
+
+        i = run_end;
+    }
+
+cleanup:
+    free_diff_side(&a);
+    free_diff_side(&b);
+    if (steps != NULL) {
+        sbJSON_free(steps);
+    }
+}
+
+static void diff_values(sbJSON *const patches, const unsigned char *const path,
+                        const sbJSON *const from, const sbJSON *const to) {
+    if ((from->type == to->type) && (from->type == sbJSON_Array)) {
+        diff_arrays(patches, path, from, to);
+    } else if ((from->type == to->type) && (from->type == sbJSON_Object)) {
+        diff_objects(patches, path, from, to);
+    } else if (!compare_json(from, to)) {
+        compose_patch(patches, (const unsigned char *)"replace", path, NULL,
+                      to);
+    }
+}
+
+sbJSON *sbJSONUtils_Diff(const sbJSON *const from, const sbJSON *const to) {
+    sbJSON *patches = NULL;
+
+    if ((from == NULL) || (to == NULL)) {
+        return NULL;
+    }
+
+    patches = sbj_create_array();
+    diff_values(patches, (const unsigned char *)"", from, to);
+
+    return patches;
+}
+
 void sbJSONUtils_SortObject(sbJSON *const object) {
     sort_object(object);
 }
@@ -1083,7 +1865,7 @@ static sbJSON *merge_patch(sbJSON *target, const sbJSON *const patch) {
         target = sbj_create_object();
     }
 
-    patch_child = patch->child;
+    patch_child = sbj_get_child(patch);
     while (patch_child != NULL) {
         if (sbj_is_null(patch_child)) {
             /* NULL is the indicator to remove a value, see RFC7396 */
@@ -1112,6 +1894,67 @@ sbJSON *sbJSONUtils_MergePatch(sbJSON *target, const sbJSON *const patch) {
     return merge_patch(target, patch);
 }
 
+/* What is left of a patch object merged into something that isn't an object:
+ * the patch without its nulls */
+static void remove_nulls(sbJSON *const object) {
+    sbJSON *child = sbj_get_child(object);
+
+    while (child != NULL) {
+        sbJSON *const next = child->next;
+        if (sbj_is_null(child)) {
+            sbj_delete(sbj_detach_item_via_pointer(object, child));
+        } else if (sbj_is_object(child)) {
+            remove_nulls(child);
+        }
+        child = next;
+    }
+}
+
+/* merge_patch, but the members of patch are moved into target instead of
+ * being copied, and patch is deleted */
+static sbJSON *merge_patch_consume(sbJSON *target, sbJSON *const patch) {
+    sbJSON *patch_child = NULL;
+
+    if (!sbj_is_object(patch)) {
+        /* scalar value, array or NULL, it replaces target as it is */
+        sbj_delete(target);
+        return patch;
+    }
+
+    if (!sbj_is_object(target)) {
+        sbj_delete(target);
+        remove_nulls(patch);
+        return patch;
+    }
+
+    /* large targets are looked up through their index, which the lookups
+     * build on their own and the detaches and appends below keep current */
+    while ((patch_child = sbj_get_child(patch)) != NULL) {
+        sbJSON *replacement = NULL;
+
+        sbj_detach_item_via_pointer(patch, patch_child);
+        if (sbj_is_null(patch_child)) {
+            /* NULL is the indicator to remove a value, see RFC7396 */
+            sbj_delete_item_from_object(target, patch_child->string);
+            sbj_delete(patch_child);
+            continue;
+        }
+
+        /* either patch_child or the member of target, both have the name */
+        replacement = merge_patch_consume(
+            sbj_detach_item_from_object(target, patch_child->string),
+            patch_child);
+        sbj_add_item_to_array(target, replacement);
+    }
+
+    sbj_delete(patch);
+    return target;
+}
+
+sbJSON *sbJSONUtils_MergePatchConsume(sbJSON *target, sbJSON *const patch) {
+    return merge_patch_consume(target, patch);
+}
+
 static sbJSON *generate_merge_patch(sbJSON *const from, sbJSON *const to) {
     sbJSON *from_child = NULL;
     sbJSON *to_child = NULL;
@@ -1127,8 +1970,8 @@ static sbJSON *generate_merge_patch(sbJSON *const from, sbJSON *const to) {
     sort_object(from);
     sort_object(to);
 
-    from_child = from->child;
-    to_child = to->child;
+    from_child = sbj_get_child(from);
+    to_child = sbj_get_child(to);
     patch = sbj_create_object();
     if (patch == NULL) {
         return NULL;
@@ -33,43 +33,54 @@ extern "C" {
 /* Implement RFC6901 (https://tools.ietf.org/html/rfc6901) JSON Pointer spec. */
 sbJSON *sbJSONUtils_GetPointer(sbJSON *const object, const char *pointer);
 
+/* A JSON pointer decoded once for repeated lookups: its ~0 and ~1 escapes,
+ * array indices and member name hashes are worked out up front. */
+typedef struct sbJSONUtils_CompiledPointer sbJSONUtils_CompiledPointer;
+/* NULL if pointer isn't "" or a path starting with '/', has invalid escape
+ * sequences, or on allocation failure. */
+sbJSONUtils_CompiledPointer *sbJSONUtils_CompilePointer(const char *pointer);
+void sbJSONUtils_FreeCompiledPointer(sbJSONUtils_CompiledPointer *pointer);
+/* Same result as sbJSONUtils_GetPointer with the uncompiled pointer. */
+sbJSON *sbJSONUtils_EvalPointer(const sbJSONUtils_CompiledPointer *pointer,
+                                sbJSON *const object);
+/* Evaluates count pointers in one walk of object, results[i] is the item of
+ * pointers[i] or NULL. The walk to a common prefix of consecutive pointers is
+ * shared, so pass pointers sorted, or at least grouped by prefix. */
+void sbJSONUtils_EvalPointers(
+    const sbJSONUtils_CompiledPointer *const *const pointers, size_t count,
+    sbJSON *const object, sbJSON **const results);
+
 /* Implement RFC6902 (https://tools.ietf.org/html/rfc6902) JSON Patch spec. */
 /* NOTE: This modifies objects in 'from' and 'to' by sorting the elements by
  * their key */
 sbJSON *sbJSONUtils_GeneratePatches(sbJSON *const from, sbJSON *const to);
+/* Generates the same kind of patches without modifying from and to. Array
+ * elements are matched up with a shortest edit script, so inserting near the
+ * front of an array is an "add" instead of a patch for every later element. */
+sbJSON *sbJSONUtils_Diff(const sbJSON *const from, const sbJSON *const to);
 /* Utility for generating patch array entries. */
 void sbJSONUtils_AddPatchToArray(sbJSON *const array, const char *const operation,
                                 const char *const path,
                                 const sbJSON *const value);
-/* Returns 0 for success. */
+/* Returns 0 for success. Consecutive operations on the same part of the
+ * document share the walk to it, so patches grouped by path apply fastest.
+ * NOT atomic: the operations before a failing one stay applied. */
 int sbJSONUtils_ApplyPatches(sbJSON *const object, const sbJSON *const patches);
-
-/*
-// Note that ApplyPatches is NOT atomic on failure. To implement an atomic
-ApplyPatches, use:
-//int sbJSONUtils_AtomicApplyPatches(sbJSON **object, sbJSON *patches)
-//{
-//    sbJSON *modme = sbj_duplicate(*object, 1);
-//    int error = sbJSONUtils_ApplyPatches(modme, patches);
-//    if (!error)
-//    {
-//        sbj_delete(*object);
-//        *object = modme;
-//    }
-//    else
-//    {
-//        sbj_delete(modme);
-//    }
-//
-//    return error;
-//}
-// Code not added to library since this strategy is a LOT slower.
-*/
+/* Same as sbJSONUtils_ApplyPatches, but if an operation fails, object is
+ * restored to the state before the first one. Removed items are kept for that
+ * until all operations succeeded instead of copying the document up front. */
+int sbJSONUtils_AtomicApplyPatches(sbJSON *const object,
+                                   const sbJSON *const patches);
 
 /* Implement RFC7386 (https://tools.ietf.org/html/rfc7396) JSON Merge Patch
  * spec. */
 /* target will be modified by patch. return value is new ptr for target. */
 sbJSON *sbJSONUtils_MergePatch(sbJSON *target, const sbJSON *const patch);
+/* Same result as sbJSONUtils_MergePatch, but takes ownership of patch: its
+ * values are moved into target instead of being copied and the rest of it is
+ * deleted, so nothing is allocated. patch can't be used afterwards and must
+ * not live in an sbj_arena. */
+sbJSON *sbJSONUtils_MergePatchConsume(sbJSON *target, sbJSON *const patch);
 /* generates a patch to move from -> to */
 /* NOTE: This modifies objects in 'from' and 'to' by sorting the elements by
  * their key */
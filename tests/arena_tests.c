@@ -0,0 +1,227 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static const char *const test_files[] = {
+    "inputs/test1", "inputs/test2", "inputs/test3", "inputs/test4",
+    "inputs/test5", "inputs/test6", "inputs/test7", "inputs/test8",
+    "inputs/test9", "inputs/test10", "inputs/test11"};
+
+static void arena_parse_should_match_regular_parse(void) {
+    sbj_arena *arena = sbj_arena_new(0);
+    size_t i = 0;
+
+    TEST_ASSERT_NOT_NULL(arena);
+
+    for (i = 0; i < sizeof(test_files) / sizeof(test_files[0]); i++) {
+        char *json = read_file(test_files[i]);
+        sbJSON *expected = NULL;
+        sbJSON *actual = NULL;
+        char *expected_printed = NULL;
+        char *actual_printed = NULL;
+
+        TEST_ASSERT_NOT_NULL_MESSAGE(json, "Failed to read test file.");
+        expected = sbj_parse(json);
+        actual = sbj_parse_into_arena(arena, json, strlen(json) + sizeof(""));
+
+        if (expected == NULL) {
+            TEST_ASSERT_NULL(actual);
+            free(json);
+            continue;
+        }
+
+        TEST_ASSERT_NOT_NULL(actual);
+        TEST_ASSERT_TRUE(actual->is_arena_owned);
+        TEST_ASSERT_TRUE(sbj_compare(expected, actual));
+
+        expected_printed = sbj_print(expected);
+        actual_printed = sbj_print(actual);
+        TEST_ASSERT_EQUAL_STRING(expected_printed, actual_printed);
+
+        free(expected_printed);
+        free(actual_printed);
+        sbj_delete(expected);
+        free(json);
+        sbj_arena_reset(arena);
+    }
+
+    sbj_arena_free(arena);
+}
+
+static void arena_parse_should_use_small_blocks_and_oversized_strings(void) {
+    char json[4096];
+    sbj_arena *arena = sbj_arena_new(64);
+    sbJSON *root = NULL;
+    size_t i = 0;
+
+    /* one string that doesn't fit into a block and many small values */
+    strcpy(json, "{\"long\": \"");
+    for (i = 0; i < 1000; i++) {
+        strcat(json, "x");
+    }
+    strcat(json, "\", \"list\": [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, \"a\", \"b\"]}");
+
+    root = sbj_parse_into_arena(arena, json, strlen(json) + sizeof(""));
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_EQUAL_size_t(1000, strlen(sbj_get_string_value(
+                                       sbj_get_object_item(root, "long"))));
+    TEST_ASSERT_EQUAL_INT(12,
+                          sbj_get_array_size(sbj_get_object_item(root, "list")));
+
+    sbj_arena_free(arena);
+}
+
+static size_t allocations = 0;
+
+static void *counting_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+static void arena_should_keep_its_block_for_small_requests(void) {
+    sbJSON_Hooks hooks = {counting_malloc, free};
+    char json[4096];
+    sbj_arena *arena = NULL;
+    size_t i = 0;
+
+    sbJSON_InitHooks(&hooks);
+    arena = sbj_arena_new(1024);
+    TEST_ASSERT_NOT_NULL(arena);
+
+    /* small values around a string that doesn't fit into a block */
+    strcpy(json, "[\"a\", \"");
+    for (i = 0; i < 2000; i++) {
+        strcat(json, "x");
+    }
+    strcat(json, "\", \"b\", \"c\"]");
+
+    allocations = 0;
+    TEST_ASSERT_NOT_NULL(
+        sbj_parse_into_arena(arena, json, strlen(json) + sizeof("")));
+    /* one block for the small ones, one for the string */
+    TEST_ASSERT_EQUAL_size_t(2, allocations);
+
+    /* the largest block is kept and takes the small values */
+    sbj_arena_reset(arena);
+    allocations = 0;
+    TEST_ASSERT_NOT_NULL(sbj_parse_into_arena(arena, "[\"a\", \"b\", \"c\"]",
+                                              sizeof("[\"a\", \"b\", \"c\"]")));
+    TEST_ASSERT_EQUAL_size_t(0, allocations);
+
+    sbj_arena_free(arena);
+    sbJSON_InitHooks(NULL);
+}
+
+static void arena_parse_should_fail_on_invalid_json(void) {
+    sbj_arena *arena = sbj_arena_new(0);
+    const char json[] = "{\"one\": [1, 2, }";
+
+    TEST_ASSERT_NULL(sbj_parse_into_arena(arena, json, sizeof(json)));
+    TEST_ASSERT_NULL(sbj_parse_into_arena(NULL, json, sizeof(json)));
+    TEST_ASSERT_EQUAL_PTR(json + 15, sbJSON_GetErrorPtr());
+
+    sbj_arena_free(arena);
+}
+
+static void arena_trees_should_support_mutation(void) {
+    const char json[] =
+        "{\"keep\": \"short\", \"drop\": [1, 2, 3], \"swap\": {\"a\": true}}";
+    sbj_arena *arena = sbj_arena_new(0);
+    sbJSON *root = sbj_parse_into_arena(arena, json, sizeof(json));
+    sbJSON *keep = NULL;
+    sbJSON *duplicate = NULL;
+    char *printed = NULL;
+
+    TEST_ASSERT_NOT_NULL(root);
+
+    /* arena strings are copied to the heap on write */
+    keep = sbj_get_object_item(root, "keep");
+    TEST_ASSERT_NOT_NULL(sbj_set_valuestring(keep, "a longer heap string"));
+    TEST_ASSERT_FALSE(keep->is_reference);
+    TEST_ASSERT_NOT_NULL(sbj_set_valuestring(keep, "shorter"));
+
+    /* deleting and replacing arena items doesn't free arena memory */
+    sbj_delete_item_from_object(root, "drop");
+    TEST_ASSERT_TRUE(sbj_replace_item_in_object(root, "swap",
+                                                sbj_create_integer_number(7)));
+    TEST_ASSERT_NOT_NULL(sbj_add_string_to_object(root, "heap", "value"));
+
+    printed = sbj_print_unformatted(root);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"keep\":\"shorter\",\"swap\":7,\"heap\":\"value\"}", printed);
+    free(printed);
+
+    /* duplicates don't reference arena memory */
+    duplicate = sbj_duplicate(root, true);
+    TEST_ASSERT_NOT_NULL(duplicate);
+    TEST_ASSERT_FALSE(duplicate->is_arena_owned);
+    TEST_ASSERT_FALSE(duplicate->child->string_is_const);
+
+    /* free the heap parts, then the arena */
+    sbj_delete(root);
+    sbj_arena_free(arena);
+
+    printed = sbj_print_unformatted(duplicate);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"keep\":\"shorter\",\"swap\":7,\"heap\":\"value\"}", printed);
+    free(printed);
+    sbj_delete(duplicate);
+}
+
+static void arena_reset_should_allow_reuse(void) {
+    const char json[] = "[\"reuse\", {\"key\": \"value\"}]";
+    sbj_arena *arena = sbj_arena_new(32);
+    size_t i = 0;
+
+    for (i = 0; i < 100; i++) {
+        sbJSON *root = sbj_parse_into_arena(arena, json, sizeof(json));
+        TEST_ASSERT_NOT_NULL(root);
+        TEST_ASSERT_EQUAL_STRING(
+            "value", sbj_get_string_value(sbj_get_object_item(
+                         sbj_get_array_item(root, 1), "key")));
+        sbj_arena_reset(arena);
+    }
+
+    sbj_arena_reset(NULL);
+    sbj_arena_free(NULL);
+    sbj_arena_free(arena);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(arena_parse_should_match_regular_parse);
+    RUN_TEST(arena_parse_should_use_small_blocks_and_oversized_strings);
+    RUN_TEST(arena_should_keep_its_block_for_small_requests);
+    RUN_TEST(arena_parse_should_fail_on_invalid_json);
+    RUN_TEST(arena_trees_should_support_mutation);
+    RUN_TEST(arena_reset_should_allow_reuse);
+
+    return UNITY_END();
+}
@@ -0,0 +1,203 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+/* child_count and indexed access agree with the linked list */
+static void assert_consistent(sbJSON const *item) {
+    sbJSON const *child = NULL;
+    int32_t length = 0;
+
+    for (child = item->child; child != NULL; child = child->next) {
+        TEST_ASSERT_EQUAL_PTR(child, sbj_get_array_item(item, length));
+        length++;
+        if ((child->type == sbJSON_Array) || (child->type == sbJSON_Object)) {
+            assert_consistent(child);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT32(length, item->child_count);
+    TEST_ASSERT_NULL(sbj_get_array_item(item, length));
+}
+
+static sbJSON *create_numbers(int count) {
+    sbJSON *array = sbj_create_array();
+    int i;
+
+    for (i = 0; i < count; i++) {
+        sbj_add_item_to_array(array, sbj_create_integer_number(i));
+    }
+
+    return array;
+}
+
+static void parsers_should_count_children(void) {
+    const char json[] = "{\"a\": [1, 2, [3, 4, 5], {}], \"b\": {\"c\": null, "
+                        "\"d\": []}, \"e\": \"f\"}";
+    sbj_arena *arena = sbj_arena_new(0);
+    sbJSON *parsed = NULL;
+
+    parsed = sbj_parse(json);
+    TEST_ASSERT_EQUAL_INT32(3, sbj_item_count(parsed));
+    TEST_ASSERT_EQUAL_INT32(4, sbj_item_count(parsed->child));
+    TEST_ASSERT_EQUAL_INT32(0, sbj_item_count(parsed->child->prev));
+    assert_consistent(parsed);
+    sbj_delete(parsed);
+
+    parsed = sbj_parse_fast(json, sizeof(json));
+    assert_consistent(parsed);
+    sbj_delete(parsed);
+
+    parsed = sbj_parse_into_arena(arena, json, sizeof(json));
+    assert_consistent(parsed);
+    sbj_arena_free(arena);
+
+    TEST_ASSERT_EQUAL_INT32(0, sbj_item_count(NULL));
+}
+
+static void mutations_should_keep_child_count(void) {
+    int const numbers[] = {1, 2, 3, 4, 5};
+    sbJSON *array = sbj_create_int_array(numbers, 5);
+    sbJSON *object = sbj_create_object();
+    sbJSON *copy = NULL;
+    sbJSON *reference = NULL;
+
+    TEST_ASSERT_EQUAL_INT(5, sbj_get_array_size(array));
+    sbj_insert_item_in_array(array, 0, sbj_create_null());
+    sbj_insert_item_in_array(array, 100, sbj_create_null());
+    sbj_delete_item_from_array(array, 3);
+    sbj_replace_item_in_array(array, 1, sbj_create_bool(true));
+    TEST_ASSERT_EQUAL_INT(6, sbj_get_array_size(array));
+    assert_consistent(array);
+
+    sbj_add_item_to_object(object, "array", array);
+    sbj_add_null_to_object(object, "null");
+    sbj_add_item_reference_to_object(object, "reference", array);
+    sbj_delete_item_from_object(object, "null");
+    TEST_ASSERT_EQUAL_INT32(2, sbj_item_count(object));
+    assert_consistent(object);
+
+    copy = sbj_duplicate(object, true);
+    assert_consistent(copy);
+    reference = sbj_duplicate(array, false);
+    TEST_ASSERT_EQUAL_INT32(0, sbj_item_count(reference));
+    sbj_delete(reference);
+
+    reference = sbj_create_array_reference(array->child);
+    TEST_ASSERT_EQUAL_INT32(6, sbj_item_count(reference));
+
+    sbj_delete(reference);
+    sbj_delete(copy);
+    sbj_delete(object);
+}
+
+static void get_items_should_fill_the_buffer(void) {
+    sbJSON *array = create_numbers(100);
+    sbJSON const *items[100];
+    int i;
+
+    sbj_get_items(array, items);
+    for (i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL_INT64(i, items[i]->u.valueint);
+    }
+
+    memset(items, 0, sizeof(items));
+    TEST_ASSERT_TRUE(sbj_array_build_index(array));
+    sbj_get_items(array, items);
+    for (i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL_INT64(i, items[i]->u.valueint);
+    }
+
+    sbj_delete(array);
+}
+
+static void vector_should_follow_mutations(void) {
+    sbJSON *array = create_numbers(1000);
+    int i;
+
+    /* accesses near the front don't need one */
+    TEST_ASSERT_NOT_NULL(sbj_get_array_item(array, 10));
+    TEST_ASSERT_NULL(array->u.vector);
+
+    TEST_ASSERT_EQUAL_INT64(500, sbj_get_array_item(array, 500)->u.valueint);
+    TEST_ASSERT_NOT_NULL(array->u.vector);
+
+    for (i = 0; i < 100; i++) {
+        sbj_insert_item_in_array(array, i * 7, sbj_create_integer_number(-i));
+        sbj_delete_item_from_array(array, 1000 - i * 3);
+        sbj_add_item_to_array(array, sbj_create_null());
+        sbj_replace_item_in_array(array, i * 5, sbj_create_bool(true));
+    }
+    sbj_delete(sbj_detach_item_via_pointer(array, array->child));
+    sbj_delete(sbj_detach_item_via_pointer(array, array->child->prev));
+    TEST_ASSERT_NOT_NULL(array->u.vector);
+    TEST_ASSERT_EQUAL_INT(1098, sbj_get_array_size(array));
+    assert_consistent(array);
+
+    sbj_array_drop_index(array);
+    TEST_ASSERT_NULL(array->u.vector);
+    assert_consistent(array);
+
+    TEST_ASSERT_FALSE(sbj_array_build_index(NULL));
+    TEST_ASSERT_FALSE(sbj_array_build_index(array->child));
+
+    sbj_delete(array);
+}
+
+static void vector_should_not_trust_a_stale_count(void) {
+    sbJSON *array = create_numbers(1000);
+    sbJSON *extra = create_numbers(100);
+    sbJSON *const first = extra->child;
+    sbJSON *const last = first->prev;
+
+    /* chained by hand, child_count still says 1000 */
+    array->child->prev->next = first;
+    first->prev = array->child->prev;
+    array->child->prev = last;
+    extra->child = NULL;
+    extra->child_count = 0;
+
+    TEST_ASSERT_FALSE(sbj_array_build_index(array));
+    TEST_ASSERT_NULL(array->u.vector);
+    TEST_ASSERT_EQUAL_INT64(500, sbj_get_array_item(array, 500)->u.valueint);
+    TEST_ASSERT_NULL(array->u.vector);
+
+    sbj_delete(extra);
+    sbj_delete(array);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(parsers_should_count_children);
+    RUN_TEST(mutations_should_keep_child_count);
+    RUN_TEST(get_items_should_fill_the_buffer);
+    RUN_TEST(vector_should_follow_mutations);
+    RUN_TEST(vector_should_not_trust_a_stale_count);
+
+    return UNITY_END();
+}
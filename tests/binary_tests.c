@@ -0,0 +1,223 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static sbJSON *round_trip(sbJSON const *item) {
+    size_t length = 0;
+    unsigned char *encoded = sbj_encode_binary(item, &length);
+    sbJSON *decoded = NULL;
+
+    TEST_ASSERT_NOT_NULL(encoded);
+    decoded = sbj_decode_binary(encoded, length);
+    sbJSON_free(encoded);
+
+    return decoded;
+}
+
+static void assert_round_trip(char const *json) {
+    sbJSON *expected = sbj_parse(json);
+    sbJSON *decoded = NULL;
+
+    if (expected == NULL) {
+        return; /* some test files are invalid on purpose */
+    }
+    decoded = round_trip(expected);
+    TEST_ASSERT_NOT_NULL_MESSAGE(decoded, json);
+    TEST_ASSERT_TRUE_MESSAGE(sbj_compare(expected, decoded), json);
+
+    sbj_delete(decoded);
+    sbj_delete(expected);
+}
+
+static void binary_should_round_trip_documents(void) {
+    static char const *const documents[] = {
+        "null",
+        "true",
+        "false",
+        "0",
+        "-1",
+        "9223372036854775807",
+        "-9223372036854775808",
+        "1.0",
+        "-0.0",
+        "1e308",
+        "5e-324",
+        "\"\"",
+        "\"unicode \\u00e4\\ud83d\\ude00 and \\\"escapes\\\"\"",
+        "[]",
+        "{}",
+        "[1, 2.5, \"three\", [null, true, false], {\"\": {}}]",
+        "{\"a\": {\"b\": [[], [[]]]}, \"b\": 2, \"c\\nd\": \"e\"}",
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        assert_round_trip(documents[i]);
+    }
+}
+
+static void binary_should_round_trip_test_files(void) {
+    char name[] = "inputs/test?";
+    char digit;
+
+    for (digit = '1'; digit <= '9'; digit++) {
+        char *json = NULL;
+        name[sizeof(name) - 2] = digit;
+        json = read_file(name);
+        TEST_ASSERT_NOT_NULL(json);
+        assert_round_trip(json);
+        free(json);
+    }
+}
+
+static void binary_should_keep_number_types_and_raw_items(void) {
+    sbJSON *array = sbj_create_array();
+    sbJSON *decoded = NULL;
+
+    sbj_add_item_to_array(array, sbj_create_double_number(2.0));
+    sbj_add_item_to_array(array, sbj_create_integer_number(2));
+    sbj_add_item_to_array(array, sbj_create_raw("{\"raw\": 1}"));
+
+    decoded = round_trip(array);
+    TEST_ASSERT_NOT_NULL(decoded);
+    TEST_ASSERT_TRUE(sbj_compare(array, decoded));
+    TEST_ASSERT_EQUAL_INT32(3, decoded->child_count);
+    TEST_ASSERT_TRUE(sbj_get_array_item(decoded, 0)->is_number_double);
+    TEST_ASSERT_FALSE(sbj_get_array_item(decoded, 1)->is_number_double);
+    TEST_ASSERT_TRUE(sbj_is_raw(sbj_get_array_item(decoded, 2)));
+    TEST_ASSERT_EQUAL_PTR(sbj_get_array_item(decoded, 2),
+                          decoded->child->prev);
+
+    sbj_delete(decoded);
+    sbj_delete(array);
+}
+
+static void binary_should_encode_small_values_compactly(void) {
+    sbJSON *item = sbj_parse("[1, -1, 63, \"ab\"]");
+    size_t length = 0;
+    unsigned char *encoded = sbj_encode_binary(item, &length);
+
+    TEST_ASSERT_NOT_NULL(encoded);
+    /* header, tag and count, three integers with one byte each, string */
+    TEST_ASSERT_EQUAL_size_t(4 + 2 + 3 * 2 + 4, length);
+
+    sbJSON_free(encoded);
+    sbj_delete(item);
+}
+
+static void binary_should_reject_broken_data(void) {
+    sbJSON *item = sbj_parse("{\"key\": [1, 2.5, \"string\", {\"a\": null}]}");
+    size_t length = 0;
+    size_t i;
+    unsigned char *encoded = sbj_encode_binary(item, &length);
+    unsigned char *copy = NULL;
+    sbJSON *decoded = NULL;
+
+    TEST_ASSERT_NOT_NULL(encoded);
+    /* every truncation fails */
+    for (i = 0; i < length; i++) {
+        copy = (unsigned char *)malloc(i + 1);
+        memcpy(copy, encoded, i);
+        TEST_ASSERT_NULL(sbj_decode_binary(copy, i));
+        free(copy);
+    }
+
+    /* as do trailing bytes */
+    copy = (unsigned char *)malloc(length + 1);
+    memcpy(copy, encoded, length);
+    copy[length] = 0;
+    TEST_ASSERT_NULL(sbj_decode_binary(copy, length + 1));
+
+    /* and a wrong header */
+    copy[0] = 'x';
+    TEST_ASSERT_NULL(sbj_decode_binary(copy, length));
+    free(copy);
+
+    /* a corrupt count */
+    {
+        unsigned char const huge_count[] = {'s',  'b',  'J',  1,    7,
+                                            0xFF, 0xFF, 0xFF, 0xFF, 0x07};
+        unsigned char const unknown_tag[] = {'s', 'b', 'J', 1, 42};
+        TEST_ASSERT_NULL(sbj_decode_binary(huge_count, sizeof(huge_count)));
+        TEST_ASSERT_NULL(sbj_decode_binary(unknown_tag, sizeof(unknown_tag)));
+    }
+
+    decoded = sbj_decode_binary(encoded, length);
+    TEST_ASSERT_TRUE(sbj_compare(item, decoded));
+
+    sbj_delete(decoded);
+    sbJSON_free(encoded);
+    sbj_delete(item);
+}
+
+static void binary_should_reject_invalid_trees(void) {
+    sbJSON *array = sbj_create_array();
+    sbJSON *invalid = sbj_create_null();
+    size_t length = 0;
+
+    invalid->type = sbJSON_Invalid;
+    sbj_add_item_to_array(array, invalid);
+    TEST_ASSERT_NULL(sbj_encode_binary(array, &length));
+    TEST_ASSERT_NULL(sbj_encode_binary(NULL, &length));
+    TEST_ASSERT_NULL(sbj_encode_binary(array, NULL));
+    TEST_ASSERT_NULL(sbj_decode_binary(NULL, 10));
+
+    sbj_delete(array);
+}
+
+static void binary_should_respect_nesting_limit(void) {
+    size_t const depth = SBJSON_NESTING_LIMIT + 1;
+    unsigned char *data = (unsigned char *)malloc(4 + 2 * depth + 1);
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(data);
+    memcpy(data, "sbJ\001", 4);
+    for (i = 0; i < depth; i++) {
+        data[4 + 2 * i] = 7; /* array */
+        data[4 + 2 * i + 1] = 1;
+    }
+    data[4 + 2 * depth] = 0; /* null */
+    TEST_ASSERT_NULL(sbj_decode_binary(data, 4 + 2 * depth + 1));
+
+    free(data);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(binary_should_round_trip_documents);
+    RUN_TEST(binary_should_round_trip_test_files);
+    RUN_TEST(binary_should_keep_number_types_and_raw_items);
+    RUN_TEST(binary_should_encode_small_values_compactly);
+    RUN_TEST(binary_should_reject_broken_data);
+    RUN_TEST(binary_should_reject_invalid_trees);
+    RUN_TEST(binary_should_respect_nesting_limit);
+
+    return UNITY_END();
+}
@@ -0,0 +1,213 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* these tests cover the compact build whatever the configuration is */
+#ifndef SBJSON_COMPACT
+#define SBJSON_COMPACT
+#endif
+
+#include "common.h"
+#include "unity.h"
+
+static void compact_should_store_short_strings_inline(void) {
+    sbJSON *tree = sbj_parse("{\"id\":\"abc\",\"name\":\"a longer string\","
+                             "\"key\":7,\"letter\":\"\\u00e9\"}");
+    sbJSON *item = NULL;
+
+    TEST_ASSERT_NOT_NULL(tree);
+
+    item = sbj_get_object_item(tree, "id");
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_TRUE(item->has_inline_storage);
+    TEST_ASSERT_TRUE(is_inline_string(item, item->string));
+    TEST_ASSERT_TRUE(is_inline_string(item, item->u.valuestring));
+    TEST_ASSERT_EQUAL_STRING("id", item->string);
+    TEST_ASSERT_EQUAL_STRING("abc", sbj_get_string_value(item));
+
+    /* only the key fits */
+    item = sbj_get_object_item(tree, "name");
+    TEST_ASSERT_TRUE(is_inline_string(item, item->string));
+    TEST_ASSERT_FALSE(is_inline_string(item, item->u.valuestring));
+    TEST_ASSERT_EQUAL_STRING("a longer string", sbj_get_string_value(item));
+
+    item = sbj_get_object_item(tree, "key");
+    TEST_ASSERT_TRUE(is_inline_string(item, item->string));
+    TEST_ASSERT_EQUAL_INT64(7, item->u.valueint);
+
+    /* "letter" and its escaped value don't both fit */
+    item = sbj_get_object_item(tree, "letter");
+    TEST_ASSERT_TRUE(is_inline_string(item, item->string));
+    TEST_ASSERT_FALSE(is_inline_string(item, item->u.valuestring));
+    TEST_ASSERT_EQUAL_STRING("\xc3\xa9", sbj_get_string_value(item));
+
+    sbj_delete(tree);
+}
+
+static void compact_should_store_strings_of_arrays_inline(void) {
+    sbJSON *tree = sbj_parse("[\"1234567\",\"12345678\",\"\"]");
+
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_TRUE(
+        is_inline_string(tree->child, tree->child->u.valuestring));
+    TEST_ASSERT_FALSE(
+        is_inline_string(tree->child->next, tree->child->next->u.valuestring));
+    TEST_ASSERT_TRUE(is_inline_string(tree->child->prev,
+                                      tree->child->prev->u.valuestring));
+    TEST_ASSERT_EQUAL_STRING("12345678",
+                             sbj_get_string_value(tree->child->next));
+
+    sbj_delete(tree);
+}
+
+static void compact_should_only_make_room_for_strings_that_fit(void) {
+    sbJSON *tree = sbj_parse("[1,{\"a longer key\":\"v\"},"
+                             "{\"another long key\":17},\"12345678\",[],"
+                             "\"\\u00e9\"]");
+    sbJSON *item = NULL;
+
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_FALSE(tree->has_inline_storage);
+
+    item = tree->child;
+    TEST_ASSERT_FALSE(item->has_inline_storage);
+
+    /* a long key, but the value fits */
+    item = item->next;
+    TEST_ASSERT_FALSE(item->has_inline_storage);
+    TEST_ASSERT_TRUE(item->child->has_inline_storage);
+    TEST_ASSERT_TRUE(is_inline_string(item->child, item->child->u.valuestring));
+
+    item = item->next;
+    TEST_ASSERT_FALSE(item->child->has_inline_storage);
+    TEST_ASSERT_EQUAL_STRING("another long key", item->child->string);
+
+    item = item->next;
+    TEST_ASSERT_FALSE(item->has_inline_storage);
+    TEST_ASSERT_EQUAL_STRING("12345678", sbj_get_string_value(item));
+
+    item = item->next;
+    TEST_ASSERT_FALSE(item->has_inline_storage);
+
+    /* escapes count with their length in the input */
+    item = item->next;
+    TEST_ASSERT_TRUE(item->has_inline_storage);
+    TEST_ASSERT_EQUAL_STRING("\xc3\xa9", sbj_get_string_value(item));
+
+    sbj_delete(tree);
+}
+
+static void compact_should_copy_inline_strings(void) {
+    sbJSON *tree = sbj_parse("{\"a\":\"b\",\"c\":[\"d\"]}");
+    sbJSON *copy = NULL;
+
+    TEST_ASSERT_NOT_NULL(tree);
+    copy = sbj_duplicate(tree, true);
+    TEST_ASSERT_NOT_NULL(copy);
+    TEST_ASSERT_TRUE(sbj_compare(tree, copy));
+    sbj_delete(tree);
+
+    TEST_ASSERT_FALSE(copy->child->string_is_const);
+    TEST_ASSERT_EQUAL_STRING("a", copy->child->string);
+    TEST_ASSERT_EQUAL_STRING("b", sbj_get_string_value(copy->child));
+    TEST_ASSERT_EQUAL_STRING("d",
+                             sbj_get_string_value(copy->child->next->child));
+    sbj_delete(copy);
+}
+
+static void compact_should_allow_changing_inline_strings(void) {
+    sbJSON *tree = sbj_parse("{\"a\":\"b\",\"c\":\"d\"}");
+    sbJSON *other = sbj_parse("{}");
+    sbJSON *item = NULL;
+    char *printed = NULL;
+
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_NOT_NULL(other);
+
+    item = sbj_get_object_item(tree, "a");
+    TEST_ASSERT_NOT_NULL(sbj_set_valuestring(item, "a much longer value"));
+    TEST_ASSERT_FALSE(item->is_reference);
+    TEST_ASSERT_NOT_NULL(sbj_set_valuestring(item, "x"));
+
+    /* moving a member renames it, its inline value goes along */
+    item = sbj_detach_item_from_object(tree, "c");
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_TRUE(sbj_add_item_to_object(other, "renamed", item));
+    TEST_ASSERT_TRUE(item->is_reference);
+
+    printed = sbj_print_unformatted(tree);
+    TEST_ASSERT_EQUAL_STRING("{\"a\":\"x\"}", printed);
+    free(printed);
+    printed = sbj_print_unformatted(other);
+    TEST_ASSERT_EQUAL_STRING("{\"renamed\":\"d\"}", printed);
+    free(printed);
+
+    sbj_delete(tree);
+    sbj_delete(other);
+}
+
+static void compact_should_round_trip_test_inputs(void) {
+    char name[] = "inputs/test??";
+    int i;
+
+    for (i = 1; i <= 11; i++) {
+        char *content = NULL;
+        sbJSON *tree = NULL;
+        sbJSON *reparsed = NULL;
+        char *printed = NULL;
+
+        snprintf(name, sizeof(name), "inputs/test%d", i);
+        content = read_file(name);
+        TEST_ASSERT_NOT_NULL(content);
+        tree = sbj_parse(content);
+        free(content);
+        if (tree == NULL) {
+            continue; /* some of the inputs are invalid on purpose */
+        }
+
+        printed = sbj_print(tree);
+        TEST_ASSERT_NOT_NULL(printed);
+        reparsed = sbj_parse(printed);
+        TEST_ASSERT_TRUE(sbj_compare(tree, reparsed));
+
+        free(printed);
+        sbj_delete(reparsed);
+        sbj_delete(tree);
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(compact_should_store_short_strings_inline);
+    RUN_TEST(compact_should_store_strings_of_arrays_inline);
+    RUN_TEST(compact_should_only_make_room_for_strings_that_fit);
+    RUN_TEST(compact_should_copy_inline_strings);
+    RUN_TEST(compact_should_allow_changing_inline_strings);
+    RUN_TEST(compact_should_round_trip_test_inputs);
+
+    return UNITY_END();
+}
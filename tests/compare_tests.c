@@ -143,6 +143,89 @@ static void sbjson_compare_should_compare_objects(void) {
                             "{\"one\": 1, \"two\": 2, \"three\": 3}"));
 }
 
+static void sbjson_compare_should_compare_repeated_names(void) {
+    TEST_ASSERT_TRUE(compare_from_string("{\"a\": 1, \"a\": 1}",
+                                         "{\"a\": 1, \"a\": 1}"));
+    TEST_ASSERT_FALSE(compare_from_string("{\"a\": 1, \"a\": 1}",
+                                          "{\"a\": 1, \"a\": 2}"));
+    TEST_ASSERT_FALSE(compare_from_string("{\"a\": 1, \"a\": 2}",
+                                          "{\"a\": 1, \"a\": 1}"));
+}
+
+static void sbjson_compare_should_compare_deeply_nested_objects(void) {
+    /* each level used to be compared twice as often as the one above */
+    static char a[64 * 8 + 16];
+    static char b[64 * 8 + 16];
+    size_t length = 0;
+    size_t i = 0;
+
+    for (i = 0; i < 64; i++) {
+        memcpy(a + length, "{\"a\":", 5);
+        length += 5;
+    }
+    memcpy(a + length, "null", 4);
+    length += 4;
+    for (i = 0; i < 64; i++) {
+        a[length++] = '}';
+    }
+    a[length] = '\0';
+    memcpy(b, a, length + 1);
+    memcpy(b + 64 * 5, "true", 4);
+
+    TEST_ASSERT_TRUE(compare_from_string(a, a));
+    TEST_ASSERT_FALSE(compare_from_string(a, b));
+}
+
+static uint64_t hash_from_string(const char *const json) {
+    sbJSON *item = sbj_parse(json);
+    uint64_t hash = 0;
+
+    TEST_ASSERT_NOT_NULL_MESSAGE(item, "Failed to parse json.");
+    hash = sbj_hash(item);
+    sbj_delete(item);
+
+    return hash;
+}
+
+static void sbjson_hash_should_ignore_member_order(void) {
+    TEST_ASSERT_EQUAL_UINT64(
+        hash_from_string("{\"a\": 1, \"b\": [true, null], \"c\": {}}"),
+        hash_from_string("{\"c\": {}, \"b\": [true, null], \"a\": 1}"));
+    TEST_ASSERT_EQUAL_UINT64(hash_from_string("0.0"),
+                             hash_from_string("-0.0"));
+}
+
+static void sbjson_hash_should_tell_values_apart(void) {
+    TEST_ASSERT_NOT_EQUAL(hash_from_string("[1, 2]"),
+                          hash_from_string("[2, 1]"));
+    TEST_ASSERT_NOT_EQUAL(hash_from_string("{\"a\": 1, \"b\": 2}"),
+                          hash_from_string("{\"a\": 2, \"b\": 1}"));
+    TEST_ASSERT_NOT_EQUAL(hash_from_string("\"1\""),
+                          hash_from_string("1"));
+    TEST_ASSERT_NOT_EQUAL(hash_from_string("true"),
+                          hash_from_string("false"));
+    TEST_ASSERT_NOT_EQUAL(hash_from_string("[]"), hash_from_string("{}"));
+    TEST_ASSERT_NOT_EQUAL(hash_from_string("[[]]"), hash_from_string("[]"));
+}
+
+static void sbjson_hash_should_agree_with_compare(void) {
+    sbJSON *item = sbj_parse("{\"x\": [1, 2.5, \"s\"], \"y\": null}");
+    sbJSON *copy = NULL;
+
+    TEST_ASSERT_NOT_NULL(item);
+    copy = sbj_duplicate(item, true);
+    TEST_ASSERT_NOT_NULL(copy);
+    TEST_ASSERT_TRUE(sbj_compare(item, copy));
+    TEST_ASSERT_EQUAL_UINT64(sbj_hash(item), sbj_hash(copy));
+
+    sbj_add_null_to_object(copy, "z");
+    TEST_ASSERT_FALSE(sbj_compare(item, copy));
+    TEST_ASSERT_NOT_EQUAL(sbj_hash(item), sbj_hash(copy));
+
+    sbj_delete(item);
+    sbj_delete(copy);
+}
+
 int main(void) {
     UNITY_BEGIN();
 
@@ -155,6 +238,11 @@ int main(void) {
     RUN_TEST(sbjson_compare_should_compare_raw);
     RUN_TEST(sbjson_compare_should_compare_arrays);
     RUN_TEST(sbjson_compare_should_compare_objects);
+    RUN_TEST(sbjson_compare_should_compare_repeated_names);
+    RUN_TEST(sbjson_compare_should_compare_deeply_nested_objects);
+    RUN_TEST(sbjson_hash_should_ignore_member_order);
+    RUN_TEST(sbjson_hash_should_tell_values_apart);
+    RUN_TEST(sbjson_hash_should_agree_with_compare);
 
     return UNITY_END();
 }
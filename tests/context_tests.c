@@ -0,0 +1,153 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static size_t allocations = 0;
+static size_t deallocations = 0;
+
+static void *counting_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+static void counting_free(void *pointer) {
+    if (pointer != NULL) {
+        deallocations++;
+    }
+    free(pointer);
+}
+
+static void context_should_use_its_own_hooks(void) {
+    sbJSON_Hooks hooks = {counting_malloc, counting_free};
+    sbj_context ctx;
+    const char json[] = "{\"name\": \"value\", \"list\": [1, 2.5, true]}";
+    sbJSON *parsed = NULL;
+    sbJSON *duplicate = NULL;
+    char *printed = NULL;
+
+    allocations = deallocations = 0;
+    sbj_context_init(&ctx, &hooks);
+
+    parsed = sbj_parse_ctx(&ctx, json, sizeof(json), NULL, true);
+    TEST_ASSERT_NOT_NULL(parsed);
+    TEST_ASSERT_NULL(sbj_context_get_error_ptr(&ctx));
+    TEST_ASSERT_TRUE(allocations > 0);
+
+    duplicate = sbj_duplicate_ctx(&ctx, parsed, true);
+    TEST_ASSERT_TRUE(sbj_compare(parsed, duplicate));
+
+    printed = sbj_print_ctx(&ctx, duplicate, false);
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"value\",\"list\":[1,2.5,true]}",
+                             printed);
+    counting_free(printed);
+
+    sbj_delete_ctx(&ctx, parsed);
+    sbj_delete_ctx(&ctx, duplicate);
+    sbj_context_destroy(&ctx);
+
+    TEST_ASSERT_EQUAL_size_t(allocations, deallocations);
+}
+
+static void context_should_report_errors_locally(void) {
+    sbj_context first;
+    sbj_context second;
+    const char broken[] = "[1, 2, x]";
+    const char valid[] = "[1, 2, 3]";
+    sbJSON *item = NULL;
+
+    sbj_context_init(&first, NULL);
+    sbj_context_init(&second, NULL);
+
+    TEST_ASSERT_NULL(sbj_parse_ctx(&first, broken, sizeof(broken), NULL, false));
+    item = sbj_parse_ctx(&second, valid, sizeof(valid), NULL, false);
+    TEST_ASSERT_NOT_NULL(item);
+
+    TEST_ASSERT_EQUAL_PTR(broken + 7, sbj_context_get_error_ptr(&first));
+    TEST_ASSERT_NULL(sbj_context_get_error_ptr(&second));
+
+    sbj_delete_ctx(&second, item);
+    sbj_context_destroy(&first);
+    sbj_context_destroy(&second);
+}
+
+static void context_should_apply_nesting_limit(void) {
+    sbj_context ctx;
+    const char json[] = "[[[[1]]]]";
+    sbJSON *item = NULL;
+
+    sbj_context_init(&ctx, NULL);
+    ctx.nesting_limit = 3;
+    TEST_ASSERT_NULL(sbj_parse_ctx(&ctx, json, sizeof(json), NULL, false));
+
+    ctx.nesting_limit = 4;
+    item = sbj_parse_ctx(&ctx, json, sizeof(json), NULL, false);
+    TEST_ASSERT_NOT_NULL(item);
+
+    sbj_delete_ctx(&ctx, item);
+    sbj_context_destroy(&ctx);
+}
+
+static void print_ctx_should_reuse_scratch_buffer(void) {
+    sbj_context ctx;
+    sbJSON *array = sbj_create_array();
+    unsigned char *scratch = NULL;
+    char *printed = NULL;
+    int i = 0;
+
+    for (i = 0; i < 200; i++) {
+        sbj_add_item_to_array(array, sbj_create_integer_number(i));
+    }
+
+    sbj_context_init(&ctx, NULL);
+    printed = sbj_print_ctx(&ctx, array, true);
+    TEST_ASSERT_NOT_NULL(printed);
+    scratch = ctx.scratch;
+    TEST_ASSERT_TRUE(ctx.scratch_size > strlen(printed));
+    free(printed);
+
+    /* the second print fits into the scratch buffer of the first one */
+    printed = sbj_print_ctx(&ctx, array, true);
+    TEST_ASSERT_EQUAL_PTR(scratch, ctx.scratch);
+    free(printed);
+
+    sbj_context_destroy(&ctx);
+    TEST_ASSERT_NULL(ctx.scratch);
+    sbj_delete(array);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(context_should_use_its_own_hooks);
+    RUN_TEST(context_should_report_errors_locally);
+    RUN_TEST(context_should_apply_nesting_limit);
+    RUN_TEST(print_ctx_should_reuse_scratch_buffer);
+
+    return UNITY_END();
+}
@@ -0,0 +1,302 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+typedef struct point {
+    int64_t x;
+    double y;
+} point;
+
+typedef struct record {
+    char *name;
+    bool active;
+    int64_t id;
+    double ratio;
+    point origin;
+    point *points;
+    size_t point_count;
+    char **tags;
+    size_t tag_count;
+    int64_t *values;
+    size_t value_count;
+} record;
+
+static sbj_field const point_fields[] = {
+    {"x", offsetof(point, x), sbj_field_integer, sbj_field_bool, 0, NULL},
+    {"y", offsetof(point, y), sbj_field_double, sbj_field_bool, 0, NULL},
+};
+static sbj_binding const point_binding = {sizeof(point), point_fields, 2};
+
+static sbj_field const record_fields[] = {
+    {"name", offsetof(record, name), sbj_field_string, sbj_field_bool, 0, NULL},
+    {"active", offsetof(record, active), sbj_field_bool, sbj_field_bool, 0,
+     NULL},
+    {"id", offsetof(record, id), sbj_field_integer, sbj_field_bool, 0, NULL},
+    {"ratio", offsetof(record, ratio), sbj_field_double, sbj_field_bool, 0,
+     NULL},
+    {"origin", offsetof(record, origin), sbj_field_object, sbj_field_bool, 0,
+     &point_binding},
+    {"points", offsetof(record, points), sbj_field_array, sbj_field_object,
+     offsetof(record, point_count), &point_binding},
+    {"tags", offsetof(record, tags), sbj_field_array, sbj_field_string,
+     offsetof(record, tag_count), NULL},
+    {"values", offsetof(record, values), sbj_field_array, sbj_field_integer,
+     offsetof(record, value_count), NULL},
+};
+static sbj_binding const record_binding = {sizeof(record), record_fields, 8};
+
+static char const document[] =
+    "{\"name\":\"first \\\"one\\\"\",\"active\":true,\"id\":-42,"
+    "\"ratio\":0.25,\"origin\":{\"x\":1,\"y\":-2.5},"
+    "\"points\":[{\"x\":3,\"y\":4},{\"x\":5,\"y\":6.75}],"
+    "\"tags\":[\"a\",\"\\u00e9\",null],\"values\":[]}";
+
+static size_t allocations = 0;
+static size_t releases = 0;
+
+static void *counting_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+static void counting_free(void *pointer) {
+    if (pointer != NULL) {
+        releases++;
+    }
+    free(pointer);
+}
+
+static void decode_should_fill_the_struct(void) {
+    record out;
+
+    TEST_ASSERT_TRUE(
+        sbj_decode(document, sizeof(document) - 1, &record_binding, &out));
+    TEST_ASSERT_EQUAL_STRING("first \"one\"", out.name);
+    TEST_ASSERT_TRUE(out.active);
+    TEST_ASSERT_EQUAL_INT64(-42, out.id);
+    TEST_ASSERT_EQUAL_DOUBLE(0.25, out.ratio);
+    TEST_ASSERT_EQUAL_INT64(1, out.origin.x);
+    TEST_ASSERT_EQUAL_DOUBLE(-2.5, out.origin.y);
+    TEST_ASSERT_EQUAL_UINT64(2, out.point_count);
+    TEST_ASSERT_EQUAL_INT64(5, out.points[1].x);
+    TEST_ASSERT_EQUAL_DOUBLE(6.75, out.points[1].y);
+    TEST_ASSERT_EQUAL_UINT64(3, out.tag_count);
+    TEST_ASSERT_EQUAL_STRING("\xC3\xA9", out.tags[1]);
+    TEST_ASSERT_NULL(out.tags[2]);
+    TEST_ASSERT_EQUAL_UINT64(0, out.value_count);
+
+    sbj_binding_free(&out, &record_binding);
+    TEST_ASSERT_NULL(out.name);
+    TEST_ASSERT_NULL(out.points);
+    TEST_ASSERT_EQUAL_UINT64(0, out.tag_count);
+}
+
+static void encode_should_print_like_the_tree(void) {
+    sbJSON *tree = sbj_parse(document);
+    record in;
+    char *encoded = NULL;
+    char *printed = NULL;
+
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_TRUE(
+        sbj_decode(document, sizeof(document) - 1, &record_binding, &in));
+
+    encoded = sbj_encode(&in, &record_binding, false);
+    printed = sbj_print_unformatted(tree);
+    TEST_ASSERT_EQUAL_STRING(printed, encoded);
+    sbJSON_free(encoded);
+    sbJSON_free(printed);
+
+    encoded = sbj_encode(&in, &record_binding, true);
+    printed = sbj_print(tree);
+    TEST_ASSERT_EQUAL_STRING(printed, encoded);
+    sbJSON_free(encoded);
+    sbJSON_free(printed);
+
+    sbj_binding_free(&in, &record_binding);
+    sbj_delete(tree);
+}
+
+static void decode_should_skip_unknown_members_without_allocating(void) {
+    static char const input[] =
+        "{\"unknown\":{\"deep\":[1,\"two\",{\"three\":null}]},"
+        "\"i\\u0064\":7,\"long \\\"escaped\\\" name that is not a field\":[],"
+        "\"ratio\":1e3,\"origin\":{\"z\":\"skipped\",\"x\":9}}";
+    sbJSON_Hooks hooks = {counting_malloc, counting_free};
+    record out;
+
+    sbJSON_InitHooks(&hooks);
+    allocations = 0;
+    TEST_ASSERT_TRUE(
+        sbj_decode(input, sizeof(input) - 1, &record_binding, &out));
+    TEST_ASSERT_EQUAL_UINT64(0, allocations);
+    TEST_ASSERT_EQUAL_INT64(7, out.id);
+    TEST_ASSERT_EQUAL_DOUBLE(1000.0, out.ratio);
+    TEST_ASSERT_EQUAL_INT64(9, out.origin.x);
+    TEST_ASSERT_NULL(out.name);
+    sbJSON_InitHooks(NULL);
+}
+
+static void decode_should_let_the_last_member_win(void) {
+    static char const input[] =
+        "{\"name\":\"a\",\"tags\":[\"x\"],\"name\":\"b\",\"tags\":null,"
+        "\"values\":[1],\"values\":[2,3],\"name\":null,\"name\":\"c\"}";
+    sbJSON_Hooks hooks = {counting_malloc, counting_free};
+    record out;
+
+    sbJSON_InitHooks(&hooks);
+    allocations = 0;
+    releases = 0;
+    TEST_ASSERT_TRUE(
+        sbj_decode(input, sizeof(input) - 1, &record_binding, &out));
+    TEST_ASSERT_EQUAL_STRING("c", out.name);
+    TEST_ASSERT_NULL(out.tags);
+    TEST_ASSERT_EQUAL_UINT64(0, out.tag_count);
+    TEST_ASSERT_EQUAL_UINT64(2, out.value_count);
+    TEST_ASSERT_EQUAL_INT64(3, out.values[1]);
+    sbj_binding_free(&out, &record_binding);
+    TEST_ASSERT_EQUAL_UINT64(allocations, releases);
+    sbJSON_InitHooks(NULL);
+}
+
+static void decode_should_fail_without_leaking(void) {
+    static char const *const inputs[] = {
+        "[]",
+        "",
+        "{\"id\":1.5}",
+        "{\"id\":\"1\"}",
+        "{\"active\":1}",
+        "{\"name\":\"x\",\"origin\":[]}",
+        "{\"name\":\"x\",\"points\":[{\"x\":1},{\"x\":true}]}",
+        "{\"tags\":[\"a\",\"b\",2]}",
+        "{\"tags\":[\"a\",]}",
+        "{\"name\":\"x\",\"unknown\":[1,}",
+        "{\"name\":\"x\",\"unknown\":\"\\q\"}",
+        "{\"name\":\"x\"",
+        "{\"name\" \"x\"}",
+        "{\"name\":\"x\",}",
+        "{\"\\uD800\":1}",
+    };
+    sbJSON_Hooks hooks = {counting_malloc, counting_free};
+    record out;
+    size_t i = 0;
+
+    sbJSON_InitHooks(&hooks);
+    for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        allocations = 0;
+        releases = 0;
+        memset(&out, 0xFF, sizeof(out));
+        TEST_ASSERT_FALSE_MESSAGE(sbj_decode(inputs[i], strlen(inputs[i]),
+                                             &record_binding, &out),
+                                  inputs[i]);
+        TEST_ASSERT_EQUAL_UINT64_MESSAGE(allocations, releases, inputs[i]);
+        TEST_ASSERT_NULL(out.name);
+        TEST_ASSERT_NULL(out.points);
+        TEST_ASSERT_NULL(out.tags);
+        if (inputs[i][0] != '\0') {
+            TEST_ASSERT_NOT_NULL(sbJSON_GetErrorPtr());
+        }
+    }
+    sbJSON_InitHooks(NULL);
+}
+
+static void decode_should_point_at_numbers_that_are_no_integers(void) {
+    static char const field[] = "{\"id\": 1.5, \"name\": \"x\"}";
+    static char const element[] = "{\"values\":[1, 2e3]}";
+    record out;
+
+    TEST_ASSERT_FALSE(
+        sbj_decode(field, sizeof(field) - 1, &record_binding, &out));
+    TEST_ASSERT_EQUAL_PTR(strchr(field, '1'), sbJSON_GetErrorPtr());
+
+    TEST_ASSERT_FALSE(
+        sbj_decode(element, sizeof(element) - 1, &record_binding, &out));
+    TEST_ASSERT_EQUAL_PTR(strchr(element, '2'), sbJSON_GetErrorPtr());
+}
+
+/* unknown members are skipped with the nesting limit of the parser */
+static void decode_should_respect_the_nesting_limit(void) {
+    static char input[SBJSON_NESTING_LIMIT * 2 + 16];
+    size_t depth = 0;
+
+    for (depth = SBJSON_NESTING_LIMIT - 1; depth <= SBJSON_NESTING_LIMIT;
+         depth++) {
+        sbJSON *tree = NULL;
+        size_t length = (size_t)sprintf(input, "{\"u\":");
+        size_t i = 0;
+        record out;
+
+        for (i = 0; i < depth; i++) {
+            input[length++] = '[';
+        }
+        for (i = 0; i < depth; i++) {
+            input[length++] = ']';
+        }
+        input[length++] = '}';
+
+        tree = sbj_parse_with_length(input, length);
+        TEST_ASSERT_EQUAL(tree != NULL,
+                          sbj_decode(input, length, &record_binding, &out));
+        TEST_ASSERT_EQUAL(depth < SBJSON_NESTING_LIMIT, tree != NULL);
+        sbj_delete(tree);
+    }
+}
+
+static void encode_should_print_null_strings_and_empty_arrays(void) {
+    record in;
+    char *encoded = NULL;
+
+    memset(&in, 0, sizeof(in));
+    in.id = 1;
+    encoded = sbj_encode(&in, &record_binding, false);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"name\":null,\"active\":false,\"id\":1,\"ratio\":0,"
+        "\"origin\":{\"x\":0,\"y\":0},\"points\":[],\"tags\":[],\"values\":[]}",
+        encoded);
+    sbJSON_free(encoded);
+
+    TEST_ASSERT_NULL(sbj_encode(NULL, &record_binding, false));
+    TEST_ASSERT_NULL(sbj_encode(&in, NULL, false));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(decode_should_fill_the_struct);
+    RUN_TEST(encode_should_print_like_the_tree);
+    RUN_TEST(decode_should_skip_unknown_members_without_allocating);
+    RUN_TEST(decode_should_let_the_last_member_win);
+    RUN_TEST(decode_should_fail_without_leaking);
+    RUN_TEST(decode_should_point_at_numbers_that_are_no_integers);
+    RUN_TEST(decode_should_respect_the_nesting_limit);
+    RUN_TEST(encode_should_print_null_strings_and_empty_arrays);
+
+    return UNITY_END();
+}
@@ -0,0 +1,184 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../sbjson_utils.h"
+#include "common.h"
+#include "unity.h"
+
+/* Diffs from and to, checks that neither changed and that the patches turn
+ * from into to. Returns the number of patches. */
+static int diff_and_apply(char const *from_json, char const *to_json) {
+    sbJSON *from = sbj_parse(from_json);
+    sbJSON *to = sbj_parse(to_json);
+    sbJSON *patches = NULL;
+    char *from_before = NULL;
+    char *to_before = NULL;
+    char *after = NULL;
+    int count = 0;
+
+    TEST_ASSERT_NOT_NULL(from);
+    TEST_ASSERT_NOT_NULL(to);
+    from_before = sbj_print_unformatted(from);
+    to_before = sbj_print_unformatted(to);
+
+    patches = sbJSONUtils_Diff(from, to);
+    TEST_ASSERT_NOT_NULL(patches);
+    count = sbj_get_array_size(patches);
+
+    after = sbj_print_unformatted(from);
+    TEST_ASSERT_EQUAL_STRING(from_before, after);
+    free(after);
+    after = sbj_print_unformatted(to);
+    TEST_ASSERT_EQUAL_STRING(to_before, after);
+    free(after);
+
+    TEST_ASSERT_EQUAL_INT(0, sbJSONUtils_ApplyPatches(from, patches));
+    TEST_ASSERT_TRUE(sbj_compare(from, to));
+
+    free(from_before);
+    free(to_before);
+    sbj_delete(patches);
+    sbj_delete(from);
+    sbj_delete(to);
+
+    return count;
+}
+
+static void diff_should_produce_working_patches(void) {
+    static char const *const pairs[][2] = {
+        {"1", "1"},
+        {"1", "2"},
+        {"1.5", "1"},
+        {"true", "false"},
+        {"\"a\"", "\"b\""},
+        {"null", "{}"},
+        {"{\"b\":1,\"a\":2}", "{\"a\":2,\"b\":1}"},
+        {"{\"b\":1,\"a\":2}", "{\"a\":3,\"c\":1}"},
+        {"{\"a/b\":1,\"m~n\":[1]}", "{\"a/b\":2,\"m~n\":[1,2]}"},
+        {"[]", "[1,2,3]"},
+        {"[1,2,3]", "[]"},
+        {"[1,2,3]", "[0,1,2,3]"},
+        {"[1,2,3]", "[1,3]"},
+        {"[1,2,3,4,5]", "[5,4,3,2,1]"},
+        {"[1,2,3]", "[\"x\",2,\"y\",3,4]"},
+        {"[{\"id\":1,\"v\":1},{\"id\":2}]", "[{\"id\":1,\"v\":2},{\"id\":2}]"},
+        {"[[1,2],[3,4],[5]]", "[[3,4],[1,2,0],[5]]"},
+        {"{\"a\":[1,{\"b\":[true,null]}]}", "{\"a\":[1,{\"b\":[false]}]}"}};
+    size_t i;
+
+    for (i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        diff_and_apply(pairs[i][0], pairs[i][1]);
+        diff_and_apply(pairs[i][1], pairs[i][0]);
+    }
+
+    TEST_ASSERT_EQUAL_INT(0,
+                          diff_and_apply("[1,{\"a\":[2]}]", "[1,{\"a\":[2]}]"));
+    TEST_ASSERT_EQUAL_INT(0, diff_and_apply("{\"b\":1,\"a\":2}",
+                                            "{\"a\":2,\"b\":1}"));
+    TEST_ASSERT_EQUAL_INT(1, diff_and_apply("true", "false"));
+    /* only the changed member of the element is replaced */
+    TEST_ASSERT_EQUAL_INT(
+        1, diff_and_apply("[{\"id\":1,\"v\":1},{\"id\":2}]",
+                          "[{\"id\":1,\"v\":2},{\"id\":2}]"));
+}
+
+/* "[0,1,...,count - 1]" with the numbers of skip left out and insert put in
+ * front of position insert_at */
+static char *numbers(int count, int skip, int insert_at, int insert) {
+    char *json = (char *)malloc((size_t)count * 12 + 32);
+    size_t length = 0;
+    int i;
+
+    TEST_ASSERT_NOT_NULL(json);
+    json[length++] = '[';
+    for (i = 0; i < count; i++) {
+        if (i == insert_at) {
+            length += (size_t)sprintf(json + length, "%d,", insert);
+        }
+        if (i != skip) {
+            length += (size_t)sprintf(json + length, "%d,", i);
+        }
+    }
+    json[length - 1] = ']';
+    json[length] = '\0';
+
+    return json;
+}
+
+static void diff_should_keep_array_patches_small(void) {
+    char *from = numbers(100000, -1, -1, 0);
+    char *to = numbers(100000, 70000, 3, -1);
+
+    /* one insertion and one removal instead of a patch per element */
+    TEST_ASSERT_EQUAL_INT(2, diff_and_apply(from, to));
+    free(to);
+
+    to = numbers(100000, -1, 0, -1);
+    TEST_ASSERT_EQUAL_INT(1, diff_and_apply(from, to));
+    free(to);
+    free(from);
+}
+
+static void diff_should_handle_very_different_arrays(void) {
+    char *from = numbers(2000, -1, -1, 0);
+    char *reversed = (char *)malloc(2000 * 12 + 32);
+    size_t length = 0;
+    int i;
+
+    TEST_ASSERT_NOT_NULL(reversed);
+    reversed[length++] = '[';
+    for (i = 1999; i >= 0; i--) {
+        length += (size_t)sprintf(reversed + length, "%d,", i);
+    }
+    reversed[length - 1] = ']';
+    reversed[length] = '\0';
+
+    /* too many edits for the edit script, the elements are replaced */
+    diff_and_apply(from, reversed);
+
+    free(reversed);
+    free(from);
+}
+
+static void diff_should_reject_null(void) {
+    sbJSON *item = sbj_create_null();
+
+    TEST_ASSERT_NULL(sbJSONUtils_Diff(NULL, item));
+    TEST_ASSERT_NULL(sbJSONUtils_Diff(item, NULL));
+    sbj_delete(item);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(diff_should_produce_working_patches);
+    RUN_TEST(diff_should_keep_array_patches_small);
+    RUN_TEST(diff_should_handle_very_different_arrays);
+    RUN_TEST(diff_should_reject_null);
+
+    return UNITY_END();
+}
@@ -0,0 +1,184 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static const char *const test_files[] = {
+    "inputs/test1", "inputs/test2", "inputs/test3", "inputs/test4",
+    "inputs/test5", "inputs/test6", "inputs/test7", "inputs/test8",
+    "inputs/test9", "inputs/test10", "inputs/test11"};
+
+static char const document[] =
+    "{\"name\":\"original\",\"list\":[1,2,{\"deep\":\"value\"}],"
+    "\"nested\":{\"a\":{\"b\":[true,null]}},\"number\":1.5}";
+
+static void assert_printed(char const *const expected, sbJSON const *item) {
+    char *printed = sbj_print_unformatted(item);
+    TEST_ASSERT_NOT_NULL(printed);
+    TEST_ASSERT_EQUAL_STRING(expected, printed);
+    sbJSON_free(printed);
+}
+
+static void duplicate_into_arena_should_match_duplicate(void) {
+    sbj_arena *arena = sbj_arena_new(0);
+    size_t i = 0;
+
+    TEST_ASSERT_NOT_NULL(arena);
+    for (i = 0; i < sizeof(test_files) / sizeof(test_files[0]); i++) {
+        char *json = read_file(test_files[i]);
+        sbJSON *original = NULL;
+        sbJSON *copy = NULL;
+        char *expected = NULL;
+
+        TEST_ASSERT_NOT_NULL(json);
+        original = sbj_parse(json);
+        free(json);
+        if (original == NULL) {
+            continue;
+        }
+
+        copy = sbj_duplicate_into_arena(arena, original);
+        TEST_ASSERT_NOT_NULL(copy);
+        TEST_ASSERT_TRUE(copy->is_arena_owned);
+        TEST_ASSERT_TRUE(sbj_compare(original, copy));
+        expected = sbj_print_unformatted(original);
+        TEST_ASSERT_NOT_NULL(expected);
+        assert_printed(expected, copy);
+        sbJSON_free(expected);
+
+        sbj_delete(original);
+        sbj_arena_reset(arena);
+    }
+
+    sbj_arena_free(arena);
+}
+
+static void duplicate_into_arena_should_be_mutable(void) {
+    sbj_arena *arena = sbj_arena_new(0);
+    sbJSON *original = sbj_parse(document);
+    sbJSON *copy = NULL;
+
+    copy = sbj_duplicate_into_arena(arena, original);
+    TEST_ASSERT_NOT_NULL(copy);
+    /* the original can go, the copy lives in the arena */
+    sbj_delete(original);
+
+    TEST_ASSERT_NOT_NULL(
+        sbj_set_valuestring(sbj_get_object_item(copy, "name"), "a copy"));
+    sbj_delete_item_from_object(copy, "nested");
+    assert_printed("{\"name\":\"a copy\",\"list\":[1,2,{\"deep\":\"value\"}],"
+                   "\"number\":1.5}",
+                   copy);
+
+    /* releases the heap string of name */
+    sbj_delete(copy);
+    sbj_arena_free(arena);
+
+    TEST_ASSERT_NULL(sbj_duplicate_into_arena(NULL, NULL));
+}
+
+static void duplicate_shared_should_not_change_the_original(void) {
+    sbJSON *original = sbj_parse(document);
+    sbJSON *copy = sbj_duplicate_shared(original);
+    sbJSON *list = NULL;
+    sbJSON *deep = NULL;
+
+    TEST_ASSERT_NOT_NULL(copy);
+    TEST_ASSERT_TRUE(sbj_compare(original, copy));
+    assert_printed(
+        "{\"name\":\"original\",\"list\":[1,2,{\"deep\":\"value\"}],"
+        "\"nested\":{\"a\":{\"b\":[true,null]}},\"number\":1.5}",
+        copy);
+
+    /* change something at every level */
+    TEST_ASSERT_NOT_NULL(
+        sbj_set_valuestring(sbj_get_object_item(copy, "name"), "copy"));
+    list = sbj_get_object_item(copy, "list");
+    sbj_set_integer_number_value(sbj_get_array_item(list, 0), 10);
+    deep = sbj_get_array_item(list, 2);
+    sbj_add_true_to_object(deep, "added");
+    sbj_delete_item_from_array(list, 1);
+    sbj_delete_item_from_object(copy, "number");
+
+    assert_printed("{\"name\":\"copy\",\"list\":[10,{\"deep\":\"value\","
+                   "\"added\":true}],\"nested\":{\"a\":{\"b\":[true,null]}}}",
+                   copy);
+    assert_printed(document, original);
+
+    /* the untouched subtree is still the original's */
+    TEST_ASSERT_TRUE(sbj_get_object_item(copy, "nested")->is_reference);
+    TEST_ASSERT_EQUAL_PTR(sbj_get_object_item(original, "nested")->child,
+                          sbj_get_object_item(copy, "nested")->child);
+
+    sbj_delete(copy);
+    assert_printed(document, original);
+    sbj_delete(original);
+}
+
+static void duplicate_shared_copies_should_be_independent(void) {
+    sbJSON *original = sbj_parse(document);
+    sbJSON *first = sbj_duplicate_shared(original);
+    sbJSON *second = sbj_duplicate_shared(original);
+    sbJSON *deep_copy = NULL;
+    sbJSON *item = NULL;
+
+    item = sbj_get_object_item(sbj_get_object_item(first, "nested"), "a");
+    sbj_add_item_to_array(sbj_get_object_item(item, "b"),
+                          sbj_create_integer_number(3));
+    item = sbj_get_object_item(sbj_get_object_item(second, "nested"), "a");
+    sbj_delete_item_from_object(item, "b");
+
+    assert_printed("{\"a\":{\"b\":[true,null,3]}}",
+                   sbj_get_object_item(first, "nested"));
+    assert_printed("{\"a\":{}}", sbj_get_object_item(second, "nested"));
+    assert_printed(document, original);
+
+    /* a regular copy of a shared one owns all of its keys */
+    deep_copy = sbj_duplicate(first, true);
+    sbj_delete(first);
+    sbj_delete(second);
+    sbj_delete(original);
+    assert_printed(
+        "{\"name\":\"original\",\"list\":[1,2,{\"deep\":\"value\"}],"
+        "\"nested\":{\"a\":{\"b\":[true,null,3]}},\"number\":1.5}",
+        deep_copy);
+    sbj_delete(deep_copy);
+
+    TEST_ASSERT_NULL(sbj_duplicate_shared(NULL));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(duplicate_into_arena_should_match_duplicate);
+    RUN_TEST(duplicate_into_arena_should_be_mutable);
+    RUN_TEST(duplicate_shared_should_not_change_the_original);
+    RUN_TEST(duplicate_shared_copies_should_be_independent);
+
+    return UNITY_END();
+}
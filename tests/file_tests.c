@@ -0,0 +1,171 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static char const temporary_file[] = "file_tests.json";
+
+static void write_file(char const *contents, size_t length) {
+    FILE *file = fopen(temporary_file, "wb");
+
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL_size_t(length, fwrite(contents, 1, length, file));
+    TEST_ASSERT_EQUAL_INT(0, fclose(file));
+}
+
+static void file_should_parse_like_the_copied_text(void) {
+    char name[] = "inputs/test?";
+    char digit;
+
+    for (digit = '1'; digit <= '9'; digit++) {
+        char *json = NULL;
+        sbJSON *expected = NULL;
+        sbJSON *item = NULL;
+        sbJSON *in_situ = NULL;
+        sbj_mapped_file *mapping = NULL;
+        size_t error_offset = 0;
+
+        name[sizeof(name) - 2] = digit;
+        json = read_file(name);
+        TEST_ASSERT_NOT_NULL(json);
+        expected = sbj_parse(json);
+
+        item = sbj_parse_file(name, &error_offset);
+        in_situ = sbj_parse_file_in_situ(name, &mapping, &error_offset);
+        if (expected == NULL) {
+            TEST_ASSERT_NULL_MESSAGE(item, name);
+            TEST_ASSERT_NULL_MESSAGE(in_situ, name);
+            TEST_ASSERT_NULL(mapping);
+        } else {
+            TEST_ASSERT_TRUE_MESSAGE(sbj_compare(expected, item), name);
+            TEST_ASSERT_TRUE_MESSAGE(sbj_compare(expected, in_situ), name);
+            TEST_ASSERT_NOT_NULL(mapping);
+        }
+
+        sbj_delete(in_situ);
+        sbj_mapped_file_free(mapping);
+        sbj_delete(item);
+        sbj_delete(expected);
+        free(json);
+    }
+}
+
+static void file_should_reference_strings_in_situ(void) {
+    char const json[] = "{\"key\": [\"a\\nb\", \"plain\"]}\n";
+    sbj_mapped_file *mapping = NULL;
+    sbJSON *item = NULL;
+    sbJSON *array = NULL;
+    char *copy = NULL;
+
+    write_file(json, sizeof(json) - 1);
+    item = sbj_parse_file_in_situ(temporary_file, &mapping, NULL);
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_NOT_NULL(mapping);
+
+    array = sbj_get_object_item(item, "key");
+    TEST_ASSERT_TRUE(array->child->is_reference);
+    TEST_ASSERT_EQUAL_STRING("a\nb", sbj_get_string_value(array->child));
+    TEST_ASSERT_EQUAL_STRING("plain", sbj_get_string_value(array->child->next));
+
+    sbj_delete(item);
+    sbj_mapped_file_free(mapping);
+
+    /* the file is unchanged */
+    copy = read_file(temporary_file);
+    TEST_ASSERT_EQUAL_STRING(json, copy);
+    free(copy);
+    remove(temporary_file);
+}
+
+static void file_should_reject_trailing_content(void) {
+    char const trailing[] = "[1, 2] \n 3";
+    char const whitespace[] = "\t[1, 2]\r\n \n";
+    size_t error_offset = 0;
+    sbj_mapped_file *mapping = NULL;
+    sbJSON *item = NULL;
+
+    write_file(trailing, sizeof(trailing) - 1);
+    TEST_ASSERT_NULL(sbj_parse_file(temporary_file, &error_offset));
+    TEST_ASSERT_EQUAL_size_t(9, error_offset);
+    TEST_ASSERT_NULL(sbJSON_GetErrorPtr());
+    TEST_ASSERT_NULL(
+        sbj_parse_file_in_situ(temporary_file, &mapping, &error_offset));
+    TEST_ASSERT_NULL(mapping);
+    TEST_ASSERT_EQUAL_size_t(9, error_offset);
+
+    /* the offset is only written on failure */
+    write_file(whitespace, sizeof(whitespace) - 1);
+    error_offset = 42;
+    item = sbj_parse_file(temporary_file, &error_offset);
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_EQUAL_INT(2, sbj_get_array_size(item));
+    TEST_ASSERT_EQUAL_size_t(42, error_offset);
+    sbj_delete(item);
+    item = sbj_parse_file_in_situ(temporary_file, &mapping, &error_offset);
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_EQUAL_size_t(42, error_offset);
+    sbj_delete(item);
+    sbj_mapped_file_free(mapping);
+
+    remove(temporary_file);
+}
+
+static void file_should_report_errors(void) {
+    char const broken[] = "{\"a\": [1, }";
+    size_t error_offset = 0;
+    sbj_mapped_file *mapping = (sbj_mapped_file *)&error_offset;
+
+    write_file(broken, sizeof(broken) - 1);
+    TEST_ASSERT_NULL(sbj_parse_file(temporary_file, &error_offset));
+    TEST_ASSERT_EQUAL_size_t(10, error_offset);
+    TEST_ASSERT_NULL(sbj_parse_file(temporary_file, NULL));
+
+    write_file("", 0);
+    TEST_ASSERT_NULL(sbj_parse_file(temporary_file, &error_offset));
+    TEST_ASSERT_EQUAL_size_t(0, error_offset);
+    remove(temporary_file);
+
+    TEST_ASSERT_NULL(sbj_parse_file(temporary_file, &error_offset));
+    TEST_ASSERT_EQUAL_size_t((size_t)-1, error_offset);
+    TEST_ASSERT_NULL(sbj_parse_file_in_situ(temporary_file, &mapping, NULL));
+    TEST_ASSERT_NULL(mapping);
+    TEST_ASSERT_NULL(sbj_parse_file(NULL, NULL));
+    TEST_ASSERT_NULL(sbj_parse_file_in_situ("inputs/test1", NULL, NULL));
+    sbj_mapped_file_free(NULL);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(file_should_parse_like_the_copied_text);
+    RUN_TEST(file_should_reference_strings_in_situ);
+    RUN_TEST(file_should_reject_trailing_content);
+    RUN_TEST(file_should_report_errors);
+
+    return UNITY_END();
+}
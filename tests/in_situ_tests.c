@@ -0,0 +1,163 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static bool points_into(char const *pointer, char const *buffer,
+                        size_t length) {
+    return (pointer >= buffer) && (pointer < buffer + length);
+}
+
+/* every string and key of the tree lives in the buffer */
+static void assert_references_buffer(sbJSON const *item, char const *buffer,
+                                     size_t length) {
+    for (; item != NULL; item = item->next) {
+        if (item->string != NULL) {
+            TEST_ASSERT_TRUE(item->string_is_const);
+            TEST_ASSERT_TRUE(points_into(item->string, buffer, length));
+        }
+        if (item->type == sbJSON_String) {
+            TEST_ASSERT_TRUE(item->is_reference);
+            TEST_ASSERT_TRUE(points_into(item->u.valuestring, buffer, length));
+        }
+        if ((item->type == sbJSON_Array) || (item->type == sbJSON_Object)) {
+            TEST_ASSERT_FALSE(item->is_reference);
+            assert_references_buffer(item->child, buffer, length);
+        }
+    }
+}
+
+static void assert_in_situ_matches_parse(char const *json) {
+    size_t const length = strlen(json);
+    char *buffer = (char *)malloc(length + 1);
+    sbJSON *expected = sbj_parse_with_length(json, length);
+    sbJSON *actual = NULL;
+
+    TEST_ASSERT_NOT_NULL(buffer);
+    memcpy(buffer, json, length + 1);
+    actual = sbj_parse_in_situ(buffer, length);
+
+    if (expected == NULL) {
+        TEST_ASSERT_NULL_MESSAGE(actual, json);
+    } else {
+        TEST_ASSERT_NOT_NULL_MESSAGE(actual, json);
+        TEST_ASSERT_TRUE_MESSAGE(sbj_compare(expected, actual), json);
+        assert_references_buffer(actual, buffer, length);
+    }
+
+    /* must not free any of the strings */
+    sbj_delete(actual);
+    sbj_delete(expected);
+    free(buffer);
+}
+
+static void in_situ_should_parse_like_parse(void) {
+    static char const *const documents[] = {
+        "\"\"",
+        "\"plain\"",
+        "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"",
+        "\"\\u00e4\\u20ac\\ud83d\\ude00 mixed in\"",
+        "[\"a\", \"b\\nc\", 1, null, true, {\"key\": \"value\"}]",
+        "{\"\": \"\", \"esc\\taped key\": {\"x\\u0041\": [\"\"]}}",
+        "\xEF\xBB\xBF{\"bom\": \"yes\"}",
+        "[\"\\x\"]",
+        "{\"a\": \"unterminated}",
+        "[\"\\ud800\"]",
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        assert_in_situ_matches_parse(documents[i]);
+    }
+}
+
+static void in_situ_should_parse_test_files(void) {
+    char name[] = "inputs/test?";
+    char digit;
+
+    for (digit = '1'; digit <= '9'; digit++) {
+        char *json = NULL;
+        name[sizeof(name) - 2] = digit;
+        json = read_file(name);
+        TEST_ASSERT_NOT_NULL(json);
+        assert_in_situ_matches_parse(json);
+        free(json);
+    }
+}
+
+static void in_situ_trees_should_be_usable(void) {
+    char buffer[] = "{\"name\": \"in\\tsitu\", \"list\": [\"x\", \"y\"]}";
+    sbJSON *tree = sbj_parse_in_situ(buffer, sizeof(buffer) - 1);
+    sbJSON *copy = NULL;
+    char *printed = NULL;
+
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_EQUAL_STRING("in\tsitu",
+                             sbj_get_string_value(
+                                 sbj_get_object_item(tree, "name")));
+
+    /* a duplicate owns its values */
+    copy = sbj_duplicate(tree, true);
+    TEST_ASSERT_NOT_NULL(copy);
+    TEST_ASSERT_FALSE(sbj_get_object_item(copy, "name")->is_reference);
+
+    TEST_ASSERT_TRUE(sbj_add_item_to_array(sbj_get_object_item(tree, "list"),
+                                           sbJSON_CreateString("z")));
+    /* values of the duplicate are its own, keys are constant like the ones
+     * added with sbj_add_item_to_objectCS */
+    sbj_get_object_item(copy, "name")->u.valuestring[0] = 'I';
+    TEST_ASSERT_EQUAL_STRING("in\tsitu", sbj_get_string_value(
+                                             sbj_get_object_item(tree, "name")));
+    TEST_ASSERT_TRUE(sbj_get_object_item(copy, "list")->string_is_const);
+
+    sbj_delete_item_from_object(tree, "name");
+    printed = sbj_print_unformatted(tree);
+    TEST_ASSERT_EQUAL_STRING("{\"list\":[\"x\",\"y\",\"z\"]}", printed);
+    free(printed);
+
+    sbj_delete(tree);
+    sbj_delete(copy);
+}
+
+static void in_situ_should_reject_invalid_arguments(void) {
+    char buffer[] = "[]";
+
+    TEST_ASSERT_NULL(sbj_parse_in_situ(NULL, 2));
+    TEST_ASSERT_NULL(sbj_parse_in_situ(buffer, 0));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(in_situ_should_parse_like_parse);
+    RUN_TEST(in_situ_should_parse_test_files);
+    RUN_TEST(in_situ_trees_should_be_usable);
+    RUN_TEST(in_situ_should_reject_invalid_arguments);
+
+    return UNITY_END();
+}
@@ -212,12 +212,40 @@ static void sbjson_utils_should_pass_json_patch_test_sbjson_utils_tests(void) {
     TEST_ASSERT_FALSE_MESSAGE(failed, "Some tests failed.");
 }
 
+static void sbjson_utils_should_restore_moved_keys_on_failure(void) {
+    static char const *const failing[] = {
+        /* the key of the moved member changes */
+        "[{\"op\":\"move\",\"from\":\"/c\",\"path\":\"/b\"},"
+        "{\"op\":\"test\",\"path\":\"/b\",\"value\":3}]",
+        /* and replaces a member that is there */
+        "[{\"op\":\"move\",\"from\":\"/c\",\"path\":\"/a\"},"
+        "{\"op\":\"test\",\"path\":\"/a\",\"value\":3}]"};
+    size_t i;
+
+    for (i = 0; i < sizeof(failing) / sizeof(failing[0]); i++) {
+        sbJSON *original = sbj_parse("{\"a\":1,\"c\":2}");
+        sbJSON *object = sbj_duplicate(original, true);
+        sbJSON *patches = sbj_parse(failing[i]);
+
+        TEST_ASSERT_NOT_NULL(object);
+        TEST_ASSERT_NOT_NULL(patches);
+        TEST_ASSERT_TRUE(sbJSONUtils_AtomicApplyPatches(object, patches) != 0);
+        TEST_ASSERT_TRUE(sbj_compare(original, object));
+        TEST_ASSERT_EQUAL_STRING("c", object->child->next->string);
+
+        sbj_delete(patches);
+        sbj_delete(object);
+        sbj_delete(original);
+    }
+}
+
 int main(void) {
     UNITY_BEGIN();
 
     RUN_TEST(sbjson_utils_should_pass_json_patch_test_tests);
     RUN_TEST(sbjson_utils_should_pass_json_patch_test_spec_tests);
     RUN_TEST(sbjson_utils_should_pass_json_patch_test_sbjson_utils_tests);
+    RUN_TEST(sbjson_utils_should_restore_moved_keys_on_failure);
 
     return UNITY_END();
 }
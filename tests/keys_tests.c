@@ -0,0 +1,200 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static sbJSON *parse_with_keys(sbj_keys *keys, char const *json) {
+    sbj_context ctx;
+    sbJSON *tree = NULL;
+
+    sbj_context_init(&ctx, NULL);
+    ctx.keys = keys;
+    tree = sbj_parse_ctx(&ctx, json, strlen(json) + 1, NULL, false);
+    sbj_context_destroy(&ctx);
+
+    return tree;
+}
+
+static void keys_should_be_shared_across_documents(void) {
+    sbj_keys *keys = sbj_keys_new(0);
+    sbJSON *first = NULL;
+    sbJSON *second = NULL;
+    char const *name = NULL;
+
+    TEST_ASSERT_NOT_NULL(keys);
+    first = parse_with_keys(keys, "[{\"name\":1,\"id\":2},{\"name\":3}]");
+    second = parse_with_keys(keys, "{\"na\\u006de\":{\"id\":true}}");
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_NOT_NULL(second);
+    TEST_ASSERT_EQUAL_size_t(2, sbj_keys_count(keys));
+
+    name = sbj_keys_intern(keys, "name");
+    TEST_ASSERT_NOT_NULL(name);
+    TEST_ASSERT_EQUAL_size_t(2, sbj_keys_count(keys));
+    TEST_ASSERT_EQUAL_PTR(name, first->child->child->string);
+    TEST_ASSERT_EQUAL_PTR(name, first->child->next->child->string);
+    /* escaped names end up in the table as well */
+    TEST_ASSERT_EQUAL_PTR(name, second->child->string);
+    TEST_ASSERT_EQUAL_PTR(first->child->child->next->string,
+                          second->child->child->string);
+    TEST_ASSERT_TRUE(first->child->child->string_is_const);
+
+    /* lookups work by address and by contents */
+    TEST_ASSERT_EQUAL_PTR(first->child->child,
+                          sbj_get_object_item(first->child, name));
+    TEST_ASSERT_EQUAL_PTR(first->child->child->next,
+                          sbj_get_object_item(first->child, "id"));
+
+    sbj_delete(first);
+    sbj_delete(second);
+    sbj_keys_free(keys);
+}
+
+static void keys_should_survive_editing_trees(void) {
+    sbj_keys *keys = sbj_keys_new(0);
+    sbJSON *tree = parse_with_keys(keys, "{\"a\":\"x\",\"b\":[]}");
+    sbJSON *copy = NULL;
+    char *printed = NULL;
+
+    TEST_ASSERT_NOT_NULL(tree);
+    copy = sbj_duplicate(tree, true);
+    TEST_ASSERT_NOT_NULL(copy);
+    TEST_ASSERT_EQUAL_PTR(tree->child->string, copy->child->string);
+
+    TEST_ASSERT_TRUE(sbj_replace_item_in_object(tree, "a",
+                                                sbj_create_integer_number(1)));
+    sbj_delete_item_from_object(tree, "b");
+    printed = sbj_print_unformatted(tree);
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1}", printed);
+    free(printed);
+    printed = sbj_print_unformatted(copy);
+    TEST_ASSERT_EQUAL_STRING("{\"a\":\"x\",\"b\":[]}", printed);
+    free(printed);
+
+    sbj_delete(tree);
+    sbj_delete(copy);
+    sbj_keys_free(keys);
+}
+
+static void keys_should_respect_the_limit(void) {
+    sbj_keys *keys = sbj_keys_new(2);
+    sbJSON *tree = NULL;
+
+    TEST_ASSERT_NOT_NULL(keys);
+    tree = parse_with_keys(keys, "{\"a\":1,\"b\":2,\"c\":3,\"a\":4}");
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_EQUAL_size_t(2, sbj_keys_count(keys));
+    TEST_ASSERT_TRUE(tree->child->string_is_const);
+    /* "c" was past the limit, it has a key of its own (which may be stored
+     * inside its node, so it can be const too) */
+    TEST_ASSERT_EQUAL_STRING("c", tree->child->next->next->string);
+    TEST_ASSERT_NULL(sbj_keys_intern(keys, "c"));
+    TEST_ASSERT_EQUAL_PTR(tree->child->string,
+                          tree->child->next->next->next->string);
+    TEST_ASSERT_NULL(sbj_keys_intern(keys, "d"));
+
+    sbj_delete(tree);
+    sbj_keys_free(keys);
+}
+
+static void keys_should_grow(void) {
+    sbj_keys *keys = sbj_keys_new(0);
+    char const *interned[1000];
+    char name[16];
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(keys);
+    for (i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "key%u", (unsigned)i);
+        interned[i] = sbj_keys_intern(keys, name);
+        TEST_ASSERT_NOT_NULL(interned[i]);
+        TEST_ASSERT_EQUAL_STRING(name, interned[i]);
+    }
+    TEST_ASSERT_EQUAL_size_t(1000, sbj_keys_count(keys));
+    for (i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "key%u", (unsigned)i);
+        TEST_ASSERT_EQUAL_PTR(interned[i], sbj_keys_intern(keys, name));
+    }
+
+    sbj_keys_free(keys);
+}
+
+#ifdef SBJSON_THREADS
+static void *parse_thread(void *keys) {
+    char json[64];
+    sbJSON *tree = NULL;
+    int i;
+
+    for (i = 0; i < 500; i++) {
+        snprintf(json, sizeof(json), "{\"shared\":%d,\"own%d\":0}", i, i);
+        tree = parse_with_keys((sbj_keys *)keys, json);
+        if ((tree == NULL) ||
+            (tree->child->string != sbj_keys_intern(keys, "shared"))) {
+            sbj_delete(tree);
+            return keys; /* failure */
+        }
+        sbj_delete(tree);
+    }
+
+    return NULL;
+}
+
+static void keys_should_be_shared_by_threads(void) {
+    sbj_keys *keys = sbj_keys_new(0);
+    pthread_t threads[4];
+    void *result = NULL;
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(keys);
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        TEST_ASSERT_EQUAL_INT(
+            0, pthread_create(&threads[i], NULL, parse_thread, keys));
+    }
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        TEST_ASSERT_EQUAL_INT(0, pthread_join(threads[i], &result));
+        TEST_ASSERT_NULL(result);
+    }
+    TEST_ASSERT_EQUAL_size_t(501, sbj_keys_count(keys));
+
+    sbj_keys_free(keys);
+}
+#endif
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(keys_should_be_shared_across_documents);
+    RUN_TEST(keys_should_survive_editing_trees);
+    RUN_TEST(keys_should_respect_the_limit);
+    RUN_TEST(keys_should_grow);
+#ifdef SBJSON_THREADS
+    RUN_TEST(keys_should_be_shared_by_threads);
+#endif
+
+    return UNITY_END();
+}
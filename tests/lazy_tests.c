@@ -0,0 +1,186 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static char const message[] =
+    "{\"header\": {\"type\": \"route\", \"tenant\": \"t1\", \"ids\": [1, 2]},"
+    " \"body\": {\"payload\": [ {\"a\" : \"]}\\\"\"}, [[ ]], null ],"
+    " \"size\" : 3 }, \"count\": 7}";
+
+static void lazy_should_parse_containers_on_access(void) {
+    sbJSON *tree = sbj_parse_lazy(message, sizeof(message) - 1);
+    sbJSON *header = NULL;
+    sbJSON *body = NULL;
+
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_TRUE(tree->is_lazy);
+    TEST_ASSERT_NULL(tree->child);
+    TEST_ASSERT_TRUE(sbj_is_object(tree));
+
+    header = sbj_get_object_item(tree, "header");
+    TEST_ASSERT_FALSE(tree->is_lazy);
+    TEST_ASSERT_EQUAL_INT32(3, tree->child_count);
+    TEST_ASSERT_NOT_NULL(header);
+    TEST_ASSERT_TRUE(header->is_lazy);
+
+    TEST_ASSERT_EQUAL_STRING(
+        "route", sbj_get_string_value(sbj_get_object_item(header, "type")));
+    TEST_ASSERT_EQUAL_INT64(
+        7, sbj_get_object_item(tree, "count")->u.valueint);
+
+    body = sbj_get_object_item(tree, "body");
+    TEST_ASSERT_TRUE(body->is_lazy);
+
+    sbj_delete(tree);
+}
+
+static void lazy_should_print_untouched_containers_verbatim(void) {
+    sbJSON *tree = sbj_parse_lazy(message, sizeof(message) - 1);
+    char *printed = NULL;
+
+    TEST_ASSERT_NOT_NULL(tree);
+    printed = sbj_print(tree);
+    TEST_ASSERT_EQUAL_STRING(message, printed);
+    free(printed);
+
+    /* touch the header only, the body keeps its formatting */
+    TEST_ASSERT_NOT_NULL(sbj_get_object_item(
+        sbj_get_object_item(tree, "header"), "tenant"));
+    printed = sbj_print_unformatted(tree);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"header\":{\"type\":\"route\",\"tenant\":\"t1\",\"ids\":[1, 2]},"
+        "\"body\":{\"payload\": [ {\"a\" : \"]}\\\"\"}, [[ ]], null ],"
+        " \"size\" : 3 },\"count\":7}",
+        printed);
+    free(printed);
+
+    sbj_delete(tree);
+}
+
+static void lazy_trees_should_equal_parsed_trees(void) {
+    sbJSON *expected = sbj_parse(message);
+    sbJSON *tree = sbj_parse_lazy(message, sizeof(message) - 1);
+    sbJSON *copy = NULL;
+    char *printed = NULL;
+    char *expected_printed = sbj_print_unformatted(expected);
+
+    TEST_ASSERT_NOT_NULL(tree);
+    copy = sbj_duplicate(tree, true);
+    TEST_ASSERT_TRUE(copy->is_lazy);
+
+    TEST_ASSERT_TRUE(sbj_compare(expected, tree));
+    TEST_ASSERT_TRUE(sbj_compare(copy, expected));
+
+    TEST_ASSERT_TRUE(sbj_expand(tree, true));
+    printed = sbj_print_unformatted(tree);
+    TEST_ASSERT_EQUAL_STRING(expected_printed, printed);
+    free(printed);
+
+    free(expected_printed);
+    sbj_delete(copy);
+    sbj_delete(tree);
+    sbj_delete(expected);
+}
+
+static void lazy_should_support_iteration_and_mutation(void) {
+    char const json[] = "[[1, 2, 3], {\"a\": [4]}, \"five\"]";
+    sbJSON *tree = sbj_parse_lazy(json, sizeof(json) - 1);
+    sbJSON *element = NULL;
+    sbJSON *inner = NULL;
+    int64_t sum = 0;
+    char *printed = NULL;
+
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_EQUAL_INT(3, sbj_get_array_size(tree));
+
+    inner = sbj_get_array_item(tree, 0);
+    TEST_ASSERT_TRUE(inner->is_lazy);
+    sbJSON_ArrayForEach(element, inner) { sum += element->u.valueint; }
+    TEST_ASSERT_EQUAL_INT64(6, sum);
+    TEST_ASSERT_FALSE(inner->is_lazy);
+
+    inner = sbj_get_array_item(tree, 1);
+    TEST_ASSERT_TRUE(sbj_add_item_to_object(inner, "b", sbj_create_null()));
+    TEST_ASSERT_EQUAL_INT32(2, sbj_item_count(inner));
+    TEST_ASSERT_TRUE(sbj_get_object_item(inner, "a")->is_lazy);
+
+    printed = sbj_print_unformatted(tree);
+    TEST_ASSERT_EQUAL_STRING("[[1,2,3],{\"a\":[4],\"b\":null},\"five\"]",
+                             printed);
+    free(printed);
+
+    /* a reference shares the children of what it refers to */
+    element = sbj_get_object_item(inner, "a");
+    inner = sbj_create_array();
+    TEST_ASSERT_TRUE(sbj_add_item_reference_to_array(inner, element));
+    TEST_ASSERT_FALSE(element->is_lazy);
+    TEST_ASSERT_EQUAL_PTR(element->child, inner->child->child);
+    TEST_ASSERT_EQUAL_INT(1, sbj_get_array_size(inner->child));
+    sbj_delete(inner);
+
+    sbj_delete(tree);
+}
+
+static void lazy_should_check_brackets_and_strings(void) {
+    char const unbalanced[] = "{\"a\": [1, 2}";
+    char const unterminated[] = "[\"]]]";
+    char const invalid_inside[] = "{\"a\": [1, x], \"b\": 2}";
+    sbJSON *tree = NULL;
+
+    TEST_ASSERT_NULL(sbj_parse_lazy(unbalanced, sizeof(unbalanced) - 1));
+    TEST_ASSERT_NULL(sbj_parse_lazy(unterminated, sizeof(unterminated) - 1));
+    TEST_ASSERT_NULL(sbj_parse_lazy(NULL, 1));
+
+    /* the contents are only checked when they are parsed */
+    tree = sbj_parse_lazy(invalid_inside, sizeof(invalid_inside) - 1);
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_EQUAL_INT64(2, sbj_get_object_item(tree, "b")->u.valueint);
+    TEST_ASSERT_NULL(sbj_get_array_item(sbj_get_object_item(tree, "a"), 0));
+    TEST_ASSERT_EQUAL_INT(0,
+                          sbj_get_array_size(sbj_get_object_item(tree, "a")));
+    TEST_ASSERT_FALSE(sbj_expand(tree, true));
+    sbj_delete(tree);
+
+    /* scalars parse like always */
+    tree = sbj_parse_lazy("\"text\"", 6);
+    TEST_ASSERT_EQUAL_STRING("text", sbj_get_string_value(tree));
+    sbj_delete(tree);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(lazy_should_parse_containers_on_access);
+    RUN_TEST(lazy_should_print_untouched_containers_verbatim);
+    RUN_TEST(lazy_trees_should_equal_parsed_trees);
+    RUN_TEST(lazy_should_support_iteration_and_mutation);
+    RUN_TEST(lazy_should_check_brackets_and_strings);
+
+    return UNITY_END();
+}
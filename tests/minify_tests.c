@@ -155,6 +155,173 @@ static void sbjson_minify_should_not_loop_infinitely(void) {
     sbj_minify(string);
 }
 
+/* the minifier as it was before it worked on blocks, the output of the
+ * current one has to match it for any input */
+static void reference_minify(char *json) {
+    char *into = json;
+
+    while (json[0] != '\0') {
+        switch (json[0]) {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            json++;
+            break;
+        case '/':
+            if (json[1] == '/') {
+                for (json += 2; (json[0] != '\0') && (json[0] != '\n');
+                     json++) {
+                }
+                if (json[0] == '\n') {
+                    json++;
+                }
+            } else if (json[1] == '*') {
+                for (json += 2; json[0] != '\0'; json++) {
+                    if ((json[0] == '*') && (json[1] == '/')) {
+                        json += 2;
+                        break;
+                    }
+                }
+            } else {
+                json++;
+            }
+            break;
+        case '\"':
+            *into++ = *json++;
+            while (json[0] != '\0') {
+                if (json[0] == '\"') {
+                    *into++ = *json++;
+                    break;
+                }
+                if ((json[0] == '\\') && (json[1] == '\"')) {
+                    *into++ = *json++;
+                }
+                *into++ = *json++;
+            }
+            break;
+        default:
+            *into++ = *json++;
+        }
+    }
+
+    *into = '\0';
+}
+
+/* random JSON-like text with long plain runs, so that most blocks take the
+ * fast path, and every kind of escape in between. The pieces from '/' on are
+ * only used with comments. */
+static void random_json(char *buffer, size_t const length, bool const comments,
+                        unsigned long *const seed) {
+    static char const *const pieces[] = {
+        " ",
+        "\t",
+        "\r\n",
+        "                                        ",
+        "\"",
+        "\\",
+        "\\\"",
+        "\\\\\"",
+        "\n",
+        "\x01",
+        "{}[]:,",
+        "true",
+        "12.5e3",
+        "\"key\":",
+        "abcdefghijklmnopqrstuvwxyz0123456789",
+        "/",
+        "*",
+        "*/",
+        "//",
+        "/*",
+        "/**/"};
+    size_t const count = comments ? sizeof(pieces) / sizeof(pieces[0]) : 15;
+    size_t used = 0;
+
+    while (used < length) {
+        char const *piece = NULL;
+        size_t piece_length = 0;
+
+        *seed = *seed * 1103515245UL + 12345UL;
+        piece = pieces[(*seed >> 16) % count];
+        piece_length = strlen(piece);
+        if (piece_length > length - used) {
+            piece_length = length - used;
+        }
+        memcpy(buffer + used, piece, piece_length);
+        used += piece_length;
+    }
+    buffer[length] = '\0';
+}
+
+static void sbjson_minify_should_match_the_reference_minifier(void) {
+    static size_t const lengths[] = {0, 1, 63, 64, 65, 200, 1000, 10000};
+    unsigned long seed = 7;
+    size_t i = 0;
+    int round = 0;
+
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        for (round = 0; round < 50; round++) {
+            size_t const length = lengths[i];
+            char *expected = (char *)malloc(length + 1);
+            char *in_place = (char *)malloc(length + 1);
+            char *output = (char *)malloc(length + 1);
+            size_t written = 0;
+
+            TEST_ASSERT_NOT_NULL(expected);
+            TEST_ASSERT_NOT_NULL(in_place);
+            TEST_ASSERT_NOT_NULL(output);
+            random_json(expected, length, (round % 2) == 1, &seed);
+            memcpy(in_place, expected, length + 1);
+
+            written = sbj_minify_to_buffer(in_place, length, output);
+            reference_minify(expected);
+            sbj_minify(in_place);
+            TEST_ASSERT_EQUAL_STRING(expected, in_place);
+            TEST_ASSERT_EQUAL_STRING(expected, output);
+            TEST_ASSERT_EQUAL_size_t(strlen(expected), written);
+
+            free(output);
+            free(in_place);
+            free(expected);
+        }
+    }
+}
+
+static void sbjson_minify_should_keep_long_strings(void) {
+    char json[400];
+    char expected[400];
+    size_t i = 0;
+
+    /* strings and escaped quotes across block boundaries */
+    strcpy(json, "[ \"");
+    for (i = 0; i < 150; i++) {
+        strcat(json, (i % 37 == 0) ? "\\\"" : " x");
+    }
+    strcat(json, "\" , \"a\\\\\" ]");
+    strcpy(expected, json);
+
+    reference_minify(expected);
+    sbj_minify(json);
+    TEST_ASSERT_EQUAL_STRING(expected, json);
+    TEST_ASSERT_EQUAL_CHAR('[', json[0]);
+    TEST_ASSERT_EQUAL_CHAR(']', json[strlen(json) - 1]);
+}
+
+static void sbjson_minify_to_buffer_should_stop_at_length(void) {
+    char const json[] = "{ \"a\" : [ 1 , 2 ] } // comment";
+    char output[sizeof(json)];
+
+    TEST_ASSERT_EQUAL_size_t(5, sbj_minify_to_buffer(json, 8, output));
+    TEST_ASSERT_EQUAL_STRING("{\"a\":", output);
+    TEST_ASSERT_EQUAL_size_t(11,
+                             sbj_minify_to_buffer(json, sizeof(json), output));
+    TEST_ASSERT_EQUAL_STRING("{\"a\":[1,2]}", output);
+    /* json itself is unchanged */
+    TEST_ASSERT_EQUAL_CHAR(' ', json[1]);
+    TEST_ASSERT_EQUAL_size_t(0, sbj_minify_to_buffer(NULL, 3, output));
+}
+
 int main(void) {
     UNITY_BEGIN();
 
@@ -165,6 +332,9 @@ int main(void) {
     RUN_TEST(sbjson_minify_should_remove_spaces);
     RUN_TEST(sbjson_minify_should_not_modify_strings);
     RUN_TEST(sbjson_minify_should_not_loop_infinitely);
+    RUN_TEST(sbjson_minify_should_match_the_reference_minifier);
+    RUN_TEST(sbjson_minify_should_keep_long_strings);
+    RUN_TEST(sbjson_minify_to_buffer_should_stop_at_length);
 
     return UNITY_END();
 }
@@ -227,7 +227,10 @@ static void sbjson_should_not_parse_to_deeply_nested_jsons(void) {
 }
 
 static void sbjson_set_number_value_should_set_numbers(void) {
-    sbJSON number[1] = {{NULL, NULL, NULL, sbJSON_Number, NULL, 0, 0, NULL}};
+    sbJSON number[1];
+
+    memset(number, 0, sizeof(number));
+    number->type = sbJSON_Number;
 
     sbj_set_double_number_value(number, 1.5);
     TEST_ASSERT_TRUE(number->is_number_double);
@@ -253,6 +256,7 @@ static void sbjson_detach_item_via_pointer_should_detach_items(void) {
     sbJSON parent[1];
 
     memset(list, '\0', sizeof(list));
+    memset(parent, '\0', sizeof(parent));
 
     /* link the list */
     list[0].next = &(list[1]);
@@ -354,11 +358,12 @@ static void sbjson_replace_item_via_pointer_should_replace_items(void) {
 }
 
 static void sbjson_replace_item_in_object_should_preserve_name(void) {
-    sbJSON root[1] = {{NULL, NULL, NULL, 0, NULL, 0, 0, NULL}};
+    sbJSON root[1];
     sbJSON *child = NULL;
     sbJSON *replacement = NULL;
     bool flag = false;
 
+    memset(root, 0, sizeof(root));
     child = sbj_create_integer_number(1);
     TEST_ASSERT_NOT_NULL(child);
     replacement = sbj_create_integer_number(2);
@@ -488,8 +493,11 @@ static void *failing_realloc(void *pointer, size_t size) {
 }
 
 static void ensure_should_fail_on_failed_realloc(void) {
-    printbuffer buffer = {
-        NULL, 10, 0, 0, false, false, {&malloc, &free, &failing_realloc}};
+    printbuffer buffer = empty_printbuffer;
+    buffer.length = 10;
+    buffer.hooks.allocate = &malloc;
+    buffer.hooks.deallocate = &free;
+    buffer.hooks.reallocate = &failing_realloc;
     buffer.buffer = (unsigned char *)malloc(100);
     TEST_ASSERT_NOT_NULL(buffer.buffer);
 
@@ -499,7 +507,7 @@ static void ensure_should_fail_on_failed_realloc(void) {
 
 static void skip_utf8_bom_should_skip_bom(void) {
     const unsigned char string[] = "\xEF\xBB\xBF{}";
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = empty_parse_buffer;
     buffer.content = string;
     buffer.length = sizeof(string);
     buffer.hooks = global_hooks;
@@ -510,7 +518,7 @@ static void skip_utf8_bom_should_skip_bom(void) {
 
 static void skip_utf8_bom_should_not_skip_bom_if_not_at_beginning(void) {
     const unsigned char string[] = " \xEF\xBB\xBF{}";
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = empty_parse_buffer;
     buffer.content = string;
     buffer.length = sizeof(string);
     buffer.hooks = global_hooks;
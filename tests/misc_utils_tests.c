@@ -59,10 +59,71 @@ static void sbjson_utils_functions_shouldnt_crash_with_null_pointers(void) {
     sbj_delete(item);
 }
 
+static void get_pointer_should_find_members_of_large_objects(void) {
+    sbJSON *object = sbj_create_object();
+    char long_name[300];
+    char pointer[sizeof(long_name) + 1];
+    char name[32];
+    int i;
+
+    for (i = 0; i < 100; i++) {
+        sprintf(name, "key%d", i);
+        sbj_add_integer_number_to_object(object, name, i);
+    }
+    sbj_add_string_to_object(object, "a/b~c", "escaped");
+    memset(long_name, 'x', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    sbj_add_string_to_object(object, long_name, "long");
+    sprintf(pointer, "/%s", long_name);
+
+    TEST_ASSERT_EQUAL_INT64(99,
+                            sbJSONUtils_GetPointer(object, "/key99")->u.valueint);
+    TEST_ASSERT_NOT_NULL(object->u.index);
+    TEST_ASSERT_EQUAL_STRING(
+        "escaped", sbJSONUtils_GetPointer(object, "/a~1b~0c")->u.valuestring);
+    TEST_ASSERT_EQUAL_STRING(
+        "long", sbJSONUtils_GetPointer(object, pointer)->u.valuestring);
+    TEST_ASSERT_NULL(sbJSONUtils_GetPointer(object, "/a~2b~0c"));
+    TEST_ASSERT_NULL(sbJSONUtils_GetPointer(object, "/key100"));
+
+    sbj_delete(object);
+}
+
+static void patches_should_keep_child_count(void) {
+    sbJSON *array = sbj_create_array();
+    sbJSON *patches = sbj_parse(
+        "[{\"op\": \"add\", \"path\": \"/3\", \"value\": 1}, "
+        "{\"op\": \"remove\", \"path\": \"/0\"}, "
+        "{\"op\": \"add\", \"path\": \"/-\", \"value\": 2}, "
+        "{\"op\": \"move\", \"from\": \"/1\", \"path\": \"/10\"}]");
+    sbJSON *child = NULL;
+    int i;
+
+    for (i = 0; i < 40; i++) {
+        sbj_add_item_to_array(array, sbj_create_integer_number(i));
+    }
+    /* access far into the array so that it keeps a vector */
+    TEST_ASSERT_NOT_NULL(sbj_get_array_item(array, 39));
+
+    TEST_ASSERT_EQUAL_INT(0, sbJSONUtils_ApplyPatches(array, patches));
+    TEST_ASSERT_EQUAL_INT(41, sbj_get_array_size(array));
+    i = 0;
+    sbJSON_ArrayForEach(child, array) {
+        TEST_ASSERT_EQUAL_PTR(child, sbj_get_array_item(array, i));
+        i++;
+    }
+    TEST_ASSERT_EQUAL_INT(41, i);
+
+    sbj_delete(patches);
+    sbj_delete(array);
+}
+
 int main(void) {
     UNITY_BEGIN();
 
     RUN_TEST(sbjson_utils_functions_shouldnt_crash_with_null_pointers);
+    RUN_TEST(get_pointer_should_find_members_of_large_objects);
+    RUN_TEST(patches_should_keep_child_count);
 
     return UNITY_END();
 }
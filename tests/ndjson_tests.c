@@ -0,0 +1,164 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+/* Checks that the records arrive in order: record i is {"i": i, ...} */
+typedef struct {
+    size_t count;
+    size_t stop_after;
+} ndjson_counter;
+
+static bool count_record(void *user, sbJSON *record) {
+    ndjson_counter *const counter = (ndjson_counter *)user;
+    sbJSON *const index = sbj_get_object_item(record, "i");
+
+    TEST_ASSERT_NOT_NULL(index);
+    TEST_ASSERT_EQUAL_INT64((int64_t)counter->count,
+                            sbj_get_number_value(index));
+    counter->count++;
+    sbj_delete(record);
+
+    return counter->count != counter->stop_after;
+}
+
+static char *make_records(size_t count, size_t *length) {
+    size_t const capacity = count * 96 + 1;
+    char *const json = (char *)malloc(capacity);
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(json);
+    *length = 0;
+    for (i = 0; i < count; i++) {
+        *length += (size_t)snprintf(
+            json + *length, capacity - *length,
+            "{\"i\": %u, \"name\": \"record\\n%u\", \"values\": [1.5, "
+            "true, null]}%s",
+            (unsigned)i, (unsigned)i, (i % 7 == 0) ? "\r\n\n" : "\n");
+    }
+
+    return json;
+}
+
+static void ndjson_should_deliver_records_in_order(void) {
+    size_t const counts[] = {0, 1, 1000, 50000};
+    size_t const threads[] = {1, 3, 0};
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        size_t length = 0;
+        char *json = make_records(counts[i], &length);
+
+        for (j = 0; j < sizeof(threads) / sizeof(threads[0]); j++) {
+            ndjson_counter counter = {0, 0};
+            TEST_ASSERT_TRUE(sbj_parse_ndjson(json, length, threads[j],
+                                              count_record, &counter));
+            TEST_ASSERT_EQUAL_size_t(counts[i], counter.count);
+        }
+        free(json);
+    }
+}
+
+static bool keep_record(void *user, sbJSON *record) {
+    sbj_add_item_to_array((sbJSON *)user, record);
+    return true;
+}
+
+static void ndjson_should_parse_like_single_documents(void) {
+    char const json[] = "  \n[1, {\"a\": \"b\"}]\n\t\n\"string\"\r\n"
+                        "null\n-2.5e3\n{\"last\": true}";
+    sbJSON *records = sbj_create_array();
+    sbJSON *expected =
+        sbj_parse("[[1, {\"a\": \"b\"}], \"string\", null, -2.5e3, "
+                  "{\"last\": true}]");
+
+    TEST_ASSERT_TRUE(
+        sbj_parse_ndjson(json, sizeof(json) - 1, 2, keep_record, records));
+    TEST_ASSERT_TRUE(sbj_compare(expected, records));
+
+    sbj_delete(expected);
+    sbj_delete(records);
+}
+
+static void ndjson_should_report_invalid_records(void) {
+    char const broken[] = "{\"i\": 0}\n{\"i\": 1}\n{\"i\": 2,}\n{\"i\": 3}\n";
+    char const trailing[] = "{\"i\": 0}\n{\"i\": 1} 2\n";
+    size_t length = 0;
+    char *json = make_records(30000, &length);
+    char *parse_error = NULL;
+    ndjson_counter counter = {0, 0};
+
+    TEST_ASSERT_FALSE(sbj_parse_ndjson(broken, sizeof(broken) - 1, 1,
+                                       count_record, &counter));
+    TEST_ASSERT_EQUAL_size_t(2, counter.count);
+    TEST_ASSERT_EQUAL_PTR(strchr(broken, '}') + 19, sbJSON_GetErrorPtr());
+
+    counter.count = 0;
+    TEST_ASSERT_FALSE(sbj_parse_ndjson(trailing, sizeof(trailing) - 1, 1,
+                                       count_record, &counter));
+    TEST_ASSERT_EQUAL_size_t(1, counter.count);
+    TEST_ASSERT_EQUAL_PTR(strrchr(trailing, '2'), sbJSON_GetErrorPtr());
+
+    /* a broken record in the middle of a batch parsed by several threads */
+    parse_error = strchr(json + length / 2, '{');
+    *parse_error = '#';
+    counter.count = 0;
+    TEST_ASSERT_FALSE(
+        sbj_parse_ndjson(json, length, 4, count_record, &counter));
+    TEST_ASSERT_TRUE(counter.count > 0);
+    TEST_ASSERT_EQUAL_PTR(parse_error, sbJSON_GetErrorPtr());
+
+    free(json);
+}
+
+static void ndjson_should_stop_when_asked(void) {
+    size_t length = 0;
+    char *json = make_records(20000, &length);
+    ndjson_counter counter = {0, 100};
+
+    TEST_ASSERT_FALSE(
+        sbj_parse_ndjson(json, length, 4, count_record, &counter));
+    TEST_ASSERT_EQUAL_size_t(100, counter.count);
+
+    TEST_ASSERT_FALSE(sbj_parse_ndjson(NULL, 10, 1, count_record, &counter));
+    TEST_ASSERT_FALSE(sbj_parse_ndjson(json, length, 1, NULL, NULL));
+
+    free(json);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(ndjson_should_deliver_records_in_order);
+    RUN_TEST(ndjson_should_parse_like_single_documents);
+    RUN_TEST(ndjson_should_report_invalid_records);
+    RUN_TEST(ndjson_should_stop_when_asked);
+
+    return UNITY_END();
+}
@@ -0,0 +1,242 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+/* the lookup without an index, first member with the name wins */
+static sbJSON *linear_lookup(sbJSON const *object, char const *name) {
+    sbJSON *child = NULL;
+    for (child = object->child; child != NULL; child = child->next) {
+        if (strcmp(child->string, name) == 0) {
+            return child;
+        }
+    }
+
+    return NULL;
+}
+
+static sbJSON *create_large_object(int members) {
+    sbJSON *object = sbj_create_object();
+    char name[32];
+    int i;
+
+    TEST_ASSERT_NOT_NULL(object);
+    for (i = 0; i < members; i++) {
+        sprintf(name, "key%d", i);
+        TEST_ASSERT_NOT_NULL(sbj_add_integer_number_to_object(object, name, i));
+    }
+
+    return object;
+}
+
+static void assert_lookups_match(sbJSON const *object, int names) {
+    char name[32];
+    int i;
+
+    for (i = 0; i < names; i++) {
+        sprintf(name, "key%d", i);
+        TEST_ASSERT_EQUAL_PTR(linear_lookup(object, name),
+                              sbj_get_object_item(object, name));
+    }
+    TEST_ASSERT_NULL(sbj_get_object_item(object, "missing"));
+}
+
+static void lookup_should_index_large_objects_only(void) {
+    sbJSON *small = create_large_object(SBJSON_INDEX_THRESHOLD - 1);
+    sbJSON *large = create_large_object(1000);
+
+    TEST_ASSERT_NULL(sbj_get_object_item(small, "missing"));
+    TEST_ASSERT_NULL(small->u.index);
+    assert_lookups_match(small, SBJSON_INDEX_THRESHOLD);
+
+    /* lookups near the front don't have to walk far */
+    TEST_ASSERT_NOT_NULL(sbj_get_object_item(large, "key0"));
+    TEST_ASSERT_NULL(large->u.index);
+
+    TEST_ASSERT_EQUAL_INT64(999, sbj_get_object_item(large, "key999")->u.valueint);
+    TEST_ASSERT_NOT_NULL(large->u.index);
+    assert_lookups_match(large, 1000);
+
+    sbj_delete(small);
+    sbj_delete(large);
+}
+
+static void index_should_follow_additions_and_detaches(void) {
+    sbJSON *object = create_large_object(100);
+    char name[32];
+    int i;
+
+    TEST_ASSERT_TRUE(sbj_object_build_index(object));
+
+    /* grows the table a few times */
+    for (i = 100; i < 2000; i++) {
+        sprintf(name, "key%d", i);
+        TEST_ASSERT_NOT_NULL(sbj_add_integer_number_to_object(object, name, i));
+    }
+    TEST_ASSERT_NOT_NULL(object->u.index);
+    assert_lookups_match(object, 2000);
+
+    for (i = 0; i < 2000; i += 3) {
+        sprintf(name, "key%d", i);
+        sbj_delete_item_from_object(object, name);
+    }
+    sbj_delete(sbj_detach_item_via_pointer(object, object->child->prev));
+    TEST_ASSERT_NOT_NULL(object->u.index);
+    TEST_ASSERT_EQUAL_size_t(2000 - 667 - 1, object->u.index->count);
+    assert_lookups_match(object, 2000);
+
+    sbj_delete(object);
+}
+
+static void index_should_keep_first_of_duplicates(void) {
+    sbJSON *object = create_large_object(50);
+    sbJSON *first = NULL;
+    sbJSON *second = NULL;
+
+    first = sbj_add_string_to_object(object, "twice", "first");
+    second = sbj_add_string_to_object(object, "twice", "second");
+    TEST_ASSERT_TRUE(sbj_object_build_index(object));
+    TEST_ASSERT_EQUAL_PTR(first, sbj_get_object_item(object, "twice"));
+
+    /* later duplicates go unnoticed */
+    sbj_add_string_to_object(object, "twice", "third");
+    sbj_delete(sbj_detach_item_via_pointer(object, second));
+    TEST_ASSERT_EQUAL_PTR(first, sbj_get_object_item(object, "twice"));
+
+    /* the next one in the list takes the place of the first */
+    sbj_delete(sbj_detach_item_via_pointer(object, first));
+    TEST_ASSERT_EQUAL_STRING(
+        "third", sbj_get_object_item(object, "twice")->u.valuestring);
+
+    /* inserting in front hides the previous member */
+    first = sbJSON_CreateString("inserted");
+    first->string = strdup("key40");
+    TEST_ASSERT_TRUE(sbj_object_build_index(object));
+    TEST_ASSERT_TRUE(sbj_insert_item_in_array(object, 1, first));
+    TEST_ASSERT_EQUAL_PTR(first, sbj_get_object_item(object, "key40"));
+    assert_lookups_match(object, 50);
+
+    sbj_delete(object);
+}
+
+static void index_should_follow_replacements(void) {
+    sbJSON *object = create_large_object(100);
+    sbJSON *replacement = sbj_create_string_reference("replaced");
+
+    TEST_ASSERT_TRUE(sbj_object_build_index(object));
+    TEST_ASSERT_TRUE(sbj_replace_item_in_object(object, "key70", replacement));
+    TEST_ASSERT_NOT_NULL(object->u.index);
+    TEST_ASSERT_EQUAL_PTR(replacement, sbj_get_object_item(object, "key70"));
+
+    /* a different name */
+    replacement = sbj_create_null();
+    replacement->string = strdup("renamed");
+    TEST_ASSERT_TRUE(sbj_replace_item_via_pointer(
+        object, sbj_get_object_item(object, "key80"), replacement));
+    TEST_ASSERT_EQUAL_PTR(replacement, sbj_get_object_item(object, "renamed"));
+    TEST_ASSERT_NULL(sbj_get_object_item(object, "key80"));
+    assert_lookups_match(object, 100);
+
+    sbj_delete(object);
+}
+
+static void copies_should_not_share_the_index(void) {
+    sbJSON *object = create_large_object(100);
+    sbJSON *holder = sbj_create_object();
+    sbJSON *copy = NULL;
+
+    TEST_ASSERT_TRUE(sbj_object_build_index(object));
+    copy = sbj_duplicate(object, true);
+    TEST_ASSERT_NULL(copy->u.index);
+    TEST_ASSERT_TRUE(sbj_compare(object, copy));
+
+    TEST_ASSERT_TRUE(sbj_add_item_reference_to_object(holder, "ref", object));
+    TEST_ASSERT_NULL(holder->child->u.index);
+    TEST_ASSERT_FALSE(sbj_object_build_index(holder->child));
+    TEST_ASSERT_EQUAL_INT64(
+        99, sbj_get_object_item(holder->child, "key99")->u.valueint);
+    TEST_ASSERT_NULL(holder->child->u.index);
+
+    sbj_delete(holder);
+    sbj_delete(copy);
+    sbj_delete(object);
+}
+
+static void build_index_should_reject_other_items(void) {
+    sbJSON *array = sbj_create_array();
+    sbJSON *object = sbj_create_object();
+
+    TEST_ASSERT_FALSE(sbj_object_build_index(NULL));
+    TEST_ASSERT_FALSE(sbj_object_build_index(array));
+
+    /* members without a name end the linear lookup, they can't be indexed */
+    sbj_add_null_to_object(object, "named");
+    sbj_add_item_to_array(object, sbj_create_null());
+    TEST_ASSERT_FALSE(sbj_object_build_index(object));
+
+    sbj_object_drop_index(NULL);
+    sbj_object_drop_index(array);
+    sbj_delete(array);
+    sbj_delete(object);
+}
+
+static void arena_objects_should_only_be_indexed_explicitly(void) {
+    sbj_arena *arena = sbj_arena_new(0);
+    sbJSON *object = NULL;
+    char *printed = NULL;
+    sbJSON *large = create_large_object(100);
+
+    printed = sbj_print(large);
+    object = sbj_parse_into_arena(arena, printed, strlen(printed));
+    TEST_ASSERT_NOT_NULL(object);
+
+    TEST_ASSERT_NOT_NULL(sbj_get_object_item(object, "key99"));
+    TEST_ASSERT_NULL(object->u.index);
+
+    TEST_ASSERT_TRUE(sbj_object_build_index(object));
+    assert_lookups_match(object, 100);
+
+    sbj_delete(object);
+    sbj_arena_free(arena);
+    free(printed);
+    sbj_delete(large);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(lookup_should_index_large_objects_only);
+    RUN_TEST(index_should_follow_additions_and_detaches);
+    RUN_TEST(index_should_keep_first_of_duplicates);
+    RUN_TEST(index_should_follow_replacements);
+    RUN_TEST(copies_should_not_share_the_index);
+    RUN_TEST(build_index_should_reject_other_items);
+    RUN_TEST(arena_objects_should_only_be_indexed_explicitly);
+
+    return UNITY_END();
+}
@@ -195,6 +195,48 @@ static void merge_tests(void) {
     }
 }
 
+static void consuming_merge_tests(void) {
+    size_t i = 0;
+    char *after = NULL;
+    char name[16];
+    sbJSON *target = NULL;
+    sbJSON *patch = NULL;
+
+    for (i = 0; i < 15; i++) {
+        target = sbj_parse(merges[i][0]);
+        patch = sbj_parse(merges[i][1]);
+        target = sbJSONUtils_MergePatchConsume(target, patch);
+        after = sbj_print_unformatted(target);
+        TEST_ASSERT_EQUAL_STRING(merges[i][2], after);
+
+        free(after);
+        sbj_delete(target);
+    }
+
+    /* a target large enough to be looked up through its index */
+    target = sbj_create_object();
+    patch = sbj_create_object();
+    for (i = 0; i < 200; i++) {
+        sprintf(name, "k%u", (unsigned)i);
+        sbj_add_integer_number_to_object(target, name, (int64_t)i);
+        if (i % 3 == 0) {
+            sbj_add_null_to_object(patch, name);
+        } else if (i % 3 == 1) {
+            sbj_add_string_to_object(patch, name, "new");
+        }
+    }
+    sbj_add_true_to_object(patch, "added");
+    target = sbJSONUtils_MergePatchConsume(target, patch);
+    TEST_ASSERT_EQUAL_INT(134, sbj_get_array_size(target));
+    TEST_ASSERT_NULL(sbj_get_object_item(target, "k3"));
+    TEST_ASSERT_EQUAL_STRING("new",
+                             sbj_get_string_value(
+                                 sbj_get_object_item(target, "k4")));
+    TEST_ASSERT_EQUAL_INT(5, (int)sbj_get_object_item(target, "k5")->u.valueint);
+    TEST_ASSERT_TRUE(sbj_is_bool(sbj_get_object_item(target, "added")));
+    sbj_delete(target);
+}
+
 static void generate_merge_tests(void) {
     size_t i = 0;
     char *patchedtext = NULL;
@@ -222,6 +264,7 @@ int main(void) {
     RUN_TEST(misc_tests);
     RUN_TEST(sort_tests);
     RUN_TEST(merge_tests);
+    RUN_TEST(consuming_merge_tests);
     RUN_TEST(generate_merge_tests);
 
     return UNITY_END();
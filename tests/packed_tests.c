@@ -0,0 +1,308 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static size_t allocations = 0;
+
+static void *counting_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+static char const document[] =
+    "{\"ints\":[1, -2, 3, 9223372036854775807],"
+    "\"doubles\":[0.5, -1e3, 2.25],"
+    "\"mixed\":[1, 2.5],"
+    "\"strings\":[\"a\"],"
+    "\"empty\":[],"
+    "\"nested\":[[1, 2], [3.5], [true]]}";
+
+/* parses json both ways and checks that the printed results match */
+static void assert_prints_like_parse(char const *json) {
+    sbJSON *packed = sbj_parse_packed(json, strlen(json));
+    sbJSON *plain = sbj_parse(json);
+    char *expected = NULL;
+    char *printed = NULL;
+
+    if (plain == NULL) {
+        /* test6 isn't JSON */
+        TEST_ASSERT_NULL(packed);
+        return;
+    }
+    TEST_ASSERT_NOT_NULL(packed);
+
+    expected = sbj_print(plain);
+    printed = sbj_print(packed);
+    TEST_ASSERT_EQUAL_STRING(expected, printed);
+    TEST_ASSERT_EQUAL_UINT64(strlen(expected), sbj_print_length(packed, true));
+    sbJSON_free(printed);
+    sbJSON_free(expected);
+
+    expected = sbj_print_unformatted(plain);
+    printed = sbj_print_unformatted(packed);
+    TEST_ASSERT_EQUAL_STRING(expected, printed);
+    TEST_ASSERT_EQUAL_UINT64(strlen(expected),
+                             sbj_print_length(packed, false));
+    sbJSON_free(printed);
+    sbJSON_free(expected);
+
+    TEST_ASSERT_TRUE(sbj_compare(packed, plain));
+    TEST_ASSERT_TRUE(sbj_compare(plain, packed));
+    TEST_ASSERT_EQUAL_UINT64(sbj_hash(plain), sbj_hash(packed));
+
+    sbj_delete(plain);
+    sbj_delete(packed);
+}
+
+static void parse_packed_should_pack_homogeneous_arrays(void) {
+    sbJSON *root = sbj_parse_packed(document, sizeof(document) - 1);
+    sbJSON *nested = NULL;
+
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_TRUE(sbj_get_object_item(root, "ints")->is_packed);
+    TEST_ASSERT_TRUE(sbj_get_object_item(root, "doubles")->is_packed);
+    TEST_ASSERT_FALSE(sbj_get_object_item(root, "mixed")->is_packed);
+    TEST_ASSERT_FALSE(sbj_get_object_item(root, "strings")->is_packed);
+    TEST_ASSERT_FALSE(sbj_get_object_item(root, "empty")->is_packed);
+    TEST_ASSERT_EQUAL_INT(
+        4, sbj_get_array_size(sbj_get_object_item(root, "ints")));
+    TEST_ASSERT_NULL(sbj_get_object_item(root, "ints")->child);
+
+    nested = sbj_get_object_item(root, "nested");
+    TEST_ASSERT_FALSE(nested->is_packed);
+    TEST_ASSERT_TRUE(sbj_get_array_item(nested, 0)->is_packed);
+    TEST_ASSERT_TRUE(sbj_get_array_item(nested, 1)->is_packed);
+    TEST_ASSERT_FALSE(sbj_get_array_item(nested, 2)->is_packed);
+
+    sbj_delete(root);
+}
+
+static void parse_packed_should_print_like_parse(void) {
+    char name[] = "inputs/test?";
+    char digit;
+
+    assert_prints_like_parse(document);
+    assert_prints_like_parse("[1e300, -0.0, 1.5]");
+    assert_prints_like_parse("[ 1 , 2 ]");
+    for (digit = '1'; digit <= '9'; digit++) {
+        char *json = NULL;
+        name[sizeof(name) - 2] = digit;
+        json = read_file(name);
+        TEST_ASSERT_NOT_NULL(json);
+        assert_prints_like_parse(json);
+        free(json);
+    }
+}
+
+static void parse_packed_should_reject_what_parse_rejects(void) {
+    static char const *const invalid[] = {"[1, 2", "[1, 2,]", "[1 2]",
+                                          "[1, -]", "[1, 2.5, x]", "[1,"};
+    size_t i;
+
+    for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        char const *expected = NULL;
+
+        TEST_ASSERT_NULL(sbj_parse_with_length(invalid[i], strlen(invalid[i])));
+        expected = sbJSON_GetErrorPtr();
+        TEST_ASSERT_NULL(sbj_parse_packed(invalid[i], strlen(invalid[i])));
+        TEST_ASSERT_TRUE(expected == sbJSON_GetErrorPtr());
+    }
+}
+
+static void parse_packed_should_not_allocate_per_element(void) {
+    sbJSON_Hooks hooks = {counting_malloc, free};
+    char json[8 * 1000 + 2];
+    size_t length = 0;
+    int i;
+    sbJSON *array = NULL;
+    int64_t integers[1000];
+
+    json[length++] = '[';
+    for (i = 0; i < 1000; i++) {
+        length += (size_t)sprintf(json + length, (i == 0) ? "%d" : ",%d", i);
+    }
+    json[length++] = ']';
+
+    sbJSON_InitHooks(&hooks);
+    allocations = 0;
+    array = sbj_parse_packed(json, length);
+    TEST_ASSERT_NOT_NULL(array);
+    TEST_ASSERT_TRUE(array->is_packed);
+    /* the node, the block and growing the numbers past the stack */
+    TEST_ASSERT_TRUE(allocations < 16);
+
+    TEST_ASSERT_TRUE(sbj_get_integers(array, integers));
+    TEST_ASSERT_TRUE(array->is_packed);
+    for (i = 0; i < 1000; i++) {
+        TEST_ASSERT_EQUAL_INT64(i, integers[i]);
+    }
+
+    sbj_delete(array);
+    sbJSON_InitHooks(NULL);
+}
+
+static void accessing_children_should_unpack(void) {
+    sbJSON *array = sbj_parse_packed("[1, 2, 3]", 9);
+    sbJSON *element = NULL;
+    char *printed = NULL;
+    int64_t sum = 0;
+
+    TEST_ASSERT_TRUE(array->is_packed);
+    sbJSON_ArrayForEach(element, array) { sum += element->u.valueint; }
+    TEST_ASSERT_EQUAL_INT64(6, sum);
+    TEST_ASSERT_FALSE(array->is_packed);
+    TEST_ASSERT_EQUAL_INT(3, sbj_get_array_size(array));
+
+    TEST_ASSERT_TRUE(sbj_add_item_to_array(array, sbj_create_bool(true)));
+    printed = sbj_print_unformatted(array);
+    TEST_ASSERT_EQUAL_STRING("[1,2,3,true]", printed);
+    sbJSON_free(printed);
+    sbj_delete(array);
+
+    array = sbj_parse_packed("[1.5, 2.5]", 10);
+    TEST_ASSERT_TRUE(sbj_expand(array, true));
+    TEST_ASSERT_FALSE(array->is_packed);
+    TEST_ASSERT_TRUE(array->child->is_number_double);
+    TEST_ASSERT_EQUAL_DOUBLE(2.5, array->child->prev->u.valuedouble);
+    sbj_delete(array);
+}
+
+static void get_typed_values_should_fill_buffers(void) {
+    sbJSON *root = sbj_parse(
+        "{\"ints\":[1,2,3],\"mixed\":[1,2.5],\"bools\":[true,false],"
+        "\"other\":[1,\"a\"],\"empty\":[]}");
+    sbJSON *packed = sbj_parse_packed("[4,5]", 5);
+    int64_t integers[3] = {0, 0, 0};
+    double doubles[3] = {0, 0, 0};
+    bool booleans[2] = {false, true};
+
+    TEST_ASSERT_TRUE(
+        sbj_get_integers(sbj_get_object_item(root, "ints"), integers));
+    TEST_ASSERT_EQUAL_INT64(3, integers[2]);
+    TEST_ASSERT_TRUE(
+        sbj_get_doubles(sbj_get_object_item(root, "mixed"), doubles));
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, doubles[0]);
+    TEST_ASSERT_EQUAL_DOUBLE(2.5, doubles[1]);
+    TEST_ASSERT_FALSE(
+        sbj_get_integers(sbj_get_object_item(root, "mixed"), integers));
+    TEST_ASSERT_TRUE(
+        sbj_get_booleans(sbj_get_object_item(root, "bools"), booleans));
+    TEST_ASSERT_TRUE(booleans[0]);
+    TEST_ASSERT_FALSE(booleans[1]);
+    TEST_ASSERT_FALSE(
+        sbj_get_doubles(sbj_get_object_item(root, "other"), doubles));
+    TEST_ASSERT_TRUE(
+        sbj_get_integers(sbj_get_object_item(root, "empty"), integers));
+
+    TEST_ASSERT_TRUE(sbj_get_doubles(packed, doubles));
+    TEST_ASSERT_EQUAL_DOUBLE(5.0, doubles[1]);
+    TEST_ASSERT_FALSE(sbj_get_booleans(packed, booleans));
+    TEST_ASSERT_TRUE(packed->is_packed);
+
+    TEST_ASSERT_FALSE(sbj_get_integers(root, integers));
+    TEST_ASSERT_FALSE(sbj_get_integers(NULL, integers));
+    TEST_ASSERT_FALSE(sbj_get_doubles(packed, NULL));
+
+    sbj_delete(packed);
+    sbj_delete(root);
+}
+
+static void create_double_array_should_link_nodes(void) {
+    double const numbers[] = {1.5, -2, 1e300};
+    sbJSON *array = sbj_create_double_array(numbers, 3);
+    char *printed = NULL;
+
+    TEST_ASSERT_NOT_NULL(array);
+    TEST_ASSERT_FALSE(array->is_packed);
+    TEST_ASSERT_NOT_NULL(array->child);
+    TEST_ASSERT_EQUAL_DOUBLE(1e300, array->child->prev->u.valuedouble);
+    TEST_ASSERT_EQUAL_INT(3, sbj_get_array_size(array));
+    printed = sbj_print_unformatted(array);
+    TEST_ASSERT_EQUAL_STRING("[1.5,-2,1e+300]", printed);
+    sbJSON_free(printed);
+    sbj_delete(array);
+}
+
+static void create_packed_double_array_should_be_packed(void) {
+    double const numbers[] = {1.5, -2, 1e300};
+    sbJSON *array = sbj_create_packed_double_array(numbers, 3);
+    sbJSON *copy = NULL;
+    sbJSON *shared = NULL;
+    char *printed = NULL;
+    double doubles[3];
+
+    TEST_ASSERT_NOT_NULL(array);
+    TEST_ASSERT_TRUE(array->is_packed);
+    printed = sbj_print_unformatted(array);
+    TEST_ASSERT_EQUAL_STRING("[1.5,-2,1e+300]", printed);
+    sbJSON_free(printed);
+
+    copy = sbj_duplicate(array, true);
+    shared = sbj_duplicate_shared(array);
+    TEST_ASSERT_TRUE(copy->is_packed);
+    TEST_ASSERT_TRUE(sbj_compare(array, copy));
+    TEST_ASSERT_TRUE(sbj_compare(array, shared));
+    /* the copies have numbers of their own */
+    TEST_ASSERT_TRUE(sbj_get_array_item(copy, 0) != NULL);
+    TEST_ASSERT_TRUE(sbj_get_doubles(shared, doubles));
+    TEST_ASSERT_EQUAL_DOUBLE(-2, doubles[1]);
+    TEST_ASSERT_TRUE(array->is_packed);
+    sbj_delete(shared);
+    sbj_delete(copy);
+
+    /* without recurse there are no elements to copy */
+    copy = sbj_duplicate(array, false);
+    TEST_ASSERT_FALSE(copy->is_packed);
+    TEST_ASSERT_EQUAL_INT(0, sbj_get_array_size(copy));
+    sbj_delete(copy);
+    sbj_delete(array);
+
+    array = sbj_create_packed_double_array(numbers, 0);
+    TEST_ASSERT_NOT_NULL(array);
+    TEST_ASSERT_FALSE(array->is_packed);
+    sbj_delete(array);
+
+    TEST_ASSERT_NULL(sbj_create_packed_double_array(NULL, 3));
+    TEST_ASSERT_NULL(sbj_create_packed_double_array(numbers, -1));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(parse_packed_should_pack_homogeneous_arrays);
+    RUN_TEST(parse_packed_should_print_like_parse);
+    RUN_TEST(parse_packed_should_reject_what_parse_rejects);
+    RUN_TEST(parse_packed_should_not_allocate_per_element);
+    RUN_TEST(accessing_children_should_unpack);
+    RUN_TEST(get_typed_values_should_fill_buffers);
+    RUN_TEST(create_double_array_should_link_nodes);
+    RUN_TEST(create_packed_double_array_should_be_packed);
+
+    return UNITY_END();
+}
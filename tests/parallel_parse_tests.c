@@ -0,0 +1,176 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+/* A top-level array of count elements that is well above the size where
+ * sbj_parse_parallel starts splitting */
+static char *make_array(size_t count, size_t *length) {
+    size_t const capacity = count * 128 + 3;
+    char *const json = (char *)malloc(capacity);
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(json);
+    *length = 0;
+    json[(*length)++] = '[';
+    for (i = 0; i < count; i++) {
+        /* strings and nested containers with brackets and commas */
+        *length += (size_t)snprintf(
+            json + *length, capacity - *length,
+            "%s{\"i\": %u, \"s\": \"a, ]\\\"}, [\", \"n\": [[%u], {}]}\n",
+            (i == 0) ? "" : ",", (unsigned)i, (unsigned)i * 7);
+    }
+    json[(*length)++] = ']';
+    json[*length] = '\0';
+
+    return json;
+}
+
+static void assert_same_as_serial(char const *json, size_t length,
+                                  size_t threads) {
+    sbJSON *expected = sbj_parse_with_length(json, length);
+    char const *expected_error = sbJSON_GetErrorPtr();
+    sbJSON *item = sbj_parse_parallel(json, length, threads);
+
+    if (expected == NULL) {
+        TEST_ASSERT_NULL(item);
+        TEST_ASSERT_EQUAL_PTR(expected_error, sbJSON_GetErrorPtr());
+        return;
+    }
+
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_NULL(sbJSON_GetErrorPtr());
+    TEST_ASSERT_TRUE(sbj_compare(expected, item));
+    TEST_ASSERT_EQUAL_INT32(expected->child_count, item->child_count);
+
+    sbj_delete(item);
+    sbj_delete(expected);
+}
+
+static void parallel_should_build_the_serial_tree(void) {
+    size_t const threads[] = {1, 2, 3, 8, 0};
+    size_t length = 0;
+    char *json = make_array(20000, &length);
+    size_t i;
+
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        assert_same_as_serial(json, length, threads[i]);
+        assert_same_as_serial(json, length + 1, threads[i]);
+    }
+
+    free(json);
+}
+
+static void parallel_should_link_children_like_add_item_to_array(void) {
+    size_t length = 0;
+    char *json = make_array(10000, &length);
+    sbJSON *item = sbj_parse_parallel(json, length, 4);
+    sbJSON *child = NULL;
+    sbJSON *previous = NULL;
+    int32_t count = 0;
+
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_EQUAL_INT32(10000, item->child_count);
+    for (child = item->child; child != NULL; child = child->next) {
+        if (previous != NULL) {
+            TEST_ASSERT_EQUAL_PTR(previous, child->prev);
+        }
+        TEST_ASSERT_EQUAL_INT64(
+            count, sbj_get_number_value(sbj_get_object_item(child, "i")));
+        previous = child;
+        count++;
+    }
+    TEST_ASSERT_EQUAL_INT32(10000, count);
+    TEST_ASSERT_EQUAL_PTR(previous, item->child->prev);
+    TEST_ASSERT_EQUAL_INT64(
+        5000, sbj_get_number_value(
+                  sbj_get_object_item(sbj_get_array_item(item, 5000), "i")));
+
+    /* appending goes after the spliced tail */
+    TEST_ASSERT_TRUE(sbj_add_item_to_array(item, sbj_create_null()));
+    TEST_ASSERT_TRUE(sbj_is_null(sbj_get_array_item(item, 10000)));
+
+    sbj_delete(item);
+    free(json);
+}
+
+static void parallel_should_report_errors_like_serial(void) {
+    size_t length = 0;
+    char *json = make_array(5000, &length);
+    char *position = NULL;
+
+    /* an empty element in the middle */
+    position = strstr(json + length / 2, ",{");
+    position[1] = ',';
+    assert_same_as_serial(json, length, 4);
+    position[1] = '{';
+
+    /* a trailing comma */
+    json[length - 1] = ',';
+    json[length] = ']';
+    assert_same_as_serial(json, length + 1, 4);
+
+    /* the wrong closing bracket */
+    json[length] = '}';
+    json[length - 1] = ' ';
+    assert_same_as_serial(json, length + 1, 4);
+
+    /* no end at all */
+    assert_same_as_serial(json, length - 1, 4);
+
+    /* garbage in an element */
+    json[length - 1] = ']';
+    position = strstr(json + length / 3, "\"n\"");
+    position[0] = 'x';
+    assert_same_as_serial(json, length, 4);
+
+    free(json);
+}
+
+static void parallel_should_parse_other_documents(void) {
+    static char const *const documents[] = {
+        "[]", "[1, 2]", "{\"a\": [1, 2]}", "\"string\"", "[1,", "",
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        assert_same_as_serial(documents[i], strlen(documents[i]) + 1, 4);
+    }
+    TEST_ASSERT_NULL(sbj_parse_parallel(NULL, 10, 4));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(parallel_should_build_the_serial_tree);
+    RUN_TEST(parallel_should_link_children_like_add_item_to_array);
+    RUN_TEST(parallel_should_report_errors_like_serial);
+    RUN_TEST(parallel_should_parse_other_documents);
+
+    return UNITY_END();
+}
@@ -0,0 +1,148 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static void assert_same_text(sbJSON const *item) {
+    size_t const threads[] = {1, 2, 3, 8, 0};
+    char *expected = sbj_print(item);
+    char *expected_unformatted = sbj_print_unformatted(item);
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(expected);
+    TEST_ASSERT_NOT_NULL(expected_unformatted);
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        char *printed = sbj_print_parallel(item, true, threads[i]);
+        TEST_ASSERT_EQUAL_STRING(expected, printed);
+        free(printed);
+
+        printed = sbj_print_parallel(item, false, threads[i]);
+        TEST_ASSERT_EQUAL_STRING(expected_unformatted, printed);
+        free(printed);
+    }
+
+    free(expected_unformatted);
+    free(expected);
+}
+
+static sbJSON *make_record(size_t i) {
+    sbJSON *record = sbj_create_object();
+    sbJSON *values = sbj_add_array_to_object(record, "values");
+
+    sbj_add_integer_number_to_object(record, "i", (int64_t)i);
+    sbj_add_string_to_object(record, "name", "record \"quoted\"\n");
+    sbj_add_item_to_array(values, sbj_create_double_number(0.5 * (double)i));
+    sbj_add_item_to_array(values, sbj_create_bool(i % 2 == 0));
+    sbj_add_item_to_array(values, sbj_create_object());
+
+    return record;
+}
+
+static void parallel_print_should_match_arrays(void) {
+    size_t const counts[] = {SBJSON_PARALLEL_THRESHOLD - 1,
+                             SBJSON_PARALLEL_THRESHOLD,
+                             3 * SBJSON_PARALLEL_THRESHOLD + 5};
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        sbJSON *array = sbj_create_array();
+        for (j = 0; j < counts[i]; j++) {
+            sbj_add_item_to_array(array, make_record(j));
+        }
+        assert_same_text(array);
+        sbj_delete(array);
+    }
+}
+
+static void parallel_print_should_match_nested_objects(void) {
+    sbJSON *root = sbj_create_object();
+    sbJSON *members = sbj_add_object_to_object(root, "members");
+    sbJSON *list = NULL;
+    char key[32];
+    size_t i;
+
+    sbj_add_string_to_object(root, "first", "value");
+    for (i = 0; i < 2 * SBJSON_PARALLEL_THRESHOLD + 1; i++) {
+        snprintf(key, sizeof(key), "key %u", (unsigned)i);
+        sbj_add_item_to_object(members, key, make_record(i));
+    }
+    /* a large array inside an object inside the large object */
+    list = sbj_add_array_to_object(sbj_get_object_item(members, "key 7"),
+                                   "list");
+    for (i = 0; i < SBJSON_PARALLEL_THRESHOLD; i++) {
+        sbj_add_item_to_array(list, sbj_create_integer_number((int64_t)i));
+    }
+    sbj_add_null_to_object(root, "last");
+
+    assert_same_text(root);
+    sbj_delete(root);
+}
+
+static void parallel_print_should_match_small_trees(void) {
+    sbJSON *item = sbj_parse("[1, {\"a\": [true, null]}, \"s\", 2.5]");
+
+    assert_same_text(item);
+    sbj_delete(item);
+
+    item = sbj_create_array();
+    assert_same_text(item);
+    sbj_delete(item);
+
+    TEST_ASSERT_NULL(sbj_print_parallel(NULL, true, 4));
+}
+
+static void parallel_print_should_fail_on_invalid_children(void) {
+    sbJSON *array = sbj_create_array();
+    sbJSON *invalid = NULL;
+    size_t i;
+
+    for (i = 0; i < 2 * SBJSON_PARALLEL_THRESHOLD; i++) {
+        sbj_add_item_to_array(array, make_record(i));
+    }
+    invalid = sbj_get_array_item(array, SBJSON_PARALLEL_THRESHOLD + 3);
+    invalid->type = sbJSON_Invalid;
+
+    TEST_ASSERT_NULL(sbj_print(array));
+    TEST_ASSERT_NULL(sbj_print_parallel(array, true, 4));
+    TEST_ASSERT_NULL(sbj_print_parallel(array, false, 4));
+
+    invalid->type = sbJSON_Object;
+    sbj_delete(array);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(parallel_print_should_match_arrays);
+    RUN_TEST(parallel_print_should_match_nested_objects);
+    RUN_TEST(parallel_print_should_match_small_trees);
+    RUN_TEST(parallel_print_should_fail_on_invalid_children);
+
+    return UNITY_END();
+}
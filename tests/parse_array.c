@@ -42,7 +42,7 @@ static void assert_is_array(sbJSON *array_item) {
 }
 
 static void assert_not_array(const char *json) {
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = empty_parse_buffer;
     buffer.content = (const unsigned char *)json;
     buffer.length = strlen(json) + sizeof("");
     buffer.hooks = global_hooks;
@@ -52,7 +52,7 @@ static void assert_not_array(const char *json) {
 }
 
 static void assert_parse_array(const char *json) {
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = empty_parse_buffer;
     buffer.content = (const unsigned char *)json;
     buffer.length = strlen(json) + sizeof("");
     buffer.hooks = global_hooks;
@@ -70,6 +70,12 @@ static void parse_double() {
     TEST_ASSERT_TRUE(test_double("[123e34]", 123e34));                                  // Fast Path Cases In Disguise
     TEST_ASSERT_TRUE(test_double("[45913141877270640000.0]", 45913141877270640000.0));
     TEST_ASSERT_TRUE(test_double("[2.2250738585072011e-308]", 2.2250738585072011e-308)); // http://www.exploringbinary.com/php-hangs-on-numeric-value-2-2250738585072011e-308/
+    TEST_ASSERT_TRUE(test_double("[0.30000000000000004]", 0.30000000000000004));
+    TEST_ASSERT_TRUE(test_double("[1e23]", 1e23));
+    TEST_ASSERT_TRUE(test_double("[9007199254740993.0]", 9007199254740992.0));                   // halfway, round to even
+    TEST_ASSERT_TRUE(test_double("[9007199254740993.00000000000000000001]", 9007199254740994.0)); // just above halfway
+    TEST_ASSERT_TRUE(test_double("[12345678901234567890123456789e-10]", 1234567890123456789.0123456789));
+    TEST_ASSERT_TRUE(test_double("[1e400]", HUGE_VAL));
 }
 
 int main(void) {
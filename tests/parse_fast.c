@@ -0,0 +1,207 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static const char *const test_files[] = {
+    "inputs/test1", "inputs/test2", "inputs/test3", "inputs/test4",
+    "inputs/test5", "inputs/test6", "inputs/test7", "inputs/test8",
+    "inputs/test9", "inputs/test10", "inputs/test11"};
+
+/* both engines have to agree on whether the input is valid and on the tree
+ * they build from it */
+static void assert_engines_agree(char const *json, size_t length) {
+    sbJSON *expected = sbj_parse_with_length(json, length);
+    sbJSON *actual = sbj_parse_fast(json, length);
+    char *expected_printed = NULL;
+    char *actual_printed = NULL;
+
+    if (expected == NULL) {
+        TEST_ASSERT_NULL_MESSAGE(actual, json);
+        TEST_ASSERT_NOT_NULL(sbJSON_GetErrorPtr());
+        return;
+    }
+    TEST_ASSERT_NOT_NULL_MESSAGE(actual, json);
+    TEST_ASSERT_TRUE(sbj_compare(expected, actual));
+
+    expected_printed = sbj_print(expected);
+    actual_printed = sbj_print(actual);
+    TEST_ASSERT_EQUAL_STRING(expected_printed, actual_printed);
+    free(expected_printed);
+    free(actual_printed);
+
+    expected_printed = sbj_print_unformatted(expected);
+    actual_printed = sbj_print_unformatted(actual);
+    TEST_ASSERT_EQUAL_STRING(expected_printed, actual_printed);
+    free(expected_printed);
+    free(actual_printed);
+
+    sbj_delete(expected);
+    sbj_delete(actual);
+}
+
+static void parse_fast_should_match_regular_parse_on_inputs(void) {
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(test_files) / sizeof(test_files[0]); i++) {
+        char *json = read_file(test_files[i]);
+        TEST_ASSERT_NOT_NULL_MESSAGE(json, "Failed to read test file.");
+
+        assert_engines_agree(json, strlen(json) + sizeof(""));
+        /* without the terminating null character */
+        assert_engines_agree(json, strlen(json));
+
+        free(json);
+    }
+}
+
+static void parse_fast_should_match_regular_parse_on_edge_cases(void) {
+    static const char *const inputs[] = {
+        "", " ", "null", "nul", "nullx", "true", "false", "tru", "-", "0",
+        "-0.5e+3", "1.5.3", "1e", "[1-2]", "123abc", "\"\"", "\"abc",
+        "\"a\\\"b\"", "\"\\", "\"\\u00e4\\ud83d\\ude00\"", "\"\\uZZZZ\"", "[]",
+        "[ ]", "{}", "{ }", "[", "]", "{", "}", "[1,]", "[,1]", "[1 2]",
+        "[1,,2]", "[nullx]", "[null,true,false]", "[[[]]]", "[[]", "[]]",
+        "{\"a\":1}", "{\"a\" 1}", "{\"a\":}", "{\"a\"}", "{a:1}", "{,}",
+        "{\"a\":1,}", "{\"a\":1\"b\":2}", "{\"a\":[1,{\"b\":null}],\"c\":\"d\"}",
+        "[1\"a\"]", "[\"a\"1]", "[\"a\":1]", "{\"a\",1}", "[}", "{]",
+        "[] trailing garbage", "{} ]", "  \t\r\n[\n1\n,\n2\n]\n  ",
+        "\xEF\xBB\xBF[1]", "\xEF\xBB\xBF", "[\"unterminated]",
+        "{\"key with spaces and  \\t tabs\":\"  value  \"}",
+        "[\"a string that is longer than a couple of machine words\",1]",
+        "                                          [1]"};
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        assert_engines_agree(inputs[i], strlen(inputs[i]) + sizeof(""));
+        if (inputs[i][0] != '\0') {
+            assert_engines_agree(inputs[i], strlen(inputs[i]));
+        }
+    }
+}
+
+static void parse_fast_should_match_regular_parse_on_mutated_inputs(void) {
+    static const char replacements[] = "[]{},:\" \\-1e.ax\0";
+    unsigned long state = 12345;
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(test_files) / sizeof(test_files[0]); i++) {
+        char *json = read_file(test_files[i]);
+        size_t const length = strlen(json);
+        size_t run = 0;
+
+        TEST_ASSERT_NOT_NULL_MESSAGE(json, "Failed to read test file.");
+        for (run = 0; run < 200; run++) {
+            char *mutated = (char *)malloc(length + 1);
+            size_t position = 0;
+            TEST_ASSERT_NOT_NULL(mutated);
+            memcpy(mutated, json, length + 1);
+
+            state = state * 1103515245 + 12345;
+            position = (state >> 8) % length;
+            state = state * 1103515245 + 12345;
+            mutated[position] =
+                replacements[(state >> 8) % (sizeof(replacements) - 1)];
+
+            assert_engines_agree(mutated, length + 1);
+            /* cut off before the end */
+            assert_engines_agree(mutated, position + 1);
+            free(mutated);
+        }
+        free(json);
+    }
+}
+
+static void parse_fast_should_respect_nesting_limit(void) {
+    char deep[SBJSON_NESTING_LIMIT + 2];
+    sbJSON *item = NULL;
+
+    memset(deep, '[', sizeof(deep) - 1);
+    deep[sizeof(deep) - 1] = '\0';
+    TEST_ASSERT_NULL(sbj_parse_fast(deep, sizeof(deep)));
+    TEST_ASSERT_NULL(sbj_parse_with_length(deep, sizeof(deep)));
+
+    /* exactly on the limit works */
+    {
+        char *nested = (char *)malloc(2 * SBJSON_NESTING_LIMIT + 1);
+        TEST_ASSERT_NOT_NULL(nested);
+        memset(nested, '[', SBJSON_NESTING_LIMIT);
+        memset(nested + SBJSON_NESTING_LIMIT, ']', SBJSON_NESTING_LIMIT);
+        nested[2 * SBJSON_NESTING_LIMIT] = '\0';
+        item = sbj_parse_fast(nested, 2 * SBJSON_NESTING_LIMIT + 1);
+        TEST_ASSERT_NOT_NULL(item);
+        assert_engines_agree(nested, 2 * SBJSON_NESTING_LIMIT + 1);
+        sbj_delete(item);
+        free(nested);
+    }
+}
+
+static void parse_fast_should_report_error_position(void) {
+    const char json[] = "{\"a\": [1, 2 3]}";
+
+    TEST_ASSERT_NULL(sbj_parse_fast(json, sizeof(json)));
+    TEST_ASSERT_EQUAL_PTR(json + 12, sbJSON_GetErrorPtr());
+    TEST_ASSERT_NULL(sbj_parse_fast(NULL, 10));
+    TEST_ASSERT_NULL(sbj_parse_fast(json, 0));
+}
+
+static void parse_fast_should_handle_tokens_across_blocks(void) {
+    /* shift every byte of the document over the 64 byte blocks stage 1 works
+     * on, with escapes and long strings right at the edges */
+    static const char document[] =
+        "{\"a\\\"b\":[\"\\\\\",\"\\\\\\\"x\",12.5,-3,true,null],"
+        "\"long\":\"0123456789012345678901234567890123456789012345678901234567"
+        "89012345678901234567890123456789\\n012345678901234567890123456789\","
+        "\"nested\":{\"empty\":{},\"list\":[[],[{}]],\"k\":\"v\"}}";
+    char json[130 + sizeof(document)];
+    size_t padding = 0;
+
+    for (padding = 0; padding < 130; padding++) {
+        memset(json, ' ', padding);
+        memcpy(json + padding, document, sizeof(document));
+        assert_engines_agree(json, padding + sizeof(document));
+        /* and cut off at every block edge */
+        if (padding + sizeof(document) > 128) {
+            assert_engines_agree(json, 128);
+        }
+        assert_engines_agree(json, 64);
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(parse_fast_should_match_regular_parse_on_inputs);
+    RUN_TEST(parse_fast_should_match_regular_parse_on_edge_cases);
+    RUN_TEST(parse_fast_should_match_regular_parse_on_mutated_inputs);
+    RUN_TEST(parse_fast_should_handle_tokens_across_blocks);
+    RUN_TEST(parse_fast_should_respect_nesting_limit);
+    RUN_TEST(parse_fast_should_report_error_position);
+
+    return UNITY_END();
+}
@@ -43,7 +43,7 @@ static void assert_is_number(sbJSON *number_item) {
 }
 
 static void assert_parse_double_number(const char *string, double real) {
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = empty_parse_buffer;
     buffer.content = (const unsigned char *)string;
     buffer.length = strlen(string) + sizeof("");
 
@@ -54,7 +54,7 @@ static void assert_parse_double_number(const char *string, double real) {
 }
 
 static void assert_parse_integer_number(const char *string, int integer) {
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = empty_parse_buffer;
     buffer.content = (const unsigned char *)string;
     buffer.length = strlen(string) + sizeof("");
 
@@ -64,6 +64,27 @@ static void assert_parse_integer_number(const char *string, int integer) {
     TEST_ASSERT_EQUAL_INT(integer, item->u.valueint);
 }
 
+static void assert_parse_int64_number(const char *string, int64_t integer) {
+    parse_buffer buffer = empty_parse_buffer;
+    buffer.content = (const unsigned char *)string;
+    buffer.length = strlen(string) + sizeof("");
+
+    TEST_ASSERT_TRUE(parse_number(item, &buffer));
+    assert_is_number(item);
+    TEST_ASSERT_FALSE(item->is_number_double);
+    TEST_ASSERT_EQUAL_INT64(integer, item->u.valueint);
+    TEST_ASSERT_EQUAL_size_t(strlen(string), buffer.offset);
+}
+
+static void assert_parse_number_length(const char *string, size_t length) {
+    parse_buffer buffer = empty_parse_buffer;
+    buffer.content = (const unsigned char *)string;
+    buffer.length = strlen(string) + sizeof("");
+
+    TEST_ASSERT_TRUE(parse_number(item, &buffer));
+    TEST_ASSERT_EQUAL_size_t(length, buffer.offset);
+}
+
 static void parse_number_should_parse_zero(void) {
     assert_parse_integer_number("0", 0);
     assert_parse_double_number("0.0", 0.0);
@@ -103,6 +124,77 @@ static void parse_number_should_parse_negative_reals(void) {
     assert_parse_double_number("-123e-128", -123e-128);
 }
 
+static void parse_number_should_keep_int64_limits_exact(void) {
+    assert_parse_int64_number("9223372036854775807", INT64_MAX);
+    assert_parse_int64_number("-9223372036854775808", INT64_MIN);
+    assert_parse_int64_number("-9223372036854775807", -INT64_MAX);
+    assert_parse_int64_number("0009223372036854775807", INT64_MAX);
+
+    assert_parse_double_number("9223372036854775808", 9223372036854775808.0);
+    assert_parse_double_number("-9223372036854775809", -9223372036854775808.0);
+    assert_parse_double_number("99999999999999999999", 1e20);
+}
+
+static void parse_number_should_parse_long_numbers(void) {
+    parse_buffer buffer = empty_parse_buffer;
+    char number[200];
+
+    /* longer than any temporary buffer */
+    buffer.hooks = global_hooks;
+    memset(number, '0', sizeof(number));
+    number[0] = '1';
+    number[sizeof(number) - 1] = '\0';
+    buffer.content = (const unsigned char *)number;
+    buffer.length = sizeof(number);
+    TEST_ASSERT_TRUE(parse_number(item, &buffer));
+    TEST_ASSERT_EQUAL_size_t(sizeof(number) - 1, buffer.offset);
+    TEST_ASSERT_EQUAL_DOUBLE(1e198, item->u.valuedouble);
+
+    number[0] = '0';
+    number[1] = '.';
+    number[2] = '1';
+    number[sizeof(number) - 2] = '1';
+    buffer.offset = 0;
+    TEST_ASSERT_TRUE(parse_number(item, &buffer));
+    TEST_ASSERT_EQUAL_size_t(sizeof(number) - 1, buffer.offset);
+    TEST_ASSERT_EQUAL_DOUBLE(0.1, item->u.valuedouble);
+
+    assert_parse_double_number("1e-10000", 0.0);
+}
+
+static void parse_number_should_stop_at_the_end_of_the_number(void) {
+    assert_parse_number_length("12,", 2);
+    assert_parse_number_length("1.5.3", 3);
+    assert_parse_number_length("1e", 1);
+    assert_parse_number_length("1e+", 1);
+    assert_parse_number_length("-2.5E-3]", 7);
+    assert_parse_number_length("1-2", 1);
+}
+
+static void parse_number_should_fail_on_missing_digits(void) {
+    parse_buffer buffer = empty_parse_buffer;
+    const char *const invalid[] = {"-", "-.", ".", "-e5", "+"};
+    size_t i;
+
+    for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        buffer.content = (const unsigned char *)invalid[i];
+        buffer.length = strlen(invalid[i]) + sizeof("");
+        buffer.offset = 0;
+        TEST_ASSERT_FALSE(parse_number(item, &buffer));
+        TEST_ASSERT_EQUAL_size_t(0, buffer.offset);
+    }
+}
+
+static void parse_number_should_not_read_past_the_buffer(void) {
+    parse_buffer buffer = empty_parse_buffer;
+    buffer.content = (const unsigned char *)"1234";
+    buffer.length = 2;
+
+    TEST_ASSERT_TRUE(parse_number(item, &buffer));
+    TEST_ASSERT_EQUAL_INT64(12, item->u.valueint);
+    TEST_ASSERT_EQUAL_size_t(2, buffer.offset);
+}
+
 int main(void) {
     /* initialize sbJSON item */
     memset(item, 0, sizeof(sbJSON));
@@ -112,5 +204,10 @@ int main(void) {
     RUN_TEST(parse_number_should_parse_positive_integers);
     RUN_TEST(parse_number_should_parse_positive_reals);
     RUN_TEST(parse_number_should_parse_negative_reals);
+    RUN_TEST(parse_number_should_keep_int64_limits_exact);
+    RUN_TEST(parse_number_should_parse_long_numbers);
+    RUN_TEST(parse_number_should_stop_at_the_end_of_the_number);
+    RUN_TEST(parse_number_should_fail_on_missing_digits);
+    RUN_TEST(parse_number_should_not_read_past_the_buffer);
     return UNITY_END();
 }
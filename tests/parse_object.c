@@ -51,7 +51,7 @@ static void assert_is_child(sbJSON *child_item, const char *name, int type) {
 }
 
 static void assert_not_object(const char *json) {
-    parse_buffer parsebuffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer parsebuffer = empty_parse_buffer;
     parsebuffer.content = (const unsigned char *)json;
     parsebuffer.length = strlen(json) + sizeof("");
     parsebuffer.hooks = global_hooks;
@@ -62,7 +62,7 @@ static void assert_not_object(const char *json) {
 }
 
 static void assert_parse_object(const char *json) {
-    parse_buffer parsebuffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer parsebuffer = empty_parse_buffer;
     parsebuffer.content = (const unsigned char *)json;
     parsebuffer.length = strlen(json) + sizeof("");
     parsebuffer.hooks = global_hooks;
@@ -43,7 +43,7 @@ static void assert_is_string(sbJSON *string_item) {
 }
 
 static void assert_parse_string(const char *string, const char *expected) {
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = empty_parse_buffer;
     buffer.content = (const unsigned char *)string;
     buffer.length = strlen(string) + sizeof("");
     buffer.hooks = global_hooks;
@@ -58,7 +58,7 @@ static void assert_parse_string(const char *string, const char *expected) {
 }
 
 static void assert_not_parse_string(const char *const string) {
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = empty_parse_buffer;
     buffer.content = (const unsigned char *)string;
     buffer.length = strlen(string) + sizeof("");
     buffer.hooks = global_hooks;
@@ -116,6 +116,41 @@ static void parse_string_should_parse_bug_94(void) {
     reset(item);
 }
 
+static void parse_string_should_handle_escapes_at_every_word_offset(void) {
+    char string[64];
+    char expected[64];
+    size_t position = 0;
+
+    /* long plain runs with a single escape sequence somewhere in them */
+    for (position = 0; position < 40; position++) {
+        memset(string, 'a', sizeof(string));
+        memset(expected, 'a', sizeof(expected));
+        string[0] = '\"';
+        string[position + 1] = '\\';
+        string[position + 2] = 'n';
+        string[42] = '\"';
+        string[43] = '\0';
+        expected[position] = '\n';
+        expected[40] = '\0';
+
+        assert_parse_string(string, expected);
+        reset(item);
+    }
+
+    /* the closing quote is found in any position */
+    for (position = 1; position < 40; position++) {
+        memset(string, 'b', sizeof(string));
+        memset(expected, 'b', sizeof(expected));
+        string[0] = '\"';
+        string[position] = '\"';
+        string[position + 1] = '\0';
+        expected[position - 1] = '\0';
+
+        assert_parse_string(string, expected);
+        reset(item);
+    }
+}
+
 int main(void) {
     /* initialize sbJSON item and error pointer */
     memset(item, 0, sizeof(sbJSON));
@@ -127,5 +162,6 @@ int main(void) {
     RUN_TEST(parse_string_should_not_parse_invalid_backslash);
     RUN_TEST(parse_string_should_parse_bug_94);
     RUN_TEST(parse_string_should_not_overflow_with_closing_backslash);
+    RUN_TEST(parse_string_should_handle_escapes_at_every_word_offset);
     return UNITY_END();
 }
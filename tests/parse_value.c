@@ -41,7 +41,7 @@ static void assert_is_value(sbJSON *value_item, int type) {
 }
 
 static void assert_parse_value(const char *string, int type) {
-    parse_buffer buffer = {0, 0, 0, 0, {0, 0, 0}};
+    parse_buffer buffer = empty_parse_buffer;
     buffer.content = (const unsigned char *)string;
     buffer.length = strlen(string) + sizeof("");
     buffer.hooks = global_hooks;
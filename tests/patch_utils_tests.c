@@ -0,0 +1,263 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../sbjson_utils.h"
+#include "common.h"
+#include "unity.h"
+
+static char const document[] =
+    "{\"a\":{\"b\":[1,2,3],\"c\":\"x\"},\"d\":[{\"e\":1},{\"e\":2}],\"f\":null}";
+
+static void assert_printed(char const *const expected, sbJSON const *item) {
+    char *printed = sbj_print_unformatted(item);
+    TEST_ASSERT_NOT_NULL(printed);
+    TEST_ASSERT_EQUAL_STRING(expected, printed);
+    sbJSON_free(printed);
+}
+
+static void apply_should_share_paths_between_operations(void) {
+    sbJSON *root = sbj_parse(document);
+    sbJSON *patches = sbj_parse(
+        "[{\"op\":\"add\",\"path\":\"/a/b/0\",\"value\":0},"
+        "{\"op\":\"remove\",\"path\":\"/a/b/3\"},"
+        "{\"op\":\"replace\",\"path\":\"/a/b/1\",\"value\":\"one\"},"
+        "{\"op\":\"test\",\"path\":\"/a/b/2\",\"value\":2},"
+        "{\"op\":\"move\",\"from\":\"/a/c\",\"path\":\"/a/b/-\"},"
+        "{\"op\":\"copy\",\"from\":\"/d/1\",\"path\":\"/d/0\"},"
+        "{\"op\":\"replace\",\"path\":\"/d/0/e\",\"value\":3},"
+        "{\"op\":\"move\",\"from\":\"/d/2\",\"path\":\"/a/g\"},"
+        "{\"op\":\"add\",\"path\":\"/f\",\"value\":{}}]");
+
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_NOT_NULL(patches);
+    TEST_ASSERT_EQUAL_INT(0, sbJSONUtils_ApplyPatches(root, patches));
+    assert_printed("{\"a\":{\"b\":[0,\"one\",2,\"x\"],\"g\":{\"e\":2}},"
+                   "\"d\":[{\"e\":3},{\"e\":1}],\"f\":{}}",
+                   root);
+
+    sbj_delete(patches);
+    sbj_delete(root);
+}
+
+static void apply_should_handle_many_operations_on_large_arrays(void) {
+    sbJSON *root = sbj_parse("{\"list\":[]}");
+    sbJSON *patches = sbj_create_array();
+    sbJSON *list = NULL;
+    sbJSON *number = NULL;
+    char path[32];
+    int i;
+
+    TEST_ASSERT_NOT_NULL(root);
+    for (i = 0; i < 1000; i++) {
+        number = sbj_create_integer_number(i);
+        sbJSONUtils_AddPatchToArray(patches, "add", "/list/-", number);
+        sbj_delete(number);
+    }
+    /* remove every other element, from the back */
+    for (i = 998; i >= 0; i -= 2) {
+        sprintf(path, "/list/%d", i);
+        sbJSONUtils_AddPatchToArray(patches, "remove", path, NULL);
+    }
+    TEST_ASSERT_EQUAL_INT(0, sbJSONUtils_ApplyPatches(root, patches));
+
+    list = sbj_get_object_item(root, "list");
+    TEST_ASSERT_EQUAL_INT(500, sbj_get_array_size(list));
+    for (i = 0; i < 500; i++) {
+        TEST_ASSERT_EQUAL_INT(2 * i + 1,
+                              (int)sbj_get_array_item(list, i)->u.valueint);
+    }
+
+    sbj_delete(patches);
+    sbj_delete(root);
+}
+
+static void atomic_apply_should_restore_the_document_on_failure(void) {
+    static char const *const failing[] = {
+        /* the last operation fails */
+        "[{\"op\":\"remove\",\"path\":\"/a/b/1\"},"
+        "{\"op\":\"add\",\"path\":\"/a/b/0\",\"value\":9},"
+        "{\"op\":\"move\",\"from\":\"/a/c\",\"path\":\"/d/0/c\"},"
+        "{\"op\":\"replace\",\"path\":\"/f\",\"value\":[1]},"
+        "{\"op\":\"add\",\"path\":\"/d/0/e\",\"value\":5},"
+        "{\"op\":\"copy\",\"from\":\"/d\",\"path\":\"/h\"},"
+        "{\"op\":\"remove\",\"path\":\"/d/1\"},"
+        "{\"op\":\"test\",\"path\":\"/f/0\",\"value\":2}]",
+        /* the root is replaced before */
+        "[{\"op\":\"remove\",\"path\":\"/a\"},"
+        "{\"op\":\"replace\",\"path\":\"\",\"value\":{\"z\":[]}},"
+        "{\"op\":\"add\",\"path\":\"/z/0\",\"value\":1},"
+        "{\"op\":\"remove\",\"path\":\"/y\"}]",
+        /* a move that has nowhere to go */
+        "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/x\"}]",
+        /* moved twice, then removed */
+        "[{\"op\":\"move\",\"from\":\"/a/b\",\"path\":\"/b\"},"
+        "{\"op\":\"move\",\"from\":\"/b\",\"path\":\"/d/-\"},"
+        "{\"op\":\"remove\",\"path\":\"/d/2\"},"
+        "{\"op\":\"add\",\"path\":\"/d/5\",\"value\":0}]"};
+    size_t i;
+
+    for (i = 0; i < sizeof(failing) / sizeof(failing[0]); i++) {
+        sbJSON *root = sbj_parse(document);
+        sbJSON *patches = sbj_parse(failing[i]);
+
+        TEST_ASSERT_NOT_NULL(root);
+        TEST_ASSERT_NOT_NULL(patches);
+        TEST_ASSERT_TRUE(sbJSONUtils_AtomicApplyPatches(root, patches) != 0);
+        assert_printed(document, root);
+        /* lookups still work on the restored objects */
+        TEST_ASSERT_NOT_NULL(sbJSONUtils_GetPointer(root, "/a/c"));
+
+        sbj_delete(patches);
+        sbj_delete(root);
+    }
+}
+
+static void atomic_apply_should_match_apply_on_success(void) {
+    static char const patch_text[] =
+        "[{\"op\":\"move\",\"from\":\"/a/b\",\"path\":\"/b\"},"
+        "{\"op\":\"remove\",\"path\":\"/b/0\"},"
+        "{\"op\":\"replace\",\"path\":\"/a\",\"value\":true},"
+        "{\"op\":\"add\",\"path\":\"/d/1/e\",\"value\":[]},"
+        "{\"op\":\"copy\",\"from\":\"/d/1\",\"path\":\"/d/-\"}]";
+    sbJSON *plain = sbj_parse(document);
+    sbJSON *atomic = sbj_parse(document);
+    sbJSON *patches = sbj_parse(patch_text);
+
+    TEST_ASSERT_EQUAL_INT(0, sbJSONUtils_ApplyPatches(plain, patches));
+    TEST_ASSERT_EQUAL_INT(0, sbJSONUtils_AtomicApplyPatches(atomic, patches));
+    TEST_ASSERT_TRUE(sbj_compare(plain, atomic));
+    /* replacing a member appends it again */
+    assert_printed("{\"d\":[{\"e\":1},{\"e\":[]},{\"e\":[]}],\"f\":null,"
+                   "\"b\":[2,3],\"a\":true}",
+                   atomic);
+
+    sbj_delete(patches);
+    sbj_delete(atomic);
+    sbj_delete(plain);
+}
+
+static void atomic_apply_should_restore_a_removed_root(void) {
+    sbJSON *root = sbj_parse(document);
+    sbJSON *patches = sbj_parse("[{\"op\":\"remove\",\"path\":\"\"},"
+                                "{\"op\":\"test\",\"path\":\"\",\"value\":1}]");
+
+    TEST_ASSERT_TRUE(sbJSONUtils_AtomicApplyPatches(root, patches) != 0);
+    assert_printed(document, root);
+    TEST_ASSERT_EQUAL_INT(1, sbJSONUtils_AtomicApplyPatches(root, NULL));
+
+    sbj_delete(patches);
+    sbj_delete(root);
+}
+
+static sbJSON *create_packed_document(void) {
+    static double const numbers[] = {1.5, 2.5, 3.5};
+    sbJSON *root = sbj_create_object();
+    sbJSON *array = sbj_create_packed_double_array(numbers, 3);
+
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_NOT_NULL(array);
+    TEST_ASSERT_TRUE(array->is_packed);
+    TEST_ASSERT_TRUE(sbj_add_item_to_object(root, "a", array));
+
+    return root;
+}
+
+static void utils_should_read_packed_arrays(void) {
+    static char const equal[] = "{\"a\":[1.5,2.5,3.5]}";
+    sbJSON *packed = create_packed_document();
+    sbJSON *parsed = sbj_parse(equal);
+    sbJSON *patches = NULL;
+
+    TEST_ASSERT_NOT_NULL(parsed);
+    patches = sbj_parse("[{\"op\":\"test\",\"path\":\"/a\","
+                        "\"value\":[1.5,2.5,3.5]}]");
+    TEST_ASSERT_EQUAL_INT(0, sbJSONUtils_ApplyPatches(packed, patches));
+    sbj_delete(patches);
+
+    sbj_delete(packed);
+    packed = create_packed_document();
+    patches = sbJSONUtils_Diff(packed, parsed);
+    TEST_ASSERT_EQUAL_INT(0, sbj_get_array_size(patches));
+    sbj_delete(patches);
+
+    sbj_delete(packed);
+    packed = create_packed_document();
+    patches = sbJSONUtils_GeneratePatches(packed, parsed);
+    TEST_ASSERT_EQUAL_INT(0, sbj_get_array_size(patches));
+    sbj_delete(patches);
+
+    sbj_delete(packed);
+    packed = create_packed_document();
+    TEST_ASSERT_NULL(sbJSONUtils_GenerateMergePatch(packed, parsed));
+
+    sbj_delete(parsed);
+    sbj_delete(packed);
+}
+
+static void utils_should_patch_packed_arrays(void) {
+    static char const from_json[] = "{\"a\":[1,2,3],\"b\":[0.5]}";
+    static char const to_json[] = "{\"a\":[1,3,4],\"b\":[0.5,1.5]}";
+    sbJSON *from = sbj_parse_packed(from_json, sizeof(from_json));
+    sbJSON *to = sbj_parse_packed(to_json, sizeof(to_json));
+    sbJSON *patches = NULL;
+
+    TEST_ASSERT_NOT_NULL(from);
+    TEST_ASSERT_NOT_NULL(to);
+    TEST_ASSERT_TRUE(sbj_get_object_item(from, "a")->is_packed);
+
+    patches = sbJSONUtils_Diff(from, to);
+    TEST_ASSERT_NOT_NULL(patches);
+    TEST_ASSERT_EQUAL_INT(0, sbJSONUtils_ApplyPatches(from, patches));
+    assert_printed(to_json, from);
+    sbj_delete(patches);
+
+    /* an element appended to a packed array */
+    sbj_delete(from);
+    from = sbj_parse_packed(from_json, sizeof(from_json));
+    patches = sbj_parse("[{\"op\":\"add\",\"path\":\"/a/-\",\"value\":9},"
+                        "{\"op\":\"replace\",\"path\":\"/b\",\"value\":1}]");
+    TEST_ASSERT_EQUAL_INT(0, sbJSONUtils_ApplyPatches(from, patches));
+    assert_printed("{\"a\":[1,2,3,9],\"b\":1}", from);
+
+    sbj_delete(patches);
+    sbj_delete(to);
+    sbj_delete(from);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(apply_should_share_paths_between_operations);
+    RUN_TEST(apply_should_handle_many_operations_on_large_arrays);
+    RUN_TEST(atomic_apply_should_restore_the_document_on_failure);
+    RUN_TEST(atomic_apply_should_match_apply_on_success);
+    RUN_TEST(atomic_apply_should_restore_a_removed_root);
+    RUN_TEST(utils_should_read_packed_arrays);
+    RUN_TEST(utils_should_patch_packed_arrays);
+
+    return UNITY_END();
+}
@@ -0,0 +1,176 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../sbjson_utils.h"
+#include "common.h"
+#include "unity.h"
+
+static char const document[] =
+    "{\"foo\":[\"bar\",\"baz\",{\"deep\":[0,[1,2]]}],\"\":0,\"a/b\":1,"
+    "\"c%d\":2,\"e^f\":3,\"g|h\":4,\"i\\\\j\":5,\"k\\\"l\":6,\" \":7,"
+    "\"m~n\":8,\"01\":9,\"nested\":{\"x\":{\"y\":{\"z\":true}}}}";
+
+static char const *const pointers[] = {
+    "",           "/foo",          "/foo/0",         "/foo/2/deep/1/0",
+    "/",          "/a~1b",         "/c%d",           "/e^f",
+    "/g|h",       "/i\\j",         "/k\"l",          "/ ",
+    "/m~0n",      "/01",           "/foo/01",        "/foo/1a",
+    "/foo/3",     "/foo/-",        "/missing",       "/missing/x",
+    "/nested/x",  "/nested/x/y/z", "/nested/x/y/w",  "/foo/0/x",
+    "/nested/x/y"};
+
+#define pointer_count (sizeof(pointers) / sizeof(pointers[0]))
+
+static void compiled_pointers_should_match_get_pointer(void) {
+    sbJSON *root = sbj_parse(document);
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(root);
+    for (i = 0; i < pointer_count; i++) {
+        sbJSONUtils_CompiledPointer *compiled =
+            sbJSONUtils_CompilePointer(pointers[i]);
+        TEST_ASSERT_NOT_NULL_MESSAGE(compiled, pointers[i]);
+        TEST_ASSERT_EQUAL_PTR_MESSAGE(sbJSONUtils_GetPointer(root, pointers[i]),
+                                      sbJSONUtils_EvalPointer(compiled, root),
+                                      pointers[i]);
+        sbJSONUtils_FreeCompiledPointer(compiled);
+    }
+
+    /* a few that have to be found */
+    TEST_ASSERT_NOT_NULL(sbJSONUtils_GetPointer(root, "/m~0n"));
+    TEST_ASSERT_NOT_NULL(sbJSONUtils_GetPointer(root, "/nested/x/y/z"));
+    /* a digit followed by other characters isn't an array index */
+    TEST_ASSERT_NULL(sbJSONUtils_GetPointer(root, "/foo/1a"));
+
+    sbj_delete(root);
+}
+
+static void compile_pointer_should_reject_invalid_pointers(void) {
+    TEST_ASSERT_NULL(sbJSONUtils_CompilePointer(NULL));
+    TEST_ASSERT_NULL(sbJSONUtils_CompilePointer("foo"));
+    TEST_ASSERT_NULL(sbJSONUtils_CompilePointer("/a~2"));
+    TEST_ASSERT_NULL(sbJSONUtils_CompilePointer("/a~"));
+    TEST_ASSERT_NULL(sbJSONUtils_EvalPointer(NULL, NULL));
+    sbJSONUtils_FreeCompiledPointer(NULL);
+}
+
+static void compiled_pointers_should_use_object_indices(void) {
+    sbJSON *object = sbj_create_object();
+    sbJSONUtils_CompiledPointer *compiled = NULL;
+    char name[16];
+    int i;
+
+    TEST_ASSERT_NOT_NULL(object);
+    for (i = 0; i < 200; i++) {
+        snprintf(name, sizeof(name), "member%d", i);
+        TEST_ASSERT_TRUE(sbj_add_item_to_object(
+            object, name, sbj_create_integer_number(i)));
+    }
+    TEST_ASSERT_TRUE(sbj_object_build_index(object));
+
+    compiled = sbJSONUtils_CompilePointer("/member150");
+    TEST_ASSERT_NOT_NULL(compiled);
+    TEST_ASSERT_EQUAL_PTR(sbj_get_object_item(object, "member150"),
+                          sbJSONUtils_EvalPointer(compiled, object));
+    sbJSONUtils_FreeCompiledPointer(compiled);
+
+    TEST_ASSERT_EQUAL_size_t(hash_name("member3"), sbj_hash_key("member3"));
+    TEST_ASSERT_NULL(sbj_get_object_item_hashed(object, "member300",
+                                                sbj_hash_key("member300")));
+
+    sbj_delete(object);
+}
+
+static void eval_pointers_should_match_single_evaluation(void) {
+    sbJSON *root = sbj_parse(document);
+    sbJSONUtils_CompiledPointer *compiled[pointer_count + 1];
+    sbJSON *results[pointer_count + 1];
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(root);
+    for (i = 0; i < pointer_count; i++) {
+        compiled[i] = sbJSONUtils_CompilePointer(pointers[i]);
+        TEST_ASSERT_NOT_NULL(compiled[i]);
+    }
+    /* entries that failed to compile are skipped */
+    compiled[pointer_count] = NULL;
+
+    sbJSONUtils_EvalPointers(
+        (const sbJSONUtils_CompiledPointer *const *)compiled,
+        pointer_count + 1, root, results);
+    for (i = 0; i < pointer_count; i++) {
+        TEST_ASSERT_EQUAL_PTR_MESSAGE(
+            sbJSONUtils_EvalPointer(compiled[i], root), results[i],
+            pointers[i]);
+        sbJSONUtils_FreeCompiledPointer(compiled[i]);
+    }
+    TEST_ASSERT_NULL(results[pointer_count]);
+
+    sbj_delete(root);
+}
+
+static void eval_pointers_should_handle_deep_pointers(void) {
+    sbJSON *root = sbj_create_array();
+    sbJSON *current = root;
+    sbJSONUtils_CompiledPointer *compiled[2];
+    sbJSON *results[2];
+    char pointer[3 * 50 + 1] = "";
+    int i;
+
+    for (i = 0; i < 50; i++) {
+        sbJSON *const child = sbj_create_array();
+        TEST_ASSERT_TRUE(sbj_add_item_to_array(current, child));
+        current = child;
+        strcat(pointer, "/0");
+    }
+
+    compiled[0] = sbJSONUtils_CompilePointer(pointer);
+    compiled[1] = sbJSONUtils_CompilePointer("/0/0/1");
+    TEST_ASSERT_NOT_NULL(compiled[0]);
+    TEST_ASSERT_NOT_NULL(compiled[1]);
+    sbJSONUtils_EvalPointers(
+        (const sbJSONUtils_CompiledPointer *const *)compiled, 2, root,
+        results);
+    TEST_ASSERT_EQUAL_PTR(current, results[0]);
+    TEST_ASSERT_NULL(results[1]);
+
+    sbJSONUtils_FreeCompiledPointer(compiled[0]);
+    sbJSONUtils_FreeCompiledPointer(compiled[1]);
+    sbj_delete(root);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(compiled_pointers_should_match_get_pointer);
+    RUN_TEST(compile_pointer_should_reject_invalid_pointers);
+    RUN_TEST(compiled_pointers_should_use_object_indices);
+    RUN_TEST(eval_pointers_should_match_single_evaluation);
+    RUN_TEST(eval_pointers_should_handle_deep_pointers);
+
+    return UNITY_END();
+}
@@ -0,0 +1,255 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static sbJSON_Hooks pool_hooks = {sbj_pool_malloc, sbj_pool_free};
+
+/* the alignment malloc guarantees for any basic type */
+struct alignment_probe {
+    char c;
+    long double d;
+};
+
+static void pool_should_reuse_freed_blocks(void) {
+    void *first = sbj_pool_malloc(sizeof(sbJSON));
+    void *second = NULL;
+
+    TEST_ASSERT_NOT_NULL(first);
+    sbj_pool_free(first);
+    second = sbj_pool_malloc(sizeof(sbJSON));
+    TEST_ASSERT_EQUAL_PTR(first, second);
+    sbj_pool_free(second);
+
+    /* a smaller request of the same class gets it as well */
+    second = sbj_pool_malloc(sizeof(sbJSON) - 10);
+    TEST_ASSERT_EQUAL_PTR(first, second);
+    sbj_pool_free(second);
+
+    sbj_pool_free(NULL);
+}
+
+static void pool_should_serve_all_sizes(void) {
+    size_t const sizes[] = {0,   1,   7,   8,   24,  47,   48,    49, 55,
+                            56,  57,  120, 239, 240, 241, 1000, 100000};
+    void *blocks[sizeof(sizes) / sizeof(sizes[0])];
+    size_t i;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        blocks[i] = sbj_pool_malloc(sizes[i]);
+        TEST_ASSERT_NOT_NULL(blocks[i]);
+        TEST_ASSERT_EQUAL_size_t(
+            0, (size_t)blocks[i] % offsetof(struct alignment_probe, d));
+        memset(blocks[i], 0xAB, sizes[i]);
+    }
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        sbj_pool_free(blocks[i]);
+    }
+}
+
+static sbJSON *churn(size_t rounds) {
+    sbJSON *state = sbj_create_object();
+    char key[32];
+    size_t i;
+
+    for (i = 0; i < rounds; i++) {
+        snprintf(key, sizeof(key), "key %u", (unsigned)(i % 50));
+        if (sbj_get_object_item(state, key) == NULL) {
+            sbj_add_item_to_object(state, key, sbj_parse("{\"a\": [1, 2]}"));
+        } else if (i % 3 == 0) {
+            sbj_delete_item_from_object(state, key);
+        } else {
+            sbj_replace_item_in_object(
+                state, key, sbJSON_CreateString("a longer replacement value"));
+        }
+    }
+
+    return state;
+}
+
+static void pool_should_back_trees(void) {
+    sbJSON *state = NULL;
+    sbJSON *copy = NULL;
+    char *printed = NULL;
+
+    sbJSON_InitHooks(&pool_hooks);
+    state = churn(10000);
+    copy = sbj_duplicate(state, true);
+    TEST_ASSERT_TRUE(sbj_compare(state, copy));
+
+    printed = sbj_print(state);
+    TEST_ASSERT_NOT_NULL(printed);
+    sbJSON_free(printed);
+
+    sbj_delete(copy);
+    sbj_delete(state);
+    sbJSON_InitHooks(NULL);
+}
+
+#ifdef SBJSON_THREADS
+static void *churn_thread(void *unused) {
+    sbJSON *state = churn(5000);
+    (void)unused;
+    sbj_delete(state);
+    return NULL;
+}
+
+static void pool_should_work_on_several_threads(void) {
+    pthread_t threads[4];
+    size_t i;
+
+    sbJSON_InitHooks(&pool_hooks);
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        TEST_ASSERT_EQUAL_INT(
+            0, pthread_create(&threads[i], NULL, churn_thread, NULL));
+    }
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        TEST_ASSERT_EQUAL_INT(0, pthread_join(threads[i], NULL));
+    }
+
+    /* the exited threads handed their blocks on */
+    churn_thread(NULL);
+    sbJSON_InitHooks(NULL);
+}
+
+#define handed_over 4096
+static void *blocks[handed_over];
+static pthread_mutex_t handover_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t handover_cond = PTHREAD_COND_INITIALIZER;
+static int handover_step = 0;
+
+static void handover_wait(int const step) {
+    pthread_mutex_lock(&handover_mutex);
+    while (handover_step < step) {
+        pthread_cond_wait(&handover_cond, &handover_mutex);
+    }
+    pthread_mutex_unlock(&handover_mutex);
+}
+
+static void handover_signal(int const step) {
+    pthread_mutex_lock(&handover_mutex);
+    if (handover_step < step) {
+        handover_step = step;
+    }
+    pthread_cond_broadcast(&handover_cond);
+    pthread_mutex_unlock(&handover_mutex);
+}
+
+/* frees what the main thread allocated, stays alive until it is told */
+static void *free_thread(void *count) {
+    size_t i;
+
+    for (i = 0; i < *(size_t *)count; i++) {
+        sbj_pool_free(blocks[i]);
+    }
+    handover_signal(1);
+    handover_wait(2);
+    return NULL;
+}
+
+static size_t count_returned(size_t const count) {
+    size_t returned = 0;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < count; i++) {
+        void *const block = sbj_pool_malloc(sizeof(sbJSON));
+        for (j = 0; j < count; j++) {
+            if (blocks[j] == block) {
+                returned++;
+                break;
+            }
+        }
+    }
+
+    return returned;
+}
+
+static void *allocate_thread(void *returned) {
+    *(size_t *)returned = count_returned(100);
+    return NULL;
+}
+
+static void pool_should_spill_blocks_freed_on_other_threads(void) {
+    size_t count = handed_over;
+    pthread_t thread;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        blocks[i] = sbj_pool_malloc(sizeof(sbJSON));
+        TEST_ASSERT_NOT_NULL(blocks[i]);
+    }
+
+    /* the thread that frees them keeps no more than a slab's worth, the
+     * rest can be allocated again while it still runs */
+    handover_step = 0;
+    TEST_ASSERT_EQUAL_INT(0,
+                          pthread_create(&thread, NULL, free_thread, &count));
+    handover_wait(1);
+    TEST_ASSERT_TRUE(count_returned(count) >= count / 2);
+    handover_signal(2);
+    TEST_ASSERT_EQUAL_INT(0, pthread_join(thread, NULL));
+}
+
+static void pool_should_keep_blocks_of_threads_that_only_free(void) {
+    size_t count = 100;
+    size_t returned = 0;
+    pthread_t thread;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        blocks[i] = sbj_pool_malloc(sizeof(sbJSON));
+        TEST_ASSERT_NOT_NULL(blocks[i]);
+    }
+
+    /* the thread never allocates, its blocks go on when it exits */
+    handover_step = 2;
+    TEST_ASSERT_EQUAL_INT(0,
+                          pthread_create(&thread, NULL, free_thread, &count));
+    TEST_ASSERT_EQUAL_INT(0, pthread_join(thread, NULL));
+    TEST_ASSERT_EQUAL_INT(
+        0, pthread_create(&thread, NULL, allocate_thread, &returned));
+    TEST_ASSERT_EQUAL_INT(0, pthread_join(thread, NULL));
+    TEST_ASSERT_EQUAL_size_t(count, returned);
+}
+#endif
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(pool_should_reuse_freed_blocks);
+    RUN_TEST(pool_should_serve_all_sizes);
+    RUN_TEST(pool_should_back_trees);
+#ifdef SBJSON_THREADS
+    RUN_TEST(pool_should_work_on_several_threads);
+    RUN_TEST(pool_should_spill_blocks_freed_on_other_threads);
+    RUN_TEST(pool_should_keep_blocks_of_threads_that_only_free);
+#endif
+
+    return UNITY_END();
+}
@@ -0,0 +1,149 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static void assert_exact_length(sbJSON *item, bool format) {
+    char *printed = format ? sbj_print(item) : sbj_print_unformatted(item);
+    size_t const length = sbj_print_length(item, format);
+    char *buffer = NULL;
+
+    TEST_ASSERT_NOT_NULL(printed);
+    TEST_ASSERT_EQUAL_size_t(strlen(printed), length);
+
+    /* one more for the terminating zero is enough, one less isn't */
+    buffer = (char *)malloc(length + 1);
+    TEST_ASSERT_NOT_NULL(buffer);
+    TEST_ASSERT_TRUE(
+        sbj_print_preallocated(item, buffer, (int)length + 1, format));
+    TEST_ASSERT_EQUAL_STRING(printed, buffer);
+    TEST_ASSERT_FALSE(
+        sbj_print_preallocated(item, buffer, (int)length, format));
+
+    free(buffer);
+    free(printed);
+}
+
+static void assert_exact_lengths(char const *json) {
+    sbJSON *item = sbj_parse(json);
+
+    if (item == NULL) {
+        return; /* some test files are invalid on purpose */
+    }
+    assert_exact_length(item, true);
+    assert_exact_length(item, false);
+    sbj_delete(item);
+
+    /* untouched lazy containers are printed as they were parsed */
+    item = sbj_parse_lazy(json, strlen(json) + 1);
+    TEST_ASSERT_NOT_NULL(item);
+    assert_exact_length(item, true);
+    assert_exact_length(item, false);
+    sbj_delete(item);
+}
+
+static void print_length_should_match_documents(void) {
+    static char const *const documents[] = {
+        "null",
+        "false",
+        "-9223372036854775808",
+        "1.5e300",
+        "-0.0",
+        "\"\"",
+        "\"quote \\\" backslash \\\\ controls \\b\\f\\n\\r\\t\\u0001\\u001f\"",
+        "\"unicode \\u00e4\\ud83d\\ude00\"",
+        "[]",
+        "{}",
+        "[[], {}, [[1, 2], {\"a\": {\"b\": [true]}}]]",
+        "{\"a\\n\": {\"b\": {\"c\": {}}, \"d\": [1, {\"e\": null}]}, \"f\": 2}",
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        assert_exact_lengths(documents[i]);
+    }
+}
+
+static void print_length_should_match_test_files(void) {
+    char name[] = "inputs/test?";
+    char digit;
+
+    for (digit = '1'; digit <= '9'; digit++) {
+        char *json = NULL;
+        name[sizeof(name) - 2] = digit;
+        json = read_file(name);
+        TEST_ASSERT_NOT_NULL(json);
+        assert_exact_lengths(json);
+        free(json);
+    }
+}
+
+static void print_length_should_match_created_items(void) {
+    sbJSON *object = sbj_create_object();
+    sbJSON *array = sbj_create_array();
+    double const doubles[] = {0.1, 1e-300, 123456789.125, 1e21, -2.5};
+    size_t i;
+
+    for (i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+        sbj_add_item_to_array(array, sbj_create_double_number(doubles[i]));
+    }
+    sbj_add_item_to_array(array, sbj_create_double_number(NAN));
+    sbj_add_item_to_array(array, sbj_create_double_number(3.0));
+    sbj_add_item_to_array(array, sbj_create_raw("{\"raw\" : 1}"));
+    sbj_add_item_to_object(object, "array", array);
+    sbj_add_item_to_object(object, "", sbj_create_string_reference(""));
+
+    assert_exact_length(object, true);
+    assert_exact_length(object, false);
+
+    sbj_delete(object);
+}
+
+static void print_length_should_fail_on_invalid_items(void) {
+    sbJSON *array = sbj_create_array();
+    sbJSON *invalid = sbj_create_null();
+
+    invalid->type = sbJSON_Invalid;
+    sbj_add_item_to_array(array, invalid);
+    TEST_ASSERT_EQUAL_size_t(0, sbj_print_length(array, true));
+    TEST_ASSERT_EQUAL_size_t(0, sbj_print_length(NULL, false));
+    TEST_ASSERT_NULL(sbj_print(array));
+
+    sbj_delete(array);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(print_length_should_match_documents);
+    RUN_TEST(print_length_should_match_test_files);
+    RUN_TEST(print_length_should_match_created_items);
+    RUN_TEST(print_length_should_fail_on_invalid_items);
+
+    return UNITY_END();
+}
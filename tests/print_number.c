@@ -24,12 +24,12 @@
 #include "common.h"
 #include "unity.h"
 
-static void assert_print_number(const char *expected, bool is_double, double double_input, int integer_input) {
+static void assert_print_number(const char *expected, bool is_double, double double_input, int64_t integer_input) {
     unsigned char printed[1024];
     unsigned char new_buffer[26];
     unsigned int i = 0;
     sbJSON item[1];
-    printbuffer buffer = {0, 0, 0, 0, 0, 0, {0, 0, 0}};
+    printbuffer buffer = empty_printbuffer;
     buffer.buffer = printed;
     buffer.length = sizeof(printed);
     buffer.offset = 0;
@@ -89,7 +89,7 @@ static void print_number_should_print_positive_reals(void) {
     assert_print_double_number("1000000000000", 10e11);
     assert_print_double_number("1.23e+129", 123e+127);
     assert_print_double_number("1.23e-126", 123e-128);
-    assert_print_double_number("3.1415926535897931", 3.1415926535897931);
+    assert_print_double_number("3.141592653589793", 3.1415926535897931);
 }
 
 static void print_number_should_print_negative_reals(void) {
@@ -100,6 +100,60 @@ static void print_number_should_print_negative_reals(void) {
     assert_print_double_number("-1.23e-126", -123e-128);
 }
 
+static void print_number_should_print_shortest_reals(void) {
+    assert_print_double_number("0.1", 0.1);
+    assert_print_double_number("0.30000000000000004", 0.1 + 0.2);
+    assert_print_double_number("0.3333333333333333", 1.0 / 3.0);
+    assert_print_double_number("0.0001", 1e-4);
+    assert_print_double_number("1e-05", 1e-5);
+    assert_print_double_number("123456.789", 123456.789);
+    assert_print_double_number("5e-324", 4.9406564584124654e-324);
+    assert_print_double_number("1.7976931348623157e+308", 1.7976931348623157e+308);
+    assert_print_double_number("1e+19", 1e19);
+}
+
+static void print_number_should_print_int64_limits(void) {
+    assert_print_number("9223372036854775807", false, 0, INT64_MAX);
+    assert_print_number("-9223372036854775808", false, 0, INT64_MIN);
+    assert_print_double_number("-9223372036854775808", -9223372036854775808.0);
+    assert_print_double_number("9.223372036854776e+18", 9223372036854775808.0);
+}
+
+static void print_number_should_round_trip(void) {
+    uint64_t state = 1;
+    int i;
+
+    for (i = 0; i < 100000; i++) {
+        sbJSON *number = NULL;
+        sbJSON *parsed = NULL;
+        char *printed = NULL;
+        uint64_t bits = 0;
+        double value = 0;
+
+        state = state * 6364136223846793005 + 1442695040888963407;
+        bits = state;
+        memcpy(&value, &bits, sizeof(value));
+        if (isnan(value) || isinf(value)) {
+            continue;
+        }
+
+        number = sbj_create_double_number(value);
+        printed = sbj_print(number);
+        parsed = sbj_parse(printed);
+        TEST_ASSERT_NOT_NULL(parsed);
+        TEST_ASSERT_TRUE(parsed->is_number_double ||
+                         ((double)parsed->u.valueint == value));
+        if (parsed->is_number_double) {
+            TEST_ASSERT_EQUAL_MEMORY(&value, &parsed->u.valuedouble,
+                                     sizeof(value));
+        }
+
+        free(printed);
+        sbj_delete(parsed);
+        sbj_delete(number);
+    }
+}
+
 static void print_number_should_print_non_number(void) {
     TEST_IGNORE();
      assert_print_double_number("null", NAN);
@@ -116,6 +170,9 @@ int main(void) {
     RUN_TEST(print_number_should_print_positive_integers);
     RUN_TEST(print_number_should_print_positive_reals);
     RUN_TEST(print_number_should_print_negative_reals);
+    RUN_TEST(print_number_should_print_shortest_reals);
+    RUN_TEST(print_number_should_print_int64_limits);
+    RUN_TEST(print_number_should_round_trip);
     RUN_TEST(print_number_should_print_non_number);
 
     return UNITY_END();
@@ -0,0 +1,172 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t calls;
+    size_t largest_write;
+    size_t fail_after; /* 0 never fails */
+} collector;
+
+static bool collect(void *user, char const *data, size_t length) {
+    collector *c = (collector *)user;
+
+    c->calls++;
+    if ((c->fail_after != 0) && (c->calls > c->fail_after)) {
+        return false;
+    }
+    if (length > c->largest_write) {
+        c->largest_write = length;
+    }
+
+    c->data = (char *)realloc(c->data, c->length + length + 1);
+    TEST_ASSERT_NOT_NULL(c->data);
+    memcpy(c->data + c->length, data, length);
+    c->length += length;
+    c->data[c->length] = '\0';
+
+    return true;
+}
+
+static void assert_sink_matches_print(sbJSON const *item, bool format,
+                                      size_t chunk_size) {
+    collector c = {NULL, 0, 0, 0, 0};
+    char *expected = format ? sbj_print(item) : sbj_print_unformatted(item);
+
+    TEST_ASSERT_NOT_NULL(expected);
+    TEST_ASSERT_TRUE(sbj_print_to_sink(item, format, collect, &c, chunk_size));
+    TEST_ASSERT_NOT_NULL(c.data);
+    TEST_ASSERT_EQUAL_STRING(expected, c.data);
+
+    free(c.data);
+    free(expected);
+}
+
+static sbJSON *create_document(void) {
+    const char json[] =
+        "{\"name\": \"sink\", \"numbers\": [1, -2, 3.5, 1e300, 0], "
+        "\"nested\": {\"empty_object\": {}, \"empty_array\": [], "
+        "\"deep\": [[[[{\"a\": true, \"b\": false, \"c\": null}]]]]}, "
+        "\"escaped\": \"tab\\tquote\\\"unicode\\u00e4\"}";
+    sbJSON *item = sbj_parse(json);
+
+    TEST_ASSERT_NOT_NULL(item);
+    return item;
+}
+
+static void sink_should_match_print_for_all_chunk_sizes(void) {
+    sbJSON *item = create_document();
+    size_t chunk_size;
+
+    for (chunk_size = 1; chunk_size < 64; chunk_size++) {
+        assert_sink_matches_print(item, true, chunk_size);
+        assert_sink_matches_print(item, false, chunk_size);
+    }
+    assert_sink_matches_print(item, true, 0);
+    assert_sink_matches_print(item, false, 0);
+
+    sbj_delete(item);
+}
+
+static void sink_should_write_in_chunks(void) {
+    sbJSON *array = sbj_create_array();
+    collector c = {NULL, 0, 0, 0, 0};
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+        sbj_add_item_to_array(array, sbj_create_integer_number(i));
+    }
+
+    TEST_ASSERT_TRUE(sbj_print_to_sink(array, false, collect, &c, 128));
+    TEST_ASSERT_TRUE(c.calls > 1);
+    TEST_ASSERT_TRUE(c.largest_write <= 128);
+    free(c.data);
+
+    assert_sink_matches_print(array, true, 128);
+
+    sbj_delete(array);
+}
+
+static void sink_should_grow_for_long_strings(void) {
+    char long_string[1000];
+    sbJSON *array = sbj_create_array();
+
+    memset(long_string, 'x', sizeof(long_string) - 1);
+    long_string[sizeof(long_string) - 1] = '\0';
+    sbj_add_item_to_array(array, sbJSON_CreateString(long_string));
+    sbj_add_item_to_array(array, sbJSON_CreateString("short"));
+
+    assert_sink_matches_print(array, false, 16);
+    assert_sink_matches_print(array, true, 16);
+
+    sbj_delete(array);
+}
+
+static void sink_should_stop_when_write_fails(void) {
+    sbJSON *item = create_document();
+    collector c = {NULL, 0, 0, 0, 1};
+
+    TEST_ASSERT_FALSE(sbj_print_to_sink(item, true, collect, &c, 8));
+    TEST_ASSERT_EQUAL_size_t(2, c.calls);
+    free(c.data);
+
+    /* a failing final write is reported as well */
+    memset(&c, 0, sizeof(c));
+    c.fail_after = 1;
+    c.calls = 1; /* the first call already fails */
+    TEST_ASSERT_FALSE(sbj_print_to_sink(item, false, collect, &c, 0));
+    TEST_ASSERT_NULL(c.data);
+
+    sbj_delete(item);
+}
+
+static void sink_should_reject_invalid_arguments(void) {
+    sbJSON *item = sbj_create_null();
+    collector c = {NULL, 0, 0, 0, 0};
+
+    TEST_ASSERT_FALSE(sbj_print_to_sink(NULL, false, collect, &c, 0));
+    TEST_ASSERT_FALSE(sbj_print_to_sink(item, false, NULL, &c, 0));
+    TEST_ASSERT_EQUAL_size_t(0, c.calls);
+
+    sbj_delete(item);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(sink_should_match_print_for_all_chunk_sizes);
+    RUN_TEST(sink_should_write_in_chunks);
+    RUN_TEST(sink_should_grow_for_long_strings);
+    RUN_TEST(sink_should_stop_when_write_fails);
+    RUN_TEST(sink_should_reject_invalid_arguments);
+
+    return UNITY_END();
+}
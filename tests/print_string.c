@@ -26,7 +26,7 @@
 
 static void assert_print_string(const char *expected, const char *input) {
     unsigned char printed[1024];
-    printbuffer buffer = {0, 0, 0, 0, 0, 0, {0, 0, 0}};
+    printbuffer buffer = empty_printbuffer;
     buffer.buffer = printed;
     buffer.length = sizeof(printed);
     buffer.offset = 0;
@@ -69,6 +69,27 @@ static void print_string_should_print_utf8(void) {
     assert_print_string("\"ü猫慕\"", "ü猫慕");
 }
 
+static void print_string_should_escape_at_every_word_offset(void) {
+    char input[48];
+    char expected[64];
+    size_t position = 0;
+
+    for (position = 0; position < 40; position++) {
+        memset(input, 'x', sizeof(input));
+        input[position] = '\t';
+        input[40] = '\0';
+
+        memset(expected, 'x', sizeof(expected));
+        expected[0] = '\"';
+        expected[position + 1] = '\\';
+        expected[position + 2] = 't';
+        expected[42] = '\"';
+        expected[43] = '\0';
+
+        assert_print_string(expected, input);
+    }
+}
+
 int main(void) {
     /* initialize cJSON item */
     UNITY_BEGIN();
@@ -76,6 +97,7 @@ int main(void) {
     RUN_TEST(print_string_should_print_empty_strings);
     RUN_TEST(print_string_should_print_ascii);
     RUN_TEST(print_string_should_print_utf8);
+    RUN_TEST(print_string_should_escape_at_every_word_offset);
 
     return UNITY_END();
 }
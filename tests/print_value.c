@@ -31,8 +31,8 @@
 static void assert_print_value(const char *input) {
     unsigned char printed[1024];
     sbJSON item[1];
-    printbuffer buffer = {0, 0, 0, 0, 0, 0, {0, 0, 0}};
-    parse_buffer parsebuffer = {0, 0, 0, 0, {0, 0, 0}};
+    printbuffer buffer = empty_printbuffer;
+    parse_buffer parsebuffer = empty_parse_buffer;
     buffer.buffer = printed;
     buffer.length = sizeof(printed);
     buffer.offset = 0;
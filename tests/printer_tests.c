@@ -0,0 +1,127 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static size_t allocations = 0;
+
+static void *counting_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+static sbJSON_Hooks counting_hooks = {counting_malloc, free};
+
+static void printer_should_match_sbj_print(void) {
+    static char const *const documents[] = {
+        "null",
+        "[1, 2.5, \"three\", [null, true, false], {\"\": {}}]",
+        "{\"a\": {\"b\": [[], [[]]]}, \"b\": 2, \"c\\nd\": \"e\"}",
+        "\"a long string that doesn't fit into the first few bytes of the "
+        "buffer\"",
+    };
+    sbj_printer *printer = sbj_printer_new(8);
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(printer);
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        sbJSON *item = sbj_parse(documents[i]);
+        char *expected = sbj_print(item);
+        char *expected_unformatted = sbj_print_unformatted(item);
+        size_t length = 0;
+        char const *printed = sbj_printer_print(printer, item, true, &length);
+
+        TEST_ASSERT_EQUAL_STRING(expected, printed);
+        TEST_ASSERT_EQUAL_size_t(strlen(expected), length);
+        printed = sbj_printer_print(printer, item, false, NULL);
+        TEST_ASSERT_EQUAL_STRING(expected_unformatted, printed);
+
+        free(expected_unformatted);
+        free(expected);
+        sbj_delete(item);
+    }
+
+    sbj_printer_free(printer);
+}
+
+static void printer_should_not_allocate_once_grown(void) {
+    sbj_printer *printer = NULL;
+    sbJSON *item = NULL;
+    char *json = read_file("inputs/test1");
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(json);
+    sbJSON_InitHooks(&counting_hooks);
+    item = sbj_parse(json);
+    TEST_ASSERT_NOT_NULL(item);
+    printer = sbj_printer_new(0);
+
+    TEST_ASSERT_NOT_NULL(sbj_printer_print(printer, item, true, NULL));
+    allocations = 0;
+    for (i = 0; i < 100; i++) {
+        TEST_ASSERT_NOT_NULL(sbj_printer_print(printer, item, i % 2, NULL));
+    }
+    TEST_ASSERT_EQUAL_size_t(0, allocations);
+
+    sbj_printer_free(printer);
+    sbj_delete(item);
+    sbJSON_InitHooks(NULL);
+    free(json);
+}
+
+static void printer_should_recover_from_failures(void) {
+    sbj_printer *printer = sbj_printer_new(0);
+    sbJSON *array = sbj_create_array();
+    sbJSON *invalid = sbj_create_null();
+
+    invalid->type = sbJSON_Invalid;
+    sbj_add_item_to_array(array, sbj_create_integer_number(1));
+    sbj_add_item_to_array(array, invalid);
+
+    TEST_ASSERT_NULL(sbj_printer_print(printer, array, true, NULL));
+    TEST_ASSERT_NULL(sbj_printer_print(printer, NULL, true, NULL));
+    TEST_ASSERT_NULL(sbj_printer_print(NULL, array, true, NULL));
+
+    invalid->type = sbJSON_Null;
+    TEST_ASSERT_EQUAL_STRING("[1,null]",
+                             sbj_printer_print(printer, array, false, NULL));
+
+    sbj_delete(array);
+    sbj_printer_free(printer);
+    sbj_printer_free(NULL);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(printer_should_match_sbj_print);
+    RUN_TEST(printer_should_not_allocate_once_grown);
+    RUN_TEST(printer_should_recover_from_failures);
+
+    return UNITY_END();
+}
@@ -0,0 +1,299 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+/* rebuilds the tree from the events */
+typedef struct {
+    sbJSON *stack[64];
+    int depth;
+    sbJSON *root;
+    char key[256];
+    bool has_key;
+    char const *input_start;
+    char const *input_end;
+    size_t zero_copy_strings;
+    size_t events;
+    size_t stop_after; /* 0 never stops */
+} builder;
+
+static bool add(builder *b, sbJSON *item) {
+    sbJSON *parent = (b->depth > 0) ? b->stack[b->depth - 1] : NULL;
+
+    b->events++;
+    if ((b->stop_after != 0) && (b->events > b->stop_after)) {
+        sbj_delete(item);
+        return false;
+    }
+
+    if (parent == NULL) {
+        TEST_ASSERT_NULL(b->root);
+        b->root = item;
+    } else if (sbj_is_object(parent)) {
+        TEST_ASSERT_TRUE(b->has_key);
+        sbj_add_item_to_object(parent, b->key, item);
+        b->has_key = false;
+    } else {
+        sbj_add_item_to_array(parent, item);
+    }
+
+    if (sbj_is_array(item) || sbj_is_object(item)) {
+        TEST_ASSERT_TRUE(b->depth < 64);
+        b->stack[b->depth++] = item;
+    }
+
+    return true;
+}
+
+static bool on_start_object(void *user) {
+    return add((builder *)user, sbj_create_object());
+}
+
+static bool on_start_array(void *user) {
+    return add((builder *)user, sbj_create_array());
+}
+
+static bool on_end(void *user) {
+    builder *b = (builder *)user;
+    TEST_ASSERT_TRUE(b->depth > 0);
+    b->depth--;
+    return true;
+}
+
+static bool on_key(void *user, char const *key, size_t length) {
+    builder *b = (builder *)user;
+    TEST_ASSERT_FALSE(b->has_key);
+    TEST_ASSERT_TRUE(length < sizeof(b->key));
+    memcpy(b->key, key, length);
+    b->key[length] = '\0';
+    b->has_key = true;
+    return true;
+}
+
+static bool on_string(void *user, char const *string, size_t length) {
+    builder *b = (builder *)user;
+    char *copy = (char *)malloc(length + 1);
+    bool result = false;
+
+    TEST_ASSERT_NOT_NULL(copy);
+    if ((string >= b->input_start) && (string < b->input_end)) {
+        b->zero_copy_strings++;
+    }
+    memcpy(copy, string, length);
+    copy[length] = '\0';
+    result = add(b, sbJSON_CreateString(copy));
+    free(copy);
+
+    return result;
+}
+
+static bool on_integer(void *user, int64_t number) {
+    return add((builder *)user, sbj_create_integer_number(number));
+}
+
+static bool on_double(void *user, double number) {
+    return add((builder *)user, sbj_create_double_number(number));
+}
+
+static bool on_bool(void *user, bool value) {
+    return add((builder *)user, sbj_create_bool(value));
+}
+
+static bool on_null(void *user) {
+    return add((builder *)user, sbj_create_null());
+}
+
+static sbj_sax_handler const building_handler = {
+    on_start_object, on_end,     on_start_array, on_end,  on_key,
+    on_string,       on_integer, on_double,      on_bool, on_null};
+
+static void builder_init(builder *b, char const *json, size_t length) {
+    memset(b, 0, sizeof(*b));
+    b->input_start = json;
+    b->input_end = json + length;
+}
+
+static void assert_sax_matches_parse(char const *json) {
+    size_t const length = strlen(json);
+    sbJSON *expected = sbj_parse_with_length(json, length);
+    builder b;
+    bool parsed = false;
+
+    builder_init(&b, json, length);
+    parsed = sbj_parse_sax(json, length, &building_handler, &b);
+    if (expected == NULL) {
+        TEST_ASSERT_FALSE_MESSAGE(parsed, json);
+    } else {
+        TEST_ASSERT_TRUE_MESSAGE(parsed, json);
+        TEST_ASSERT_EQUAL_INT(0, b.depth);
+        TEST_ASSERT_TRUE_MESSAGE(sbj_compare(expected, b.root), json);
+    }
+
+    sbj_delete(b.root);
+    sbj_delete(expected);
+}
+
+static void sax_should_deliver_the_same_values_as_parse(void) {
+    static char const *const documents[] = {
+        "null",
+        " true ",
+        "false",
+        "-9223372036854775808",
+        "18446744073709551616",
+        "1.5e300",
+        "\"plain\"",
+        "\"esc\\t\\\"aped\\\" \\u00e4\\ud83d\\ude00\"",
+        "[]",
+        "{}",
+        "[1, 2.5, \"three\", [null, true], {\"a\": {}}]",
+        "{\"k\\\\ey\": [{\"x\": 1}, {\"y\": [2, 3]}], \"z\": \"end\"}",
+        "\xEF\xBB\xBF[\"bom\"]",
+        "[1] trailing",
+        /* invalid */
+        "",
+        "[1,",
+        "[1,]",
+        "{\"a\" 1}",
+        "{\"a\": 1,}",
+        "{1: 2}",
+        "\"bad escape \\x\"",
+        "{\"key \\q\": 1}",
+        "\"unterminated",
+        "[nul]",
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        assert_sax_matches_parse(documents[i]);
+    }
+}
+
+static void sax_should_parse_test_files(void) {
+    char name[] = "inputs/test?";
+    char digit;
+
+    for (digit = '1'; digit <= '9'; digit++) {
+        char *json = NULL;
+        name[sizeof(name) - 2] = digit;
+        json = read_file(name);
+        TEST_ASSERT_NOT_NULL(json);
+        assert_sax_matches_parse(json);
+        free(json);
+    }
+}
+
+static void sax_should_pass_plain_strings_without_copying(void) {
+    char const json[] = "[\"abc\", \"with\\nescape\", \"def\"]";
+    builder b;
+
+    builder_init(&b, json, sizeof(json) - 1);
+    TEST_ASSERT_TRUE(
+        sbj_parse_sax(json, sizeof(json) - 1, &building_handler, &b));
+    TEST_ASSERT_EQUAL_size_t(2, b.zero_copy_strings);
+    TEST_ASSERT_EQUAL_STRING("with\nescape",
+                             sbj_get_array_item(b.root, 1)->u.valuestring);
+
+    sbj_delete(b.root);
+}
+
+static void sax_should_stop_when_a_callback_fails(void) {
+    char const json[] = "[1, 2, 3, 4]";
+    builder b;
+
+    builder_init(&b, json, sizeof(json) - 1);
+    b.stop_after = 3;
+    TEST_ASSERT_FALSE(
+        sbj_parse_sax(json, sizeof(json) - 1, &building_handler, &b));
+    TEST_ASSERT_EQUAL_size_t(4, b.events);
+    TEST_ASSERT_EQUAL_INT32(2, sbj_get_array_size(b.root));
+
+    sbj_delete(b.root);
+}
+
+static bool sum_integer(void *user, int64_t number) {
+    *(int64_t *)user += number;
+    return true;
+}
+
+static void sax_should_allow_missing_callbacks(void) {
+    char const json[] = "{\"a\": [1, 2, {\"b\": 3}], \"c\": \"skip\\n\", "
+                        "\"d\": 4.5, \"e\": null, \"f\": 5}";
+    sbj_sax_handler handler;
+    int64_t sum = 0;
+
+    memset(&handler, 0, sizeof(handler));
+    handler.integer = sum_integer;
+    TEST_ASSERT_TRUE(sbj_parse_sax(json, sizeof(json) - 1, &handler, &sum));
+    TEST_ASSERT_EQUAL_INT64(11, sum);
+
+    TEST_ASSERT_FALSE(sbj_parse_sax("[\"\\x\"]", 6, &handler, &sum));
+    TEST_ASSERT_FALSE(sbj_parse_sax(NULL, 1, &handler, &sum));
+    TEST_ASSERT_FALSE(sbj_parse_sax(json, sizeof(json) - 1, NULL, &sum));
+}
+
+static void sax_should_respect_nesting_limit(void) {
+    char deep[SBJSON_NESTING_LIMIT + 2];
+    sbj_sax_handler handler;
+
+    memset(&handler, 0, sizeof(handler));
+    memset(deep, '[', sizeof(deep));
+    TEST_ASSERT_FALSE(sbj_parse_sax(deep, sizeof(deep), &handler, NULL));
+}
+
+static void sax_should_report_errors_like_parse(void) {
+    static char const empty[] = "";
+    static char const broken[] = "[1, x]";
+    sbj_sax_handler handler;
+
+    memset(&handler, 0, sizeof(handler));
+
+    TEST_ASSERT_NULL(sbj_parse_with_length(empty, 0));
+    TEST_ASSERT_EQUAL_PTR(empty, sbJSON_GetErrorPtr());
+    TEST_ASSERT_FALSE(sbj_parse_sax(empty, 0, &handler, NULL));
+    TEST_ASSERT_EQUAL_PTR(empty, sbJSON_GetErrorPtr());
+
+    TEST_ASSERT_NULL(sbj_parse_with_length(broken, sizeof(broken) - 1));
+    TEST_ASSERT_EQUAL_PTR(broken + 4, sbJSON_GetErrorPtr());
+    TEST_ASSERT_FALSE(
+        sbj_parse_sax(broken, sizeof(broken) - 1, &handler, NULL));
+    TEST_ASSERT_EQUAL_PTR(broken + 4, sbJSON_GetErrorPtr());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(sax_should_deliver_the_same_values_as_parse);
+    RUN_TEST(sax_should_parse_test_files);
+    RUN_TEST(sax_should_pass_plain_strings_without_copying);
+    RUN_TEST(sax_should_stop_when_a_callback_fails);
+    RUN_TEST(sax_should_allow_missing_callbacks);
+    RUN_TEST(sax_should_respect_nesting_limit);
+    RUN_TEST(sax_should_report_errors_like_parse);
+
+    return UNITY_END();
+}
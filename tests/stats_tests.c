@@ -0,0 +1,204 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* these tests cover the counting build whatever the configuration is */
+#ifndef SBJSON_STATS
+#define SBJSON_STATS
+#endif
+
+#include "common.h"
+#include "unity.h"
+
+static char const document[] =
+    "{\"a\":[1,2,{\"b\":\"xyz\"}],\"a longer key\":\"a longer string\"}";
+
+static void stats_should_count_parsing_and_deleting(void) {
+    sbj_stats stats;
+    sbJSON *tree = NULL;
+
+    sbj_reset_stats(NULL);
+    tree = sbj_parse(document);
+    TEST_ASSERT_NOT_NULL(tree);
+
+    TEST_ASSERT_TRUE(sbj_get_stats(NULL, &stats));
+    TEST_ASSERT_EQUAL_size_t(7, stats.nodes_allocated);
+    TEST_ASSERT_EQUAL_size_t(0, stats.nodes_freed);
+#ifndef SBJSON_COMPACT
+    /* "a", "b", "xyz", "a longer key" and "a longer string" */
+    TEST_ASSERT_EQUAL_size_t(2 + 2 + 4 + 13 + 16, stats.string_bytes);
+#else
+    /* only the long ones don't fit into the nodes */
+    TEST_ASSERT_TRUE(stats.string_bytes < 2 + 2 + 4 + 13 + 16);
+#endif
+    TEST_ASSERT_EQUAL_size_t(3, stats.max_depth);
+    TEST_ASSERT_EQUAL_size_t(strlen(document), stats.bytes_parsed);
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    TEST_ASSERT_TRUE(stats.parse_cycles > 0);
+#endif
+
+    sbj_delete(tree);
+    TEST_ASSERT_TRUE(sbj_get_stats(NULL, &stats));
+    TEST_ASSERT_EQUAL_size_t(7, stats.nodes_freed);
+
+    sbj_reset_stats(NULL);
+    TEST_ASSERT_TRUE(sbj_get_stats(NULL, &stats));
+    TEST_ASSERT_EQUAL_size_t(0, stats.nodes_allocated);
+    TEST_ASSERT_EQUAL_size_t(0, stats.bytes_parsed);
+}
+
+static void stats_should_count_print_buffer_growth(void) {
+    sbJSON *tree = sbj_parse(document);
+    sbj_stats stats;
+    char *printed = NULL;
+    size_t printed_length = 0;
+
+    TEST_ASSERT_NOT_NULL(tree);
+    sbj_reset_stats(NULL);
+
+    printed = sbj_print_buffered(tree, 1, false);
+    TEST_ASSERT_NOT_NULL(printed);
+    printed_length = strlen(printed);
+    TEST_ASSERT_TRUE(sbj_get_stats(NULL, &stats));
+    TEST_ASSERT_TRUE(stats.print_buffer_grows > 0);
+    TEST_ASSERT_TRUE(stats.print_buffer_bytes_copied > 0);
+    TEST_ASSERT_EQUAL_size_t(printed_length, stats.bytes_printed);
+    sbJSON_free(printed);
+
+    /* sized up front, nothing has to grow */
+    sbj_reset_stats(NULL);
+    printed = sbj_print(tree);
+    TEST_ASSERT_NOT_NULL(printed);
+    TEST_ASSERT_TRUE(sbj_get_stats(NULL, &stats));
+    TEST_ASSERT_EQUAL_size_t(0, stats.print_buffer_grows);
+    TEST_ASSERT_EQUAL_size_t(strlen(printed), stats.bytes_printed);
+    sbJSON_free(printed);
+
+    sbj_delete(tree);
+}
+
+static bool discard(void *user, char const *data, size_t length) {
+    (void)user;
+    (void)data;
+    (void)length;
+    return true;
+}
+
+static void stats_should_count_printing_to_a_sink(void) {
+    sbJSON *tree = sbj_parse(document);
+    char *printed = sbj_print_unformatted(tree);
+    sbj_stats stats;
+
+    TEST_ASSERT_NOT_NULL(printed);
+    sbj_reset_stats(NULL);
+    /* every chunk is passed on, the longest string fits into one */
+    TEST_ASSERT_TRUE(sbj_print_to_sink(tree, false, discard, NULL, 32));
+    TEST_ASSERT_TRUE(sbj_get_stats(NULL, &stats));
+    TEST_ASSERT_EQUAL_size_t(strlen(printed), stats.bytes_printed);
+    TEST_ASSERT_EQUAL_size_t(0, stats.print_buffer_grows);
+
+    sbJSON_free(printed);
+    sbj_delete(tree);
+}
+
+static void stats_should_be_kept_per_context(void) {
+    sbj_context ctx;
+    sbj_stats stats;
+    sbJSON *tree = NULL;
+    char *printed = NULL;
+
+    sbj_context_init(&ctx, NULL);
+    sbj_reset_stats(NULL);
+
+    tree = sbj_parse_ctx(&ctx, document, sizeof(document), NULL, true);
+    TEST_ASSERT_NOT_NULL(tree);
+    printed = sbj_print_ctx(&ctx, tree, false);
+    TEST_ASSERT_NOT_NULL(printed);
+    sbj_delete_ctx(&ctx, tree);
+
+    TEST_ASSERT_TRUE(sbj_get_stats(&ctx, &stats));
+    TEST_ASSERT_EQUAL_size_t(7, stats.nodes_allocated);
+    TEST_ASSERT_EQUAL_size_t(7, stats.nodes_freed);
+    TEST_ASSERT_EQUAL_size_t(3, stats.max_depth);
+    TEST_ASSERT_EQUAL_size_t(strlen(document), stats.bytes_parsed);
+    TEST_ASSERT_EQUAL_size_t(strlen(printed), stats.bytes_printed);
+
+    /* nothing went to the counters of the thread */
+    TEST_ASSERT_TRUE(sbj_get_stats(NULL, &stats));
+    TEST_ASSERT_EQUAL_size_t(0, stats.nodes_allocated);
+    TEST_ASSERT_EQUAL_size_t(0, stats.nodes_freed);
+    TEST_ASSERT_EQUAL_size_t(0, stats.bytes_parsed);
+
+    sbj_reset_stats(&ctx);
+    TEST_ASSERT_TRUE(sbj_get_stats(&ctx, &stats));
+    TEST_ASSERT_EQUAL_size_t(0, stats.nodes_allocated);
+    TEST_ASSERT_EQUAL_size_t(0, stats.max_depth);
+
+    sbJSON_free(printed);
+    sbj_context_destroy(&ctx);
+}
+
+static void stats_should_include_the_work_of_other_threads(void) {
+    size_t const count = 20000;
+    size_t const length = 1 + count * 8;
+    char *json = (char *)malloc(length + 1);
+    sbJSON *tree = NULL;
+    sbj_stats stats;
+    size_t i = 0;
+
+    /* big enough to be split between the threads */
+    TEST_ASSERT_NOT_NULL(json);
+    json[0] = '[';
+    for (i = 0; i < count; i++) {
+        memcpy(json + 1 + i * 8, "[12345],", 8);
+    }
+    json[length - 1] = ']';
+    json[length] = '\0';
+
+    sbj_reset_stats(NULL);
+    tree = sbj_parse_parallel(json, length, 4);
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_EQUAL_INT((int)count, sbj_get_array_size(tree));
+
+    TEST_ASSERT_TRUE(sbj_get_stats(NULL, &stats));
+    TEST_ASSERT_EQUAL_size_t(1 + 2 * count, stats.nodes_allocated);
+    TEST_ASSERT_EQUAL_size_t(2, stats.max_depth);
+
+    sbj_delete(tree);
+    free(json);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(stats_should_count_parsing_and_deleting);
+    RUN_TEST(stats_should_count_print_buffer_growth);
+    RUN_TEST(stats_should_count_printing_to_a_sink);
+    RUN_TEST(stats_should_be_kept_per_context);
+    RUN_TEST(stats_should_include_the_work_of_other_threads);
+
+    return UNITY_END();
+}
@@ -0,0 +1,242 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+/* feed json in pieces of chunk_size bytes, 0 feeds it all at once */
+static sbJSON *parse_in_chunks(char const *json, size_t length,
+                               size_t chunk_size) {
+    sbj_stream_parser *parser = sbj_stream_parser_new();
+    size_t offset = 0;
+
+    TEST_ASSERT_NOT_NULL(parser);
+    if (chunk_size == 0) {
+        chunk_size = length;
+    }
+    while (offset < length) {
+        size_t const piece = ((length - offset) < chunk_size)
+                                 ? (length - offset)
+                                 : chunk_size;
+        /* hand over a private copy to catch reads of old chunks */
+        char *copy = (char *)malloc(piece);
+        bool fed = false;
+
+        TEST_ASSERT_NOT_NULL(copy);
+        memcpy(copy, json + offset, piece);
+        fed = sbj_stream_feed(parser, copy, piece);
+        free(copy);
+        if (!fed) {
+            break;
+        }
+        offset += piece;
+    }
+
+    return sbj_stream_finish(parser);
+}
+
+/* split in every possible way, the result has to match sbj_parse_with_length */
+static void assert_stream_matches_parse(char const *json, size_t length) {
+    sbJSON *expected = sbj_parse_with_length(json, length);
+    char *expected_text =
+        (expected != NULL) ? sbj_print_unformatted(expected) : NULL;
+    size_t chunk_size;
+    size_t split;
+
+    for (chunk_size = 0; chunk_size <= 8; chunk_size++) {
+        sbJSON *actual = parse_in_chunks(json, length, chunk_size);
+        if (expected == NULL) {
+            TEST_ASSERT_NULL_MESSAGE(actual, json);
+            continue;
+        }
+        TEST_ASSERT_NOT_NULL_MESSAGE(actual, json);
+        {
+            char *actual_text = sbj_print_unformatted(actual);
+            TEST_ASSERT_EQUAL_STRING(expected_text, actual_text);
+            free(actual_text);
+        }
+        TEST_ASSERT_TRUE(sbj_compare(expected, actual));
+        sbj_delete(actual);
+    }
+
+    /* two chunks, split everywhere */
+    for (split = 0; split <= length; split++) {
+        sbj_stream_parser *parser = sbj_stream_parser_new();
+        sbJSON *actual = NULL;
+
+        if (sbj_stream_feed(parser, json, split)) {
+            sbj_stream_feed(parser, json + split, length - split);
+        }
+        actual = sbj_stream_finish(parser);
+        if (expected == NULL) {
+            TEST_ASSERT_NULL_MESSAGE(actual, json);
+        } else {
+            TEST_ASSERT_TRUE(sbj_compare(expected, actual));
+        }
+        sbj_delete(actual);
+    }
+
+    free(expected_text);
+    sbj_delete(expected);
+}
+
+static void stream_should_parse_like_parse_with_length(void) {
+    static char const *const documents[] = {
+        "null",
+        "true",
+        "false",
+        "0",
+        "-12345678901234567890",
+        "9223372036854775807",
+        "3.14159e-10 ",
+        "\"\"",
+        "\"hello\\n\\\"world\\\" \\u00e4\\ud83d\\ude00\"",
+        "[]",
+        "{}",
+        " [ 1 , 2.5 , -3e2 , \"four\" , null , true , false ] ",
+        "{\"a\": {\"b\": [[], {}, [{\"c\": \"d\"}]]}, \"e\\\\\": 1e5}",
+        "\xEF\xBB\xBF{\"bom\": true}",
+        "[1] trailing garbage",
+        "123abc",
+        "1e",
+        /* invalid */
+        "",
+        "   ",
+        "[",
+        "[1,",
+        "[1,]",
+        "{\"a\" 1}",
+        "{\"a\": 1,}",
+        "{1: 2}",
+        "[nul]",
+        "nul",
+        "tru",
+        "[1e]",
+        "[1 2]",
+        "[-]",
+        "\"unterminated",
+        "\"bad escape \\x\"",
+        "\"\\ud800\"",
+        "]",
+        "\xEF\xBB{}",
+        "[\xEF\xBB\xBF]",
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        assert_stream_matches_parse(documents[i], strlen(documents[i]));
+    }
+}
+
+static void stream_should_parse_test_files(void) {
+    char name[] = "inputs/test?";
+    char digit;
+
+    for (digit = '1'; digit <= '9'; digit++) {
+        char *json = NULL;
+        name[sizeof(name) - 2] = digit;
+        json = read_file(name);
+        TEST_ASSERT_NOT_NULL(json);
+        assert_stream_matches_parse(json, strlen(json));
+        free(json);
+    }
+}
+
+static void stream_should_parse_large_documents(void) {
+    sbJSON *array = sbj_create_array();
+    char *json = NULL;
+    sbJSON *parsed = NULL;
+    int i;
+
+    for (i = 0; i < 2000; i++) {
+        sbJSON *object = sbj_create_object();
+        sbj_add_integer_number_to_object(object, "id", i);
+        sbj_add_double_number_to_object(object, "value", i / 7.0);
+        sbj_add_string_to_object(object, "name", "a \"quoted\" name\\");
+        sbj_add_item_to_array(array, object);
+    }
+    json = sbj_print(array);
+    TEST_ASSERT_NOT_NULL(json);
+    /* integral doubles come back as integers, compare with a parsed copy */
+    sbj_delete(array);
+    array = sbj_parse(json);
+
+    parsed = parse_in_chunks(json, strlen(json), 4096);
+    TEST_ASSERT_TRUE(sbj_compare(array, parsed));
+    TEST_ASSERT_EQUAL_INT32(2000, parsed->child_count);
+    sbj_delete(parsed);
+
+    parsed = parse_in_chunks(json, strlen(json), 3);
+    TEST_ASSERT_TRUE(sbj_compare(array, parsed));
+    sbj_delete(parsed);
+
+    free(json);
+    sbj_delete(array);
+}
+
+static void stream_should_report_errors(void) {
+    sbj_stream_parser *parser = sbj_stream_parser_new();
+
+    TEST_ASSERT_TRUE(sbj_stream_feed(parser, "[1, 2", 5));
+    TEST_ASSERT_EQUAL_size_t(0, sbj_stream_error_position(parser));
+    TEST_ASSERT_FALSE(sbj_stream_feed(parser, ", x]", 4));
+    TEST_ASSERT_EQUAL_size_t(7, sbj_stream_error_position(parser));
+    /* stays failed */
+    TEST_ASSERT_FALSE(sbj_stream_feed(parser, "]", 1));
+    TEST_ASSERT_NULL(sbj_stream_finish(parser));
+
+    /* incomplete input */
+    parser = sbj_stream_parser_new();
+    TEST_ASSERT_TRUE(sbj_stream_feed(parser, "{\"a\": [", 7));
+    TEST_ASSERT_NULL(sbj_stream_finish(parser));
+
+    TEST_ASSERT_FALSE(sbj_stream_feed(NULL, "1", 1));
+    TEST_ASSERT_NULL(sbj_stream_finish(NULL));
+}
+
+static void stream_should_respect_nesting_limit(void) {
+    char deep[SBJSON_NESTING_LIMIT + 2];
+    sbj_stream_parser *parser = sbj_stream_parser_new();
+
+    memset(deep, '[', sizeof(deep));
+    TEST_ASSERT_FALSE(sbj_stream_feed(parser, deep, sizeof(deep)));
+    TEST_ASSERT_EQUAL_size_t(SBJSON_NESTING_LIMIT,
+                             sbj_stream_error_position(parser));
+    TEST_ASSERT_NULL(sbj_stream_finish(parser));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(stream_should_parse_like_parse_with_length);
+    RUN_TEST(stream_should_parse_test_files);
+    RUN_TEST(stream_should_parse_large_documents);
+    RUN_TEST(stream_should_report_errors);
+    RUN_TEST(stream_should_respect_nesting_limit);
+
+    return UNITY_END();
+}
@@ -0,0 +1,246 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static void assert_round_trip(char const *json) {
+    sbJSON *expected = sbj_parse(json);
+    sbj_tape *tape = NULL;
+    sbj_tape *copy = NULL;
+    sbJSON *tree = NULL;
+
+    tape = sbj_tape_parse(json, strlen(json) + sizeof(""));
+    if (expected == NULL) {
+        /* some test files are invalid on purpose */
+        TEST_ASSERT_NULL_MESSAGE(tape, json);
+        return;
+    }
+    TEST_ASSERT_NOT_NULL_MESSAGE(tape, json);
+    tree = sbj_tape_to_tree(tape, sbj_tape_root(tape));
+    TEST_ASSERT_TRUE_MESSAGE(sbj_compare(expected, tree), json);
+    sbj_delete(tree);
+
+    copy = sbj_tape_from_tree(expected);
+    TEST_ASSERT_NOT_NULL_MESSAGE(copy, json);
+    tree = sbj_tape_to_tree(copy, sbj_tape_root(copy));
+    TEST_ASSERT_TRUE_MESSAGE(sbj_compare(expected, tree), json);
+    sbj_delete(tree);
+
+    sbj_tape_free(copy);
+    sbj_tape_free(tape);
+    sbj_delete(expected);
+}
+
+static void tape_should_round_trip_documents(void) {
+    static char const *const documents[] = {
+        "null",
+        "true",
+        "false",
+        "0",
+        "-9223372036854775808",
+        "1.5",
+        "\"\"",
+        "\"unicode \\u00e4\\ud83d\\ude00 and \\\"escapes\\\"\"",
+        "[]",
+        "{}",
+        "[1, 2.5, \"three\", [null, true, false], {\"\": {}}]",
+        "{\"a\": {\"b\": [[], [[]]]}, \"b\": 2, \"c\\nd\": \"e\"}",
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        assert_round_trip(documents[i]);
+    }
+}
+
+static void tape_should_round_trip_test_files(void) {
+    char name[] = "inputs/test?";
+    char digit;
+
+    for (digit = '1'; digit <= '9'; digit++) {
+        char *json = NULL;
+        name[sizeof(name) - 2] = digit;
+        json = read_file(name);
+        TEST_ASSERT_NOT_NULL(json);
+        assert_round_trip(json);
+        free(json);
+    }
+}
+
+static void tape_should_navigate(void) {
+    char const json[] = "{\"skip\": [[1, [2]], {\"x\": 3}], "
+                        "\"n\": 42, \"d\": 0.5, \"s\": \"a\\u0000b\", "
+                        "\"t\": true, \"z\": null}";
+    sbj_tape *tape = sbj_tape_parse(json, sizeof(json));
+    size_t root = 0;
+    size_t member = 0;
+    size_t length = 0;
+    char const *string = NULL;
+
+    TEST_ASSERT_NOT_NULL(tape);
+    root = sbj_tape_root(tape);
+    TEST_ASSERT_EQUAL_INT(sbJSON_Object, sbj_tape_type(tape, root));
+    TEST_ASSERT_EQUAL_size_t(6, sbj_tape_count(tape, root));
+
+    /* the first member's subtree is skipped in one step */
+    member = sbj_tape_child(tape, root);
+    TEST_ASSERT_EQUAL_STRING("skip", sbj_tape_get_key(tape, member));
+    TEST_ASSERT_EQUAL_INT(sbJSON_Array, sbj_tape_type(tape, member));
+    TEST_ASSERT_EQUAL_size_t(2, sbj_tape_count(tape, member));
+    member = sbj_tape_next(tape, root, member);
+    TEST_ASSERT_EQUAL_STRING("n", sbj_tape_get_key(tape, member));
+    TEST_ASSERT_EQUAL_INT64(42, sbj_tape_get_integer(tape, member));
+
+    TEST_ASSERT_EQUAL_DOUBLE(
+        0.5, sbj_tape_get_double(tape, sbj_tape_get_member(tape, root, "d")));
+    TEST_ASSERT_EQUAL_INT64(
+        0, sbj_tape_get_integer(tape, sbj_tape_get_member(tape, root, "d")));
+    TEST_ASSERT_EQUAL_DOUBLE(
+        42, sbj_tape_get_double(tape, sbj_tape_get_member(tape, root, "n")));
+
+    member = sbj_tape_get_member(tape, root, "s");
+    string = sbj_tape_get_string(tape, member, &length);
+    TEST_ASSERT_EQUAL_size_t(3, length);
+    TEST_ASSERT_EQUAL_MEMORY("a\0b", string, 4);
+
+    TEST_ASSERT_TRUE(
+        sbj_tape_get_bool(tape, sbj_tape_get_member(tape, root, "t")));
+    TEST_ASSERT_EQUAL_INT(
+        sbJSON_Null,
+        sbj_tape_type(tape, sbj_tape_get_member(tape, root, "z")));
+    TEST_ASSERT_EQUAL_size_t(SBJ_TAPE_NONE,
+                             sbj_tape_get_member(tape, root, "missing"));
+    TEST_ASSERT_EQUAL_size_t(SBJ_TAPE_NONE,
+                             sbj_tape_get_member(tape, root, "x"));
+
+    /* iterating to the end */
+    member = sbj_tape_get_member(tape, root, "z");
+    TEST_ASSERT_EQUAL_size_t(SBJ_TAPE_NONE,
+                             sbj_tape_next(tape, root, member));
+
+    sbj_tape_free(tape);
+}
+
+static void tape_should_index_arrays(void) {
+    char const json[] = "[[1, [2, 3]], {\"a\": [4]}, \"five\", 6]";
+    sbj_tape *tape = sbj_tape_parse(json, sizeof(json));
+    size_t root = 0;
+    size_t inner = 0;
+
+    TEST_ASSERT_NOT_NULL(tape);
+    root = sbj_tape_root(tape);
+    TEST_ASSERT_EQUAL_size_t(4, sbj_tape_count(tape, root));
+    TEST_ASSERT_EQUAL_INT64(6,
+                            sbj_tape_get_integer(
+                                tape, sbj_tape_get_item(tape, root, 3)));
+    TEST_ASSERT_EQUAL_STRING(
+        "five", sbj_tape_get_string(tape, sbj_tape_get_item(tape, root, 2),
+                                    NULL));
+    TEST_ASSERT_EQUAL_size_t(SBJ_TAPE_NONE,
+                             sbj_tape_get_item(tape, root, 4));
+
+    inner = sbj_tape_get_item(tape, sbj_tape_get_item(tape, root, 0), 1);
+    TEST_ASSERT_EQUAL_INT64(3, sbj_tape_get_integer(
+                                   tape, sbj_tape_get_item(tape, inner, 1)));
+    TEST_ASSERT_EQUAL_size_t(SBJ_TAPE_NONE,
+                             sbj_tape_get_item(tape, inner, 2));
+
+    /* lookups on values of the wrong type */
+    TEST_ASSERT_EQUAL_size_t(SBJ_TAPE_NONE,
+                             sbj_tape_get_member(tape, root, "a"));
+    TEST_ASSERT_EQUAL_size_t(0, sbj_tape_count(
+                                    tape, sbj_tape_get_item(tape, root, 3)));
+    TEST_ASSERT_NULL(sbj_tape_get_key(tape, root));
+    TEST_ASSERT_NULL(sbj_tape_get_string(tape, root, NULL));
+
+    sbj_tape_free(tape);
+}
+
+static void tape_should_keep_number_types(void) {
+    sbJSON *array = sbj_create_array();
+    sbj_tape *tape = NULL;
+    sbJSON *tree = NULL;
+
+    sbj_add_item_to_array(array, sbj_create_double_number(2.0));
+    sbj_add_item_to_array(array, sbj_create_integer_number(2));
+    sbj_add_item_to_array(array, sbj_create_raw("{\"raw\": 1}"));
+
+    tape = sbj_tape_from_tree(array);
+    TEST_ASSERT_NOT_NULL(tape);
+    TEST_ASSERT_EQUAL_INT(sbJSON_Raw,
+                          sbj_tape_type(tape, sbj_tape_get_item(tape, 0, 2)));
+    tree = sbj_tape_to_tree(tape, sbj_tape_root(tape));
+    TEST_ASSERT_TRUE(sbj_compare(array, tree));
+    TEST_ASSERT_TRUE(sbj_get_array_item(tree, 0)->is_number_double);
+    TEST_ASSERT_FALSE(sbj_get_array_item(tree, 1)->is_number_double);
+
+    sbj_delete(tree);
+    sbj_tape_free(tape);
+    sbj_delete(array);
+}
+
+static void tape_should_reject_invalid_input(void) {
+    static char const *const documents[] = {
+        "", "[", "{\"a\":}", "[1,]", "\"\\x\"", "{\"a\" 1}",
+    };
+    sbJSON *array = sbj_create_array();
+    sbJSON *invalid = sbj_create_null();
+    size_t i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+        TEST_ASSERT_NULL_MESSAGE(
+            sbj_tape_parse(documents[i], strlen(documents[i]) + 1),
+            documents[i]);
+    }
+    TEST_ASSERT_NULL(sbj_tape_parse(NULL, 10));
+
+    invalid->type = sbJSON_Invalid;
+    sbj_add_item_to_array(array, invalid);
+    TEST_ASSERT_NULL(sbj_tape_from_tree(array));
+    TEST_ASSERT_NULL(sbj_tape_from_tree(NULL));
+
+    TEST_ASSERT_EQUAL_size_t(SBJ_TAPE_NONE, sbj_tape_root(NULL));
+    TEST_ASSERT_EQUAL_INT(sbJSON_Invalid, sbj_tape_type(NULL, 0));
+    TEST_ASSERT_NULL(sbj_tape_to_tree(NULL, 0));
+    sbj_tape_free(NULL);
+
+    sbj_delete(array);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(tape_should_round_trip_documents);
+    RUN_TEST(tape_should_round_trip_test_files);
+    RUN_TEST(tape_should_navigate);
+    RUN_TEST(tape_should_index_arrays);
+    RUN_TEST(tape_should_keep_number_types);
+    RUN_TEST(tape_should_reject_invalid_input);
+
+    return UNITY_END();
+}
@@ -0,0 +1,190 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+  Modifications (c) 2024 sbJSON Authors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "unity.h"
+
+static size_t allocations = 0;
+
+static void *counting_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+/* checks sbj_validate against parsing the input with the tree parser */
+static void assert_validate_matches_parse(char const *json, size_t length) {
+    char const *parse_end = NULL;
+    sbJSON *item = NULL;
+    bool expected = false;
+    size_t expected_offset = 0;
+    size_t error_offset = (size_t)-1;
+    bool valid = false;
+
+    item = sbj_parse_with_length_opts(json, length, &parse_end, false);
+    if (item != NULL) {
+        char const *end = parse_end;
+        while ((end < json + length) && (*(unsigned char const *)end <= 32)) {
+            end++;
+        }
+        expected = (end == json + length);
+        expected_offset = (end < json + length) ? (size_t)(end - json)
+                                                : length - 1;
+        sbj_delete(item);
+    } else if (length > 0) {
+        expected_offset = (size_t)(sbJSON_GetErrorPtr() - json);
+    }
+
+    valid = sbj_validate(json, length, &error_offset);
+    TEST_ASSERT_EQUAL_MESSAGE(expected, valid, json);
+    if (!valid) {
+        TEST_ASSERT_EQUAL_UINT64_MESSAGE(expected_offset, error_offset, json);
+    }
+}
+
+static void validate_should_accept_what_parse_accepts(void) {
+    static char const *const inputs[] = {
+        "null", "true", "false", " \t\r\n[] ", "{}", "0", "-0", "1.5e+10",
+        "1.", "-.5", "007", "1e", "1E-", "\"\"", "\"plain\"",
+        "\"\\b\\f\\n\\r\\t\\\"\\\\\\/\"", "\"\\u00e9\\uD83D\\uDE00\"",
+        "\"\\u0000\"", "[1, [2, [3]], {\"a\": {\"b\": null}}]",
+        "{\"a\":1,\"b\":[true,false],\"c\":\"x\"}", "\xEF\xBB\xBF[1]",
+        "[1]\n\n", "[1]\0",
+        /* invalid */
+        "", " ", "nul", "tru", "falsey", "[", "]", "[1,]", "[1 2]", "[,1]",
+        "{", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "{a:1}", "{\"a\" 1}",
+        "\"unterminated", "\"bad escape \\x\"", "\"\\u12\"",
+        "\"\\uDC00\"", "\"\\uD800\"", "\"\\uD800\\n\"", "\"\\uD800\\u0041\"",
+        "\"trailing backslash\\", "-", "+1", "-a", ".", "[1] x", "1 2",
+        "{\"a\":[1,{\"b\":[}]}", "[\"a\" : 1]"};
+    size_t i;
+
+    for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        assert_validate_matches_parse(inputs[i], strlen(inputs[i]));
+    }
+    /* the terminator is whitespace to the parser */
+    assert_validate_matches_parse("[1]", sizeof("[1]"));
+}
+
+static void validate_should_stop_at_the_length(void) {
+    char const json[] = "{\"key\": [1, 2, 3]}";
+    size_t length;
+
+    for (length = 0; length <= sizeof(json) - 1; length++) {
+        assert_validate_matches_parse(json, length);
+    }
+}
+
+static void validate_should_check_test_files(void) {
+    char name[] = "inputs/test?";
+    char digit;
+
+    for (digit = '1'; digit <= '9'; digit++) {
+        char *json = NULL;
+        size_t length = 0;
+        size_t position = 0;
+
+        name[sizeof(name) - 2] = digit;
+        json = read_file(name);
+        TEST_ASSERT_NOT_NULL(json);
+        length = strlen(json);
+        assert_validate_matches_parse(json, length);
+        /* and every truncation of the file */
+        for (position = 0; position < length; position += 7) {
+            assert_validate_matches_parse(json, position);
+        }
+        free(json);
+    }
+}
+
+static void validate_should_respect_nesting_limit(void) {
+    char deep[2 * (SBJSON_NESTING_LIMIT + 1)];
+    size_t error_offset = 0;
+
+    /* exactly at the limit */
+    memset(deep, '[', SBJSON_NESTING_LIMIT);
+    memset(deep + SBJSON_NESTING_LIMIT, ']', SBJSON_NESTING_LIMIT);
+    TEST_ASSERT_TRUE(
+        sbj_validate(deep, 2 * SBJSON_NESTING_LIMIT, &error_offset));
+
+    /* one level deeper */
+    memset(deep, '[', SBJSON_NESTING_LIMIT + 1);
+    memset(deep + SBJSON_NESTING_LIMIT + 1, ']', SBJSON_NESTING_LIMIT + 1);
+    assert_validate_matches_parse(deep, sizeof(deep));
+    TEST_ASSERT_FALSE(sbj_validate(deep, sizeof(deep), &error_offset));
+    TEST_ASSERT_EQUAL_UINT64(SBJSON_NESTING_LIMIT, error_offset);
+}
+
+static void validate_should_not_allocate_or_set_the_error(void) {
+    char const valid[] = "{\"a\":[\"\\uD83D\\uDE00 escaped\",1.5,null]}";
+    char const invalid[] = "{\"a\":[\"\\uDE00\"]}";
+    sbJSON_Hooks hooks = {counting_malloc, free};
+    sbJSON *item = NULL;
+    char const *parse_error = NULL;
+    size_t error_offset = 0;
+
+    /* leave an error behind */
+    TEST_ASSERT_NULL(sbj_parse("[1,"));
+    parse_error = sbJSON_GetErrorPtr();
+    TEST_ASSERT_NOT_NULL(parse_error);
+
+    sbJSON_InitHooks(&hooks);
+    allocations = 0;
+    TEST_ASSERT_TRUE(sbj_validate(valid, sizeof(valid) - 1, &error_offset));
+    TEST_ASSERT_FALSE(
+        sbj_validate(invalid, sizeof(invalid) - 1, &error_offset));
+    TEST_ASSERT_EQUAL_UINT64(7, error_offset);
+    TEST_ASSERT_FALSE(sbj_validate(invalid, sizeof(invalid) - 1, NULL));
+    TEST_ASSERT_EQUAL_UINT64(0, allocations);
+    TEST_ASSERT_TRUE(parse_error == sbJSON_GetErrorPtr());
+
+    item = sbj_parse(valid);
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_TRUE(allocations > 0);
+    sbj_delete(item);
+    sbJSON_InitHooks(NULL);
+}
+
+static void validate_should_reject_null_input(void) {
+    size_t error_offset = 1;
+
+    TEST_ASSERT_FALSE(sbj_validate(NULL, 5, &error_offset));
+    TEST_ASSERT_EQUAL_UINT64(0, error_offset);
+    TEST_ASSERT_FALSE(sbj_validate("[]", 0, NULL));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(validate_should_accept_what_parse_accepts);
+    RUN_TEST(validate_should_stop_at_the_length);
+    RUN_TEST(validate_should_check_test_files);
+    RUN_TEST(validate_should_respect_nesting_limit);
+    RUN_TEST(validate_should_not_allocate_or_set_the_error);
+    RUN_TEST(validate_should_reject_null_input);
+
+    return UNITY_END();
+}